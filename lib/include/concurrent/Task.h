@@ -0,0 +1,89 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * A cooperative task with its own stack. The stack is supplied by you and is usually
+   * a static array. Tasks are run by the TaskScheduler and give up the CPU only when
+   * they call TaskScheduler::yield(), directly or through one of the library calls that
+   * would otherwise busy-wait.
+   *
+   * The stack must be large enough for the deepest call chain in the task plus one
+   * saved context (36 bytes, 100 bytes if the FPU is in use). Tasks are not preempted
+   * so there is no interrupt frame to allow for beyond what the IRQ handlers themselves use.
+   *
+   *   static uint32_t netStack[256];
+   *   static Task netTask(netStack,sizeof(netStack),netTaskFunction,&net);
+   *   TaskScheduler::addTask(netTask);
+   */
+
+  class Task {
+
+    public:
+
+      /**
+       * The task entry point. The task is finished when this function returns.
+       */
+
+      typedef void (*TaskFunction)(void *param);
+
+
+      /**
+       * Possible task states
+       */
+
+      enum class State : uint8_t {
+        READY,          ///< runnable
+        FINISHED        ///< the function has returned
+      };
+
+    protected:
+      uint32_t *_sp;
+      TaskFunction _function;
+      void *_param;
+      Task *_next;
+      volatile State _state;
+
+      friend class TaskScheduler;
+
+    protected:
+      constexpr Task();
+
+    public:
+      Task(void *stack,uint32_t stackSize,TaskFunction function,void *param=nullptr);
+
+      bool isFinished() const;
+  };
+
+
+  /**
+   * Protected constructor used for the context of the main program. It has no stack of
+   * its own because it's already running on the main stack. It's constexpr so that the
+   * main task is constant-initialised and usable by static constructors that yield.
+   */
+
+  constexpr Task::Task()
+    : _sp(nullptr),
+      _function(nullptr),
+      _param(nullptr),
+      _next(this),
+      _state(State::READY) {
+  }
+
+
+  /**
+   * Check if the task function has returned
+   * @return true if finished
+   */
+
+  inline bool Task::isFinished() const {
+    return _state==State::FINISHED;
+  }
+}
@@ -0,0 +1,129 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * Round-robin cooperative scheduler. The code running in main() is a task like any
+   * other so the scheduler needs no start-up call: add your tasks and then carry on in
+   * main() calling yield() (or any library call that yields) in your main loop.
+   *
+   * yield() switches to the next ready task. It is safe to call at any time: it returns
+   * immediately if no tasks have been added or if it's called from an interrupt handler,
+   * so library code can call it from inside wait loops without knowing whether the
+   * application uses tasks. Blocking library calls such as TcpConnection::send(),
+   * TcpConnectionArray::wait(), SdioDmaSdCard and the ARP resolver yield while they wait.
+   *
+   * waitFor() is the general purpose "awaitable": it yields until a condition becomes true
+   * or a timeout expires.
+   */
+
+  class TaskScheduler {
+
+    protected:
+      static Task _mainTask;
+      static Task *_current;
+
+    protected:
+      static void taskEntry();
+
+      friend class Task;
+
+    public:
+      static void addTask(Task& task);
+      static void yield();
+      static void sleep(uint32_t millis);
+
+      template<class TPredicate>
+      static bool waitFor(TPredicate predicate,uint32_t timeoutMillis=0);
+
+      static Task& getCurrentTask();
+      static bool hasTasks();
+      static bool inHandlerMode();
+  };
+
+
+  /**
+   * Yield until the predicate returns true or the timeout expires
+   * @param predicate A callable returning bool, e.g. a lambda that tests a flag
+   * @param timeoutMillis The timeout in milliseconds, zero to wait forever
+   * @return true if the predicate became true, false if we timed out
+   */
+
+  template<class TPredicate>
+  inline bool TaskScheduler::waitFor(TPredicate predicate,uint32_t timeoutMillis) {
+
+    uint32_t start;
+
+    start=MillisecondTimer::millis();
+
+    while(!predicate()) {
+
+      if(timeoutMillis && MillisecondTimer::hasTimedOut(start,timeoutMillis))
+        return false;
+
+      yield();
+    }
+
+    return true;
+  }
+
+
+  /**
+   * Yield for at least the given number of milliseconds
+   * @param millis The number of milliseconds
+   */
+
+  inline void TaskScheduler::sleep(uint32_t millis) {
+
+    uint32_t start;
+
+    start=MillisecondTimer::millis();
+
+    while(!MillisecondTimer::hasTimedOut(start,millis))
+      yield();
+  }
+
+
+  /**
+   * Get the currently running task
+   * @return The current task
+   */
+
+  inline Task& TaskScheduler::getCurrentTask() {
+    return *_current;
+  }
+
+
+  /**
+   * Check if there is anything to switch to
+   * @return true if there are tasks other than the current one
+   */
+
+  inline bool TaskScheduler::hasTasks() {
+    return _current->_next!=_current;
+  }
+
+
+  /**
+   * Check if we are running in an interrupt handler. Context switches are not possible
+   * in handler mode.
+   * @return true if in handler mode
+   */
+
+  inline bool TaskScheduler::inHandlerMode() {
+
+    uint32_t ipsr;
+
+    // the F1 CMSIS does not have __get_IPSR()
+
+    asm volatile("mrs %0, ipsr" : "=r" (ipsr));
+    return ipsr!=0;
+  }
+}
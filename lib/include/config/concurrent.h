@@ -25,3 +25,8 @@
 #if !defined(STM32PLUS_F0)
   #include "concurrent/Mutex.h"
 #endif
+
+// cooperative tasks
+
+#include "concurrent/Task.h"
+#include "concurrent/TaskScheduler.h"
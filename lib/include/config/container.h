@@ -0,0 +1,25 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+/**
+ * @file
+ * General purpose containers that avoid the per-node allocations and small fixed growth
+ * steps of the bundled STL: an open addressing hash map (heap-backed or fixed capacity)
+ * and a vector with inline storage.
+ */
+
+#include <iterator>
+#include <new>
+#include <memory>
+#include <utility>
+#include <functional>
+#include <stl_hash_fun.h>
+
+#include "memory/flat_hash_map.h"
+#include "memory/small_vector.h"
@@ -213,3 +213,4 @@
 #include "dma/features/DmaMemoryCopyFeature.h"
 #include "dma/features/DmaMemoryFillFeature.h"
 #include "dma/features/PwmFadeTimerDmaFeature.h"
+#include "dma/features/TimerInputCaptureDmaFeature.h"
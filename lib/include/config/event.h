@@ -27,8 +27,22 @@
 
 #include "event/slot.h"
 #include "event/signal.h"
+#include "event/fixed_signal.h"
+#include "event/static_signal.h"
 
-// macros for declaring the event signature and source class
+// macros for declaring the event signature and source class. Define STM32PLUS_FIXED_EVENT_CAPACITY
+// to the maximum number of subscribers per event source to have all the library's event sources
+// use the heap-free fixed_signal instead of the slist-based signal. The busiest source sets the
+// capacity: the network stack's notification source has a subscriber for most of the layers plus
+// one for each TCP server and connection. A subscriber that doesn't fit sets the errorProvider.
 
+#ifdef STM32PLUS_FIXED_EVENT_CAPACITY
+#define DECLARE_EVENT_SIGNATURE(name,sig) typedef wink::slot<sig> name##EventSourceSlot; typedef wink::fixed_signal<name##EventSourceSlot,STM32PLUS_FIXED_EVENT_CAPACITY> name##EventSourceType
+#else
 #define DECLARE_EVENT_SIGNATURE(name,sig) typedef wink::slot<sig> name##EventSourceSlot; typedef wink::signal<name##EventSourceSlot> name##EventSourceType
+#endif
+
+// macro for declaring a fixed capacity event signature for an individual event source
+
+#define DECLARE_FIXED_EVENT_SIGNATURE(name,sig,capacity) typedef wink::slot<sig> name##EventSourceSlot; typedef wink::fixed_signal<name##EventSourceSlot,capacity> name##EventSourceType
 #define DECLARE_EVENT_SOURCE(name) name##EventSourceType name##EventSender
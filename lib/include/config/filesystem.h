@@ -9,11 +9,12 @@
 /**
  * @file
  * Include this config file to get access to all the filesytem functionality. At present this grants you access
- * to the FAT16 and FAT32 functionality.
+ * to the FAT16, FAT32 and exFAT functionality.
  */
 
-// filesystem depends on iterator, stream, device, timing, string
+// filesystem depends on event, iterator, stream, device, timing, string
 
+#include "config/event.h"
 #include "config/iterator.h"
 #include "config/stream.h"
 #include "config/device.h"
@@ -34,6 +35,7 @@
 #include "filesystem/Mbr.h"
 #include "filesystem/TokenisedPathname.h"
 #include "filesystem/FileSystem.h"
+#include "filesystem/VolumeManager.h"
 
 #include "filesystem/fat/BootSector16.h"
 #include "filesystem/fat/BootSector32.h"
@@ -46,6 +48,8 @@
 #include "filesystem/fat/DirectoryEntryWithLocation.h"
 #include "filesystem/fat/FilenameHandler.h"
 #include "filesystem/fat/DirectoryEntryIterator.h"
+#include "filesystem/fat/DirectorySectorCache.h"
+#include "filesystem/fat/DirectorySectorBatch.h"
 
 #include "filesystem/fat/ClusterChainIterator.h"
 #include "filesystem/fat/FatFileInformation.h"
@@ -61,6 +65,8 @@
 
 #include "filesystem/fat/FatFile.h"
 #include "filesystem/fat/FatFileSystem.h"
+#include "filesystem/fat/FatJournal.h"
+#include "filesystem/fat/FatAppendFile.h"
 #include "filesystem/fat/FatFileSystemFormatter.h"
 
 #include "filesystem/fat/Fat32FsInfo.h"
@@ -71,3 +77,12 @@
 #include "filesystem/fat/Fat16FileSystemFormatter.h"
 #include "filesystem/fat/Fat16RootDirectoryEntryIterator.h"
 #include "filesystem/fat/FatDirectoryIterator.h"
+
+#include "filesystem/exfat/ExFatBootSector.h"
+#include "filesystem/exfat/ExFatDirectoryEntry.h"
+#include "filesystem/exfat/ExFatEntrySet.h"
+#include "filesystem/exfat/ExFatFileInformation.h"
+#include "filesystem/exfat/ExFatFileSystem.h"
+#include "filesystem/exfat/ExFatFile.h"
+#include "filesystem/exfat/ExFatDirectoryIterator.h"
+#include "filesystem/exfat/ExFatFileSystemFormatter.h"
@@ -13,18 +13,20 @@
  * available. DMA and interrupt-driven access are both supported.
  */
 
-// i2c depends on rcc, gpio, event, interrupts, dma, timing
+// i2c depends on rcc, gpio, event, interrupts, dma, timing, concurrent
 
 #include "config/rcc.h"
 #include "config/gpio.h"
 #include "config/event.h"
 #include "config/dma.h"
 #include "config/timing.h"
+#include "config/concurrent.h"
 
 // generic peripheral includes
 
 #include "i2c/I2CPinInitialiser.h"
 #include "i2c/I2CEventSource.h"
+#include "i2c/I2CTransaction.h"
 
 #if defined(STM32PLUS_F0)
   #include "i2c/f0/I2C.h"
@@ -45,6 +47,9 @@
 
 #if defined(STM32PLUS_F1) || defined(STM32PLUS_F4)
 #include "i2c/features/f1,f4/I2CSlaveFeature.h"
+#include "i2c/features/f1,f4/I2CMasterTransactionEngine.h"
+#include "i2c/features/f1,f4/I2CMasterInterruptFeature.h"
+#include "i2c/features/f1,f4/I2CMasterDmaAdapter.h"
 #endif
 
 // includes for the alternate function mappings
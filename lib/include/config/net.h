@@ -43,6 +43,9 @@
 
 #include "net/EtherType.h"
 #include "net/NetUtil.h"
+#include "net/NetView.h"
+#include "net/NetOptionIterator.h"
+#include "net/NetLatencyHistogram.h"
 #include "net/datalink/DatalinkChecksum.h"
 #include "net/NetBuffer.h"
 #include "net/NetEventDescriptor.h"
@@ -80,6 +83,8 @@
 
 #include "net/datalink/MacAddress.h"
 #include "net/datalink/EthernetTransmitRequestEvent.h"
+#include "net/datalink/EthernetBatchTransmitRequestEvent.h"
+#include "net/datalink/DatalinkMulticastFilterEvent.h"
 #include "net/datalink/EthernetFrameData.h"
 #include "net/datalink/EthernetTaggedFrameData.h"
 #include "net/datalink/EthernetSnapFrameData.h"
@@ -121,9 +126,12 @@
 #include "net/network/IpProtocol.h"
 #include "net/network/ip/InternetChecksum.h"
 #include "net/network/ip/IpTransmitRequestEvent.h"
+#include "net/network/ip/IpLargeSendRequestEvent.h"
 #include "net/network/arp/ArpMappingRequestEvent.h"
+#include "net/network/arp/ArpPendingFrameEvent.h"
 
 #include "net/network/ip/IpAddressMappingEvent.h"
+#include "net/network/ip/IpMulticastMembershipEvent.h"
 
 #include "net/network/arp/ArpOperation.h"
 #include "net/network/arp/ArpFrameData.h"
@@ -135,6 +143,7 @@
 #include "net/network/ip/IpPacketHeader.h"
 #include "net/network/ip/IpPacket.h"
 #include "net/network/ip/IpPacketEvent.h"
+#include "net/network/ip/IpChecksumMode.h"
 #include "net/network/ip/features/IpFragmentedPacket.h"
 #include "net/network/ip/features/IpPacketReassemblerFeature.h"
 #include "net/network/ip/features/IpPacketFragmentFeature.h"
@@ -152,6 +161,9 @@
 #include "net/transport/icmp/IcmpErrorPacket.h"
 #include "net/transport/icmp/Icmp.h"
 
+#include "net/transport/igmp/IgmpPacket.h"
+#include "net/transport/igmp/Igmp.h"
+
 #include "net/transport/udp/UdpDatagram.h"
 #include "net/transport/udp/UdpDatagramEvent.h"
 #include "net/transport/udp/Udp.h"
@@ -171,6 +183,8 @@
 #include "net/transport/tcp/TcpConnectionReleasedEvent.h"
 #include "net/transport/tcp/TcpConnectionClosedEvent.h"
 #include "net/transport/tcp/TcpConnectionDataReadyEvent.h"
+#include "net/transport/tcp/TcpDelayedAckTimerEvent.h"
+#include "net/transport/tcp/TcpHalfOpenConnection.h"
 #include "net/transport/tcp/TcpReceiveBuffer.h"
 #include "net/transport/tcp/TcpConnection.h"
 #include "net/transport/tcp/TcpClientConnection.h"
@@ -182,6 +196,7 @@
 #include "net/transport/tcp/Tcp.h"
 #include "net/transport/tcp/TcpWaitState.h"
 #include "net/transport/tcp/TcpConnectionArray.h"
+#include "net/transport/tcp/TcpConnectionPool.h"
 #include "net/transport/tcp/TcpTextLineReceiver.h"
 #include "net/transport/tcp/TcpOutputStreamOfStreams.h"
 #include "net/transport/tcp/TcpInputStream.h"
@@ -191,6 +206,7 @@
 // application layer
 
 #include "net/application/dns/DnsPacketHeader.h"
+#include "net/application/dns/DnsName.h"
 #include "net/application/dns/DnsQueryPacket.h"
 #include "net/application/dns/DnsReplyPacket.h"
 #include "net/application/dns/DnsCache.h"
@@ -203,6 +219,7 @@
 #include "net/application/ping/Ping.h"
 
 #include "net/application/llip/LinkLocalIp.h"
+#include "net/application/statistics/StatisticsServer.h"
 
 #include "net/application/ApplicationLayer.h"
 
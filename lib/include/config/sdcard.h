@@ -25,6 +25,7 @@
 #include "config/nvic.h"
 #include "config/dma.h"
 #include "config/timing.h"
+#include "config/concurrent.h"
 
 // use interrupts
 
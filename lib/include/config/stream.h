@@ -29,6 +29,7 @@
 #include "stream/BufferedInputOutputStream.h"
 #include "stream/ByteArrayOutputStream.h"
 #include "stream/ByteArrayInputStream.h"
+#include "stream/ChunkedOutputStream.h"
 #include "stream/CircularBufferInputOutputStream.h"
 #include "stream/LzgDecompressionInputStream.h"
 #include "stream/ConnectedInputOutputStream.h"
@@ -64,6 +64,10 @@
 #include "timer/features/TimerEncoderFeature.h"
 #include "timer/features/TimerBreakFeature.h"
 
+// input capture processing
+
+#include "timer/InputCaptureProcessor.h"
+
 // generic peripheral includes
 
 #include "timer/TimerPeripheral.h"
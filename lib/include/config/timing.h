@@ -26,3 +26,4 @@
 #include "timing/NullTimeProvider.h"
 #include "timing/MicrosecondDelay.h"
 #include "timing/MillisecondTimer.h"
+#include "timing/MonotonicTimer.h"
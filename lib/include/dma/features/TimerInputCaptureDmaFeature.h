@@ -0,0 +1,270 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * Capture register sizes. Timers with a 32-bit counter have 32-bit capture registers and
+   * must be transferred as words or the upper half of each capture is lost.
+   */
+
+  template<bool T32Bit>
+  struct TimerInputCaptureSize {
+    typedef uint16_t CaptureType;
+
+    enum {
+      MEMORY_WORD_SIZE = DMA_MemoryDataSize_HalfWord,
+      PERIPHERAL_WORD_SIZE = DMA_PeripheralDataSize_HalfWord
+    };
+  };
+
+  template<>
+  struct TimerInputCaptureSize<true> {
+    typedef uint32_t CaptureType;
+
+    enum {
+      MEMORY_WORD_SIZE = DMA_MemoryDataSize_Word,
+      PERIPHERAL_WORD_SIZE = DMA_PeripheralDataSize_Word
+    };
+  };
+
+
+  /**
+   * Work out the counter width of the timer that owns a capture register. TIM2 and TIM5 on
+   * the F4 and TIM2 on the F0 are 32-bit, all the others are 16-bit.
+   * @tparam TRegisterAddress The CCR register address
+   */
+
+  template<uint32_t TRegisterAddress>
+  struct TimerInputCaptureWidth {
+    enum {
+#if defined(STM32PLUS_F4)
+      IS_32BIT = (TRegisterAddress & ~0x3FFUL)==TIM2_BASE || (TRegisterAddress & ~0x3FFUL)==TIM5_BASE
+#elif defined(STM32PLUS_F0)
+      IS_32BIT = (TRegisterAddress & ~0x3FFUL)==TIM2_BASE
+#else
+      IS_32BIT = false
+#endif
+    };
+  };
+
+
+  /**
+   * Stream input capture values into a circular buffer by DMA. Each capture event on the
+   * timer channel triggers a DMA transfer of the CCR register so the CPU does no work per
+   * edge. The application drains the buffer in blocks, typically from the DMA half/complete
+   * interrupts or from the main loop, and passes the blocks to an InputCaptureProcessor.
+   *
+   * The consumer must drain the buffer at least once per buffer-length of edges. There is
+   * no hardware indication that the DMA has lapped the reader.
+   *
+   * The capture width follows the timer's counter width. Captures from 32-bit timers are
+   * transferred and stored as uint32_t, all others as uint16_t. CaptureType names the type
+   * that the buffer must be declared with.
+   *
+   *   Timer2Channel1DmaChannel<TimerInputCaptureDmaFeature<Timer2Ccr1DmaPeripheralInfo,TIM_DMA_CC1>> dma;
+   *   dma.beginCapture(timer,captures,sizeof(captures)/sizeof(captures[0]));
+   *
+   * @tparam TPeripheralInfo The CCR register peripheral info, e.g. Timer2Ccr1DmaPeripheralInfo
+   * @tparam TTimerEvent The capture event that triggers the transfer, e.g. TIM_DMA_CC1
+   * @tparam TPriority The DMA priority, default is high
+   */
+
+#if defined(STM32PLUS_F4)
+
+  // the FIFO would hold back the most recent captures so it's disabled
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority=DMA_Priority_High>
+  class TimerInputCaptureDmaFeature : public TimerDmaFeature<TPeripheralInfo,TTimerEvent,TPriority,DMA_Mode_Circular,DMA_FIFOMode_Disable> {
+    typedef TimerDmaFeature<TPeripheralInfo,TTimerEvent,TPriority,DMA_Mode_Circular,DMA_FIFOMode_Disable> BaseType;
+    typedef TimerInputCaptureSize<TimerInputCaptureWidth<TPeripheralInfo::REGISTER_ADDRESS>::IS_32BIT> SizeType;
+
+#else
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority=DMA_Priority_High>
+  class TimerInputCaptureDmaFeature : public TimerDmaFeature<TPeripheralInfo,TTimerEvent,TPriority,DMA_Mode_Circular> {
+    typedef TimerDmaFeature<TPeripheralInfo,TTimerEvent,TPriority,DMA_Mode_Circular> BaseType;
+    typedef TimerInputCaptureSize<TimerInputCaptureWidth<TPeripheralInfo::REGISTER_ADDRESS>::IS_32BIT> SizeType;
+
+#endif
+
+    public:
+      typedef typename SizeType::CaptureType CaptureType;
+
+    protected:
+      CaptureType *_buffer;
+      uint16_t _bufferSize;
+      uint16_t _readPos;
+
+    public:
+      TimerInputCaptureDmaFeature(Dma& dma);
+
+      void beginCapture(Timer& timer,CaptureType *buffer,uint16_t bufferSize);
+      void stopCapture(Timer& timer);
+
+      uint16_t getWritePosition();
+      uint16_t available();
+      uint16_t peek(const CaptureType *& block);
+      void consume(uint16_t count);
+      uint16_t read(CaptureType *dest,uint16_t maxCount);
+  };
+
+
+  /**
+   * Constructor. The base class sets half-word transfers from the peripheral info and
+   * they're widened here if the timer is 32-bit.
+   * @param dma The DMA channel
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority>
+  inline TimerInputCaptureDmaFeature<TPeripheralInfo,TTimerEvent,TPriority>::TimerInputCaptureDmaFeature(Dma& dma)
+    : BaseType(dma),
+      _buffer(nullptr),
+      _bufferSize(0),
+      _readPos(0) {
+
+    this->_init.DMA_PeripheralDataSize=SizeType::PERIPHERAL_WORD_SIZE;
+    this->_init.DMA_MemoryDataSize=SizeType::MEMORY_WORD_SIZE;
+  }
+
+
+  /**
+   * Start streaming captures into the circular buffer. The timer channel must already
+   * be configured for input capture and the timer must be running or about to be enabled.
+   * @param timer The timer
+   * @param buffer The buffer
+   * @param bufferSize The buffer size in captures
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority>
+  inline void TimerInputCaptureDmaFeature<TPeripheralInfo,TTimerEvent,TPriority>::beginCapture(Timer& timer,CaptureType *buffer,uint16_t bufferSize) {
+
+    _buffer=buffer;
+    _bufferSize=bufferSize;
+    _readPos=0;
+
+    this->beginReadByTimer(timer,buffer,bufferSize);
+  }
+
+
+  /**
+   * Stop streaming. Captures already in the buffer remain available.
+   * @param timer The timer
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority>
+  inline void TimerInputCaptureDmaFeature<TPeripheralInfo,TTimerEvent,TPriority>::stopCapture(Timer& timer) {
+    TIM_DMACmd(timer,TTimerEvent,DISABLE);
+  }
+
+
+  /**
+   * Get the index in the buffer that the DMA will write next
+   * @return The write position
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority>
+  inline uint16_t TimerInputCaptureDmaFeature<TPeripheralInfo,TTimerEvent,TPriority>::getWritePosition() {
+
+    uint16_t remaining;
+
+    // the counter reloads to the buffer size in circular mode so it's never zero for long
+
+    remaining=DMA_GetCurrDataCounter(this->_dma);
+    return remaining==0 ? 0 : _bufferSize-remaining;
+  }
+
+
+  /**
+   * Get the number of captures waiting to be read
+   * @return The number of captures
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority>
+  inline uint16_t TimerInputCaptureDmaFeature<TPeripheralInfo,TTimerEvent,TPriority>::available() {
+
+    uint16_t writePos;
+
+    writePos=getWritePosition();
+
+    if(writePos>=_readPos)
+      return writePos-_readPos;
+
+    return _bufferSize-_readPos+writePos;
+  }
+
+
+  /**
+   * Get a pointer to the next contiguous block of unread captures without copying. There
+   * may be more captures after a wrap so call peek() again after consume().
+   * @param[out] block Set to the start of the block
+   * @return The number of captures in the block
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority>
+  inline uint16_t TimerInputCaptureDmaFeature<TPeripheralInfo,TTimerEvent,TPriority>::peek(const CaptureType *& block) {
+
+    uint16_t writePos;
+
+    writePos=getWritePosition();
+    block=_buffer+_readPos;
+
+    if(writePos>=_readPos)
+      return writePos-_readPos;
+
+    return _bufferSize-_readPos;
+  }
+
+
+  /**
+   * Mark captures as read
+   * @param count The number of captures to skip over
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority>
+  inline void TimerInputCaptureDmaFeature<TPeripheralInfo,TTimerEvent,TPriority>::consume(uint16_t count) {
+
+    _readPos+=count;
+
+    if(_readPos>=_bufferSize)
+      _readPos-=_bufferSize;
+  }
+
+
+  /**
+   * Copy out captures
+   * @param dest Where to copy to
+   * @param maxCount The maximum number to copy
+   * @return The number copied
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority>
+  inline uint16_t TimerInputCaptureDmaFeature<TPeripheralInfo,TTimerEvent,TPriority>::read(CaptureType *dest,uint16_t maxCount) {
+
+    const CaptureType *block;
+    uint16_t count,total;
+
+    total=0;
+
+    while(maxCount>0 && (count=peek(block))>0) {
+
+      if(count>maxCount)
+        count=maxCount;
+
+      memcpy(dest,block,count*sizeof(CaptureType));
+      consume(count);
+
+      dest+=count;
+      total+=count;
+      maxCount-=count;
+    }
+
+    return total;
+  }
+}
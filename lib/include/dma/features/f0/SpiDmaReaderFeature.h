@@ -27,7 +27,8 @@ namespace stm32plus {
 
     public:
       SpiDmaReaderFeature(Dma& dma);
-      void beginRead(void *dest,uint32_t count);
+      void beginRead(void *dest,uint32_t count,bool incrementMemory=true);
+      void stopRead();
   };
 
 
@@ -70,10 +71,12 @@ namespace stm32plus {
    *
    * @param[in] dest The destination of the transfer.
    * @param[in] count The number of units (bytes or halfwords) to transfer.
+   * @param[in] incrementMemory false to store every received unit at dest, for example to discard
+   *   what the slave clocks out while we are writing.
    */
 
   template<class TSpi,uint32_t TPriority,bool TByteSize>
-  inline void SpiDmaReaderFeature<TSpi,TPriority,TByteSize>::beginRead(void *dest,uint32_t count) {
+  inline void SpiDmaReaderFeature<TSpi,TPriority,TByteSize>::beginRead(void *dest,uint32_t count,bool incrementMemory) {
 
     DMA_Channel_TypeDef *peripheralAddress;
 
@@ -81,6 +84,7 @@ namespace stm32plus {
 
     _init.DMA_MemoryBaseAddr=reinterpret_cast<uint32_t>(dest);
     _init.DMA_BufferSize=count;
+    _init.DMA_MemoryInc=incrementMemory ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
 
     // this class is always in a hierarchy with DmaPeripheral
 
@@ -92,4 +96,25 @@ namespace stm32plus {
     DMA_Init(peripheralAddress,&_init);
     DMA_Cmd(peripheralAddress,ENABLE);
   }
+
+
+  /**
+   * Abandon a transfer that is in progress, for example because the matching transmit failed.
+   * The status flags are cleared so that no interrupt is raised for it.
+   */
+
+  template<class TSpi,uint32_t TPriority,bool TByteSize>
+  inline void SpiDmaReaderFeature<TSpi,TPriority,TByteSize>::stopRead() {
+
+    DMA_Channel_TypeDef *peripheralAddress;
+
+    // the channel stops immediately
+
+    peripheralAddress=_dma;
+    DMA_Cmd(peripheralAddress,DISABLE);
+
+    _dma.clearCompleteFlag();
+    _dma.clearHalfCompleteFlag();
+    _dma.clearErrorFlag();
+  }
 }
@@ -24,7 +24,7 @@ namespace stm32plus {
 
     public:
       SpiDmaWriterFeature(Dma& dma);
-      void beginWrite(const void *source,uint32_t count);
+      void beginWrite(const void *source,uint32_t count,bool incrementMemory=true);
   };
 
 
@@ -67,10 +67,12 @@ namespace stm32plus {
    *
    * @param[in] source memory address of the source data bytes.
    * @param[in] count The number of bytes to transfer.
+   * @param[in] incrementMemory false to send the unit at source count times, for example a 0xFF
+   *   filler that clocks in a read.
    */
 
   template<class TSpi,uint32_t TPriority,bool TByteSize>
-  inline void SpiDmaWriterFeature<TSpi,TPriority,TByteSize>::beginWrite(const void *source,uint32_t count) {
+  inline void SpiDmaWriterFeature<TSpi,TPriority,TByteSize>::beginWrite(const void *source,uint32_t count,bool incrementMemory) {
 
     DMA_Channel_TypeDef *peripheralAddress;
 
@@ -78,6 +80,7 @@ namespace stm32plus {
 
     _init.DMA_MemoryBaseAddr=reinterpret_cast<uint32_t>(source);
     _init.DMA_BufferSize=count;
+    _init.DMA_MemoryInc=incrementMemory ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
 
     // this class is always in a hierarchy with DmaPeripheral
 
@@ -27,7 +27,8 @@ namespace stm32plus {
 
     public:
       SpiDmaReaderFeature(Dma& dma);
-      void beginRead(void *dest,uint32_t count);
+      void beginRead(void *dest,uint32_t count,bool incrementMemory=true);
+      void stopRead();
   };
 
 
@@ -76,10 +77,12 @@ namespace stm32plus {
    *
    * @param[in] dest The destination of the transfer.
    * @param[in] count The number of bytes to transfer.
+   * @param[in] incrementMemory false to store every received unit at dest, for example to discard
+   *   what the slave clocks out while we are writing.
    */
 
   template<class TSpi,uint32_t TPriority,bool TByteSize,uint32_t TFifoMode>
-  inline void SpiDmaReaderFeature<TSpi,TPriority,TByteSize,TFifoMode>::beginRead(void *dest,uint32_t count) {
+  inline void SpiDmaReaderFeature<TSpi,TPriority,TByteSize,TFifoMode>::beginRead(void *dest,uint32_t count,bool incrementMemory) {
 
     DMA_Stream_TypeDef *peripheralAddress;
 
@@ -87,6 +90,7 @@ namespace stm32plus {
 
     _init.DMA_Memory0BaseAddr=reinterpret_cast<uint32_t>(dest);
     _init.DMA_BufferSize=count;
+    _init.DMA_MemoryInc=incrementMemory ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
 
     // this class is always in a hierarchy with DmaPeripheral
 
@@ -98,4 +102,27 @@ namespace stm32plus {
     DMA_Init(peripheralAddress,&_init);
     DMA_Cmd(peripheralAddress,ENABLE);
   }
+
+
+  /**
+   * Abandon a transfer that is in progress, for example because the matching transmit failed.
+   * The status flags are cleared so that no interrupt is raised for it.
+   */
+
+  template<class TSpi,uint32_t TPriority,bool TByteSize,uint32_t TFifoMode>
+  inline void SpiDmaReaderFeature<TSpi,TPriority,TByteSize,TFifoMode>::stopRead() {
+
+    DMA_Stream_TypeDef *peripheralAddress;
+
+    // the stream finishes the current unit before it stops and sets the complete flag when it does
+
+    peripheralAddress=_dma;
+
+    DMA_Cmd(peripheralAddress,DISABLE);
+    while(DMA_GetCmdStatus(peripheralAddress)==ENABLE);
+
+    _dma.clearCompleteFlag();
+    _dma.clearHalfCompleteFlag();
+    _dma.clearErrorFlag();
+  }
 }
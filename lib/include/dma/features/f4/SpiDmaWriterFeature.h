@@ -27,7 +27,7 @@ namespace stm32plus {
 
     public:
       SpiDmaWriterFeature(Dma& dma);
-      void beginWrite(const void *source,uint32_t count);
+      void beginWrite(const void *source,uint32_t count,bool incrementMemory=true);
   };
 
 
@@ -76,10 +76,12 @@ namespace stm32plus {
    *
    * @param[in] source memory address of the source data bytes.
    * @param[in] count The number of bytes to transfer.
+   * @param[in] incrementMemory false to send the unit at source count times, for example a 0xFF
+   *   filler that clocks in a read.
    */
 
   template<class TSpi,uint32_t TPriority,bool TByteSize,uint32_t TFifoMode>
-  inline void SpiDmaWriterFeature<TSpi,TPriority,TByteSize,TFifoMode>::beginWrite(const void *source,uint32_t count) {
+  inline void SpiDmaWriterFeature<TSpi,TPriority,TByteSize,TFifoMode>::beginWrite(const void *source,uint32_t count,bool incrementMemory) {
 
     DMA_Stream_TypeDef *peripheralAddress;
 
@@ -87,6 +89,7 @@ namespace stm32plus {
 
     _init.DMA_Memory0BaseAddr=reinterpret_cast<uint32_t>(source);
     _init.DMA_BufferSize=count;
+    _init.DMA_MemoryInc=incrementMemory ? DMA_MemoryInc_Enable : DMA_MemoryInc_Disable;
 
     // this class is always in a hierarchy with DmaPeripheral
 
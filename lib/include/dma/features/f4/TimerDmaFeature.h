@@ -15,7 +15,7 @@
 namespace stm32plus {
 
   /**
-   * Template definition of a DMA feature used for transferring data to a peripheral
+   * Template definition of a DMA feature used for transferring data to or from a peripheral
    * where that transfer is regulated by events from a timer.
    *
    * @tparam TPeripheralInfo a helper class used to describe key data about the target peripheral
@@ -32,6 +32,7 @@ namespace stm32plus {
       TimerDmaFeature(Dma& dma);
 
       void beginWriteByTimer(Timer& timer,const void *source,uint32_t count);
+      void beginReadByTimer(Timer& timer,void *dest,uint32_t count);
   };
 
   /**
@@ -80,6 +81,42 @@ namespace stm32plus {
 
     _init.DMA_Memory0BaseAddr=reinterpret_cast<uint32_t>(source);
     _init.DMA_BufferSize=count;
+    _init.DMA_DIR=DMA_DIR_MemoryToPeripheral;
+
+    // set the peripheral address from the overloaded operator
+
+    peripheralAddress=_dma;
+
+    // connect the timer to its associated DMA channel
+
+    TIM_DMACmd(timer,TTimerEvent,ENABLE);
+
+    // disable and then re-enable DMA
+
+    DMA_Cmd(peripheralAddress,DISABLE);
+    DMA_Init(peripheralAddress,&_init);
+    DMA_Cmd(peripheralAddress,ENABLE);
+  }
+
+
+  /**
+   * Start a transfer of data from the peripheral controlled by timer. This is how input
+   * capture values are streamed out of a CCR register into memory.
+   *
+   * @param[in] dest memory address of the destination buffer.
+   * @param[in] count The number of words/half-words/bytes to transfer.
+   */
+
+  template<class TPeripheralInfo,uint16_t TTimerEvent,uint32_t TPriority,uint32_t TDmaMode,uint32_t TFifoMode>
+  inline void TimerDmaFeature<TPeripheralInfo,TTimerEvent,TPriority,TDmaMode,TFifoMode>::beginReadByTimer(Timer& timer,void *dest,uint32_t count) {
+
+    DMA_Stream_TypeDef *peripheralAddress;
+
+    // set up the parameters for this transfer
+
+    _init.DMA_Memory0BaseAddr=reinterpret_cast<uint32_t>(dest);
+    _init.DMA_BufferSize=count;
+    _init.DMA_DIR=DMA_DIR_PeripheralToMemory;
 
     // set the peripheral address from the overloaded operator
 
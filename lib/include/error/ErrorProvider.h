@@ -110,7 +110,13 @@ namespace stm32plus {
         ERROR_PROVIDER_USB_IN_ENDPOINT                            = 71,
         ERROR_PROVIDER_INTERNAL_FLASH                             = 72,
         ERROR_PROVIDER_INTERNAL_FLASH_SETTINGS                    = 73,
-        ERROR_PROVIDER_CAN                                        = 74
+        ERROR_PROVIDER_CAN                                        = 74,
+        ERROR_PROVIDER_VOLUME_MANAGER                             = 75,
+        ERROR_PROVIDER_FAT_JOURNAL                                = 76,
+        ERROR_PROVIDER_EXFAT_FILESYSTEM                           = 77,
+        ERROR_PROVIDER_EXFAT_FILESYSTEM_FORMATTER                 = 78,
+        ERROR_PROVIDER_NET_TCP_CONNECTION_POOL                    = 79,
+        ERROR_PROVIDER_EVENT                                      = 80
       };
 
     public:
@@ -0,0 +1,145 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace wink {
+
+  /**
+   * A signal with a fixed number of subscriber slots held inline in the object. Nothing is
+   * allocated on the heap and raising an event is a walk over a contiguous array, which makes
+   * this a good fit for event sources that are raised from interrupt handlers.
+   *
+   * Subscribers are called in descending priority order. Subscribers with equal priority are
+   * called most-recently-inserted first, which is the order that wink::signal uses, so this
+   * class is a drop-in replacement for it.
+   *
+   * If the signal is raised from an IRQ then insert and remove subscribers with that IRQ
+   * disabled because the array is compacted in place.
+   *
+   * Inserting into a full signal sets ERROR_PROVIDER_EVENT/E_TOO_MANY_SUBSCRIBERS in the
+   * errorProvider and returns false. Callers that can fail should pass that on.
+   *
+   * @tparam Slot The wink::slot type
+   * @tparam Capacity The maximum number of subscribers
+   */
+
+  template<class Slot,uint8_t Capacity=4>
+  struct fixed_signal {
+
+    public:
+      typedef Slot slot_type;
+
+      enum {
+        DEFAULT_PRIORITY = 0
+      };
+
+      /**
+       * Error codes
+       */
+
+      enum {
+        E_TOO_MANY_SUBSCRIBERS = 1    ///< all Capacity slots are in use
+      };
+
+    protected:
+      slot_type _slots[Capacity];
+      int8_t _priorities[Capacity];
+      uint8_t _count;
+
+    public:
+      fixed_signal()
+        : _count(0) {
+      }
+
+      /**
+       * Connect a slot to the signal
+       * @param slot The slot to connect
+       * @param priority Higher priority subscribers are called first
+       * @return false if all the slots are in use. The errorProvider is set.
+       */
+
+      bool insertSubscriber(const slot_type& slot,int8_t priority=DEFAULT_PRIORITY) {
+
+        uint8_t i,pos;
+
+        if(_count==Capacity)
+          return stm32plus::errorProvider.set(stm32plus::ErrorProvider::ERROR_PROVIDER_EVENT,E_TOO_MANY_SUBSCRIBERS);
+
+        // the new slot goes in front of the first existing slot with the same or lower priority
+
+        for(pos=0;pos<_count && _priorities[pos]>priority;pos++);
+
+        for(i=_count;i>pos;i--) {
+          _slots[i]=_slots[i-1];
+          _priorities[i]=_priorities[i-1];
+        }
+
+        _slots[pos]=slot;
+        _priorities[pos]=priority;
+        _count++;
+
+        return true;
+      }
+
+      /**
+       * Disconnect a slot from the signal
+       * @param slot The slot to disconnect
+       * @return false if it was not connected
+       */
+
+      bool removeSubscriber(const slot_type& slot) {
+
+        uint8_t i;
+
+        for(i=0;i<_count;i++) {
+
+          if(_slots[i]==slot) {
+
+            for(_count--;i<_count;i++) {
+              _slots[i]=_slots[i+1];
+              _priorities[i]=_priorities[i+1];
+            }
+            return true;
+          }
+        }
+        return false;
+      }
+
+      /**
+       * Call each connected slot in priority order
+       * @param args The arguments to pass to the slots
+       */
+
+      template<class... Args>
+      void raiseEvent(Args&&... args) const {
+
+        const slot_type *slot,*last;
+
+        for(slot=_slots,last=_slots+_count;slot!=last;slot++)
+          (*slot)(args...);
+      }
+
+      /**
+       * Get the number of connected slots
+       * @return The subscriber count
+       */
+
+      uint8_t size() const {
+        return _count;
+      }
+
+      /**
+       * Check if there's room for another subscriber
+       * @return true if full
+       */
+
+      bool full() const {
+        return _count==Capacity;
+      }
+  };
+}
@@ -52,14 +52,16 @@ namespace wink {
 
       /// Connects a slot to the signal
       /// \param slot The slot you wish to connect
+      /// \return always true. It's there so callers can check it the same way as fixed_signal.
       /// \see bind To bind a slot to a function
 
-      void insertSubscriber(const slot_type& slot) {
+      bool insertSubscriber(const slot_type& slot) {
 
         if(_slots.size()==0)
           _firstSlot=slot;
 
         _slots.push_front(slot);
+        return true;
       }
 
       /// Disconnects a slot from the signal
@@ -0,0 +1,53 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace wink {
+
+  /**
+   * A signal whose subscribers are fixed at compile time. Use it for components that are
+   * statically wired together: there is no storage, no registration and the compiler can
+   * inline each handler directly into the code that raises the event.
+   *
+   * Subscribers are called in the order that they appear in the template parameter list,
+   * so list them in priority order. For example:
+   *
+   *   void onDmaA(DmaEventType det);
+   *   void onDmaB(DmaEventType det);
+   *
+   *   typedef wink::static_signal<void (*)(DmaEventType),&onDmaA,&onDmaB> MyDmaSignal;
+   *   MyDmaSignal::raiseEvent(DmaEventType::EVENT_COMPLETE);
+   *
+   * @tparam FnPtr The function pointer type of the subscribers
+   * @tparam Fns The subscribers
+   */
+
+  template<class FnPtr,FnPtr... Fns>
+  struct static_signal {
+
+    /**
+     * Call each subscriber in turn
+     * @param args The arguments to pass to the subscribers
+     */
+
+    template<class... Args>
+    static void raiseEvent(Args&&... args) {
+      int expander[]={ 0,(Fns(args...),0)... };
+      (void)expander;
+    }
+
+    /**
+     * Get the number of subscribers
+     * @return The subscriber count
+     */
+
+    static constexpr uint8_t size() {
+      return sizeof...(Fns);
+    }
+  };
+}
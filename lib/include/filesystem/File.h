@@ -47,7 +47,13 @@ namespace stm32plus {
         E_END_OF_FILE,
 
         /// The file is unusable because it contains a bad cluster
-        E_BAD_CLUSTER
+        E_BAD_CLUSTER,
+
+        /// Another handle has this file open for writing
+        E_FILE_LOCKED,
+
+        /// The operation is not supported on this type of file
+        E_NOT_SUPPORTED
       };
 
     public:
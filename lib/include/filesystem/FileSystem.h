@@ -50,7 +50,10 @@ namespace stm32plus {
         E_FILE_EXISTS,
 
         /// invalid block size
-        E_INVALID_BLOCK_SIZE
+        E_INVALID_BLOCK_SIZE,
+
+        /// The file is open and cannot be deleted
+        E_FILE_IN_USE
       };
 
 
@@ -63,18 +66,24 @@ namespace stm32plus {
         Fat16,
 
         /// FAT32 filesystem
-        Fat32
+        Fat32,
+
+        /// exFAT filesystem
+        ExFat
       };
 
     public:
       static bool getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,FileSystem*& newFileSystem);
+      static bool getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,uint32_t firstSectorIndex,FileSystem*& newFileSystem);
 
       virtual ~FileSystem();
 
       const TimeProvider& getTimeProvider() const;
 
       virtual bool readSector(uint32_t sectorIndex,void *buffer);
+      virtual bool readSectors(uint32_t sectorIndex,void *buffer,uint32_t count);
       virtual bool writeSector(uint32_t sectorIndex,void *buffer);
+      virtual bool writeSectors(uint32_t sectorIndex,void *buffer,uint32_t count);
 
       /**
        * Get the first sector index
@@ -0,0 +1,88 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * @brief Mounts all the volumes on a block device.
+   *
+   * FileSystem::getInstance() only mounts the first partition. This class mounts every usable
+   * primary partition in the MBR, or the whole device if it has no MBR. Volumes are numbered
+   * from zero in partition table order. Pathnames passed to resolve() and openFile() may be
+   * prefixed with a volume number and a colon, e.g. "1:/logs/today.csv". Pathnames without a
+   * prefix refer to volume zero.
+   *
+   * The volumes are deleted with the manager. All files and iterators obtained from them must
+   * be deleted first.
+   */
+
+  class VolumeManager {
+
+    public:
+
+      /**
+       * Error codes
+       */
+
+      enum {
+        /// No volume could be mounted
+        E_NO_VOLUMES=1,
+
+        /// The volume number is out of range
+        E_INVALID_VOLUME
+      };
+
+      /// The maximum number of volumes, one per MBR primary partition
+      static const uint8_t MAX_VOLUMES=4;
+
+    protected:
+      FileSystem *_volumes[MAX_VOLUMES];
+      uint8_t _volumeCount;
+
+    protected:
+      static bool isMountablePartition(const MbrPartition& partition);
+
+    public:
+      VolumeManager();
+      ~VolumeManager();
+
+      VolumeManager(const VolumeManager&)=delete;
+      VolumeManager& operator=(const VolumeManager&)=delete;
+
+      bool mount(BlockDevice& blockDevice,const TimeProvider& timeProvider);
+      void unmount();
+
+      uint8_t getVolumeCount() const;
+      FileSystem& getVolume(uint8_t index) const;
+
+      bool resolve(const char *pathname,FileSystem*& fs,const char*& volumePathname) const;
+      bool openFile(const char *pathname,File*& newFile) const;
+  };
+
+
+  /**
+   * Get the number of mounted volumes
+   * @return The volume count
+   */
+
+  inline uint8_t VolumeManager::getVolumeCount() const {
+    return _volumeCount;
+  }
+
+
+  /**
+   * Get a volume
+   * @param[in] index The volume number, must be less than getVolumeCount()
+   * @return The file system on the volume
+   */
+
+  inline FileSystem& VolumeManager::getVolume(uint8_t index) const {
+    return *_volumes[index];
+  }
+}
@@ -0,0 +1,85 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * @brief exFAT main boot sector. The members of this structure are packed so they can be
+     * exactly mapped on to the disk structure.
+     */
+
+    struct ExFatBootSector {
+
+      /// Jump instruction to boot code: 0xEB 0x76 0x90.
+      uint8_t JumpBoot[3];
+
+      /// "EXFAT   ". This is how an exFAT volume is recognised.
+      char FileSystemName[8];
+
+      /// Must be zero. Overlaps the FAT BPB so that FAT drivers reject the volume.
+      uint8_t MustBeZero[53];
+
+      /// Sector offset of the volume from the start of the media. Zero if not known.
+      uint64_t PartitionOffset;
+
+      /// Size of the volume in sectors.
+      uint64_t VolumeLength;
+
+      /// Sector offset of the first FAT from the start of the volume.
+      uint32_t FatOffset;
+
+      /// Length of each FAT in sectors.
+      uint32_t FatLength;
+
+      /// Sector offset of the cluster heap from the start of the volume.
+      uint32_t ClusterHeapOffset;
+
+      /// Number of clusters in the cluster heap.
+      uint32_t ClusterCount;
+
+      /// First cluster of the root directory.
+      uint32_t FirstClusterOfRootDirectory;
+
+      /// Volume serial number.
+      uint32_t VolumeSerialNumber;
+
+      /// Revision, major in the high byte. Must be 1.00.
+      uint16_t FileSystemRevision;
+
+      /// Bit 0: active FAT, bit 1: volume dirty, bit 2: media failure. Not included in the boot checksum.
+      uint16_t VolumeFlags;
+
+      /// log2 of the bytes per sector: 9 to 12.
+      uint8_t BytesPerSectorShift;
+
+      /// log2 of the sectors per cluster. The cluster size may not exceed 32Mb.
+      uint8_t SectorsPerClusterShift;
+
+      /// Number of FATs, 1 or 2. 2 is only used by TexFAT.
+      uint8_t NumberOfFats;
+
+      /// INT 13h drive number.
+      uint8_t DriveSelect;
+
+      /// Percentage of the cluster heap that's allocated, or 0xFF if unknown. Not included in the boot checksum.
+      uint8_t PercentInUse;
+
+      /// Reserved.
+      uint8_t Reserved[7];
+
+      /// Boot code.
+      uint8_t BootCode[390];
+
+      /// 0xAA55
+      uint16_t BootSignature;
+
+    } __attribute__ ((packed));
+  }
+}
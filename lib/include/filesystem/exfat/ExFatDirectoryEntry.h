@@ -0,0 +1,154 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * @brief File directory entry (type 0x85). The first entry of a file or directory entry set.
+     */
+
+    struct ExFatFileEntry {
+      uint8_t EntryType;
+      uint8_t SecondaryCount;             ///< number of entries that follow in the set
+      uint16_t SetChecksum;               ///< checksum of the whole set, see ExFatFileSystem::calculateEntryChecksum
+      uint16_t FileAttributes;            ///< FileInformation::FileAttributes
+      uint16_t Reserved1;
+      uint32_t CreateTimestamp;           ///< FAT date in the high word, FAT time in the low word
+      uint32_t LastModifiedTimestamp;
+      uint32_t LastAccessedTimestamp;
+      uint8_t Create10msIncrement;
+      uint8_t LastModified10msIncrement;
+      uint8_t CreateUtcOffset;
+      uint8_t LastModifiedUtcOffset;
+      uint8_t LastAccessedUtcOffset;
+      uint8_t Reserved2[7];
+    } __attribute__ ((packed));
+
+
+    /**
+     * @brief Stream extension directory entry (type 0xC0). Always the second entry in a file set.
+     */
+
+    struct ExFatStreamEntry {
+      uint8_t EntryType;
+      uint8_t GeneralSecondaryFlags;      ///< FLAG_ALLOCATION_POSSIBLE, FLAG_NO_FAT_CHAIN
+      uint8_t Reserved1;
+      uint8_t NameLength;                 ///< characters in the name
+      uint16_t NameHash;                  ///< hash of the up-cased name
+      uint16_t Reserved2;
+      uint64_t ValidDataLength;           ///< bytes that have been written
+      uint32_t Reserved3;
+      uint32_t FirstCluster;
+      uint64_t DataLength;                ///< file length, or allocated size for directories
+    } __attribute__ ((packed));
+
+
+    /**
+     * @brief File name directory entry (type 0xC1). Holds up to 15 UTF-16 characters.
+     */
+
+    struct ExFatFileNameEntry {
+      uint8_t EntryType;
+      uint8_t GeneralSecondaryFlags;
+      uint16_t FileName[15];
+    } __attribute__ ((packed));
+
+
+    /**
+     * @brief Allocation bitmap directory entry (type 0x81), found in the root directory.
+     */
+
+    struct ExFatBitmapEntry {
+      uint8_t EntryType;
+      uint8_t BitmapFlags;                ///< bit 0 selects the bitmap for the first or second FAT
+      uint8_t Reserved[18];
+      uint32_t FirstCluster;
+      uint64_t DataLength;
+    } __attribute__ ((packed));
+
+
+    /**
+     * @brief Up-case table directory entry (type 0x82), found in the root directory.
+     */
+
+    struct ExFatUpcaseEntry {
+      uint8_t EntryType;
+      uint8_t Reserved1[3];
+      uint32_t TableChecksum;
+      uint8_t Reserved2[12];
+      uint32_t FirstCluster;
+      uint64_t DataLength;
+    } __attribute__ ((packed));
+
+
+    /**
+     * @brief Volume label directory entry (type 0x83), found in the root directory.
+     */
+
+    struct ExFatVolumeLabelEntry {
+      uint8_t EntryType;
+      uint8_t CharacterCount;
+      uint16_t VolumeLabel[11];
+      uint8_t Reserved[8];
+    } __attribute__ ((packed));
+
+
+    /**
+     * @brief A 32 byte exFAT directory entry
+     */
+
+    union ExFatDirectoryEntry {
+
+      /**
+       * Entry types. Bit 7 is the in-use flag, clearing it deletes the entry.
+       */
+
+      enum {
+        TYPE_END_OF_DIRECTORY = 0x00,
+        TYPE_IN_USE           = 0x80,
+        TYPE_BITMAP           = 0x81,
+        TYPE_UPCASE           = 0x82,
+        TYPE_VOLUME_LABEL     = 0x83,
+        TYPE_FILE             = 0x85,
+        TYPE_STREAM           = 0xC0,
+        TYPE_FILE_NAME        = 0xC1
+      };
+
+      /**
+       * Stream extension flags
+       */
+
+      enum {
+        FLAG_ALLOCATION_POSSIBLE = 0x01,
+        FLAG_NO_FAT_CHAIN        = 0x02    ///< the clusters are contiguous and the FAT is not used
+      };
+
+      /**
+       * Sizes
+       */
+
+      enum {
+        NAME_CHARS_PER_ENTRY = 15,
+        MAX_NAME_LENGTH      = 255,
+        MAX_SECONDARY_COUNT  = 18
+      };
+
+      uint8_t EntryType;
+      uint8_t Raw[32];
+
+      ExFatFileEntry File;
+      ExFatStreamEntry Stream;
+      ExFatFileNameEntry FileName;
+      ExFatBitmapEntry Bitmap;
+      ExFatUpcaseEntry Upcase;
+      ExFatVolumeLabelEntry VolumeLabel;
+    };
+  }
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * @brief Iterate over the files and directories in an exFAT directory.
+     *
+     * exFAT directories do not have "." and ".." entries. Entry sets with a bad checksum
+     * are skipped, as are the bitmap, up-case and volume label entries in the root.
+     */
+
+    class ExFatDirectoryIterator : public DirectoryIterator, public ExFatFileInformation {
+
+      protected:
+        ExFatFileSystem& _fs;
+        ExFatDirectory _dir;
+        ExFatEntrySet _set;
+        uint32_t _nextIndex;        // index of the entry after the current set
+
+      public:
+        ExFatDirectoryIterator(ExFatFileSystem& fs,const ExFatDirectory& dir);
+
+        /**
+         * Virtual destructor. Do nothing.
+         */
+
+        virtual ~ExFatDirectoryIterator() {
+        }
+
+        const ExFatEntrySet& getEntrySet() const;
+
+        // overrides from Iterator<FileInformation>
+
+        virtual bool next() override;
+        virtual const FileInformation& current() override;
+
+        // overrides from DirectoryIterator
+
+        virtual bool getSubdirectoryIterator(DirectoryIterator *& newIterator) override;
+        virtual bool isCurrentDirectory() override;
+        virtual bool isParentDirectory() override;
+        virtual bool moveTo(const char *filename) override;
+        virtual bool openFile(File*& newFile) override;
+    };
+
+
+    /**
+     * Get the entry set of the current file or directory
+     * @return The entry set.
+     */
+
+    inline const ExFatEntrySet& ExFatDirectoryIterator::getEntrySet() const {
+      return _set;
+    }
+  }
+}
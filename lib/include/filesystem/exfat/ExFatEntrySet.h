@@ -0,0 +1,108 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * @brief The location of a directory's entries on the volume.
+     *
+     * Directories are addressed by entry index. The last cluster visited is remembered so
+     * that walking a FAT chained directory from start to end does not traverse the chain
+     * for every entry.
+     */
+
+    struct ExFatDirectory {
+      uint32_t firstCluster;
+      uint32_t length;                    ///< allocated size in bytes, or zero to follow the FAT chain to its end
+      bool contiguous;                    ///< true if the FAT is not used (NoFatChain)
+      uint32_t cachedClusterIndex;        ///< index within the directory of cachedCluster
+      uint32_t cachedCluster;             ///< zero if nothing is cached
+
+      void set(uint32_t first,uint32_t len,bool contig);
+    };
+
+
+    /**
+     * @brief A file or directory entry set: the file entry, the stream extension and the name.
+     *
+     * The set is held in memory with the location of its first entry so that it can be
+     * written back. The name is held as 8-bit characters, non-ASCII characters become '?'.
+     */
+
+    struct ExFatEntrySet {
+      ExFatFileEntry file;
+      ExFatStreamEntry stream;
+      ExFatDirectory parent;              ///< the directory that holds the set
+      uint32_t entryIndex;                ///< index of the file entry within the parent
+      char name[ExFatDirectoryEntry::MAX_NAME_LENGTH+1];
+
+      bool isDirectory() const;
+      bool isContiguous() const;
+      uint32_t getFirstCluster() const;
+      void getDirectory(ExFatDirectory& dir) const;
+    };
+
+
+    /**
+     * Set the location of the directory entries
+     * @param[in] first The first cluster.
+     * @param[in] len The allocated length in bytes, or zero to follow the FAT chain.
+     * @param[in] contig true if the directory is contiguous and the FAT is not used.
+     */
+
+    inline void ExFatDirectory::set(uint32_t first,uint32_t len,bool contig) {
+      firstCluster=first;
+      length=len;
+      contiguous=contig;
+      cachedClusterIndex=0;
+      cachedCluster=0;
+    }
+
+
+    /**
+     * Check if this set describes a directory
+     * @return true if it's a directory
+     */
+
+    inline bool ExFatEntrySet::isDirectory() const {
+      return (file.FileAttributes & FileInformation::ATTR_DIRECTORY)!=0;
+    }
+
+
+    /**
+     * Check if the clusters are contiguous and the FAT is not used to find them
+     * @return true if NoFatChain is set
+     */
+
+    inline bool ExFatEntrySet::isContiguous() const {
+      return (stream.GeneralSecondaryFlags & ExFatDirectoryEntry::FLAG_NO_FAT_CHAIN)!=0;
+    }
+
+
+    /**
+     * Get the first cluster of the data
+     * @return The first cluster, or zero if nothing is allocated
+     */
+
+    inline uint32_t ExFatEntrySet::getFirstCluster() const {
+      return stream.FirstCluster;
+    }
+
+
+    /**
+     * Get the location of the entries in the directory described by this set
+     * @param[out] dir The directory location.
+     */
+
+    inline void ExFatEntrySet::getDirectory(ExFatDirectory& dir) const {
+      dir.set(stream.FirstCluster,static_cast<uint32_t>(stream.DataLength),isContiguous());
+    }
+  }
+}
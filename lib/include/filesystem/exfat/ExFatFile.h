@@ -0,0 +1,92 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * @brief exFAT implementation of the File class.
+     *
+     * Reads and writes of whole sectors go directly between the caller's buffer and the
+     * device as multi-sector transfers. A transfer is split only where the clusters stop
+     * being consecutive, which for a contiguous (NoFatChain) file is never. Space is
+     * allocated for the whole of a write before any data is written.
+     *
+     * Like FatFile, only one handle on a file may write to it and the other handles see
+     * the new length after each write.
+     */
+
+    class ExFatFile : public File {
+
+      protected:
+        ExFatFileSystem& _fs;
+        ExFatEntrySet _set;
+        ByteMemblock _sectorBuffer;
+        uint32_t _cluster;              // last cluster looked up in a FAT chain, zero if none
+        uint32_t _clusterIndex;         // index of _cluster within the file
+        ExFatFile *_nextOpen;
+        bool _writer;
+
+        friend class ExFatFileSystem;
+
+      protected:
+        bool getCluster(uint32_t clusterIndex,uint32_t& cluster);
+        bool getSectorRun(uint32_t offset,uint32_t maxSectors,uint32_t& sectorIndex,uint32_t& count);
+        bool writeData(const uint8_t *ptr,uint32_t offset,uint32_t size);
+        bool isSameFile(const ExFatEntrySet& set) const;
+        void entrySetUpdated(const ExFatEntrySet& set);
+        uint32_t getAllocatedClusters() const;
+
+      public:
+        ExFatFile(ExFatFileSystem& fs,const ExFatEntrySet& set);
+        virtual ~ExFatFile();
+
+        bool isWriter() const;
+        const ExFatEntrySet& getEntrySet() const;
+
+        // overrides from File
+
+        virtual bool read(void *ptr,uint32_t size,uint32_t& actuallyRead) override;
+        virtual bool write(const void *ptr,uint32_t size) override;
+        virtual bool seek(int32_t offset,SeekFrom origin) override;
+        virtual uint32_t getLength() override;
+    };
+
+
+    /**
+     * Check if this handle is the writer for its file
+     * @return true if it's the writer
+     */
+
+    inline bool ExFatFile::isWriter() const {
+      return _writer;
+    }
+
+
+    /**
+     * Get the entry set for this file
+     * @return The entry set.
+     */
+
+    inline const ExFatEntrySet& ExFatFile::getEntrySet() const {
+      return _set;
+    }
+
+
+    /**
+     * Check if the given entry set is the one for this file
+     * @param[in] set The entry set to compare with
+     * @return true if it's the same location on the file system
+     */
+
+    inline bool ExFatFile::isSameFile(const ExFatEntrySet& set) const {
+      return _set.parent.firstCluster==set.parent.firstCluster && _set.entryIndex==set.entryIndex;
+    }
+  }
+}
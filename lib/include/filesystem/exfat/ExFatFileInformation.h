@@ -0,0 +1,59 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * @brief File information taken from an exFAT entry set. The name is copied so the
+     * information remains valid after the set has gone.
+     */
+
+    class ExFatFileInformation : public FileInformation {
+
+      protected:
+        uint32_t _attributes;
+        char _filename[ExFatDirectoryEntry::MAX_NAME_LENGTH+1];
+        time_t _creationDate;
+        time_t _lastWriteDateTime;
+        time_t _lastAccessDateTime;
+        uint32_t _length;
+
+      protected:
+        void assign(const ExFatEntrySet& set);
+
+      public:
+
+        /**
+         * Default constructor. Do nothing.
+         */
+
+        ExFatFileInformation() {
+        }
+
+        ExFatFileInformation(const ExFatEntrySet& set);
+
+        /**
+         * Virtual destructor. Do nothing.
+         */
+
+        virtual ~ExFatFileInformation() {
+        }
+
+        // overrides from FileInformation
+
+        virtual uint32_t getAttributes() const override;
+        virtual const char *getFilename() const override;
+        virtual time_t getCreationDateTime() const override;
+        virtual time_t getLastWriteDateTime() const override;
+        virtual time_t getLastAccessDateTime() const override;
+        virtual uint32_t getLength() const override;
+    };
+  }
+}
@@ -0,0 +1,249 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * @namespace exfat 'exfat' is a sub-namespace of stm32plus that contains the exFAT file
+   * system used on SDXC cards. As with FAT you'll normally use it through the FileSystem class.
+   */
+
+  namespace exfat {
+
+    class ExFatFile;
+
+    /**
+     * @brief exFAT file system.
+     *
+     * Free space is tracked in the allocation bitmap so finding free clusters does not touch
+     * the FAT. Files are allocated contiguously whenever the clusters after the end of the
+     * file are free, in which case the NoFatChain flag is set and the FAT is not used at all
+     * to read or write them. A file is converted to a FAT chain only when it cannot grow
+     * contiguously.
+     *
+     * Limitations:
+     *
+     *  - names are 8-bit. Characters outside ASCII are read as '?' and name matching is
+     *    case insensitive for ASCII only.
+     *  - files are limited to 4Gb by the File interface.
+     *  - only the first FAT and allocation bitmap are used. TexFAT volumes are not supported.
+     *  - the allocation bitmap must be contiguous, as it is when written by all formatters.
+     *
+     * Open files are tracked so that they cannot be deleted. As with FAT, only one handle on
+     * a file may write to it and the other handles are told about the new length.
+     */
+
+    class ExFatFileSystem : public FileSystem {
+
+      protected:
+        uint32_t _fatOffset;                // first sector of the active FAT
+        uint32_t _clusterHeapOffset;        // first sector of cluster 2
+        uint32_t _clusterCount;             // number of clusters in the heap
+        uint32_t _rootCluster;              // first cluster of the root directory
+        uint32_t _sectorSize;
+        uint8_t _sectorShift;
+        uint8_t _clusterShift;              // log2 of the sectors per cluster
+
+        uint32_t _bitmapFirstSector;        // the allocation bitmap is contiguous
+        uint32_t _bitmapLength;             // bytes
+
+        ByteMemblock _fatSector;            // write-through cache of one FAT sector
+        uint32_t _fatSectorIndex;
+        ByteMemblock _bitmapSector;         // write-through cache of one bitmap sector
+        uint32_t _bitmapSectorIndex;
+        ByteMemblock _directorySector;      // write-back cache of one directory sector
+        uint32_t _directorySectorIndex;
+        bool _directorySectorDirty;
+
+        uint32_t _nextFreeCluster;          // where the next free cluster search starts
+        ExFatFile *_openFiles;
+
+        static const uint32_t NO_SECTOR=0xFFFFFFFF;
+        static const uint32_t END_OF_CHAIN=0xFFFFFFFF;
+        static const uint32_t BAD_CLUSTER=0xFFFFFFF7;
+
+      protected:
+        ExFatFileSystem(BlockDevice& blockDevice,const TimeProvider& timeProvider,const ExFatBootSector& bootSector,uint32_t firstSectorIndex);
+
+        bool initialise();
+        bool loadFatSector(uint32_t sectorIndex);
+        bool loadBitmapSector(uint32_t sectorIndex);
+        bool loadDirectorySector(uint32_t sectorIndex);
+        bool locateEntry(ExFatDirectory& dir,uint32_t index,uint32_t& sectorIndex,uint32_t& offset);
+        bool extendDirectory(ExFatDirectory& dir,ExFatEntrySet *owner);
+        bool findFreeEntries(ExFatDirectory& dir,ExFatEntrySet *owner,uint32_t count,uint32_t& index);
+        bool findEntrySet(const TokenisedPathname& tp,int tokenCount,ExFatEntrySet& set,bool& isRoot);
+        bool findInDirectory(ExFatDirectory& dir,const char *name,ExFatEntrySet& set);
+        bool createEntrySet(const char *pathname,uint16_t attributes,uint32_t firstCluster,uint32_t length);
+        bool deleteEntrySet(const char *pathname,bool directory);
+        bool directoryIsEmpty(const ExFatEntrySet& set,bool& isEmpty);
+        bool writeFatRun(uint32_t firstCluster,uint32_t count);
+        bool setClustersAllocated(uint32_t firstCluster,uint32_t count,bool allocated);
+        bool zeroCluster(uint32_t cluster);
+
+      public:
+
+        /**
+         * Error codes
+         */
+
+        enum {
+          /// The volume is not a supported exFAT volume
+          E_UNSUPPORTED_VOLUME=1,
+
+          /// A checksum is wrong
+          E_BAD_CHECKSUM,
+
+          /// Expected a file, got something else.
+          E_NOT_A_FILE,
+
+          /// Expected a directory, got something else.
+          E_NOT_A_DIRECTORY,
+
+          /// Expected an empty directory but it has content.
+          E_DIRECTORY_NOT_EMPTY,
+
+          /// The file or directory was not found
+          E_NOT_FOUND,
+
+          /// There are no free clusters
+          E_VOLUME_FULL,
+
+          /// A cluster chain is corrupt
+          E_BAD_CLUSTER,
+
+          /// The name is too long or empty
+          E_INVALID_NAME
+        };
+
+        // factory constructors/destructor
+
+        static bool getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,ExFatFileSystem*& newFileSystem);
+        static bool getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,uint32_t firstSectorIndex,ExFatFileSystem*& newFileSystem);
+
+        virtual ~ExFatFileSystem();
+
+        // overrides from FileSystem
+
+        virtual FileSystemType getFileSystemType() const override;
+        virtual bool getFileInformation(const char *filename,FileInformation*& finfo) override;
+        virtual bool getDirectoryIterator(const char *pathname,DirectoryIterator*& newIterator) override;
+        virtual bool createFile(const char *filename) override;
+        virtual bool createDirectory(const char *dirname) override;
+        virtual bool openFile(const char *filename,File*& newFile) override;
+        virtual bool deleteFile(const char *filename) override;
+        virtual bool deleteDirectory(const char *dirname) override;
+        virtual uint32_t getSectorSizeInBytes() const override;
+        virtual bool getFreeSpace(uint32_t& freeUnits,uint32_t& unitsMultiplier) override;
+
+        // geometry
+
+        uint32_t getClusterCount() const;
+        uint32_t getSectorsPerCluster() const;
+        uint32_t getClusterSizeInBytes() const;
+        uint32_t clusterToSector(uint32_t cluster) const;
+        bool isValidCluster(uint32_t cluster) const;
+
+        // cluster allocation
+
+        bool readFatEntry(uint32_t cluster,uint32_t& next);
+        bool writeFatEntry(uint32_t cluster,uint32_t next);
+        bool findFreeClusters(uint32_t wanted,uint32_t& firstCluster,uint32_t& count);
+        bool areClustersFree(uint32_t firstCluster,uint32_t count,bool& isFree);
+        bool allocateClusters(ExFatEntrySet& set,uint32_t lastCluster,uint32_t count,uint32_t& firstNewCluster);
+        bool freeClusters(uint32_t firstCluster,uint32_t clusterCount,bool contiguous);
+
+        // directory entries
+
+        bool readEntry(ExFatDirectory& dir,uint32_t index,ExFatDirectoryEntry& entry);
+        bool writeEntry(ExFatDirectory& dir,uint32_t index,const ExFatDirectoryEntry& entry);
+        bool flushDirectory();
+        bool readEntrySet(ExFatDirectory& dir,uint32_t index,ExFatEntrySet& set);
+        bool writeEntrySet(ExFatEntrySet& set);
+        void getRootDirectory(ExFatDirectory& dir) const;
+
+        // open file tracking
+
+        void fileOpened(ExFatFile& file);
+        void fileClosed(ExFatFile& file);
+        bool isFileOpen(const ExFatEntrySet& set) const;
+        bool claimWriter(ExFatFile& file);
+        void entrySetUpdated(const ExFatFile& file);
+
+        // checksums
+
+        static uint16_t calculateNameHash(const char *name);
+        static uint16_t calculateEntryChecksum(const ExFatDirectoryEntry& entry,bool primary,uint16_t checksum);
+        static uint32_t calculateBootChecksum(const uint8_t *sector,uint32_t sectorSize,uint32_t sectorNumber,uint32_t checksum);
+        static uint32_t calculateUpcaseChecksum(const uint8_t *table,uint32_t length,uint32_t checksum);
+    };
+
+
+    /**
+     * Get the number of clusters in the cluster heap
+     * @return The cluster count
+     */
+
+    inline uint32_t ExFatFileSystem::getClusterCount() const {
+      return _clusterCount;
+    }
+
+
+    /**
+     * Get the number of sectors in a cluster
+     * @return The sectors per cluster
+     */
+
+    inline uint32_t ExFatFileSystem::getSectorsPerCluster() const {
+      return 1 << _clusterShift;
+    }
+
+
+    /**
+     * Get the size of a cluster
+     * @return The cluster size in bytes
+     */
+
+    inline uint32_t ExFatFileSystem::getClusterSizeInBytes() const {
+      return _sectorSize << _clusterShift;
+    }
+
+
+    /**
+     * Convert a cluster number to the index of its first sector
+     * @param[in] cluster The cluster number, from 2
+     * @return The sector index on the file system
+     */
+
+    inline uint32_t ExFatFileSystem::clusterToSector(uint32_t cluster) const {
+      return _clusterHeapOffset+((cluster-2) << _clusterShift);
+    }
+
+
+    /**
+     * Check if a cluster number is inside the cluster heap
+     * @param[in] cluster The cluster number
+     * @return true if it's valid
+     */
+
+    inline bool ExFatFileSystem::isValidCluster(uint32_t cluster) const {
+      return cluster>=2 && cluster<_clusterCount+2;
+    }
+
+
+    /**
+     * Get the location of the root directory. The root directory always uses the FAT.
+     * @param[out] dir The root directory location.
+     */
+
+    inline void ExFatFileSystem::getRootDirectory(ExFatDirectory& dir) const {
+      dir.set(_rootCluster,0,false);
+    }
+  }
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * @brief Formatter for exFAT file systems.
+     *
+     * Creates the main and backup boot regions, a single FAT, the allocation bitmap, an
+     * up-case table and the root directory. The up-case table covers the ASCII range only,
+     * which is what ExFatFileSystem uses for name matching. The sector size is 512 bytes.
+     *
+     * The default cluster size follows the SD card recommendations: 4Kb up to 256Mb, 32Kb up
+     * to 32Gb and 128Kb above that. The cluster heap can be aligned to the erase block size
+     * of the device.
+     */
+
+    class ExFatFileSystemFormatter {
+
+      protected:
+        BlockDevice& _blockDevice;
+        uint32_t _firstSectorIndex;
+        uint32_t _numSectors;
+        uint32_t _alignment;
+        char _volumeLabel[12];
+        ExFatBootSector _bootSector;
+        uint32_t _bitmapClusters;
+        uint32_t _usedClusters;
+
+      protected:
+        bool createBootSector(uint32_t sectorsPerCluster);
+        bool writeBootRegion(uint32_t sectorIndex);
+        bool writeFat();
+        bool writeBitmap();
+        bool writeUpcaseTable(uint32_t& checksum);
+        bool writeRootDirectory(uint32_t upcaseChecksum);
+        bool zeroSectors(uint32_t firstSectorIndex,uint32_t count);
+
+      protected:
+        static const uint32_t SECTOR_SIZE=512;
+        static const uint32_t SECTOR_SHIFT=9;
+        static const uint32_t UPCASE_ENTRIES=128;
+        static const uint32_t ZERO_BUFFER_SECTORS=8;  // sectors per multi-block write when zeroing
+
+      public:
+
+        enum {
+          /// tried to format a disk whose size is out of range for the format.
+          E_INVALID_DISK_SIZE=1,
+
+          /// the requested cluster size is not valid
+          E_INVALID_CLUSTER_SIZE
+        };
+
+        ExFatFileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel,uint32_t alignment=1,uint32_t sectorsPerCluster=0);
+    };
+  }
+}
@@ -11,6 +11,7 @@ namespace stm32plus {
   namespace fat {
 
   class FatFileSystem;
+  class LongNameDirentGenerator;
 
 
   /**
@@ -74,6 +75,7 @@ namespace stm32plus {
         time_t getCreationDateTime();
 
         bool writeDirents(DirectoryEntry *dirents_,int direntCount_);
+        bool createEntries(LongNameDirentGenerator **generators_,uint32_t count_,uint32_t& createdCount_);
 
       // helpers for converting dates and times for directory entries
 
@@ -0,0 +1,58 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace fat {
+
+    class FatFileSystem;
+
+
+    /**
+     * @brief Stage changes to directory entries and write each affected sector once.
+     *
+     * Each sector that is modified is read into the batch on first use and changed in
+     * memory. flush() writes the staged sectors back, using one multi-block write for each
+     * run of consecutive sectors. If the batch fills up it's flushed automatically.
+     *
+     * Deleting an entry set can also record the first cluster of the file. The cluster chains
+     * are freed after the sectors that referred to them have been written, so that an
+     * interrupted flush can lose clusters but never leave an entry pointing at free ones.
+     *
+     * Changes that have not been flushed are discarded when the batch is destroyed.
+     */
+
+    class DirectorySectorBatch {
+
+      public:
+        enum {
+          /// Default number of sectors held in the batch
+          DEFAULT_CAPACITY = 4
+        };
+
+      protected:
+        FatFileSystem& _fs;
+        ByteMemblock _buffer;
+        Memblock<uint32_t> _sectorIndices;
+        Memblock<uint32_t> _chains;         // first clusters of deleted files waiting to be freed
+        uint32_t _capacity;
+        uint32_t _sectorCount;
+        uint32_t _chainCount;
+
+      protected:
+        uint8_t *getSector(uint32_t sectorIndex);
+
+      public:
+        DirectorySectorBatch(FatFileSystem& fs,uint32_t capacity=DEFAULT_CAPACITY);
+
+        bool writeEntry(const DirectoryEntryWithLocation& dirent);
+        bool deleteEntries(FilenameHandler& fh,uint32_t firstCluster);
+        bool flush();
+    };
+  }
+}
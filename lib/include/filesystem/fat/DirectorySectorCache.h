@@ -0,0 +1,56 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace fat {
+
+    class FatFileSystem;
+
+
+    /**
+     * @brief A small cache of consecutive directory sectors.
+     *
+     * The directory entry iterators use this to keep the sectors they are walking resident
+     * so that each sector is read once rather than once per 32 byte entry. On a miss a run
+     * of up to 'capacity' consecutive sectors is read with one multi-block device call.
+     *
+     * Caches register with the file system, which copies sectors written through it into
+     * any cache that holds them so that the cached data is never stale.
+     */
+
+    class DirectorySectorCache {
+
+      public:
+        enum {
+          /// Default number of sectors held in the cache
+          DEFAULT_CAPACITY = 4
+        };
+
+      protected:
+        FatFileSystem& _fs;
+        ByteMemblock _buffer;
+        uint32_t _capacity;
+        uint32_t _firstSector;
+        uint32_t _count;
+        DirectorySectorCache *_next;
+
+        friend class FatFileSystem;
+
+      protected:
+        void sectorWritten(uint32_t sectorIndex,const void *data);
+
+      public:
+        DirectorySectorCache(FatFileSystem& fs,uint32_t capacity);
+        ~DirectorySectorCache();
+
+        uint8_t *getSector(uint32_t sectorIndex,uint32_t runLength);
+        void invalidate();
+    };
+  }
+}
@@ -22,7 +22,7 @@ namespace stm32plus {
         virtual void initReservedClusters(uint8_t *sector) const override;
 
       public:
-        Fat16FileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel);
+        Fat16FileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel,uint32_t alignment=1,const FatFormatProgressEventSourceSlot *progress=nullptr);
     };
   }
 }
@@ -13,7 +13,8 @@ namespace stm32plus {
   /**
    * @brief Iterator for directory entries in the Fat16 root directory.
    *
-   * The Fat16 root directory is a contiguous block of sectors.
+   * The Fat16 root directory is a contiguous block of sectors. They are read ahead in runs
+   * and kept in a DirectorySectorCache.
    */
 
     class Fat16RootDirectoryEntryIterator : public DirectoryEntryIterator {
@@ -23,7 +24,8 @@ namespace stm32plus {
         uint32_t _firstEntryInCurrentSector;
         uint32_t _entriesPerSector;
         uint32_t _rootDirMaxEntries;
-        Memblock<uint8_t> _currentSector;
+        DirectorySectorCache _cache;
+        uint8_t *_currentSector;
 
       protected:
         uint32_t entryOffsetInSector(uint32_t entryIndex) const;
@@ -25,7 +25,7 @@ namespace stm32plus {
         void createNewFsInfo(Fat32FsInfo& fsinfo) const;
 
       public:
-        Fat32FileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel);
+        Fat32FileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel,uint32_t alignment=1,const FatFormatProgressEventSourceSlot *progress=nullptr);
         virtual ~Fat32FileSystemFormatter() {}
     };
 
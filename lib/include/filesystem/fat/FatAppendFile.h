@@ -0,0 +1,81 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace fat {
+
+    /**
+     * @brief A FAT file optimised for sustained appending, e.g. data logging.
+     *
+     * Obtain one from FatFileSystem::openAppendFile(). Unlike FatFile, which writes the
+     * data, the FAT and the directory entry on every call to write(), this class:
+     *
+     *  - buffers 'batchSectors' sectors of data and writes them with multi-block writes.
+     *  - allocates 'preallocateClusters' consecutive clusters at a time, ahead of the data,
+     *    and links them into the chain with one FAT sector write per FAT sector touched.
+     *  - protects the cluster chain updates with a FatJournal so that a power loss cannot
+     *    leave the chain pointing at a free cluster.
+     *  - writes the file size to the directory entry only when commit() is called.
+     *
+     * Call commit() periodically. After a power loss the file contains everything up to the
+     * last commit. Preallocated clusters beyond the committed size remain attached to the
+     * file until it's next opened for appending and closed, at which point they are freed.
+     * The destructor commits and frees any unused clusters.
+     *
+     * The file is append-only: read() and seek() are not supported. Other handles on the same
+     * file can read it and see the data up to the last commit.
+     */
+
+    class FatAppendFile : public FatFile {
+
+      protected:
+        FatJournal& _journal;
+        ByteMemblock _batch;
+        uint32_t _batchSectors;
+        uint32_t _preallocateClusters;
+        uint32_t _sectorSize;
+        uint32_t _clusterSize;
+        uint32_t _batchStart;           // file offset of the first byte in the batch, sector aligned
+        uint32_t _batchCluster;         // cluster holding _batchStart, or 0 if not yet allocated
+        uint32_t _tailCluster;          // last cluster in the chain, or 0 if there is none
+        uint32_t _chainClusters;        // number of clusters in the chain
+
+        friend class FatFileSystem;
+
+      protected:
+        bool initialise();
+        bool ensureCapacity(uint32_t bytesNeeded);
+        bool flushBatch();
+        bool trim();
+        uint32_t getFirstCluster() const;
+
+      public:
+        FatAppendFile(FatFileSystem& fs,DirectoryEntryWithLocation& dirent,FatJournal& journal,uint32_t batchSectors,uint32_t preallocateClusters);
+        virtual ~FatAppendFile();
+
+        bool commit();
+
+        // overrides from File
+
+        virtual bool read(void *ptr,uint32_t size,uint32_t& actuallyRead) override;
+        virtual bool write(const void *ptr,uint32_t size) override;
+        virtual bool seek(int32_t offset,SeekFrom origin) override;
+        virtual uint32_t getLength() override;
+    };
+
+
+    /*
+     * Get the first cluster from the directory entry
+     */
+
+    inline uint32_t FatAppendFile::getFirstCluster() const {
+      return (static_cast<uint32_t>(_dirent.Dirent.sdir.DIR_FstClusHI) << 16) | _dirent.Dirent.sdir.DIR_FstClusLO;
+    }
+  }
+}
@@ -15,7 +15,8 @@ namespace stm32plus {
     /**
      * @brief Fat file extends the basic File class.
      *
-     * FAT implementation of the File base class.
+     * FAT implementation of the File base class. Handles register themselves with the file
+     * system so that several handles on the same file stay coherent. See FatFileSystem.
      */
 
     class FatFile : public File {
@@ -24,18 +25,21 @@ namespace stm32plus {
         DirectoryEntryWithLocation _dirent;
         ByteMemblock _sectorBuffer;
         FileSectorIterator _iterator;
+        FatFile *_nextOpen;
+        bool _writer;
+
+        friend class FatFileSystem;
 
       protected:
         void calcIndexes();
+        bool isSameFile(const DirectoryEntryWithLocation& dirent) const;
+        void directoryEntryUpdated(const DirectoryEntry& dirent);
 
       public:
         FatFile(FatFileSystem& fs_,DirectoryEntryWithLocation& dirent_);
+        virtual ~FatFile();
 
-        /**
-         * Virtual destructor, does nothing.
-         */
-
-        virtual ~FatFile() {}
+        bool isWriter() const;
 
       // get the dirent
 
@@ -48,5 +52,26 @@ namespace stm32plus {
         virtual bool seek(int32_t offset,SeekFrom origin) override;
         virtual uint32_t getLength() override;
     };
+
+
+    /**
+     * Check if this handle is the writer for its file
+     * @return true if it's the writer
+     */
+
+    inline bool FatFile::isWriter() const {
+      return _writer;
+    }
+
+
+    /**
+     * Check if the given directory entry is the one for this file
+     * @param[in] dirent The directory entry to compare with
+     * @return true if it's the same location on the file system
+     */
+
+    inline bool FatFile::isSameFile(const DirectoryEntryWithLocation& dirent) const {
+      return _dirent.SectorNumber==dirent.SectorNumber && _dirent.IndexWithinSector==dirent.IndexWithinSector;
+    }
   }
 }
@@ -18,11 +18,37 @@ namespace stm32plus {
   namespace fat {
 
     class FatDirectoryIterator;
+    class FatFile;
+    class FatAppendFile;
+    class FatJournal;
+    class DirectorySectorCache;
+
+    /**
+     * The signature for the deleteFiles() filter: void myFilter(const FileInformation& file,bool& deleteIt).
+     * deleteIt is false on entry, set it to true to delete the file.
+     */
+
+    DECLARE_EVENT_SIGNATURE(FatDeleteFilter,void(const FileInformation&,bool&));
+
 
     /**
      * @brief Base class for FAT filesystems.
      *
      * Exposes the common functionality of FAT16 and FAT32 filesystems.
+     *
+     * The file system keeps track of the files that are open on it so that many handles on
+     * the same file stay coherent. A file may have one writer and any number of readers: the
+     * first handle to write becomes the writer and other handles that try to write will
+     * fail with E_FILE_LOCKED until it's deleted. Readers see the new length as soon as the
+     * writer updates the directory entry. Open files cannot be deleted. All files must be
+     * deleted before the file system.
+     *
+     * The most recently used FAT sector is cached and shared by all handles, and sectors
+     * written through the file system are copied into any live directory sector caches.
+     *
+     * Changes to directory entries are staged in a DirectorySectorBatch so that each sector
+     * is written once however many entries in it change. deleteFiles(), deleteTree() and
+     * createFiles() work on many entries in one pass over the directory.
      */
 
     class FatFileSystem : public FileSystem {
@@ -34,6 +60,14 @@ namespace stm32plus {
         uint32_t _rootDirFirstSector; // first sector of the root directory
         uint32_t _countOfClusters; // total # of clusters
 
+        ByteMemblock _fatSector;            // shared write-through cache of one FAT sector
+        uint32_t _fatSectorIndex;           // sector index held in _fatSector
+        FatFile *_openFiles;                // list of open files
+        DirectorySectorCache *_directoryCaches;   // list of live directory sector caches
+
+        static const uint32_t NO_SECTOR=0xFFFFFFFF;
+        static const uint32_t CREATE_BATCH_SIZE=16;   // names handled in one pass by createFiles()
+
       protected:
         FatFileSystem(BlockDevice& blockDevice,const TimeProvider& timeProvider,const fat::BootSector& bootSector,uint32_t firstSectorIndex,uint32_t countOfClusters);
 
@@ -42,6 +76,12 @@ namespace stm32plus {
         bool getParentDirectoryFirstCluster(TokenisedPathname& pathTokens,uint16_t* lo,uint16_t* hi);
         bool fullyDelete(FatDirectoryIterator& it);
         bool deleteDirents(FatDirectoryIterator& fdi);
+        bool createDirents(DirectoryEntryIterator& dir,const char *filename);
+        bool treeHasOpenFile(uint32_t firstCluster,bool& inUse);
+        bool deleteTreeClusters(uint32_t firstCluster);
+        static uint32_t getFirstCluster(const DirectoryEntry& dirent);
+        bool loadFatSector(uint32_t sectorIndex);
+        bool flushFatSector();
 
       public:
 
@@ -65,6 +105,7 @@ namespace stm32plus {
 
         // factory constructor/destructor
         static bool getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,FatFileSystem*& newFileSystem);
+        static bool getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,uint32_t firstSectorIndex,FatFileSystem*& newFileSystem);
 
         virtual ~FatFileSystem();
 
@@ -79,6 +120,34 @@ namespace stm32plus {
         virtual bool createDirectory(const char *dirname) override;
         virtual uint32_t getSectorSizeInBytes() const override;
         virtual bool getFreeSpace(uint32_t& freeUnits,uint32_t& unitsMultiplier) override;
+        virtual bool writeSector(uint32_t sectorIndex,void *buffer) override;
+        virtual bool writeSectors(uint32_t sectorIndex,void *buffer,uint32_t count) override;
+
+        // batched cluster allocation for appending
+
+        bool findFreeClusterRun(uint32_t maxCount,uint32_t& firstCluster,uint32_t& count);
+        bool writeClusterRun(uint32_t firstCluster,uint32_t count);
+        bool openAppendFile(const char *filename,FatJournal& journal,FatAppendFile*& newFile,uint32_t batchSectors=8,uint32_t preallocateClusters=4);
+
+        // bulk directory operations
+
+        bool createFiles(const char *dirname,const char *const *filenames,uint32_t count);
+        bool deleteFiles(const char *dirname,const FatDeleteFilterEventSourceSlot& filter,uint32_t& deletedCount);
+        bool deleteTree(const char *pathname);
+
+        // open file tracking
+
+        void fileOpened(FatFile& file);
+        void fileClosed(FatFile& file);
+        bool claimWriter(FatFile& file);
+        void directoryEntryUpdated(const FatFile& file);
+        bool isFileOpen(const DirectoryEntryWithLocation& dirent) const;
+        uint32_t getOpenFileCount() const;
+
+        // directory cache coherency
+
+        void cacheCreated(DirectorySectorCache& cache);
+        void cacheDestroyed(DirectorySectorCache& cache);
 
         const fat::BootSector& getBootSector() const;
         uint32_t getCountOfClusters() const;
@@ -92,6 +161,7 @@ namespace stm32plus {
         bool writeFatEntry(uint32_t fatEntryIndex,uint32_t fatEntryContent);
         bool writeDirectoryEntry(DirectoryEntryWithLocation& dirent);
         bool deAllocateClusterChain(uint32_t firstCluster);
+        bool deAllocateClusterChains(const uint32_t *firstClusters,uint32_t count);
         bool directoryHasContent(const char *dirName,bool& hasContent);
 
         /**
@@ -11,7 +11,17 @@ namespace stm32plus {
   namespace fat {
 
     /**
-     * Fat filesystem formatter base class
+     * The signature for format progress notifications: void myHandler(uint32_t sectorsWritten,uint32_t totalSectors)
+     */
+
+    DECLARE_EVENT_SIGNATURE(FatFormatProgress,void(uint32_t,uint32_t));
+
+
+    /**
+     * Fat filesystem formatter base class. The reserved area, FATs and root directory are
+     * zeroed with multi-block writes from a zeroed buffer. The data region can be aligned
+     * to the erase block size of the device (typically 4Mb, or 8192 sectors, for an SD card)
+     * by padding the reserved area.
      */
 
     class FatFileSystemFormatter {
@@ -21,25 +31,34 @@ namespace stm32plus {
         BlockDevice& _blockDevice;
         uint32_t _numSectors;
         uint32_t _firstSectorIndex;
+        uint32_t _alignment;
+        uint32_t _sectorsWritten;
+        uint32_t _sectorsToWrite;
+        const FatFormatProgressEventSourceSlot *_progress;
         BootSector _bootSector;
 
       protected:
-        FatFileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel);
+        FatFileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel,uint32_t alignment,const FatFormatProgressEventSourceSlot *progress);
         virtual ~FatFileSystemFormatter() {}
 
         virtual bool createNewBootSector();
 
         void setReservedSectorSignature(uint8_t *sector) const;
         void initVolumeLabelDirent(uint8_t *rootDirSector) const;
+        uint32_t getAlignmentPadding(uint32_t systemSectors) const;
+        void beginProgress(uint32_t totalSectors);
+        bool writeSector(const void *sector,uint32_t sectorIndex);
+        bool zeroSectors(uint32_t firstSectorIndex,uint32_t count);
         bool writeBootSector(uint32_t bootSectorIndex);
-        bool writeFats(uint32_t firstFatFirstSector,uint32_t sectorsPerFat) const;
-        bool writeRootDirectoryEntries(uint32_t sectorIndex) const;
+        bool writeFats(uint32_t firstFatFirstSector,uint32_t sectorsPerFat);
+        bool writeRootDirectoryEntries(uint32_t sectorIndex,uint32_t sectorCount);
 
         virtual bool writeReservedSectors()=0;
         virtual void initReservedClusters(uint8_t *sector) const=0;
 
       protected:
         static const uint8_t MEDIA_TYPE=0xf8;         // fixed media, which this may not be.
+        static const uint32_t ZERO_BUFFER_SECTORS=8;  // sectors per multi-block write when zeroing
 
       public:
 
@@ -51,5 +70,3 @@ namespace stm32plus {
     };
   }
 }
-
-
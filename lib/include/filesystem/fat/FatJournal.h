@@ -0,0 +1,112 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace fat {
+
+    /**
+     * @brief A small intent journal for cluster chain updates.
+     *
+     * Extending or trimming a cluster chain takes several writes to the two FATs and
+     * possibly the directory entry. If power is lost part way through, the chain can be
+     * left pointing at a free cluster. The journal writes a record describing the update
+     * before starting it and clears the record when it's finished. If a record is found
+     * when the file system is mounted then the update is repeated. Every update is
+     * idempotent so repeating a finished or partly finished one is safe. An interrupted
+     * trim can leave lost clusters behind but never a chain that references a free one.
+     *
+     * The record lives in the first sector of a hidden system file in the root directory
+     * that's created the first time the journal is opened.
+     */
+
+    class FatJournal {
+
+      public:
+
+        /**
+         * Error codes
+         */
+
+        enum {
+          /// The journal file has not been located
+          E_NOT_OPEN=1,
+
+          /// The journal file is damaged or not a journal
+          E_INVALID_JOURNAL
+        };
+
+        /**
+         * The journalled operations
+         */
+
+        enum Operation {
+          OP_NONE   = 0,      ///< the journal is clean
+          OP_EXTEND = 1,      ///< link a run of clusters on to the end of a chain
+          OP_TRIM   = 2       ///< free the part of a chain after a given cluster
+        };
+
+        /**
+         * The journal record, at the start of the journal sector
+         */
+
+        struct Record {
+          uint32_t magic;
+          uint32_t sequence;
+          uint32_t operation;
+          uint32_t tailCluster;       ///< last cluster to keep, or 0 if the file has none
+          uint32_t firstCluster;      ///< OP_EXTEND: first cluster of the run to add
+          uint32_t clusterCount;      ///< OP_EXTEND: length of the run to add
+          uint32_t direntSector;      ///< location of the file's directory entry
+          uint32_t direntIndex;
+          uint32_t checksum;
+        } __attribute__((packed));
+
+        static const char *const FILENAME;
+        static const uint32_t MAGIC=0x4c4e524a;   // "JRNL"
+
+      protected:
+        FatFileSystem& _fs;
+        ByteMemblock _sector;
+        uint32_t _sectorIndex;
+        uint32_t _sequence;
+
+      protected:
+        bool writeRecord(Operation op,uint32_t tailCluster,uint32_t firstCluster,uint32_t clusterCount,const DirectoryEntryWithLocation& dirent);
+        bool clearRecord();
+        bool apply(const Record& record);
+        bool applyExtend(const Record& record);
+        bool applyTrim(const Record& record);
+        bool setFirstCluster(uint32_t direntSector,uint32_t direntIndex,uint32_t cluster);
+        bool getFirstCluster(uint32_t direntSector,uint32_t direntIndex,uint32_t& cluster);
+
+        static uint32_t calculateChecksum(const Record& record);
+
+      public:
+        FatJournal(FatFileSystem& fs);
+
+        bool open();
+        bool locate(bool create);
+        bool replay();
+        bool isOpen() const;
+
+        bool extendChain(uint32_t tailCluster,uint32_t firstCluster,uint32_t clusterCount,const DirectoryEntryWithLocation& dirent);
+        bool trimChain(uint32_t tailCluster,const DirectoryEntryWithLocation& dirent);
+    };
+
+
+    /**
+     * Check if the journal file has been located
+     * @return true if it's open
+     */
+
+    inline bool FatJournal::isOpen() const {
+      return _sectorIndex!=0;
+    }
+  }
+}
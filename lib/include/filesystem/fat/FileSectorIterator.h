@@ -33,6 +33,7 @@ namespace stm32plus {
         }
 
         uint32_t getClusterNumber();
+        uint32_t getSectorsRemainingInCluster() const;
 
         bool readSector(void *buffer);
         bool writeSector(void *buffer);
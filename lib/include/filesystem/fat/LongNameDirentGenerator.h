@@ -18,18 +18,52 @@ namespace stm32plus {
      * the 8.3 format supported by old versions of MSDOS.
      *
      * This class does not actually write the new directory entries. The caller is responsible for that.
+     *
+     * Short names are made unique in a single pass over the target directory. The numeric tails
+     * already in use for the basis name are collected into a bitmap and the lowest free one is
+     * taken. Like Windows, only the first few tails are used with the plain basis. After that the
+     * basis is replaced by the first two characters plus a hash of the long name, e.g. SE3F1A~1.CSV,
+     * so that creating many files with a common prefix does not get slower with each file.
+     *
+     * To create many files in one directory the caller can construct each generator without a
+     * target directory, pass every existing entry to scanEntry() in a single pass and then call
+     * generate(). The caller must also scan the entries generated for the earlier files.
      */
 
     class LongNameDirentGenerator {
 
       protected:
-        DirectoryEntryIterator& _targetDir;
+
+        /**
+         * Limits for the numeric tail search
+         */
+
+        enum {
+          /// tails ~1 to ~4 are tried with the plain basis before the hashed basis is used
+          PLAIN_TAIL_LIMIT = 4,
+
+          /// tails tracked for the hashed basis, one bit per tail
+          HASHED_TAIL_LIMIT = 255,
+
+          /// words in a tail bitmap
+          TAIL_BITMAP_WORDS = (HASHED_TAIL_LIMIT+32)/32,
+
+          /// number of different hashes tried before giving up
+          MAX_HASH_ATTEMPTS = 16
+        };
+
+        DirectoryEntryIterator *_targetDir;
         const char *_longName;
         DirectoryEntry *_dirents;
         uint16_t _createDate;
         uint16_t _createTime;
         int _direntCount;
         int _currentIteratorIndex;
+        uint16_t _salt;
+        char _shortName[12];
+        char _hashedName[11];
+        uint32_t _plainTails[TAIL_BITMAP_WORDS];
+        uint32_t _hashedTails[TAIL_BITMAP_WORDS];
 
       public:
 
@@ -39,24 +73,39 @@ namespace stm32plus {
 
         enum {
           /// The filename already exists in the directory.
-          E_FILE_EXISTS=1
+          E_FILE_EXISTS=1,
+
+          /// A unique short name could not be generated
+          E_NO_UNIQUE_SHORT_NAME=2
         };
 
       public:
         LongNameDirentGenerator(const char *longName_,DirectoryEntryIterator& targetDir_,uint16_t createDate_,uint16_t createTime_);
+        LongNameDirentGenerator(const char *longName_,uint16_t createDate_,uint16_t createTime_);
         ~LongNameDirentGenerator();
 
+        bool scanEntry(const char *filename_,const uint8_t *direntName_);
+        bool generate();
+
         int getDirentCount();
         DirectoryEntry *getDirents();
+        const char *getLongName() const;
 
       protected:
         bool generateDirentsFromLongName();
+        void calculateDirentCount();
+        void beginScan(uint16_t salt_);
+        bool selectShortName();
+        void buildDirents();
         void generateShortName(char *shortName_) const;
         void computeLossyShortName(const char *shortName_,char *lossyName_,int tailNumber_) const;
         uint8_t shortNameChecksum(const uint8_t *shortName_) const;
         bool isLongNameValidShortName() const;
         void copyChars(const char *& src_,int& srcLen_,uint16_t *dest_,int destLen_);
-        bool findUniqueShortName(char *shortName_);
+        bool findUniqueShortName();
+        void generateHashedShortName(const char *shortName_,char *hashedName_,uint16_t salt_) const;
+        void markTailIfUsed(const uint8_t *direntName_,const char *basis_,uint32_t *tails_,int tailLimit_) const;
+        static int findFreeTail(const uint32_t *tails_,int tailLimit_);
     };
   }
 }
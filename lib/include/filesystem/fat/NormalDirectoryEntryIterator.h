@@ -14,7 +14,8 @@ namespace stm32plus {
      * @brief Iterate over normal directory entries.
      *
      * A normal directory entry iterator iterates over directory entries stored in a "file" structure,
-     * i.e. a sequence of clusters specified by their FAT entries.
+     * i.e. a sequence of clusters specified by their FAT entries. Sectors are read ahead in runs
+     * up to the end of the current cluster and kept in a DirectorySectorCache.
      */
 
     class NormalDirectoryEntryIterator : public DirectoryEntryIterator {
@@ -23,6 +24,8 @@ namespace stm32plus {
         FileSectorIterator _iterator;
         uint32_t _firstClusterIndex;
         uint32_t _currentDirentIndex;
+        uint32_t _entriesPerSector;
+        DirectorySectorCache _cache;
 
       protected:
         // overrides from DirectoryEntryIterator
@@ -0,0 +1,152 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * Descriptor for a single I2C master transaction. A transaction is an optional write
+   * phase followed by an optional read phase. If both are present then the read phase
+   * is started with a repeated START so the typical "write register index then read the
+   * register contents" exchange is a single transaction.
+   *
+   * Transactions are queued by reference and linked together through the 'next' member
+   * so the queue never touches the heap. The descriptor and its buffers must remain valid
+   * until the status is no longer QUEUED or IN_PROGRESS.
+   */
+
+  struct I2CTransaction {
+
+    /**
+     * Possible states of the transaction
+     */
+
+    enum class Status : uint8_t {
+      IDLE,             ///< never been submitted
+      QUEUED,           ///< waiting behind another transaction
+      IN_PROGRESS,      ///< currently on the bus
+      COMPLETE,         ///< finished successfully
+      FAILED            ///< finished with an error, see errorCode
+    };
+
+    uint8_t slaveAddress;           ///< 7-bit address, left aligned in the byte
+    const uint8_t *writeData;
+    uint8_t *readData;
+    uint16_t writeCount;
+    uint16_t readCount;
+    volatile Status status;
+    volatile uint32_t errorCode;    ///< one of the I2C::E_I2C_* codes if status is FAILED
+    void *userData;                 ///< not used by the library, for your own use
+    I2CTransaction *next;           ///< queue linkage, owned by the transaction engine
+
+    I2CTransaction();
+
+    void setWrite(uint8_t slave,const void *data,uint16_t count);
+    void setRead(uint8_t slave,void *data,uint16_t count);
+    void setWriteRead(uint8_t slave,const void *wdata,uint16_t wcount,void *rdata,uint16_t rcount);
+
+    bool isBusy() const;
+    bool succeeded() const;
+  };
+
+
+  /**
+   * The signature for transaction completion: void myHandler(I2CTransaction& transaction)
+   * Completion events are raised from IRQ context.
+   */
+
+  DECLARE_EVENT_SIGNATURE(I2CTransactionComplete,void(I2CTransaction&));
+
+
+  /**
+   * Base structure that holds just the event subscriber/publisher for transaction completion
+   */
+
+  struct I2CTransactionEventSource {
+    DECLARE_EVENT_SOURCE(I2CTransactionComplete);
+  };
+
+
+  /**
+   * Constructor
+   */
+
+  inline I2CTransaction::I2CTransaction()
+    : slaveAddress(0),
+      writeData(nullptr),
+      readData(nullptr),
+      writeCount(0),
+      readCount(0),
+      status(Status::IDLE),
+      errorCode(0),
+      userData(nullptr),
+      next(nullptr) {
+  }
+
+
+  /**
+   * Set up a write-only transaction
+   * @param slave The slave address, left aligned
+   * @param data The data to write
+   * @param count The number of bytes to write
+   */
+
+  inline void I2CTransaction::setWrite(uint8_t slave,const void *data,uint16_t count) {
+    setWriteRead(slave,data,count,nullptr,0);
+  }
+
+
+  /**
+   * Set up a read-only transaction
+   * @param slave The slave address, left aligned
+   * @param data Where to store the bytes
+   * @param count The number of bytes to read
+   */
+
+  inline void I2CTransaction::setRead(uint8_t slave,void *data,uint16_t count) {
+    setWriteRead(slave,nullptr,0,data,count);
+  }
+
+
+  /**
+   * Set up a write followed by a repeated START and a read
+   * @param slave The slave address, left aligned
+   * @param wdata The data to write, usually a register index
+   * @param wcount The number of bytes to write
+   * @param rdata Where to store the bytes read
+   * @param rcount The number of bytes to read
+   */
+
+  inline void I2CTransaction::setWriteRead(uint8_t slave,const void *wdata,uint16_t wcount,void *rdata,uint16_t rcount) {
+    slaveAddress=slave;
+    writeData=static_cast<const uint8_t *>(wdata);
+    writeCount=wcount;
+    readData=static_cast<uint8_t *>(rdata);
+    readCount=rcount;
+  }
+
+
+  /**
+   * Check if the transaction is queued or on the bus
+   * @return true if it's not finished yet
+   */
+
+  inline bool I2CTransaction::isBusy() const {
+    return status==Status::QUEUED || status==Status::IN_PROGRESS;
+  }
+
+
+  /**
+   * Check if the transaction completed without error
+   * @return true if it worked
+   */
+
+  inline bool I2CTransaction::succeeded() const {
+    return status==Status::COMPLETE;
+  }
+}
@@ -46,12 +46,26 @@ namespace stm32plus {
       };
 
       enum {
-        E_I2C_TIMEOUT=1         ///< timed out waiting for a response
+        E_I2C_TIMEOUT=1,            ///< timed out waiting for a response
+        E_I2C_ACK_FAILURE=2,        ///< the slave did not acknowledge
+        E_I2C_ARBITRATION_LOST=3,   ///< another master won the bus
+        E_I2C_BUS_ERROR=4,          ///< misplaced START/STOP or a DMA error
+        E_I2C_OVERRUN=5,            ///< data overrun or underrun
+        E_I2C_PEC_ERROR=6,          ///< received PEC did not match
+        E_I2C_SMBUS_TIMEOUT=7       ///< SMBus clock low timeout
       };
 
     protected:
       I2C_TypeDef *_peripheralAddress;
       uint8_t _addressSize;
+      GPIO_TypeDef *_sclPort;
+      GPIO_TypeDef *_sdaPort;
+      uint16_t _sclPin;
+      uint16_t _sdaPin;
+      void (*_pinInitialiser)();
+
+    protected:
+      static void halfBitDelay();
 
     protected:
       I2C(const Parameters& params,I2C_TypeDef *peripheralAddress);
@@ -61,6 +75,7 @@ namespace stm32plus {
       void disablePeripheral() const;
 
       void reset(bool enterReset) const;
+      void clearBus() const;
 
       uint8_t getAddressSize() const;
       void setAddressSize(uint8_t addressSize);
@@ -75,7 +90,12 @@ namespace stm32plus {
 
   inline I2C::I2C(const Parameters& params,I2C_TypeDef *peripheralAddress)
     : _peripheralAddress(peripheralAddress),
-      _addressSize(params.i2c_addressSize) {
+      _addressSize(params.i2c_addressSize),
+      _sclPort(nullptr),
+      _sdaPort(nullptr),
+      _sclPin(0),
+      _sdaPin(0),
+      _pinInitialiser(nullptr) {
   }
 
 
@@ -107,6 +127,61 @@ namespace stm32plus {
   }
 
 
+  /**
+   * Free a bus that a slave is holding by driving the pins as GPIO outputs. SCL is clocked 9
+   * times, enough for the slave to finish any byte that it was sending and see a NACK, and
+   * then a STOP is generated. The pins are handed back to the peripheral afterwards.
+   */
+
+  inline void I2C::clearBus() const {
+
+    uint8_t i;
+
+    if(_pinInitialiser==nullptr)
+      return;
+
+    disablePeripheral();
+
+    // release both lines before they become outputs so there's no glitch
+
+    GPIO_SetBits(_sclPort,_sclPin);
+    GPIO_SetBits(_sdaPort,_sdaPin);
+
+    GpioPinInitialiser::initialise(_sclPort,_sclPin,Gpio::OUTPUT,GPIO_Speed_50MHz,Gpio::PUPD_NONE,Gpio::OPEN_DRAIN);
+    GpioPinInitialiser::initialise(_sdaPort,_sdaPin,Gpio::OUTPUT,GPIO_Speed_50MHz,Gpio::PUPD_NONE,Gpio::OPEN_DRAIN);
+
+    for(i=0;i<9;i++) {
+      GPIO_ResetBits(_sclPort,_sclPin);
+      halfBitDelay();
+      GPIO_SetBits(_sclPort,_sclPin);
+      halfBitDelay();
+    }
+
+    // STOP: SDA rises while SCL is high
+
+    GPIO_ResetBits(_sdaPort,_sdaPin);
+    halfBitDelay();
+    GPIO_SetBits(_sdaPort,_sdaPin);
+    halfBitDelay();
+
+    _pinInitialiser();
+    enablePeripheral();
+  }
+
+
+  /**
+   * Wait for about half a bit time at 100kHz. The loop is at least 4 cycles per iteration.
+   */
+
+  inline void I2C::halfBitDelay() {
+
+    uint32_t i;
+
+    for(i=SystemCoreClock/800000;i;i--)
+      __NOP();
+  }
+
+
   /**
    * Cast to a I2C peripheral structure
    */
@@ -46,6 +46,14 @@ namespace stm32plus {
 
     I2CPinInitialiser<TPinPackage,TPeripheralName>::initialise();
 
+    // remember the pins so that clearBus() can take them over
+
+    _sclPort=(GPIO_TypeDef *)TPinPackage::Port_SCL;
+    _sdaPort=(GPIO_TypeDef *)TPinPackage::Port_SDA;
+    _sclPin=TPinPackage::Pin_SCL;
+    _sdaPin=TPinPackage::Pin_SDA;
+    _pinInitialiser=&I2CPinInitialiser<TPinPackage,TPeripheralName>::initialise;
+
     // initialise the peripheral
 
     init.I2C_ClockSpeed=params.i2c_clockSpeed;
@@ -0,0 +1,128 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+#if !defined(STM32PLUS_F1) && !defined(STM32PLUS_F4)
+#error Only F1 and F4 supported
+#endif
+
+
+namespace stm32plus {
+
+  /**
+   * Connects a pair of I2C DMA channels to an I2CMasterTransactionEngine so that the data
+   * phase of long transfers is moved by DMA. The channels must include the DMA interrupt
+   * feature as well as the I2C reader/writer feature, for example:
+   *
+   *   I2C1TxDmaChannel<I2C1TxDmaChannelInterruptFeature,I2CDmaWriterFeature<I2C1PeripheralTraits> > txDma;
+   *   I2C1RxDmaChannel<I2C1RxDmaChannelInterruptFeature,I2CDmaReaderFeature<I2C1PeripheralTraits> > rxDma;
+   *   I2CMasterDmaAdapter<decltype(txDma),decltype(rxDma)> adapter(i2c,txDma,rxDma);
+   *
+   * @tparam TTxDma The DMA channel class that has the I2CDmaWriterFeature
+   * @tparam TRxDma The DMA channel class that has the I2CDmaReaderFeature
+   */
+
+  template<class TTxDma,class TRxDma>
+  class I2CMasterDmaAdapter : public I2CMasterDma {
+
+    protected:
+      I2CMasterTransactionEngine& _engine;
+      TTxDma& _txDma;
+      TRxDma& _rxDma;
+
+    public:
+      I2CMasterDmaAdapter(I2CMasterTransactionEngine& engine,TTxDma& txDma,TRxDma& rxDma,uint16_t threshold=16);
+      virtual ~I2CMasterDmaAdapter();
+
+      // overrides from I2CMasterDma
+
+      virtual void beginWrite(const uint8_t *data,uint32_t count) override;
+      virtual void beginRead(uint8_t *data,uint32_t count) override;
+
+      // DMA event subscription
+
+      void onDmaEvent(DmaEventType det);
+  };
+
+
+  /**
+   * Constructor. Subscribe to the completion and error interrupts of both channels and
+   * attach ourselves to the engine.
+   * @param engine The transaction engine
+   * @param txDma The DMA channel for writes
+   * @param rxDma The DMA channel for reads
+   * @param threshold The minimum data phase size to move with DMA
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline I2CMasterDmaAdapter<TTxDma,TRxDma>::I2CMasterDmaAdapter(I2CMasterTransactionEngine& engine,TTxDma& txDma,TRxDma& rxDma,uint16_t threshold)
+    : _engine(engine),
+      _txDma(txDma),
+      _rxDma(rxDma) {
+
+    _txDma.DmaInterruptEventSender.insertSubscriber(DmaInterruptEventSourceSlot::bind(this,&I2CMasterDmaAdapter::onDmaEvent));
+    _rxDma.DmaInterruptEventSender.insertSubscriber(DmaInterruptEventSourceSlot::bind(this,&I2CMasterDmaAdapter::onDmaEvent));
+
+    _txDma.enableInterrupts(TTxDma::COMPLETE | TTxDma::TRANSFER_ERROR);
+    _rxDma.enableInterrupts(TRxDma::COMPLETE | TRxDma::TRANSFER_ERROR);
+
+    _engine.setDma(this,threshold);
+  }
+
+
+  /**
+   * Destructor, detach from the engine and the DMA channels
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline I2CMasterDmaAdapter<TTxDma,TRxDma>::~I2CMasterDmaAdapter() {
+
+    _engine.setDma(nullptr);
+
+    _txDma.DmaInterruptEventSender.removeSubscriber(DmaInterruptEventSourceSlot::bind(this,&I2CMasterDmaAdapter::onDmaEvent));
+    _rxDma.DmaInterruptEventSender.removeSubscriber(DmaInterruptEventSourceSlot::bind(this,&I2CMasterDmaAdapter::onDmaEvent));
+  }
+
+
+  /**
+   * Start the write channel
+   * @param data The source data
+   * @param count The number of bytes
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline void I2CMasterDmaAdapter<TTxDma,TRxDma>::beginWrite(const uint8_t *data,uint32_t count) {
+    _txDma.beginWrite(data,count);
+  }
+
+
+  /**
+   * Start the read channel
+   * @param data The destination
+   * @param count The number of bytes
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline void I2CMasterDmaAdapter<TTxDma,TRxDma>::beginRead(uint8_t *data,uint32_t count) {
+    _rxDma.beginRead(data,count);
+  }
+
+
+  /**
+   * DMA interrupt from either channel
+   * @param det The event type
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline void I2CMasterDmaAdapter<TTxDma,TRxDma>::onDmaEvent(DmaEventType det) {
+
+    if(det==DmaEventType::EVENT_COMPLETE)
+      _engine.onDmaComplete(true);
+    else if(det==DmaEventType::EVENT_TRANSFER_ERROR)
+      _engine.onDmaComplete(false);
+  }
+}
@@ -0,0 +1,81 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+#if !defined(STM32PLUS_F1) && !defined(STM32PLUS_F4)
+#error Only F1 and F4 supported
+#endif
+
+
+namespace stm32plus {
+
+  /**
+   * Feature that runs an I2CMasterTransactionEngine from the event and error interrupts
+   * of the I2C peripheral. Use it instead of I2CInterruptFeature and the polling features:
+   *
+   *   I2C1_Default<I2C1MasterInterruptFeature> i2c(params);
+   *   i2c.submit(transaction);
+   *
+   * If you change the NVIC priorities with setNvicPriorities() then call
+   * enableInterrupts(I2C_IT_ERR) afterwards to apply them.
+   *
+   * @tparam TI2CNumber The number of the I2C peripheral (1..3)
+   */
+
+  template<uint8_t TI2CNumber>
+  class I2CMasterInterruptFeature : public I2CInterruptFeature<TI2CNumber>,
+                                    public I2CMasterTransactionEngine {
+
+    public:
+      I2CMasterInterruptFeature(I2C& i2c);
+      ~I2CMasterInterruptFeature();
+  };
+
+
+  /*
+   * Typedefs for easy use
+   */
+
+  typedef I2CMasterInterruptFeature<1> I2C1MasterInterruptFeature;
+  typedef I2CMasterInterruptFeature<2> I2C2MasterInterruptFeature;
+
+#if defined(STM32PLUS_F4)
+  typedef I2CMasterInterruptFeature<3> I2C3MasterInterruptFeature;
+#endif
+
+
+  /**
+   * Constructor. Subscribe to our own interrupts and enable the NVIC lines. The event
+   * interrupts are only switched on while there is a transaction in progress.
+   * @param i2c The I2C peripheral
+   */
+
+  template<uint8_t TI2CNumber>
+  inline I2CMasterInterruptFeature<TI2CNumber>::I2CMasterInterruptFeature(I2C& i2c)
+    : I2CInterruptFeature<TI2CNumber>(i2c),
+      I2CMasterTransactionEngine(i2c) {
+
+    this->I2CInterruptEventSender.insertSubscriber(
+        I2CInterruptEventSourceSlot::bind(static_cast<I2CMasterTransactionEngine *>(this),&I2CMasterTransactionEngine::onInterrupt)
+      );
+
+    this->enableInterrupts(I2C_IT_ERR);
+  }
+
+
+  /**
+   * Destructor, unsubscribe from the interrupts
+   */
+
+  template<uint8_t TI2CNumber>
+  inline I2CMasterInterruptFeature<TI2CNumber>::~I2CMasterInterruptFeature() {
+
+    this->I2CInterruptEventSender.removeSubscriber(
+        I2CInterruptEventSourceSlot::bind(static_cast<I2CMasterTransactionEngine *>(this),&I2CMasterTransactionEngine::onInterrupt)
+      );
+  }
+}
@@ -0,0 +1,154 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+#if !defined(STM32PLUS_F1) && !defined(STM32PLUS_F4)
+#error Only F1 and F4 supported
+#endif
+
+
+namespace stm32plus {
+
+  /**
+   * Interface to a pair of DMA channels that the transaction engine can use to move
+   * the data phase of long transfers. See I2CMasterDmaAdapter for the implementation
+   * that connects the engine to the I2CDmaWriterFeature and I2CDmaReaderFeature classes.
+   */
+
+  class I2CMasterDma {
+
+    public:
+      virtual ~I2CMasterDma() {}
+
+      virtual void beginWrite(const uint8_t *data,uint32_t count)=0;
+      virtual void beginRead(uint8_t *data,uint32_t count)=0;
+  };
+
+
+  /**
+   * Asynchronous I2C master. Transactions are queued with submit() and executed back-to-back
+   * from the I2C event and error interrupts so the caller never waits on the bus. Completion
+   * is signalled through the transaction's status member and the I2CTransactionComplete event,
+   * which is raised from IRQ context.
+   *
+   * The engine is driven by the I2CEventType notifications raised by the I2C interrupt
+   * handlers. Use it through the I2CMasterInterruptFeature template, which wires up the
+   * interrupts for you.
+   *
+   * checkTimeout() must be called periodically from normal code. As well as catching stalled
+   * transactions it starts a queued transaction that could not start from IRQ context because
+   * the previous STOP was still on the bus.
+   */
+
+  class I2CMasterTransactionEngine : public I2CTransactionEventSource {
+
+    protected:
+
+      /**
+       * Engine states
+       */
+
+      enum class State : uint8_t {
+        IDLE,
+        WRITE_START,          // START sent, waiting for SB
+        WRITE_ADDRESS,        // address sent, waiting for ADDR
+        WRITE_DATA,           // feeding DR from TXE
+        WRITE_DMA,            // DMA is feeding DR, waiting for BTF
+        WRITE_LAST,           // last byte in DR, waiting for BTF
+        READ_START,           // (repeated) START sent, waiting for SB
+        READ_ADDRESS,         // address sent, waiting for ADDR
+        READ_DATA,            // draining DR from RXNE
+        READ_LAST3,           // 3 bytes left, waiting for BTF
+        READ_LAST2,           // 2 bytes left, waiting for BTF
+        READ_DMA,             // DMA is draining DR, waiting for DMA complete
+        STOP_PENDING          // next transaction waiting for the last STOP to clear
+      };
+
+      I2C& _i2c;
+      I2C_TypeDef *_peripheral;
+      I2CTransaction * volatile _head;
+      I2CTransaction * volatile _tail;
+      I2CMasterDma *_dma;
+      uint32_t _timeout;
+      uint32_t _startTime;
+      const uint8_t *_writePtr;
+      uint8_t *_readPtr;
+      uint16_t _remaining;
+      uint16_t _dmaThreshold;
+      volatile State _state;
+
+    protected:
+      void startNext();
+      void endWritePhase();
+      void complete(I2CTransaction::Status status,uint32_t errorCode);
+      void abort(uint32_t errorCode);
+
+      void onStartBitSent();
+      void onAddressSent();
+      void onReadyToTransmit();
+      void onByteTransferFinished();
+      void onReceive();
+
+    public:
+      I2CMasterTransactionEngine(I2C& i2c);
+
+      bool submit(I2CTransaction& transaction);
+      bool isIdle() const;
+
+      void setTimeout(uint32_t timeout);
+      void setDma(I2CMasterDma *dma,uint16_t threshold=16);
+
+      bool checkTimeout();
+      void recoverBus();
+
+      // event subscriptions
+
+      void onInterrupt(I2CEventType iet);
+      void onDmaComplete(bool success);
+  };
+
+
+  /**
+   * Constructor
+   * @param i2c The I2C peripheral that we are driving
+   */
+
+  inline I2CMasterTransactionEngine::I2CMasterTransactionEngine(I2C& i2c)
+    : _i2c(i2c),
+      _peripheral(i2c),
+      _head(nullptr),
+      _tail(nullptr),
+      _dma(nullptr),
+      _timeout(1000),
+      _startTime(0),
+      _writePtr(nullptr),
+      _readPtr(nullptr),
+      _remaining(0),
+      _dmaThreshold(0),
+      _state(State::IDLE) {
+  }
+
+
+  /**
+   * Check if the engine has no transaction in progress or queued
+   * @return true if idle
+   */
+
+  inline bool I2CMasterTransactionEngine::isIdle() const {
+    return _head==nullptr;
+  }
+
+
+  /**
+   * Set the timeout used by checkTimeout()
+   * @param timeout The maximum time in milliseconds that a transaction may spend on the bus
+   */
+
+  inline void I2CMasterTransactionEngine::setTimeout(uint32_t timeout) {
+    _timeout=timeout;
+  }
+}
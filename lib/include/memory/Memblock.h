@@ -128,13 +128,25 @@ namespace stm32plus {
        */
 
       void reallocate(uint32_t newSize) {
+        reallocate(newSize,_size);
+      }
+
+
+      /**
+       * Reallocate to handle new data, copying only the part of the block that's in use.
+       * Only increases are supported.
+       * @param[in] newSize The size to increase to.
+       * @param[in] usedSize The number of types at the start of the block to preserve.
+       */
+
+      void reallocate(uint32_t newSize,uint32_t usedSize) {
         T *newData;
 
         if(_data==nullptr)
           allocate(newSize);
         else {
           newData=new T[newSize];
-          memcpy(newData,_data,_size*sizeof(T));
+          memcpy(newData,_data,usedSize*sizeof(T));
           delete [] _data;
           _data=newData;
           _size=newSize;
@@ -0,0 +1,645 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * Open addressing hash table with linear probing over a power-of-two array of slots.
+   * Elements are stored inline in the slot array so there is no per-element allocation.
+   * Deletion shifts the following elements of the probe sequence back into the hole so
+   * there are no tombstones and lookups never slow down as the table ages.
+   *
+   * The user hash is mixed with a Fibonacci multiply before it's reduced to a slot index
+   * so identity hashes such as std::hash<uint32_t> are fine.
+   *
+   * This base class does not own the slot array and never grows. Use flat_hash_map for a
+   * heap-backed table that grows on demand or fixed_flat_hash_map for a table with inline
+   * storage that never touches the heap.
+   *
+   * @tparam TKey The key type
+   * @tparam TValue The mapped type
+   * @tparam THash Hash function object, default std::hash<TKey>
+   * @tparam TEqual Key equality function object, default std::equal_to<TKey>
+   */
+
+  template<class TKey,class TValue,class THash=std::hash<TKey>,class TEqual=std::equal_to<TKey> >
+  class flat_hash_map_base {
+
+    public:
+      typedef std::pair<TKey,TValue> value_type;
+
+
+      /**
+       * A slot in the table. The value is only constructed when the slot is used.
+       */
+
+      struct Slot {
+
+        union {
+          value_type value;
+        };
+
+        bool used;
+
+        Slot() {}
+        ~Slot() {}
+      };
+
+
+      /**
+       * Forward iterator over the used slots. Do not modify the key through the iterator.
+       */
+
+      class iterator {
+
+        protected:
+          Slot *_slot;
+          Slot *_end;
+
+        public:
+          iterator(Slot *slot,Slot *end)
+            : _slot(slot),
+              _end(end) {
+            skip();
+          }
+
+          void skip() {
+            while(_slot!=_end && !_slot->used)
+              _slot++;
+          }
+
+          value_type& operator*() const { return _slot->value; }
+          value_type *operator->() const { return &_slot->value; }
+          iterator& operator++() { _slot++; skip(); return *this; }
+          bool operator==(const iterator& rhs) const { return _slot==rhs._slot; }
+          bool operator!=(const iterator& rhs) const { return _slot!=rhs._slot; }
+      };
+
+    protected:
+      Slot *_slots;
+      uint32_t _capacity;
+      uint32_t _size;
+      uint8_t _shift;
+      THash _hash;
+      TEqual _equal;
+
+    protected:
+      flat_hash_map_base();
+      ~flat_hash_map_base();
+
+      void attach(Slot *slots,uint32_t capacity);
+      uint32_t home(const TKey& key) const;
+      uint32_t findIndex(const TKey& key) const;
+      void destroyAll();
+
+      template<class... TArgs>
+      std::pair<iterator,bool> insertNoGrow(const TKey& key,TArgs&&... args);
+
+    public:
+      iterator begin() { return iterator(_slots,_slots+_capacity); }
+      iterator end() { return iterator(_slots+_capacity,_slots+_capacity); }
+
+      iterator find(const TKey& key);
+      bool contains(const TKey& key) const;
+      bool erase(const TKey& key);
+      void clear();
+
+      uint32_t size() const;
+      bool empty() const;
+      uint32_t capacity() const;
+      uint32_t max_size() const;
+  };
+
+
+  /**
+   * Heap-backed flat hash map that doubles its capacity when the load factor exceeds 3/4.
+   * There is no operator[] because it would have nothing to return when the map can't grow.
+   * Use emplace(key), which default constructs a missing value, and check the iterator
+   * against end().
+   * @tparam TAllocator The allocator, rebound internally to the slot type
+   */
+
+  template<class TKey,class TValue,class THash=std::hash<TKey>,class TEqual=std::equal_to<TKey>,class TAllocator=std::allocator<std::pair<TKey,TValue> > >
+  class flat_hash_map : public flat_hash_map_base<TKey,TValue,THash,TEqual> {
+
+    public:
+      typedef flat_hash_map_base<TKey,TValue,THash,TEqual> base_type;
+      typedef typename base_type::value_type value_type;
+      typedef typename base_type::Slot Slot;
+      typedef typename base_type::iterator iterator;
+      typedef typename TAllocator::template rebind<Slot>::other allocator_type;
+
+    protected:
+      allocator_type _allocator;
+
+    protected:
+      bool rehash(uint32_t newCapacity);
+
+    public:
+      flat_hash_map(uint32_t initialCapacity=0,const TAllocator& allocator=TAllocator());
+      ~flat_hash_map();
+
+      flat_hash_map(const flat_hash_map&)=delete;
+      flat_hash_map& operator=(const flat_hash_map&)=delete;
+
+      bool reserve(uint32_t count);
+
+      std::pair<iterator,bool> insert(const TKey& key,const TValue& value);
+
+      template<class... TArgs>
+      std::pair<iterator,bool> emplace(const TKey& key,TArgs&&... args);
+  };
+
+
+  /**
+   * Fixed capacity flat hash map with inline storage. It never allocates so it can be a
+   * static or a member without touching the heap. Inserts fail when the map is 3/4 full.
+   * @tparam TCapacity The number of slots, must be a power of two
+   */
+
+  template<class TKey,class TValue,uint32_t TCapacity,class THash=std::hash<TKey>,class TEqual=std::equal_to<TKey> >
+  class fixed_flat_hash_map : public flat_hash_map_base<TKey,TValue,THash,TEqual> {
+
+    static_assert(TCapacity>=2 && (TCapacity & (TCapacity-1))==0,"capacity must be a power of two");
+
+    public:
+      typedef flat_hash_map_base<TKey,TValue,THash,TEqual> base_type;
+      typedef typename base_type::value_type value_type;
+      typedef typename base_type::Slot Slot;
+      typedef typename base_type::iterator iterator;
+
+    protected:
+      Slot _storage[TCapacity];
+
+    public:
+      fixed_flat_hash_map();
+      ~fixed_flat_hash_map();
+
+      fixed_flat_hash_map(const fixed_flat_hash_map&)=delete;
+      fixed_flat_hash_map& operator=(const fixed_flat_hash_map&)=delete;
+
+      std::pair<iterator,bool> insert(const TKey& key,const TValue& value);
+
+      template<class... TArgs>
+      std::pair<iterator,bool> emplace(const TKey& key,TArgs&&... args);
+  };
+
+
+  /**
+   * Constructor
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline flat_hash_map_base<TKey,TValue,THash,TEqual>::flat_hash_map_base()
+    : _slots(nullptr),
+      _capacity(0),
+      _size(0),
+      _shift(32) {
+  }
+
+
+  /**
+   * Destructor. The derived class owns the slot array and must have called destroyAll().
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline flat_hash_map_base<TKey,TValue,THash,TEqual>::~flat_hash_map_base() {
+  }
+
+
+  /**
+   * Use a new, empty slot array
+   * @param slots The slot array
+   * @param capacity The number of slots, a power of two
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline void flat_hash_map_base<TKey,TValue,THash,TEqual>::attach(Slot *slots,uint32_t capacity) {
+
+    uint32_t i;
+
+    _slots=slots;
+    _capacity=capacity;
+    _size=0;
+
+    for(i=0;i<capacity;i++)
+      slots[i].used=false;
+
+    for(_shift=32;capacity>1;capacity>>=1)
+      _shift--;
+  }
+
+
+  /**
+   * Get the preferred slot for a key
+   * @param key The key
+   * @return The slot index
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline uint32_t flat_hash_map_base<TKey,TValue,THash,TEqual>::home(const TKey& key) const {
+
+    uint32_t h;
+
+    // multiply by 2^32/phi and keep the top bits. a shift of 32 would be undefined so the
+    // single slot case is handled separately
+
+    if(_shift>=32)
+      return 0;
+
+    h=static_cast<uint32_t>(_hash(key));
+    h*=0x9E3779B9U;
+
+    return h >> _shift;
+  }
+
+
+  /**
+   * Find the slot holding a key
+   * @param key The key
+   * @return The slot index or _capacity if not found
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline uint32_t flat_hash_map_base<TKey,TValue,THash,TEqual>::findIndex(const TKey& key) const {
+
+    uint32_t i,mask;
+
+    if(_size==0)
+      return _capacity;
+
+    mask=_capacity-1;
+
+    for(i=home(key);_slots[i].used;i=(i+1) & mask)
+      if(_equal(_slots[i].value.first,key))
+        return i;
+
+    return _capacity;
+  }
+
+
+  /**
+   * Insert if there is room and the key is not already present
+   * @param key The key
+   * @param args The arguments for the TValue constructor
+   * @return The iterator and true if inserted. If the key exists the iterator points to it and
+   *   the flag is false. If there is no room the iterator is end() and the flag is false.
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  template<class... TArgs>
+  inline std::pair<typename flat_hash_map_base<TKey,TValue,THash,TEqual>::iterator,bool>
+  flat_hash_map_base<TKey,TValue,THash,TEqual>::insertNoGrow(const TKey& key,TArgs&&... args) {
+
+    uint32_t i,mask;
+
+    if(_capacity) {
+
+      mask=_capacity-1;
+
+      for(i=home(key);_slots[i].used;i=(i+1) & mask)
+        if(_equal(_slots[i].value.first,key))
+          return std::pair<iterator,bool>(iterator(_slots+i,_slots+_capacity),false);
+
+      if(_size<max_size()) {
+
+        new (&_slots[i].value) value_type(key,TValue(static_cast<TArgs&&>(args)...));
+        _slots[i].used=true;
+        _size++;
+
+        return std::pair<iterator,bool>(iterator(_slots+i,_slots+_capacity),true);
+      }
+    }
+
+    return std::pair<iterator,bool>(end(),false);
+  }
+
+
+  /**
+   * Find a key
+   * @param key The key
+   * @return The iterator, end() if not found
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline typename flat_hash_map_base<TKey,TValue,THash,TEqual>::iterator flat_hash_map_base<TKey,TValue,THash,TEqual>::find(const TKey& key) {
+    return iterator(_slots+findIndex(key),_slots+_capacity);
+  }
+
+
+  /**
+   * Check for a key
+   * @param key The key
+   * @return true if present
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline bool flat_hash_map_base<TKey,TValue,THash,TEqual>::contains(const TKey& key) const {
+    return findIndex(key)!=_capacity;
+  }
+
+
+  /**
+   * Remove a key. The elements that follow in the same probe run are shifted back so that
+   * no tombstone is left behind.
+   * @param key The key
+   * @return true if it was found and removed
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline bool flat_hash_map_base<TKey,TValue,THash,TEqual>::erase(const TKey& key) {
+
+    uint32_t hole,i,h,mask;
+
+    if((hole=findIndex(key))==_capacity)
+      return false;
+
+    _slots[hole].value.~value_type();
+
+    mask=_capacity-1;
+
+    for(i=(hole+1) & mask;_slots[i].used;i=(i+1) & mask) {
+
+      // an element can fill the hole if its home is not cyclically within (hole,i]
+
+      h=home(_slots[i].value.first);
+
+      if(((i-h) & mask)>=((i-hole) & mask)) {
+        new (&_slots[hole].value) value_type(static_cast<value_type&&>(_slots[i].value));
+        _slots[i].value.~value_type();
+        hole=i;
+      }
+    }
+
+    _slots[hole].used=false;
+    _size--;
+
+    return true;
+  }
+
+
+  /**
+   * Destroy all the elements and mark every slot free
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline void flat_hash_map_base<TKey,TValue,THash,TEqual>::destroyAll() {
+
+    uint32_t i;
+
+    for(i=0;i<_capacity;i++) {
+      if(_slots[i].used) {
+        _slots[i].value.~value_type();
+        _slots[i].used=false;
+      }
+    }
+
+    _size=0;
+  }
+
+
+  /**
+   * Remove all the elements. The capacity is unchanged.
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline void flat_hash_map_base<TKey,TValue,THash,TEqual>::clear() {
+    destroyAll();
+  }
+
+
+  /**
+   * Get the number of elements
+   * @return The element count
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline uint32_t flat_hash_map_base<TKey,TValue,THash,TEqual>::size() const {
+    return _size;
+  }
+
+
+  /**
+   * Check for no elements
+   * @return true if empty
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline bool flat_hash_map_base<TKey,TValue,THash,TEqual>::empty() const {
+    return _size==0;
+  }
+
+
+  /**
+   * Get the number of slots
+   * @return The slot count
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline uint32_t flat_hash_map_base<TKey,TValue,THash,TEqual>::capacity() const {
+    return _capacity;
+  }
+
+
+  /**
+   * Get the number of elements that can be stored before the table must grow. The load
+   * factor is kept at or below 3/4 so probe runs stay short. There is always at least one
+   * free slot so that an unsuccessful probe terminates.
+   * @return The maximum size at the current capacity
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual>
+  inline uint32_t flat_hash_map_base<TKey,TValue,THash,TEqual>::max_size() const {
+
+    if(_capacity<4)
+      return _capacity ? _capacity-1 : 0;
+
+    return _capacity-_capacity/4;
+  }
+
+
+  /**
+   * Constructor
+   * @param initialCapacity The number of elements to reserve space for. Zero means that
+   *   nothing is allocated until the first insert.
+   * @param allocator The allocator
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual,class TAllocator>
+  inline flat_hash_map<TKey,TValue,THash,TEqual,TAllocator>::flat_hash_map(uint32_t initialCapacity,const TAllocator& allocator)
+    : _allocator(allocator) {
+
+    if(initialCapacity)
+      reserve(initialCapacity);
+  }
+
+
+  /**
+   * Destructor
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual,class TAllocator>
+  inline flat_hash_map<TKey,TValue,THash,TEqual,TAllocator>::~flat_hash_map() {
+
+    if(this->_slots) {
+      this->destroyAll();
+      _allocator.deallocate(this->_slots,this->_capacity);
+    }
+  }
+
+
+  /**
+   * Make room for at least count elements without further growth
+   * @param count The number of elements
+   * @return false if the memory could not be allocated
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual,class TAllocator>
+  inline bool flat_hash_map<TKey,TValue,THash,TEqual,TAllocator>::reserve(uint32_t count) {
+
+    uint32_t newCapacity;
+
+    for(newCapacity=4;newCapacity-newCapacity/4<count;newCapacity<<=1);
+
+    if(newCapacity<=this->_capacity)
+      return true;
+
+    return rehash(newCapacity);
+  }
+
+
+  /**
+   * Move all the elements into a new slot array
+   * @param newCapacity The new number of slots, a power of two
+   * @return false if the memory could not be allocated
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual,class TAllocator>
+  inline bool flat_hash_map<TKey,TValue,THash,TEqual,TAllocator>::rehash(uint32_t newCapacity) {
+
+    Slot *oldSlots,*newSlots;
+    uint32_t i,oldCapacity;
+
+    if((newSlots=_allocator.allocate(newCapacity))==nullptr)
+      return false;
+
+    oldSlots=this->_slots;
+    oldCapacity=this->_capacity;
+
+    this->attach(newSlots,newCapacity);
+
+    if(oldSlots) {
+
+      for(i=0;i<oldCapacity;i++) {
+
+        if(oldSlots[i].used) {
+          this->insertNoGrow(oldSlots[i].value.first,static_cast<TValue&&>(oldSlots[i].value.second));
+          oldSlots[i].value.~value_type();
+        }
+      }
+
+      _allocator.deallocate(oldSlots,oldCapacity);
+    }
+
+    return true;
+  }
+
+
+  /**
+   * Insert a key/value pair if the key is not already present
+   * @param key The key
+   * @param value The value
+   * @return The iterator and true if inserted, or the existing element and false
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual,class TAllocator>
+  inline std::pair<typename flat_hash_map<TKey,TValue,THash,TEqual,TAllocator>::iterator,bool>
+  flat_hash_map<TKey,TValue,THash,TEqual,TAllocator>::insert(const TKey& key,const TValue& value) {
+    return emplace(key,value);
+  }
+
+
+  /**
+   * Construct a value in place if the key is not already present
+   * @param key The key
+   * @param args The arguments for the TValue constructor
+   * @return The iterator and true if inserted, or the existing element and false. If memory
+   *   could not be allocated then end() and false are returned.
+   */
+
+  template<class TKey,class TValue,class THash,class TEqual,class TAllocator>
+  template<class... TArgs>
+  inline std::pair<typename flat_hash_map<TKey,TValue,THash,TEqual,TAllocator>::iterator,bool>
+  flat_hash_map<TKey,TValue,THash,TEqual,TAllocator>::emplace(const TKey& key,TArgs&&... args) {
+
+    // grow only if the key is new and there's no room for it
+
+    if(this->_size>=this->max_size()) {
+
+      iterator it=this->find(key);
+
+      if(it!=this->end())
+        return std::pair<iterator,bool>(it,false);
+
+      if(!rehash(this->_capacity ? this->_capacity*2 : 4))
+        return std::pair<iterator,bool>(this->end(),false);
+    }
+
+    return this->insertNoGrow(key,static_cast<TArgs&&>(args)...);
+  }
+
+
+  /**
+   * Constructor
+   */
+
+  template<class TKey,class TValue,uint32_t TCapacity,class THash,class TEqual>
+  inline fixed_flat_hash_map<TKey,TValue,TCapacity,THash,TEqual>::fixed_flat_hash_map() {
+    this->attach(_storage,TCapacity);
+  }
+
+
+  /**
+   * Destructor
+   */
+
+  template<class TKey,class TValue,uint32_t TCapacity,class THash,class TEqual>
+  inline fixed_flat_hash_map<TKey,TValue,TCapacity,THash,TEqual>::~fixed_flat_hash_map() {
+    this->destroyAll();
+  }
+
+
+  /**
+   * Insert a key/value pair if the key is not already present and there is room
+   * @param key The key
+   * @param value The value
+   * @return The iterator and true if inserted. See flat_hash_map_base::insertNoGrow.
+   */
+
+  template<class TKey,class TValue,uint32_t TCapacity,class THash,class TEqual>
+  inline std::pair<typename fixed_flat_hash_map<TKey,TValue,TCapacity,THash,TEqual>::iterator,bool>
+  fixed_flat_hash_map<TKey,TValue,TCapacity,THash,TEqual>::insert(const TKey& key,const TValue& value) {
+    return this->insertNoGrow(key,value);
+  }
+
+
+  /**
+   * Construct a value in place if the key is not already present and there is room
+   * @param key The key
+   * @param args The arguments for the TValue constructor
+   * @return The iterator and true if inserted. See flat_hash_map_base::insertNoGrow.
+   */
+
+  template<class TKey,class TValue,uint32_t TCapacity,class THash,class TEqual>
+  template<class... TArgs>
+  inline std::pair<typename fixed_flat_hash_map<TKey,TValue,TCapacity,THash,TEqual>::iterator,bool>
+  fixed_flat_hash_map<TKey,TValue,TCapacity,THash,TEqual>::emplace(const TKey& key,TArgs&&... args) {
+    return this->insertNoGrow(key,static_cast<TArgs&&>(args)...);
+  }
+}
@@ -0,0 +1,372 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * Vector with inline storage for the first TInline elements. Nothing is allocated until
+   * the inline storage is full, after which the elements move to the heap and the capacity
+   * doubles on each growth so a sequence of push_back() calls is linear time.
+   *
+   * @tparam T The element type
+   * @tparam TInline The number of elements stored inline
+   * @tparam TAllocator The allocator for the heap storage
+   */
+
+  template<class T,uint32_t TInline,class TAllocator=std::allocator<T> >
+  class small_vector {
+
+    static_assert(TInline>0,"inline capacity must be at least one");
+
+    public:
+      typedef T value_type;
+      typedef T *iterator;
+      typedef const T *const_iterator;
+
+    protected:
+
+      /**
+       * Uninitialised inline storage
+       */
+
+      union Storage {
+        T items[TInline];
+
+        Storage() {}
+        ~Storage() {}
+      };
+
+      Storage _inline;
+      T *_data;
+      uint32_t _size;
+      uint32_t _capacity;
+      TAllocator _allocator;
+
+    protected:
+      bool isInline() const;
+      bool grow(uint32_t minCapacity);
+      T *allocate(uint32_t minCapacity,uint32_t& newCapacity);
+      void relocate(T *newData,uint32_t newCapacity);
+      void release();
+
+    public:
+      small_vector(const TAllocator& allocator=TAllocator());
+      small_vector(const small_vector& src);
+      ~small_vector();
+
+      small_vector& operator=(const small_vector& src);
+
+      bool reserve(uint32_t count);
+      bool resize(uint32_t count);
+
+      bool push_back(const T& value);
+
+      template<class... TArgs>
+      bool emplace_back(TArgs&&... args);
+
+      void pop_back();
+      iterator erase(iterator pos);
+      void clear();
+
+      uint32_t size() const { return _size; }
+      uint32_t capacity() const { return _capacity; }
+      bool empty() const { return _size==0; }
+
+      T *data() { return _data; }
+      const T *data() const { return _data; }
+
+      iterator begin() { return _data; }
+      iterator end() { return _data+_size; }
+      const_iterator begin() const { return _data; }
+      const_iterator end() const { return _data+_size; }
+
+      T& operator[](uint32_t index) { return _data[index]; }
+      const T& operator[](uint32_t index) const { return _data[index]; }
+
+      T& front() { return _data[0]; }
+      T& back() { return _data[_size-1]; }
+      const T& front() const { return _data[0]; }
+      const T& back() const { return _data[_size-1]; }
+  };
+
+
+  /**
+   * Constructor
+   * @param allocator The allocator used when the inline storage overflows
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline small_vector<T,TInline,TAllocator>::small_vector(const TAllocator& allocator)
+    : _data(_inline.items),
+      _size(0),
+      _capacity(TInline),
+      _allocator(allocator) {
+  }
+
+
+  /**
+   * Copy constructor
+   * @param src The vector to copy
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline small_vector<T,TInline,TAllocator>::small_vector(const small_vector& src)
+    : _data(_inline.items),
+      _size(0),
+      _capacity(TInline),
+      _allocator(src._allocator) {
+
+    *this=src;
+  }
+
+
+  /**
+   * Destructor
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline small_vector<T,TInline,TAllocator>::~small_vector() {
+    clear();
+    release();
+  }
+
+
+  /**
+   * Assignment
+   * @param src The vector to copy
+   * @return self reference
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline small_vector<T,TInline,TAllocator>& small_vector<T,TInline,TAllocator>::operator=(const small_vector& src) {
+
+    uint32_t i;
+
+    if(this!=&src) {
+
+      clear();
+
+      if(reserve(src._size))
+        for(i=0;i<src._size;i++)
+          new (_data+i) T(src._data[i]);
+
+      _size=src._size<=_capacity ? src._size : 0;
+    }
+
+    return *this;
+  }
+
+
+  /**
+   * Check if the elements are in the inline storage
+   * @return true if inline
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline bool small_vector<T,TInline,TAllocator>::isInline() const {
+    return _data==_inline.items;
+  }
+
+
+  /**
+   * Free the heap storage, if any, and return to inline storage. The vector must be empty.
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline void small_vector<T,TInline,TAllocator>::release() {
+
+    if(!isInline()) {
+      _allocator.deallocate(_data,_capacity);
+      _data=_inline.items;
+      _capacity=TInline;
+    }
+  }
+
+
+  /**
+   * Move the elements to a larger heap block. The capacity at least doubles.
+   * @param minCapacity The minimum capacity required
+   * @return false if out of memory
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline bool small_vector<T,TInline,TAllocator>::grow(uint32_t minCapacity) {
+
+    uint32_t newCapacity;
+    T *newData;
+
+    if((newData=allocate(minCapacity,newCapacity))==nullptr)
+      return false;
+
+    relocate(newData,newCapacity);
+    return true;
+  }
+
+
+  /**
+   * Allocate a heap block for growth. The capacity at least doubles.
+   * @param minCapacity The minimum capacity required
+   * @param[out] newCapacity The capacity of the new block
+   * @return The uninitialised block, nullptr if out of memory
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline T *small_vector<T,TInline,TAllocator>::allocate(uint32_t minCapacity,uint32_t& newCapacity) {
+
+    newCapacity=_capacity*2;
+
+    if(newCapacity<minCapacity)
+      newCapacity=minCapacity;
+
+    return _allocator.allocate(newCapacity);
+  }
+
+
+  /**
+   * Move the elements to a new block from allocate() and release the old storage
+   * @param newData The new block
+   * @param newCapacity Its capacity
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline void small_vector<T,TInline,TAllocator>::relocate(T *newData,uint32_t newCapacity) {
+
+    uint32_t i;
+
+    for(i=0;i<_size;i++) {
+      new (newData+i) T(static_cast<T&&>(_data[i]));
+      _data[i].~T();
+    }
+
+    if(!isInline())
+      _allocator.deallocate(_data,_capacity);
+
+    _data=newData;
+    _capacity=newCapacity;
+  }
+
+
+  /**
+   * Ensure capacity for count elements
+   * @param count The number of elements
+   * @return false if out of memory
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline bool small_vector<T,TInline,TAllocator>::reserve(uint32_t count) {
+    return count<=_capacity || grow(count);
+  }
+
+
+  /**
+   * Change the number of elements. New elements are default constructed.
+   * @param count The new size
+   * @return false if out of memory
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline bool small_vector<T,TInline,TAllocator>::resize(uint32_t count) {
+
+    if(!reserve(count))
+      return false;
+
+    while(_size>count)
+      pop_back();
+
+    while(_size<count)
+      new (_data+_size++) T();
+
+    return true;
+  }
+
+
+  /**
+   * Append a copy of an element
+   * @param value The element
+   * @return false if out of memory
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline bool small_vector<T,TInline,TAllocator>::push_back(const T& value) {
+    return emplace_back(value);
+  }
+
+
+  /**
+   * Construct an element on the end
+   * @param args The constructor arguments
+   * @return false if out of memory
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  template<class... TArgs>
+  inline bool small_vector<T,TInline,TAllocator>::emplace_back(TArgs&&... args) {
+
+    uint32_t newCapacity;
+    T *newData;
+
+    if(_size==_capacity) {
+
+      // the arguments may refer to an element, e.g. v.push_back(v[0]), so the new element is
+      // constructed in the new block before the old elements are moved out and destroyed
+
+      if((newData=allocate(_size+1,newCapacity))==nullptr)
+        return false;
+
+      new (newData+_size) T(static_cast<TArgs&&>(args)...);
+      relocate(newData,newCapacity);
+    }
+    else
+      new (_data+_size) T(static_cast<TArgs&&>(args)...);
+
+    _size++;
+
+    return true;
+  }
+
+
+  /**
+   * Remove the last element
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline void small_vector<T,TInline,TAllocator>::pop_back() {
+    _data[--_size].~T();
+  }
+
+
+  /**
+   * Remove an element, moving the ones after it down
+   * @param pos The element to remove
+   * @return An iterator to the element that followed the removed one
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline typename small_vector<T,TInline,TAllocator>::iterator small_vector<T,TInline,TAllocator>::erase(iterator pos) {
+
+    iterator it;
+
+    for(it=pos;it+1!=end();it++)
+      *it=static_cast<T&&>(*(it+1));
+
+    pop_back();
+    return pos;
+  }
+
+
+  /**
+   * Remove all the elements. Heap storage is kept for reuse.
+   */
+
+  template<class T,uint32_t TInline,class TAllocator>
+  inline void small_vector<T,TInline,TAllocator>::clear() {
+    while(_size)
+      pop_back();
+  }
+}
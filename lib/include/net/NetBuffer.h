@@ -23,6 +23,7 @@ namespace stm32plus {
       protected:
         const void *_userBuffer;
         uint32_t _userBufferSize;
+        void *_ownedUserBuffer;       // a copy of the user buffer made by ownUserBuffer()
 
         void *_internalBuffer;
         uint32_t _internalBufferSize;
@@ -56,6 +57,8 @@ namespace stm32plus {
         NetBuffer *getReference() const;
         void setReference(NetBuffer *reference);
 
+        bool ownUserBuffer();
+
         DatalinkChecksum getChecksumRequest() const;
         void setChecksumRequest(DatalinkChecksum checksumRequest);
     };
@@ -72,6 +75,7 @@ namespace stm32plus {
 
       _userBufferSize=userBufferSize;
       _userBuffer=userBuffer;
+      _ownedUserBuffer=nullptr;
 
       // allocate space for net buffer and position the write pointer past the end
 
@@ -86,8 +90,12 @@ namespace stm32plus {
      */
 
     inline NetBuffer::~NetBuffer() {
+
       if(_internalBuffer)
         free(_internalBuffer);
+
+      if(_ownedUserBuffer)
+        free(_ownedUserBuffer);
     }
 
 
@@ -189,6 +197,29 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Replace the user buffer with a copy that this buffer owns. This must be done before the
+     * buffer is kept beyond the send call that created it because the caller is free to reuse
+     * its memory once the call returns. For a fragment it also removes the dependency on the
+     * original packet that's kept alive by the last fragment's reference.
+     * @return false if there was not enough memory for the copy
+     */
+
+    inline bool NetBuffer::ownUserBuffer() {
+
+      if(_userBuffer==nullptr || _userBufferSize==0 || _ownedUserBuffer!=nullptr)
+        return true;
+
+      if((_ownedUserBuffer=malloc(_userBufferSize))==nullptr)
+        return false;
+
+      memcpy(_ownedUserBuffer,_userBuffer,_userBufferSize);
+      _userBuffer=_ownedUserBuffer;
+
+      return true;
+    }
+
+
     /**
      * Get the checksum request type
      * @return The checksum request type
@@ -27,15 +27,20 @@ namespace stm32plus {
           PHY_READ_REQUEST,             ///< request to read a PHY register
           PHY_WRITE_REQUEST,            ///< request to write a PHY register
           ETHERNET_TRANSMIT_REQUEST,    ///< request to send an ethernet frame
+          ETHERNET_BATCH_TRANSMIT_REQUEST,  ///< request to send several ethernet frames to the same destination
           DATALINK_FRAME,               ///< Datalink frame arrived
           DATALINK_FRAME_SENT,          ///< Datalink frame sent on to the wire
+          DATALINK_MULTICAST_FILTER,    ///< start or stop receiving a multicast MAC address
           IP_PACKET,                    ///< IP packet arrived
           IP_TRANSMIT_REQUEST,          ///< an IP packet needs to be transmitted
+          IP_LARGE_SEND_REQUEST,        ///< a run of protocol segments needs to be transmitted
           IP_ADDRESS_MAPPING,         ///< an association between a MAC and an IP is being notified
+          IP_MULTICAST_MEMBERSHIP,      ///< a multicast group has been joined or left
           ICMP_PACKET,                  ///< an ICMP packet has been received
           ICMP_TRANSMIT_REQUEST,        ///< an ICMP packet should be sent
           UDP_DATAGRAM,                 ///< a UDP datagram has been received
           ARP_MAPPING_REQUEST,          ///< a request to get an ARP mapping
+          ARP_PENDING_FRAME,            ///< a frame that must wait for an ARP mapping
           ARP_FRAME,                    ///< an ARP frame has been received
           IP_ADDRESS_ANNOUNCEMENT,      ///< a new ip address has been assigned
           SUBNET_MASK_ANNOUNCEMENT,     ///< a new subnet mask has been assigned
@@ -52,6 +57,7 @@ namespace stm32plus {
           TCP_CONNECTION_CLOSED,        ///< TCP remote end has closed
           TCP_CONNECTION_DATA_READY,    ///< we have buffered some data from the remote end
           TCP_CONNECTION_STATE_CHANGED, ///< the state of a TCP connection has changed
+          TCP_DELAYED_ACK_TIMER,        ///< time for TCP connections to send ACKs that they've been delaying
           DEBUG_MESSAGE                 ///< message for debugging
         };
 
@@ -0,0 +1,145 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * A histogram of latencies in microseconds with power of two buckets. Bucket zero counts
+     * latencies under 1us, bucket n counts latencies of at least 2^(n-1)us and under 2^n us and
+     * the last bucket counts everything from 2^(BUCKETS-2)us upwards. Recording a sample is a count
+     * leading zeros and a few adds so it's cheap enough for the receive and transmit interrupts.
+     */
+
+    class NetLatencyHistogram {
+
+      public:
+        enum {
+          BUCKETS = 16                  ///< the last bucket holds latencies of 16.384ms and above
+        };
+
+      protected:
+        uint32_t _buckets[BUCKETS];
+        uint32_t _count;
+        uint32_t _maximum;
+        uint64_t _total;
+
+      public:
+        NetLatencyHistogram();
+
+        void record(uint32_t micros);
+        void reset();
+
+        uint32_t getBucket(uint8_t bucket) const;
+        uint32_t getCount() const;
+        uint32_t getMaximum() const;
+        uint32_t getAverage() const;
+
+        static uint32_t getBucketLimit(uint8_t bucket);
+    };
+
+
+    /**
+     * Constructor
+     */
+
+    inline NetLatencyHistogram::NetLatencyHistogram() {
+      reset();
+    }
+
+
+    /**
+     * Add a sample to the histogram
+     * @param micros The latency in microseconds
+     */
+
+    inline void NetLatencyHistogram::record(uint32_t micros) {
+
+      uint8_t bucket;
+
+      // the bucket is the number of significant bits in the sample
+
+      bucket=micros==0 ? 0 : 32-__builtin_clz(micros);
+
+      if(bucket>=BUCKETS)
+        bucket=BUCKETS-1;
+
+      _buckets[bucket]++;
+      _count++;
+      _total+=micros;
+
+      if(micros>_maximum)
+        _maximum=micros;
+    }
+
+
+    /**
+     * Clear all the samples
+     */
+
+    inline void NetLatencyHistogram::reset() {
+      memset(_buckets,0,sizeof(_buckets));
+      _count=_maximum=0;
+      _total=0;
+    }
+
+
+    /**
+     * Get the number of samples in a bucket
+     * @param bucket The bucket number, 0..BUCKETS-1
+     * @return The number of samples
+     */
+
+    inline uint32_t NetLatencyHistogram::getBucket(uint8_t bucket) const {
+      return _buckets[bucket];
+    }
+
+
+    /**
+     * Get the total number of samples
+     * @return The number of samples
+     */
+
+    inline uint32_t NetLatencyHistogram::getCount() const {
+      return _count;
+    }
+
+
+    /**
+     * Get the largest sample
+     * @return The maximum latency in microseconds
+     */
+
+    inline uint32_t NetLatencyHistogram::getMaximum() const {
+      return _maximum;
+    }
+
+
+    /**
+     * Get the mean of the samples
+     * @return The average latency in microseconds, zero if there are no samples
+     */
+
+    inline uint32_t NetLatencyHistogram::getAverage() const {
+      return _count ? static_cast<uint32_t>(_total/_count) : 0;
+    }
+
+
+    /**
+     * Get the exclusive upper limit of a bucket, for labelling a dump of the histogram
+     * @param bucket The bucket number
+     * @return The limit in microseconds, or zero for the last bucket which has no limit
+     */
+
+    inline uint32_t NetLatencyHistogram::getBucketLimit(uint8_t bucket) {
+      return bucket>=BUCKETS-1 ? 0 : 1UL << bucket;
+    }
+  }
+}
@@ -0,0 +1,194 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * Iterator over kind-length-value options such as those in TCP headers and DHCP packets.
+     * The options are read where they lie. Single byte end and padding options are understood
+     * and every option is checked to be inside the view. Iteration stops at an option that would
+     * run past the end and isMalformed() then returns true.
+     *
+     * Usage:
+     *
+     *   TcpOptionIterator it(view);
+     *   while(it.next()) {
+     *     if(it.getKind()==...)
+     *       it.getValue()...
+     *   }
+     *
+     * @tparam TEndKind The option that ends the list
+     * @tparam TPadKind The single byte padding option
+     * @tparam TLengthIncludesHeader true if the length byte counts the kind and length bytes (TCP),
+     *   false if it counts only the value (DHCP)
+     */
+
+    template<uint8_t TEndKind,uint8_t TPadKind,bool TLengthIncludesHeader>
+    class NetOptionIterator {
+
+      protected:
+        NetView _options;
+        NetView _value;
+        uint16_t _offset;                 ///< where the next option starts
+        uint16_t _current;                ///< where the current option starts
+        uint8_t _kind;
+        bool _malformed;
+
+      public:
+        NetOptionIterator(const NetView& options);
+
+        bool next();
+        bool find(uint8_t kind);
+
+        uint8_t getKind() const;
+        const NetView& getValue() const;
+        bool isMalformed() const;
+
+        template<class T>
+        const T *overlay() const;
+    };
+
+
+    /**
+     * Constructor
+     * @param options The option bytes
+     */
+
+    template<uint8_t TEndKind,uint8_t TPadKind,bool TLengthIncludesHeader>
+    inline NetOptionIterator<TEndKind,TPadKind,TLengthIncludesHeader>::NetOptionIterator(const NetView& options)
+      : _options(options),
+        _offset(0),
+        _current(0),
+        _kind(TEndKind),
+        _malformed(false) {
+    }
+
+
+    /**
+     * Move to the next option
+     * @return false if there are no more options
+     */
+
+    template<uint8_t TEndKind,uint8_t TPadKind,bool TLengthIncludesHeader>
+    inline bool NetOptionIterator<TEndKind,TPadKind,TLengthIncludesHeader>::next() {
+
+      const uint8_t *data;
+      uint16_t length;
+
+      data=_options.getData();
+
+      while(_offset<_options.getSize()) {
+
+        _kind=data[_offset];
+
+        if(_kind==TEndKind)
+          break;
+
+        if(_kind==TPadKind) {
+          _offset++;
+          continue;
+        }
+
+        // must have a length byte and the value must fit
+
+        if(!_options.contains(_offset,2))
+          break;
+
+        length=data[_offset+1];
+
+        if(TLengthIncludesHeader) {
+          if(length<2)
+            break;
+          length-=2;
+        }
+
+        if(!_options.contains(_offset+2,length))
+          break;
+
+        _current=_offset;
+        _value=NetView(data+_offset+2,length);
+        _offset+=2+length;
+
+        return true;
+      }
+
+      // we only get here normally at the end option or the end of the data
+
+      _malformed=_offset<_options.getSize() && _kind!=TEndKind;
+      _offset=_options.getSize();
+      _kind=TEndKind;
+
+      return false;
+    }
+
+
+    /**
+     * Move to the next option of the given kind
+     * @param kind The option to find
+     * @return false if there are no more options of this kind
+     */
+
+    template<uint8_t TEndKind,uint8_t TPadKind,bool TLengthIncludesHeader>
+    inline bool NetOptionIterator<TEndKind,TPadKind,TLengthIncludesHeader>::find(uint8_t kind) {
+
+      while(next())
+        if(_kind==kind)
+          return true;
+
+      return false;
+    }
+
+
+    /**
+     * Get the kind of the current option
+     * @return The option kind
+     */
+
+    template<uint8_t TEndKind,uint8_t TPadKind,bool TLengthIncludesHeader>
+    inline uint8_t NetOptionIterator<TEndKind,TPadKind,TLengthIncludesHeader>::getKind() const {
+      return _kind;
+    }
+
+
+    /**
+     * Get the value of the current option, which is the bytes after the kind and length
+     * @return The value
+     */
+
+    template<uint8_t TEndKind,uint8_t TPadKind,bool TLengthIncludesHeader>
+    inline const NetView& NetOptionIterator<TEndKind,TPadKind,TLengthIncludesHeader>::getValue() const {
+      return _value;
+    }
+
+
+    /**
+     * Check if iteration stopped at an option that runs past the end of the data
+     * @return true if it did
+     */
+
+    template<uint8_t TEndKind,uint8_t TPadKind,bool TLengthIncludesHeader>
+    inline bool NetOptionIterator<TEndKind,TPadKind,TLengthIncludesHeader>::isMalformed() const {
+      return _malformed;
+    }
+
+
+    /**
+     * Get a pointer to a packed structure that starts at the kind byte of the current option
+     * @return The structure, or nullptr if the option is too short for it
+     */
+
+    template<uint8_t TEndKind,uint8_t TPadKind,bool TLengthIncludesHeader>
+    template<class T>
+    inline const T *NetOptionIterator<TEndKind,TPadKind,TLengthIncludesHeader>::overlay() const {
+      return _options.subView(_current,2+_value.getSize()).template overlay<T>();
+    }
+  }
+}
@@ -0,0 +1,234 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * A field at a fixed offset in a protocol structure. The offset and type are fixed at compile
+     * time so reading a field is a load at a constant offset plus the byte swap. Fields don't have
+     * to be aligned. 16 and 32 bit integers are converted from network byte order. Anything else,
+     * e.g. an IpAddress, is copied as it is because it's already kept in network byte order.
+     *
+     * Protocol parsers group their fields in a struct, for example:
+     *
+     *   struct Fields {
+     *     typedef NetField<0,uint16_t> Type;
+     *     typedef NetField<4,uint32_t> Ttl;
+     *     enum { SIZE=8 };
+     *   };
+     *
+     * @tparam TOffset The offset of the field from the start of the structure
+     * @tparam T The type of the field
+     */
+
+    template<uint16_t TOffset,class T>
+    struct NetField {
+
+      typedef T ValueType;
+
+      enum {
+        OFFSET = TOffset,
+        END = TOffset+sizeof(T)           ///< offset of the byte after the field
+      };
+
+
+      /**
+       * Read the field
+       * @param base The start of the structure
+       * @return The value in host byte order
+       */
+
+      static T read(const uint8_t *base) {
+
+        T value;
+
+        memcpy(&value,base+TOffset,sizeof(T));
+        return toHost(value);
+      }
+
+
+      /**
+       * Write the field
+       * @param base The start of the structure
+       * @param value The value in host byte order
+       */
+
+      static void write(uint8_t *base,T value) {
+
+        value=toHost(value);              // the swap is its own inverse
+        memcpy(base+TOffset,&value,sizeof(T));
+      }
+
+      protected:
+        static uint16_t toHost(uint16_t value) { return NetUtil::ntohs(value); }
+        static uint32_t toHost(uint32_t value) { return NetUtil::ntohl(value); }
+
+        template<class TOther>
+        static const TOther& toHost(const TOther& value) { return value; }
+    };
+
+
+    /**
+     * A read-only window on to the bytes of a packet. Nothing is copied, the view just knows where
+     * the bytes are and how many of them there are. Every checked access is tested against that
+     * size so a malformed packet can't make a parser read past its end.
+     */
+
+    class NetView {
+
+      protected:
+        const uint8_t *_data;
+        uint16_t _size;
+
+      public:
+        NetView();
+        NetView(const void *data,uint16_t size);
+
+        const uint8_t *getData() const;
+        uint16_t getSize() const;
+
+        bool contains(uint16_t offset,uint16_t length) const;
+        NetView subView(uint16_t offset,uint16_t length) const;
+        NetView subView(uint16_t offset) const;
+
+        template<class TField>
+        bool get(typename TField::ValueType& value,uint16_t offset=0) const;
+
+        template<class TField>
+        typename TField::ValueType read(uint16_t offset=0) const;
+
+        template<class T>
+        const T *overlay(uint16_t offset=0) const;
+    };
+
+
+    /**
+     * Default constructor: an empty view
+     */
+
+    inline NetView::NetView()
+      : _data(nullptr),
+        _size(0) {
+    }
+
+
+    /**
+     * Constructor
+     * @param data The first byte
+     * @param size The number of bytes
+     */
+
+    inline NetView::NetView(const void *data,uint16_t size)
+      : _data(reinterpret_cast<const uint8_t *>(data)),
+        _size(size) {
+    }
+
+
+    /**
+     * Get the first byte
+     * @return A pointer to the first byte
+     */
+
+    inline const uint8_t *NetView::getData() const {
+      return _data;
+    }
+
+
+    /**
+     * Get the number of bytes in the view
+     * @return The size
+     */
+
+    inline uint16_t NetView::getSize() const {
+      return _size;
+    }
+
+
+    /**
+     * Check that a range of bytes is inside the view
+     * @param offset The start of the range
+     * @param length The number of bytes
+     * @return true if they're all inside
+     */
+
+    inline bool NetView::contains(uint16_t offset,uint16_t length) const {
+      return static_cast<uint32_t>(offset)+length<=_size;
+    }
+
+
+    /**
+     * Get a view of part of this view
+     * @param offset The start of the part
+     * @param length The size of the part
+     * @return The part, or an empty view if it's not all inside this one
+     */
+
+    inline NetView NetView::subView(uint16_t offset,uint16_t length) const {
+      return contains(offset,length) ? NetView(_data+offset,length) : NetView();
+    }
+
+
+    /**
+     * Get a view of the rest of this view
+     * @param offset The start of the part
+     * @return The part from the offset to the end, or an empty view if the offset is past the end
+     */
+
+    inline NetView NetView::subView(uint16_t offset) const {
+      return offset<=_size ? NetView(_data+offset,_size-offset) : NetView();
+    }
+
+
+    /**
+     * Read a field if it's inside the view
+     * @param[out] value The field value
+     * @param offset Where the structure that holds the field starts in this view
+     * @return false if the field is not all inside the view
+     * @tparam TField A NetField type
+     */
+
+    template<class TField>
+    inline bool NetView::get(typename TField::ValueType& value,uint16_t offset) const {
+
+      if(!contains(offset,TField::END))
+        return false;
+
+      value=TField::read(_data+offset);
+      return true;
+    }
+
+
+    /**
+     * Read a field without checking the size. Use this after contains() has checked the size of
+     * the whole structure so that the check is done once and not for every field.
+     * @param offset Where the structure that holds the field starts in this view
+     * @return The field value
+     * @tparam TField A NetField type
+     */
+
+    template<class TField>
+    inline typename TField::ValueType NetView::read(uint16_t offset) const {
+      return TField::read(_data+offset);
+    }
+
+
+    /**
+     * Get a pointer to a packed structure that lies in this view
+     * @param offset Where the structure starts
+     * @return The structure, or nullptr if it's not all inside the view
+     */
+
+    template<class T>
+    inline const T *NetView::overlay(uint16_t offset) const {
+      return contains(offset,sizeof(T)) ? reinterpret_cast<const T *>(_data+offset) : nullptr;
+    }
+  }
+}
@@ -109,9 +109,11 @@ namespace stm32plus {
       // the RTC on those devices is so different.
 
 #if defined(STM32PLUS_F4)
-      _rtcInterruptFeature->ExtiInterruptEventSender.insertSubscriber(ExtiInterruptEventSourceSlot::bind(this,&NetworkIntervalTicker::onTickF4));
+      if(!_rtcInterruptFeature->ExtiInterruptEventSender.insertSubscriber(ExtiInterruptEventSourceSlot::bind(this,&NetworkIntervalTicker::onTickF4)))
+        return false;
 #elif defined(STM32PLUS_F1_CL_E)
-      _rtcInterruptFeature->RtcSecondInterruptEventSender.insertSubscriber(RtcSecondInterruptEventSourceSlot::bind(this,&NetworkIntervalTicker::onTick));
+      if(!_rtcInterruptFeature->RtcSecondInterruptEventSender.insertSubscriber(RtcSecondInterruptEventSourceSlot::bind(this,&NetworkIntervalTicker::onTick)))
+        return false;
 #else
       #error Unsupported MCU
 #endif
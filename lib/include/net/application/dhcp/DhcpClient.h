@@ -99,6 +99,7 @@ namespace stm32plus {
 
         volatile DhcpPacket::MessageType _expectedResponseMessage;  ///< which message type is expected next
         DhcpPacket volatile *_responsePacket;           ///< the received packet
+        uint16_t _responseSize;                         ///< size of the received packet
 
       protected:
         bool stateIdle();
@@ -152,7 +153,7 @@ namespace stm32plus {
     /**
      * Initialise the class
      * @param params The parameters class
-     * @return true always
+     * @return true if it worked
      */
 
     template<class TTransportLayer>
@@ -167,10 +168,17 @@ namespace stm32plus {
       _transactionId=0;
       _expectedResponseMessage=DhcpPacket::MessageType::NONE;
 
+      // claim the response port so that UDP does not drop the responses if it's been asked to
+      // drop datagrams for ports that nobody has acquired
+
+      if(!this->ip_acquireDefinedPort(IpPorts::PORT_DHCP_RESPONSE))
+        return false;
+
       // subscribe to notifications and receive events
 
-      this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&DhcpClient<TTransportLayer>::onNotification));
-      this->UdpReceiveEventSender.insertSubscriber(UdpReceiveEventSourceSlot::bind(this,&DhcpClient<TTransportLayer>::onReceive));
+      if(!this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&DhcpClient<TTransportLayer>::onNotification)) ||
+         !this->UdpReceiveEventSender.insertSubscriber(UdpReceiveEventSourceSlot::bind(this,&DhcpClient<TTransportLayer>::onReceive)))
+        return false;
 
       // start the ticker off as disabled
 
@@ -297,17 +305,15 @@ namespace stm32plus {
 
       // get the server address from the response - it's not volatile now
 
-      uint8_t *options;
-      if((options=const_cast<DhcpPacket *>(_responsePacket)->getOption(54))==nullptr)
-        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_DHCP,E_NO_DHCP_SERVER_OPTION);
-
-      // get the DHCP server address from the response
+      const DhcpPacket *packet(const_cast<const DhcpPacket *>(_responsePacket));
+      NetView value;
 
-      _dhcpServerAddress.ipAddress=*reinterpret_cast<uint32_t *>(options+2);
+      if(!packet->getOption(_responseSize,54,value) || !value.get<NetField<0,IpAddress>>(_dhcpServerAddress))
+        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_DHCP,E_NO_DHCP_SERVER_OPTION);
 
       // get our offered address
 
-      _ipAddress=const_cast<IpAddress&>(_responsePacket->dhcp_yiaddr);
+      _ipAddress=packet->dhcp_yiaddr;
 
       // free the response packet
 
@@ -374,54 +380,50 @@ namespace stm32plus {
     template<class TTransportLayer>
     inline bool DhcpClient<TTransportLayer>::stateAck() {
 
+      IpAddress address;
       uint32_t lease;
 
       // get the information from the response - it's no longer volatile
 
-      _ipAddress=const_cast<IpAddress&>(_responsePacket->dhcp_yiaddr);
+      const DhcpPacket *packet(const_cast<const DhcpPacket *>(_responsePacket));
 
-      uint8_t *options;
-      options=reinterpret_cast<uint8_t *>(const_cast<DhcpPacket *>(_responsePacket))+DhcpPacket::getPacketSize();
+      _ipAddress=packet->dhcp_yiaddr;
 
-      while(*options!=255) {
+      // the options are read in place. a field that's missing from a short option is left alone.
 
-        if(*options==0)             // code 0 is just a null byte
-          options++;
-        else {
-          switch(*options) {
-
-            case 1:                 // subnet mask
-              _subnetMask.ipAddress=*reinterpret_cast<uint32_t *>(options+2);
-              break;
-
-            case 3:                 // router (default gateway)
-              _defaultGateway.ipAddress=*reinterpret_cast<uint32_t *>(options+2);
-              break;
-
-            case 6:                 // DNS servers (up to 3)
-              if(options[1]>=4)
-                _dnsServers[0].ipAddress=*reinterpret_cast<uint32_t *>(options+2);
-              if(options[1]>=8)
-                _dnsServers[1].ipAddress=*reinterpret_cast<uint32_t *>(options+6);
-              if(options[1]>=12)
-                _dnsServers[2].ipAddress=*reinterpret_cast<uint32_t *>(options+10);
-              break;
-
-            case 15:
-              _domainName.reset(new char[options[1]+1]);
-              memcpy(_domainName.get(),options+2,options[1]);
-              _domainName[options[1]]='\0';
-              break;
-
-            case 51:                // lease time in seconds (renew 50% of time through)
-              lease=NetUtil::ntohl(*reinterpret_cast<uint32_t *>(options+2));
-              _expiryTime=this->_rtc->getTick()+lease;
-              break;
-          }
+      DhcpOptionIterator it(packet->getOptions(_responseSize));
+
+      while(it.next()) {
 
-          // move to next option
+        const NetView& value(it.getValue());
 
-          options+=2+options[1];
+        switch(it.getKind()) {
+
+          case 1:                 // subnet mask
+            if(value.get<NetField<0,IpAddress>>(address))
+              _subnetMask.ipAddress=address.ipAddress;
+            break;
+
+          case 3:                 // router (default gateway)
+            value.get<NetField<0,IpAddress>>(_defaultGateway);
+            break;
+
+          case 6:                 // DNS servers (up to 3)
+            value.get<NetField<0,IpAddress>>(_dnsServers[0]);
+            value.get<NetField<4,IpAddress>>(_dnsServers[1]);
+            value.get<NetField<8,IpAddress>>(_dnsServers[2]);
+            break;
+
+          case 15:                // domain name
+            _domainName.reset(new char[value.getSize()+1]);
+            memcpy(_domainName.get(),value.getData(),value.getSize());
+            _domainName[value.getSize()]='\0';
+            break;
+
+          case 51:                // lease time in seconds (renew 50% of time through)
+            if(value.get<NetField<0,uint32_t>>(lease))
+              _expiryTime=this->_rtc->getTick()+lease;
+            break;
         }
       }
 
@@ -490,6 +492,8 @@ namespace stm32plus {
     template<class TTransportLayer>
     inline void DhcpClient<TTransportLayer>::onReceive(UdpDatagramEvent& upe) {
 
+      uint16_t packetLength;
+
       // handle UDP packets when we're waiting
 
       if(_expectedResponseMessage==DhcpPacket::MessageType::NONE || _responsePacket!=nullptr)
@@ -505,6 +509,12 @@ namespace stm32plus {
 
       upe.handled=true;
 
+      // must have the whole fixed part of the packet
+
+      packetLength=NetUtil::ntohs(upe.udpDatagram.udp_length)-UdpDatagram::getHeaderSize();
+      if(packetLength<DhcpPacket::getPacketSize())
+        return;
+
       // check the packet content magic number
 
       DhcpPacket *packet=reinterpret_cast<DhcpPacket *>(upe.udpDatagram.udp_data);
@@ -518,18 +528,17 @@ namespace stm32plus {
 
       // must be the message type we expect
 
-      if(_expectedResponseMessage!=packet->getMessageType())
+      if(_expectedResponseMessage!=packet->getMessageType(packetLength))
         return;
 
       // store the packet and release the waiting code. not too concerned about the performance
       // overhead of copying packets around here because DHCP only runs when the system is
       // starting up or renewing.
 
-      uint16_t packetLength=NetUtil::ntohs(upe.udpDatagram.udp_length);
-
       DhcpPacket *rp=reinterpret_cast<DhcpPacket *>(malloc(packetLength));
       memcpy(reinterpret_cast<void *>(rp),packet,packetLength);
 
+      _responseSize=packetLength;
       _responsePacket=rp;
     }
 
@@ -12,6 +12,14 @@ namespace stm32plus {
   namespace net {
 
 
+    /**
+     * Iterator over the options in a DHCP packet. The option length does not include the code and
+     * length bytes.
+     */
+
+    typedef NetOptionIterator<255,0,false> DhcpOptionIterator;
+
+
     /**
      * Structure of a DHCP packet. This can be cast directly on to memory.
      */
@@ -338,38 +346,51 @@ namespace stm32plus {
 
       /**
        * Get the message type option
+       * @param packetSize The size of the whole packet including the options
        * @return The message type
        */
 
-      MessageType getMessageType() {
+      MessageType getMessageType(uint16_t packetSize) const {
 
-        uint8_t *option;
+        NetView value;
+        uint8_t type;
 
-        if((option=getOption(53))==nullptr)
+        if(!getOption(packetSize,53,value) || !value.get<NetField<0,uint8_t>>(type))
           return MessageType::NONE;
 
-        return static_cast<MessageType>(option[2]);
+        return static_cast<MessageType>(type);
+      }
+
+
+      /**
+       * Get an iterator over the options. The options are read in place and none of them can
+       * run past the end of the packet.
+       * @param packetSize The size of the whole packet including the options
+       * @return The iterator
+       */
+
+      DhcpOptionIterator getOptions(uint16_t packetSize) const {
+        return DhcpOptionIterator(NetView(this,packetSize).subView(getPacketSize()));
       }
 
 
       /**
-       * Get the address of a specific option
-       * @return The address or nullptr if not found
+       * Get the value of a specific option
+       * @param packetSize The size of the whole packet including the options
+       * @param code The option code
+       * @param[out] value The option value
+       * @return false if not found
        */
 
-      uint8_t *getOption(uint8_t code) {
+      bool getOption(uint16_t packetSize,uint8_t code,NetView& value) const {
 
-        uint8_t *options;
-        options=reinterpret_cast<uint8_t *>(this)+getPacketSize();
+        DhcpOptionIterator it(getOptions(packetSize));
 
-        while(*options!=255 && *options!=code) {
-          if(*options==0)             // code 0 is just a null byte
-            options++;
-          else
-            options+=options[1]+2;    // length is in *(code+1)
-        }
+        if(!it.find(code))
+          return false;
 
-        return *options==255 ? nullptr : options;
+        value=it.getValue();
+        return true;
       }
     } __attribute__((packed));
   }
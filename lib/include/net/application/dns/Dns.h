@@ -60,6 +60,7 @@ namespace stm32plus {
 
         volatile bool _awaitingReply;
         DnsReplyPacket volatile *_replyPacket;
+        uint16_t _replySize;
 
       protected:
         void onNotification(NetEventDescriptor& ned);
@@ -127,8 +128,9 @@ namespace stm32plus {
 
       // subscribe to notifications and receive events
 
-      this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Dns<TTransportLayer>::onNotification));
-      this->UdpReceiveEventSender.insertSubscriber(UdpReceiveEventSourceSlot::bind(this,&Dns<TTransportLayer>::onReceive));
+      if(!this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Dns<TTransportLayer>::onNotification)) ||
+         !this->UdpReceiveEventSender.insertSubscriber(UdpReceiveEventSourceSlot::bind(this,&Dns<TTransportLayer>::onReceive)))
+        return false;
       return true;
     }
 
@@ -313,7 +315,6 @@ namespace stm32plus {
     inline bool Dns<TTransportLayer>::processQueryResponse(IpAddress& ipAddress,uint32_t& ttl) {
 
       uint16_t flags=NetUtil::ntohs(_replyPacket->dns_flags);
-      uint8_t *answers,*record;
 
       // the flags must not have an error (unknown host is picked up here as cause=3)
 
@@ -330,25 +331,13 @@ namespace stm32plus {
       if(NetUtil::ntohs(_replyPacket->dns_numberOfAnswerRrs)==0)
         return this->setError(ErrorProvider::ERROR_PROVIDER_NET_DNS,E_NO_ANSWERS);
 
-      // find the answers
-
-      DnsReplyPacket *packet(const_cast<DnsReplyPacket *>(_replyPacket));
-      answers=packet->findAnswers();
+      // find the A record for the name that we asked about
 
-      // find the first A record
+      const DnsReplyPacket *packet(const_cast<const DnsReplyPacket *>(_replyPacket));
 
-      if((record=packet->findRecord(answers,DnsPacketHeader::RecordType::A))==nullptr)
+      if(!packet->findAddress(_replySize,ipAddress,ttl))
         return this->setError(ErrorProvider::ERROR_PROVIDER_NET_DNS,E_NO_A_RECORD_IN_ANSWERS);
 
-      // step over the name (should possibly verify that it's the answer to our question here)
-
-      record=packet->stepOverName(record);
-
-      // pull out the IP address and ttl from the record
-
-      ipAddress.ipAddress=*reinterpret_cast<uint32_t *>(record+10);
-      ttl=NetUtil::ntohl(*reinterpret_cast<uint32_t *>(record+4));
-
       return true;
     }
 
@@ -361,6 +350,8 @@ namespace stm32plus {
     template<class TTransportLayer>
     inline void Dns<TTransportLayer>::onReceive(UdpDatagramEvent& upe) {
 
+      uint16_t packetLength;
+
       // must be for our reply port
 
       if(NetUtil::ntohs(upe.udpDatagram.udp_destinationPort)!=_replyPort)
@@ -378,9 +369,11 @@ namespace stm32plus {
       // must be a valid packet on the DNS port
 
       if(NetUtil::ntohs(upe.udpDatagram.udp_sourcePort)!=IpPorts::PORT_DNS_REQUEST ||
-         NetUtil::ntohs(upe.udpDatagram.udp_length)<DnsPacketHeader::getPacketHeaderSize())
+         NetUtil::ntohs(upe.udpDatagram.udp_length)<UdpDatagram::getHeaderSize()+DnsPacketHeader::getPacketHeaderSize())
         return;
 
+      packetLength=NetUtil::ntohs(upe.udpDatagram.udp_length)-UdpDatagram::getHeaderSize();
+
       DnsQueryPacket *reply(reinterpret_cast<DnsQueryPacket *>(upe.udpDatagram.udp_data));
 
       // must be our DNS packet. there is no fixed magic number to indicate that this packet is
@@ -391,8 +384,9 @@ namespace stm32plus {
 
       // it's for us
 
-      _replyPacket=(DnsReplyPacket *)malloc(upe.udpDatagram.udp_length);
-      memcpy(const_cast<DnsReplyPacket *>(_replyPacket),upe.udpDatagram.udp_data,upe.udpDatagram.udp_length);
+      _replySize=packetLength;
+      _replyPacket=(DnsReplyPacket *)malloc(packetLength);
+      memcpy(const_cast<DnsReplyPacket *>(_replyPacket),upe.udpDatagram.udp_data,packetLength);
 
       // wake up the caller
 
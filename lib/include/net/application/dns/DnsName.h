@@ -0,0 +1,188 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * An encoded name in a DNS packet, read in place. A name is a list of length-prefixed labels
+     * that ends with an empty label or a pointer to the rest of the name somewhere else in the
+     * packet (RFC 1035 section 4.1.4). Compressed names are followed through their pointers
+     * without being copied out. Every label is checked to be inside the packet and the number
+     * of pointers that can be followed is limited so that a malicious loop terminates.
+     */
+
+    class DnsName {
+
+      public:
+        enum {
+          MAX_POINTERS = 16               ///< pointers we follow in one name before giving up
+        };
+
+      protected:
+        NetView _packet;                  ///< the whole DNS packet, pointers are offsets from its start
+        uint16_t _offset;                 ///< where the name starts
+
+      protected:
+        bool nextLabel(uint16_t& offset,uint8_t& pointers,const uint8_t *& label,uint8_t& length) const;
+
+      public:
+        DnsName();
+        DnsName(const NetView& packet,uint16_t offset);
+
+        bool skip(uint16_t& next) const;
+        bool equals(const DnsName& rhs) const;
+    };
+
+
+    /**
+     * Default constructor: an empty view
+     */
+
+    inline DnsName::DnsName()
+      : _offset(0) {
+    }
+
+
+    /**
+     * Constructor
+     * @param packet The whole DNS packet
+     * @param offset Where the name starts in the packet
+     */
+
+    inline DnsName::DnsName(const NetView& packet,uint16_t offset)
+      : _packet(packet),
+        _offset(offset) {
+    }
+
+
+    /**
+     * Find the end of the name where it lies. Pointers are not followed because the name ends
+     * at the first one.
+     * @param[out] next The offset of the first byte after the name
+     * @return false if the name runs past the end of the packet
+     */
+
+    inline bool DnsName::skip(uint16_t& next) const {
+
+      const uint8_t *data;
+      uint16_t offset;
+
+      data=_packet.getData();
+      offset=_offset;
+
+      while(_packet.contains(offset,1)) {
+
+        // a pointer is the end of the name
+
+        if((data[offset] & 0xc0)==0xc0) {
+
+          if(!_packet.contains(offset,2))
+            return false;
+
+          next=offset+2;
+          return true;
+        }
+
+        // the empty label is the end of the name
+
+        if(data[offset]==0) {
+          next=offset+1;
+          return true;
+        }
+
+        if((data[offset] & 0xc0)!=0)
+          return false;
+
+        offset+=data[offset]+1;
+      }
+
+      return false;
+    }
+
+
+    /**
+     * Compare with another name, which may be in a different packet. Labels are compared
+     * without regard to ASCII case.
+     * @param rhs The other name
+     * @return true if the names are the same and both are well formed
+     */
+
+    inline bool DnsName::equals(const DnsName& rhs) const {
+
+      const uint8_t *label,*rhsLabel;
+      uint16_t offset,rhsOffset;
+      uint8_t length,rhsLength,pointers,rhsPointers,i;
+
+      offset=_offset;
+      rhsOffset=rhs._offset;
+      pointers=rhsPointers=0;
+
+      do {
+
+        if(!nextLabel(offset,pointers,label,length) || !rhs.nextLabel(rhsOffset,rhsPointers,rhsLabel,rhsLength))
+          return false;
+
+        if(length!=rhsLength)
+          return false;
+
+        for(i=0;i<length;i++)
+          if(tolower(label[i])!=tolower(rhsLabel[i]))
+            return false;
+
+      } while(length!=0);
+
+      return true;
+    }
+
+
+    /**
+     * Get the next label in the name, following pointers
+     * @param[in,out] offset Where to look for the label. Updated to the next label.
+     * @param[in,out] pointers The number of pointers followed so far
+     * @param[out] label The first character of the label
+     * @param[out] length The length of the label, zero at the end of the name
+     * @return false if the name is malformed
+     */
+
+    inline bool DnsName::nextLabel(uint16_t& offset,uint8_t& pointers,const uint8_t *& label,uint8_t& length) const {
+
+      const uint8_t *data;
+
+      data=_packet.getData();
+
+      for(;;) {
+
+        if(!_packet.contains(offset,1))
+          return false;
+
+        // labels are up to 63 characters. the 01 and 10 prefixes are reserved.
+
+        if((data[offset] & 0xc0)==0)
+          break;
+
+        if((data[offset] & 0xc0)!=0xc0 || !_packet.contains(offset,2) || ++pointers>MAX_POINTERS)
+          return false;
+
+        offset=((data[offset] & 0x3f) << 8) | data[offset+1];
+      }
+
+      length=data[offset];
+      label=data+offset+1;
+
+      if(!_packet.contains(offset+1,length))
+        return false;
+
+      offset+=length+1;
+      return true;
+    }
+  }
+}
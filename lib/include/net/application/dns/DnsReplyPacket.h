@@ -13,96 +13,128 @@ namespace stm32plus {
 
 
     /**
-     * DNS reply packet
+     * DNS reply packet. The reply is parsed where it lies: names are compared through their
+     * compression pointers with DnsName and the fixed fields are read with NetField. Nothing
+     * is read from outside the packet.
      */
 
     struct DnsReplyPacket : DnsPacketHeader {
 
       /**
-       * Find the start of the answers in this packet. Assumes a well-formed response.
-       * @return the answers pointer
+       * The fields after the name in a question
        */
 
-      uint8_t *findAnswers() {
+      struct QuestionFields {
+        typedef NetField<0,uint16_t> Type;
+        typedef NetField<2,uint16_t> Class;
 
-        uint16_t i;
-        uint8_t *ptr;
-
-        // get a pointer to the questions
+        enum { SIZE=4 };
+      };
 
-        ptr=reinterpret_cast<uint8_t *>(this)+DnsPacketHeader::getPacketHeaderSize();
 
-        // step over each question
+      /**
+       * The fields after the name in a resource record
+       */
 
-        for(i=NetUtil::ntohs(dns_numberOfQuestions);i!=0;i--)
-          ptr=stepOverName(ptr)+4;          // step over the name + (type, class)
+      struct ResourceRecordFields {
+        typedef NetField<0,uint16_t> Type;
+        typedef NetField<2,uint16_t> Class;
+        typedef NetField<4,uint32_t> Ttl;
+        typedef NetField<8,uint16_t> DataLength;
 
-        return ptr;
-      }
+        enum { SIZE=10 };
+      };
 
 
       /**
-       * Step over the labels that make up the name pointed at by ptr. The labels that make up a
-       * name may optionally end in a pointer, or just be a pointer. In any case the occurence of
-       * a pointer is the end of the name.
-       * @param ptr The start of a name
-       * @return The start of the next name
+       * Find the start of the answers in this packet
+       * @param packetSize The size of the whole packet
+       * @param[out] offset The offset of the first answer
+       * @return false if the questions are malformed
        */
 
-      uint8_t *stepOverName(uint8_t *ptr) {
+      bool findAnswers(uint16_t packetSize,uint16_t& offset) const {
 
-        while(*ptr) {
+        NetView packet(this,packetSize);
+        uint16_t i;
 
-          // check for a pointer
+        offset=DnsPacketHeader::getPacketHeaderSize();
 
-          if((*ptr & 0xc0)==0xc0)
-            return ptr+2;           // don't care what the pointer is, just that this is the end of the name
+        // step over each question
 
-          ptr+=(*ptr)+1;            // normal label with length prefix
-        }
+        for(i=NetUtil::ntohs(dns_numberOfQuestions);i!=0;i--) {
 
-        // and over the \0 terminator
+          if(!DnsName(packet,offset).skip(offset) || !packet.contains(offset,QuestionFields::SIZE))
+            return false;
 
-        return ptr+1;
+          offset+=QuestionFields::SIZE;
+        }
+
+        return true;
       }
 
 
       /**
-       * Find the first occurrence of a record with the given type
-       * @param answers The start of the answers records
-       * @param requestedType The type to search for
-       * @return A pointer to the record, or null
+       * Find the address of the name in the first question. The server may answer with a chain of
+       * CNAME records that lead to the A record, in which case we follow the chain.
+       * @param packetSize The size of the whole packet
+       * @param[out] ipAddress The address
+       * @param[out] ttl The time-to-live of the A record in seconds
+       * @return false if there's no A record for the name or the packet is malformed
        */
 
-      uint8_t *findRecord(uint8_t *answers,RecordType requestedType) {
+      bool findAddress(uint16_t packetSize,IpAddress& ipAddress,uint32_t& ttl) const {
 
-        uint8_t *dataptr,*ptr;
-        RecordType thisType;
-        uint16_t i;
+        NetView packet(this,packetSize);
+        DnsName name,target;
+        uint16_t i,offset,dataOffset,dataLength;
+        RecordType type;
+
+        // the answers are for the name in the first question
 
-        ptr=answers;
+        if(NetUtil::ntohs(dns_numberOfQuestions)==0 || !findAnswers(packetSize,offset))
+          return false;
+
+        target=DnsName(packet,DnsPacketHeader::getPacketHeaderSize());
 
         for(i=NetUtil::ntohs(dns_numberOfAnswerRrs);i!=0;i--) {
 
-          // get past the encoded name
+          // get past the encoded name and check that the fixed fields and data are all there
+
+          name=DnsName(packet,offset);
+
+          if(!name.skip(offset) || !packet.contains(offset,ResourceRecordFields::SIZE))
+            return false;
+
+          type=static_cast<RecordType>(packet.read<ResourceRecordFields::Type>(offset));
+          dataLength=packet.read<ResourceRecordFields::DataLength>(offset);
+          dataOffset=offset+ResourceRecordFields::SIZE;
+
+          if(!packet.contains(dataOffset,dataLength))
+            return false;
+
+          if(name.equals(target)) {
 
-          dataptr=stepOverName(ptr);
+            // an alias: the records that follow are for the canonical name
 
-          // is it a record of the correct type?
+            if(type==RecordType::CNAME)
+              target=DnsName(packet,dataOffset);
 
-          thisType=static_cast<RecordType>(NetUtil::ntohs(*reinterpret_cast<uint16_t *>(dataptr)));
-          if(thisType==requestedType)
-            return ptr;
+            else if(type==RecordType::A && dataLength==sizeof(IpAddress)) {
+              ttl=packet.read<ResourceRecordFields::Ttl>(offset);
+              ipAddress=packet.read<NetField<0,IpAddress>>(dataOffset);
+              return true;
+            }
+          }
 
           // next one
 
-          ptr=dataptr+8;                                                // to the resource data length
-          ptr+=2+NetUtil::ntohs(*reinterpret_cast<uint16_t *>(ptr));    // over the length and data
+          offset=dataOffset+dataLength;
         }
 
         // not found
 
-        return nullptr;
+        return false;
       }
 
     } __attribute__((packed));
@@ -39,6 +39,8 @@ namespace stm32plus {
         uint16_t _responseCode;                     ///< HTTP response code number
         int32_t _responseContentLength;             ///< content length of response, or -1 if server not sent
         std::string _responseContentType;           ///< response content type, or empty if server not sent
+        bool _responseConnectionClose;              ///< the server sent Connection: close
+        bool _responseConnectionKeepAlive;          ///< the server sent Connection: keep-alive
 
       public:
         HttpClient(TcpConnection& conn);
@@ -57,6 +59,7 @@ namespace stm32plus {
         int32_t getResponseContentLength() const;
         const std::string& getResponseContentType() const;
         const std::slist<std::string>& getResponseHeaders() const;
+        bool isPersistent() const;
     };
 
 
@@ -268,6 +271,8 @@ namespace stm32plus {
       _responseHeaders.clear();
       _responseContentType.clear();
       _responseContentLength=-1;
+      _responseConnectionClose=false;
+      _responseConnectionKeepAlive=false;
 
       for(;;) {
 
@@ -306,6 +311,10 @@ namespace stm32plus {
               _responseContentType=headerLine.substr(pos1);
             else if(!strncasecmp(headerLine.c_str(),"Content-Length",14))
               _responseContentLength=atol(headerLine.substr(pos1).c_str());
+            else if(!strncasecmp(headerLine.c_str(),"Connection",10)) {
+              _responseConnectionClose=!strncasecmp(headerLine.c_str()+pos1,"close",5);
+              _responseConnectionKeepAlive=!strncasecmp(headerLine.c_str()+pos1,"keep-alive",10);
+            }
           }
 
           // add the header line
@@ -359,5 +368,31 @@ namespace stm32plus {
     inline const std::string& HttpClient::getResponseContentType() const {
       return _responseContentType;
     }
+
+
+    /**
+     * Check if the connection can be used for another request after the response body has been
+     * read. HTTP/1.1 connections are persistent unless the server says Connection: close, HTTP/1.0
+     * connections only if the server says Connection: keep-alive. We don't decode chunked bodies so
+     * the response must also have a Content-Length, unless it has no body at all. Pass the result
+     * to TcpConnectionPool::release().
+     * @return true if the connection can be reused
+     */
+
+    inline bool HttpClient::isPersistent() const {
+
+      if(_responseConnectionClose)
+        return false;
+
+      if(_httpVersion==HttpVersion::HTTP_1_0 && !_responseConnectionKeepAlive)
+        return false;
+
+      // responses that never have a body
+
+      if(_httpMethod==HttpMethod::HEAD || _responseCode==204 || _responseCode==304 || (_responseCode>=100 && _responseCode<200))
+        return true;
+
+      return _responseContentLength>=0;
+    }
   }
 }
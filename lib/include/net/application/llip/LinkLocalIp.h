@@ -117,11 +117,13 @@ namespace stm32plus {
 
       // subscribe to ARP messages
 
-      this->ArpReceiveEventSender.insertSubscriber(ArpReceiveEventSourceSlot::bind(this,&LinkLocalIp<TTransportLayer>::onReceive));
+      if(!this->ArpReceiveEventSender.insertSubscriber(ArpReceiveEventSourceSlot::bind(this,&LinkLocalIp<TTransportLayer>::onReceive)))
+        return false;
 
       // subscribe to notifications (to get the stack's MAC)
 
-      this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&LinkLocalIp<TTransportLayer>::onNotification));
+      if(!this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&LinkLocalIp<TTransportLayer>::onNotification)))
+        return false;
 
       // set up our RTC ticker, initially disabled
 
@@ -100,8 +100,7 @@ namespace stm32plus {
 
       // subscribe to receive events from the network
 
-      this->NetworkReceiveEventSender.insertSubscriber(NetworkReceiveEventSourceSlot::bind(this,&Ping<TTransportLayer>::onReceive));
-      return true;
+      return this->NetworkReceiveEventSender.insertSubscriber(NetworkReceiveEventSourceSlot::bind(this,&Ping<TTransportLayer>::onReceive));
     }
 
 
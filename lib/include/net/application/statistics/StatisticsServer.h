@@ -0,0 +1,476 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * Application layer feature that publishes the stack's statistics counters over UDP.
+     * A datagram sent to stats_port names the section that's wanted and is answered with
+     * one datagram of plain text with one counter per line, for example:
+     *
+     *   ip.packetsReceived 1234
+     *   ip.packetsSent 1180
+     *
+     * The sections are mac, arp, ip, icmp, udp and tcp for the protocol counters and macrx
+     * and mactx for the MAC latency histograms. A section for a layer that's not in the
+     * stack, or a histogram that's not enabled, gets no reply. You can fetch the counters
+     * from a PC with:
+     *
+     *   echo ip | nc -u -w1 <board-address> 7777
+     *
+     * Only requests from our own subnet are answered and each request gets at most one
+     * reply so the server can't be used to reflect traffic at somebody else.
+     *
+     * The replies are sent from the receive IRQ so they use the asynchronous UDP send.
+     */
+
+    template<class TTransportLayer>
+    class StatisticsServer : public virtual TTransportLayer {
+
+      public:
+
+        /**
+         * Parameters class
+         */
+
+        struct Parameters {
+
+          uint16_t stats_port;                  ///< UDP port to listen on. Default is 7777.
+
+          Parameters() {
+            stats_port=7777;
+          }
+        };
+
+      protected:
+
+        enum {
+          BUFFER_SIZE = 512                     ///< enough for a latency histogram with 10 digit counters
+        };
+
+        Parameters _params;
+        char _buffer[BUFFER_SIZE];              ///< the section being built
+        uint16_t _length;                       ///< bytes used in _buffer
+        const char *_section;                   ///< the name that prefixes each line
+
+      protected:
+        void onReceive(UdpDatagramEvent& ned);
+
+        bool isLocalSubnet(const IpAddress& address) const;
+        static bool isSection(const char *request,uint16_t length,const char *section);
+
+        void beginSection(const char *section);
+        void appendCounter(const char *name,uint32_t value);
+        bool buildLatency(const char *section,const NetLatencyHistogram *histogram);
+
+        template<class T> auto buildMac(const T& stack,int) -> decltype(stack.getMacStatistics(),bool());
+        template<class T> auto buildMacReceiveLatency(const T& stack,int) -> decltype(stack.getMacReceiveLatency(),bool());
+        template<class T> auto buildMacTransmitLatency(const T& stack,int) -> decltype(stack.getMacTransmitLatency(),bool());
+        template<class T> auto buildArp(const T& stack,int) -> decltype(stack.getArpStatistics(),bool());
+        template<class T> auto buildIp(const T& stack,int) -> decltype(stack.getIpStatistics(),bool());
+        template<class T> auto buildIcmp(const T& stack,int) -> decltype(stack.getIcmpStatistics(),bool());
+        template<class T> auto buildUdp(const T& stack,int) -> decltype(stack.getUdpStatistics(),bool());
+        template<class T> auto buildTcp(const T& stack,int) -> decltype(stack.getTcpStatistics(),bool());
+
+        // fallbacks for the layers that are not in the stack
+
+        template<class T> bool buildMac(const T&,long) { return false; }
+        template<class T> bool buildMacReceiveLatency(const T&,long) { return false; }
+        template<class T> bool buildMacTransmitLatency(const T&,long) { return false; }
+        template<class T> bool buildArp(const T&,long) { return false; }
+        template<class T> bool buildIp(const T&,long) { return false; }
+        template<class T> bool buildIcmp(const T&,long) { return false; }
+        template<class T> bool buildUdp(const T&,long) { return false; }
+        template<class T> bool buildTcp(const T&,long) { return false; }
+
+      public:
+        bool initialise(const Parameters& params);
+        bool startup();
+    };
+
+
+    /**
+     * Initialise the class
+     * @param params The parameters class
+     * @return true if it worked
+     */
+
+    template<class TTransportLayer>
+    inline bool StatisticsServer<TTransportLayer>::initialise(const Parameters& params) {
+
+      _params=params;
+
+      // claim the port so that UDP does not drop the requests if it's been asked to
+      // drop datagrams for ports that nobody has acquired
+
+      if(!this->ip_acquireDefinedPort(_params.stats_port))
+        return false;
+
+      return this->UdpReceiveEventSender.insertSubscriber(UdpReceiveEventSourceSlot::bind(this,&StatisticsServer<TTransportLayer>::onReceive));
+    }
+
+
+    /**
+     * Startup the class
+     * @return true
+     */
+
+    template<class TTransportLayer>
+    inline bool StatisticsServer<TTransportLayer>::startup() {
+      return true;
+    }
+
+
+    /**
+     * UDP receive callback. The request is the name of a section, optionally followed by
+     * whitespace. The section is built and sent back to the requester in one datagram.
+     * @param upe The UDP datagram event
+     */
+
+    template<class TTransportLayer>
+    inline void StatisticsServer<TTransportLayer>::onReceive(UdpDatagramEvent& upe) {
+
+      uint16_t remotePort,length;
+      const char *request;
+      bool built;
+
+      if(NetUtil::ntohs(upe.udpDatagram.udp_destinationPort)!=_params.stats_port)
+        return;
+
+      upe.handled=true;
+
+      // can't reply to a sender that didn't give a port
+
+      if((remotePort=NetUtil::ntohs(upe.udpDatagram.udp_sourcePort))==0)
+        return;
+
+      IpAddress remoteAddress(upe.ipPacket.header->ip_sourceAddress);
+
+      if(!isLocalSubnet(remoteAddress))
+        return;
+
+      // UDP has already checked the length against the IP payload. echo adds a newline.
+
+      request=reinterpret_cast<const char *>(upe.udpDatagram.udp_data);
+      length=NetUtil::ntohs(upe.udpDatagram.udp_length)-UdpDatagram::getHeaderSize();
+
+      while(length>0 && (request[length-1]=='\n' || request[length-1]=='\r' || request[length-1]==' '))
+        length--;
+
+      const TTransportLayer& stack(*this);
+
+      if(isSection(request,length,"mac"))
+        built=buildMac(stack,0);
+      else if(isSection(request,length,"macrx"))
+        built=buildMacReceiveLatency(stack,0);
+      else if(isSection(request,length,"mactx"))
+        built=buildMacTransmitLatency(stack,0);
+      else if(isSection(request,length,"arp"))
+        built=buildArp(stack,0);
+      else if(isSection(request,length,"ip"))
+        built=buildIp(stack,0);
+      else if(isSection(request,length,"icmp"))
+        built=buildIcmp(stack,0);
+      else if(isSection(request,length,"udp"))
+        built=buildUdp(stack,0);
+      else if(isSection(request,length,"tcp"))
+        built=buildTcp(stack,0);
+      else
+        built=false;
+
+      // failures are counted by the UDP statistics, there's nobody to tell from here
+
+      if(built)
+        this->udpSend(remoteAddress,_params.stats_port,remotePort,_buffer,_length,true,0);
+    }
+
+
+    /**
+     * Check that a requester is a host on our own subnet. Nothing is answered until we have
+     * an address and a subnet mask, and the subnet broadcast address is never a host.
+     * @param address The requester's address
+     * @return true if it's on our subnet
+     */
+
+    template<class TTransportLayer>
+    inline bool StatisticsServer<TTransportLayer>::isLocalSubnet(const IpAddress& address) const {
+
+      const IpAddress& myAddress(this->getIpAddress());
+      const IpSubnetMask& mySubnetMask(this->getSubnetMask());
+
+      if(!myAddress.isValid() || !mySubnetMask.isValid())
+        return false;
+
+      if(address.isBroadcast() || address.isMulticastGroup() || mySubnetMask.isBroadcastAddress(address))
+        return false;
+
+      return mySubnetMask.matches(address,myAddress);
+    }
+
+
+    /**
+     * Compare the request with a section name
+     * @param request The request text, not nul terminated
+     * @param length The length of the request
+     * @param section The nul terminated section name
+     * @return true if they're the same
+     */
+
+    template<class TTransportLayer>
+    inline bool StatisticsServer<TTransportLayer>::isSection(const char *request,uint16_t length,const char *section) {
+      return strlen(section)==length && memcmp(request,section,length)==0;
+    }
+
+
+    /**
+     * Start building a section
+     * @param section The prefix for each counter name
+     */
+
+    template<class TTransportLayer>
+    inline void StatisticsServer<TTransportLayer>::beginSection(const char *section) {
+      _section=section;
+      _length=0;
+    }
+
+
+    /**
+     * Append a "section.name value" line to the buffer. Lines that don't fit are dropped.
+     * @param name The counter name
+     * @param value The counter value
+     */
+
+    template<class TTransportLayer>
+    inline void StatisticsServer<TTransportLayer>::appendCounter(const char *name,uint32_t value) {
+
+      uint16_t sectionLength,nameLength;
+
+      sectionLength=strlen(_section);
+      nameLength=strlen(name);
+
+      // section, dot, name, space, up to 10 digits and a terminating nul from modp_uitoa10
+
+      if(_length+sectionLength+nameLength+13>BUFFER_SIZE)
+        return;
+
+      memcpy(_buffer+_length,_section,sectionLength);
+      _length+=sectionLength;
+      _buffer[_length++]='.';
+
+      memcpy(_buffer+_length,name,nameLength);
+      _length+=nameLength;
+      _buffer[_length++]=' ';
+
+      _length+=StringUtil::modp_uitoa10(value,_buffer+_length);
+      _buffer[_length++]='\n';
+    }
+
+
+    /**
+     * Build a section for a latency histogram. The buckets are named for their exclusive
+     * upper limit in microseconds, for example "macrx.lt64", and the last is named for its
+     * lower limit, for example "macrx.ge16384".
+     * @param section The section name
+     * @param histogram The histogram, or nullptr if it's not enabled
+     * @return false if the histogram is not enabled
+     */
+
+    template<class TTransportLayer>
+    inline bool StatisticsServer<TTransportLayer>::buildLatency(const char *section,const NetLatencyHistogram *histogram) {
+
+      uint8_t i;
+      char name[16];
+
+      if(histogram==nullptr)
+        return false;
+
+      beginSection(section);
+      appendCounter("count",histogram->getCount());
+      appendCounter("average",histogram->getAverage());
+      appendCounter("maximum",histogram->getMaximum());
+
+      for(i=0;i<NetLatencyHistogram::BUCKETS;i++) {
+
+        if(i<NetLatencyHistogram::BUCKETS-1) {
+          memcpy(name,"lt",2);
+          StringUtil::modp_uitoa10(NetLatencyHistogram::getBucketLimit(i),name+2);
+        }
+        else {
+          memcpy(name,"ge",2);
+          StringUtil::modp_uitoa10(NetLatencyHistogram::getBucketLimit(i-1),name+2);
+        }
+
+        appendCounter(name,histogram->getBucket(i));
+      }
+
+      return true;
+    }
+
+
+    /**
+     * Build the MAC counters
+     */
+
+    template<class TTransportLayer>
+    template<class T>
+    inline auto StatisticsServer<TTransportLayer>::buildMac(const T& stack,int) -> decltype(stack.getMacStatistics(),bool()) {
+
+      const auto& s(stack.getMacStatistics());
+
+      beginSection("mac");
+      appendCounter("framesReceived",s.framesReceived);
+      appendCounter("receiveErrors",s.receiveErrors);
+      appendCounter("framesUnsupported",s.framesUnsupported);
+      appendCounter("receiveBuffersExhausted",s.receiveBuffersExhausted);
+      appendCounter("framesSent",s.framesSent);
+      appendCounter("framesDropped",s.framesDropped);
+      appendCounter("transmitBusy",s.transmitBusy);
+      appendCounter("transmitQueueHighWater",s.transmitQueueHighWater);
+      appendCounter("dmaErrors",s.dmaErrors);
+      return true;
+    }
+
+
+    /**
+     * Build the MAC receive latency histogram
+     */
+
+    template<class TTransportLayer>
+    template<class T>
+    inline auto StatisticsServer<TTransportLayer>::buildMacReceiveLatency(const T& stack,int) -> decltype(stack.getMacReceiveLatency(),bool()) {
+      return buildLatency("macrx",stack.getMacReceiveLatency());
+    }
+
+
+    /**
+     * Build the MAC transmit latency histogram
+     */
+
+    template<class TTransportLayer>
+    template<class T>
+    inline auto StatisticsServer<TTransportLayer>::buildMacTransmitLatency(const T& stack,int) -> decltype(stack.getMacTransmitLatency(),bool()) {
+      return buildLatency("mactx",stack.getMacTransmitLatency());
+    }
+
+
+    /**
+     * Build the ARP counters
+     */
+
+    template<class TTransportLayer>
+    template<class T>
+    inline auto StatisticsServer<TTransportLayer>::buildArp(const T& stack,int) -> decltype(stack.getArpStatistics(),bool()) {
+
+      const auto& s(stack.getArpStatistics());
+
+      beginSection("arp");
+      appendCounter("requestsSent",s.requestsSent);
+      appendCounter("requestsAnswered",s.requestsAnswered);
+      appendCounter("repliesReceived",s.repliesReceived);
+      appendCounter("framesMalformed",s.framesMalformed);
+      appendCounter("cacheHits",s.cacheHits);
+      appendCounter("cacheMisses",s.cacheMisses);
+      appendCounter("framesQueued",s.framesQueued);
+      appendCounter("framesDropped",s.framesDropped);
+      appendCounter("resolutionsFailed",s.resolutionsFailed);
+      return true;
+    }
+
+
+    /**
+     * Build the IP counters. The checksum counters go in the same section.
+     */
+
+    template<class TTransportLayer>
+    template<class T>
+    inline auto StatisticsServer<TTransportLayer>::buildIp(const T& stack,int) -> decltype(stack.getIpStatistics(),bool()) {
+
+      const auto& s(stack.getIpStatistics());
+      const auto& cs(stack.getChecksumStatistics());
+
+      beginSection("ip");
+      appendCounter("packetsReceived",s.packetsReceived);
+      appendCounter("packetsNotForUs",s.packetsNotForUs);
+      appendCounter("packetsMalformed",s.packetsMalformed);
+      appendCounter("fragmentsReceived",s.fragmentsReceived);
+      appendCounter("reassemblyFailures",s.reassemblyFailures);
+      appendCounter("packetsSent",s.packetsSent);
+      appendCounter("sendFailures",s.sendFailures);
+      appendCounter("checksumsGenerated",cs.packetsGenerated);
+      appendCounter("checksumsVerified",cs.packetsVerified);
+      appendCounter("headerChecksumErrors",cs.headerErrors);
+      appendCounter("payloadChecksumErrors",cs.payloadErrors);
+      return true;
+    }
+
+
+    /**
+     * Build the ICMP counters
+     */
+
+    template<class TTransportLayer>
+    template<class T>
+    inline auto StatisticsServer<TTransportLayer>::buildIcmp(const T& stack,int) -> decltype(stack.getIcmpStatistics(),bool()) {
+
+      const auto& s(stack.getIcmpStatistics());
+
+      beginSection("icmp");
+      appendCounter("packetsReceived",s.packetsReceived);
+      appendCounter("packetsMalformed",s.packetsMalformed);
+      appendCounter("echoRequestsReceived",s.echoRequestsReceived);
+      appendCounter("echoRepliesSent",s.echoRepliesSent);
+      appendCounter("destinationUnreachableReceived",s.destinationUnreachableReceived);
+      appendCounter("packetsSent",s.packetsSent);
+      appendCounter("sendFailures",s.sendFailures);
+      return true;
+    }
+
+
+    /**
+     * Build the UDP counters. This reply is counted too, but only after it's been built.
+     */
+
+    template<class TTransportLayer>
+    template<class T>
+    inline auto StatisticsServer<TTransportLayer>::buildUdp(const T& stack,int) -> decltype(stack.getUdpStatistics(),bool()) {
+
+      const auto& s(stack.getUdpStatistics());
+
+      beginSection("udp");
+      appendCounter("datagramsReceived",s.datagramsReceived);
+      appendCounter("datagramsMalformed",s.datagramsMalformed);
+      appendCounter("datagramsNoPort",s.datagramsNoPort);
+      appendCounter("datagramsSent",s.datagramsSent);
+      appendCounter("sendFailures",s.sendFailures);
+      return true;
+    }
+
+
+    /**
+     * Build the TCP counters
+     */
+
+    template<class TTransportLayer>
+    template<class T>
+    inline auto StatisticsServer<TTransportLayer>::buildTcp(const T& stack,int) -> decltype(stack.getTcpStatistics(),bool()) {
+
+      const auto& s(stack.getTcpStatistics());
+
+      beginSection("tcp");
+      appendCounter("segmentsReceived",s.segmentsReceived);
+      appendCounter("segmentsMalformed",s.segmentsMalformed);
+      appendCounter("segmentsUnmatched",s.segmentsUnmatched);
+      appendCounter("resetsSent",s.resetsSent);
+      return true;
+    }
+  }
+}
@@ -0,0 +1,30 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+    /**
+     * Request to the MAC to start or stop receiving frames sent to a multicast MAC address. Requests
+     * are reference counted so every add must eventually be matched by a remove.
+     */
+
+    struct DatalinkMulticastFilterEvent : NetEventDescriptor {
+
+      const MacAddress& macAddress;       ///< the multicast address
+      bool add;                           ///< true to start receiving, false to stop
+
+      DatalinkMulticastFilterEvent(const MacAddress& mac,bool addAddress)
+        : NetEventDescriptor(NetEventType::DATALINK_MULTICAST_FILTER),
+          macAddress(mac),
+          add(addAddress) {
+      }
+    };
+  }
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * Event descriptor for a request to transmit several ethernet frames to the same
+     * destination. The link layer queues them in consecutive transmit descriptors.
+     */
+
+    struct EthernetBatchTransmitRequestEvent : NetEventDescriptor {
+
+      NetBuffer **networkBuffers;           ///< buffers to send, one per frame
+      uint16_t networkBufferCount;          ///< number of buffers
+      const MacAddress& macAddress;         ///< reference to MAC (will be copied out)
+      EtherType etherType;                  ///< ethertype number
+      uint16_t sentCount;                   ///< set by the link layer to the number of frames accepted
+      bool succeeded;                       ///< set to true by the link layer if all the frames were accepted
+
+      /**
+       * Constructor
+       * @param nbs The buffers to send. The receiver owns them, including any that it fails to send.
+       * @param count The number of buffers
+       * @param mac The MAC address
+       * @param et The event type
+       * @param ckreq The checksum request for all the frames
+       */
+
+      EthernetBatchTransmitRequestEvent(NetBuffer **nbs,uint16_t count,const MacAddress& mac,EtherType et,DatalinkChecksum ckreq)
+        : NetEventDescriptor(NetEventType::ETHERNET_BATCH_TRANSMIT_REQUEST),
+          networkBuffers(nbs),
+          networkBufferCount(count),
+          macAddress(mac),
+          etherType(et),
+          sentCount(0),
+          succeeded(false) {
+
+        uint16_t i;
+
+        // transfer the checksum request into the netbuffers as they are tightly coupled
+
+        for(i=0;i<count;i++)
+          nbs[i]->setChecksumRequest(ckreq);
+      }
+    };
+  }
+}
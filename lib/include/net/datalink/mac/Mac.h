@@ -117,7 +117,8 @@ namespace stm32plus {
 
       // subscribe to notification events
 
-      this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Mac<TPhysicalLayer>::onNotification));
+      if(!this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Mac<TPhysicalLayer>::onNotification)))
+        return false;
 
       // enable the interrupts
 
@@ -69,6 +69,7 @@ namespace stm32plus {
           uint32_t mac_txWaitMillis;        //!< max time to wait for a pending frame to go
           uint8_t mac_receiveBufferCount;   //!< number of receive buffers
           uint8_t mac_transmitBufferCount;  //!< number of transmit buffers
+          bool mac_latencyHistograms;       //!< time frames through the stack and on to the wire. Default is false.
 
           /**
            * Constructor, set up the defaults
@@ -100,10 +101,31 @@ namespace stm32plus {
 
             mac_receiveBufferCount=5;
             mac_transmitBufferCount=5;
+
+            // latency histograms cost a microsecond timer read per frame each way
+
+            mac_latencyHistograms=false;
           }
         };
 
 
+        /**
+         * Frame counters. These are updated in the MAC interrupts and by whatever sends frames.
+         */
+
+        struct Statistics {
+          uint32_t framesReceived;            //!< good frames passed up the stack
+          uint32_t receiveErrors;             //!< frames dropped because the MAC flagged an error (CRC, overflow, checksum...)
+          uint32_t framesUnsupported;         //!< frames dropped because we don't understand the format
+          uint32_t receiveBuffersExhausted;   //!< times the receive DMA ran out of buffers
+          uint32_t framesSent;                //!< frames handed to the transmit DMA
+          uint32_t framesDropped;             //!< frames deleted without being sent
+          uint32_t transmitBusy;              //!< times a frame found no free transmit descriptor
+          uint32_t transmitQueueHighWater;    //!< the most transmit descriptors in use at once
+          uint32_t dmaErrors;                 //!< DMA error interrupts
+        };
+
+
       protected:
 
         // receive buffers and descriptors. there's little scope to improve this over ST's
@@ -118,6 +140,19 @@ namespace stm32plus {
         scoped_array<ETH_DMADESCTypeDef> _transmitDmaDescriptors;
         scoped_array<NetBuffer *> _transmitNetBuffers;
         int _transmitBufferIndex;
+        uint8_t _transmitsQueued;
+
+        // counters and the optional latency histograms. _transmitTimes holds the time that each
+        // transmit descriptor was handed to the DMA.
+
+        Statistics _statistics;
+        scoped_ptr<NetLatencyHistogram> _receiveLatency;
+        scoped_ptr<NetLatencyHistogram> _transmitLatency;
+        scoped_array<uint32_t> _transmitTimes;
+
+        // reference counts for the 64 bits in the multicast hash table
+
+        uint8_t _multicastHashReferences[64];
 
         // parameters class
 
@@ -126,13 +161,24 @@ namespace stm32plus {
       protected:
         void processReceivedFrame(const FrameTypeDef& frame);
         bool setupEthernetFrame(const FrameTypeDef& fd,EthernetFrame& ef) const;
+        void deliverFrame(const FrameTypeDef& fd,EthernetFrame& ef);
 
         bool sendBuffer(NetBuffer *nb);
+        uint16_t sendBuffers(NetBuffer **nbs,uint16_t count);
+        bool queueBuffer(NetBuffer *nb);
+        void startTransmit();
+        bool prepareFrame(NetBuffer *nb,const MacAddress& macAddress,EtherType etherType);
+        void sendBatch(EthernetBatchTransmitRequestEvent& event);
 
         bool initialise(const Parameters& params);
         bool startup();
 
         void onSend(NetEventDescriptor& ned);
+        void onNotification(NetEventDescriptor& ned);
+
+        void updateMulticastFilter(const MacAddress& address,bool add);
+        static uint8_t getMulticastHashIndex(const MacAddress& address);
+        static constexpr uint8_t getMulticastHashIndex(const uint8_t *address);
 
       public:
         MacBase();
@@ -143,6 +189,10 @@ namespace stm32plus {
 
         uint32_t getDatalinkTransmitHeaderSize() const;
         uint32_t getDatalinkMtuSize() const;
+
+        const Statistics& getMacStatistics() const;
+        const NetLatencyHistogram *getMacReceiveLatency() const;
+        const NetLatencyHistogram *getMacTransmitLatency() const;
     };
 
 
@@ -174,5 +224,37 @@ namespace stm32plus {
     inline uint32_t MacBase::getDatalinkMtuSize() const {
       return _params.mac_mtu;
     }
+
+
+    /**
+     * Get the frame counters
+     * @return The statistics
+     */
+
+    inline const MacBase::Statistics& MacBase::getMacStatistics() const {
+      return _statistics;
+    }
+
+
+    /**
+     * Get the time taken by the stack to process each received frame, measured from the MAC
+     * receive interrupt to the return from the upper layers.
+     * @return The histogram, or nullptr if mac_latencyHistograms is false
+     */
+
+    inline const NetLatencyHistogram *MacBase::getMacReceiveLatency() const {
+      return _receiveLatency.get();
+    }
+
+
+    /**
+     * Get the time that each transmitted frame waited for the wire, measured from being handed to
+     * the DMA to the transmit complete interrupt.
+     * @return The histogram, or nullptr if mac_latencyHistograms is false
+     */
+
+    inline const NetLatencyHistogram *MacBase::getMacTransmitLatency() const {
+      return _transmitLatency.get();
+    }
   }
 }
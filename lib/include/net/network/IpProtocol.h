@@ -17,6 +17,7 @@ namespace stm32plus {
 
     enum class IpProtocol : uint8_t {
       ICMP = 0x01,
+      IGMP  = 0x02,
       TCP   = 0x06,
       UDP   = 0x11
     };
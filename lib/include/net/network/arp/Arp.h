@@ -17,6 +17,20 @@ namespace stm32plus {
      * Network layer feature that implements the Address Resolution Protocol (ARP)
      * ARP is used as to convert one address form into another. In our implementation
      * we will support converting MAC addresses into IP addresses.
+     *
+     * Lookups that miss the cache do not wait for the reply. The request is sent and the
+     * frames for that address are parked in a small queue until the reply arrives, when
+     * they're sent. A parked frame takes a copy of any caller data that it refers to because
+     * the caller may reuse that memory as soon as its send returns. Requests are repeated
+     * every arp_retryInterval seconds and the parked frames are deleted if there's still no
+     * reply after arp_retries requests.
+     *
+     * A frame that finds the queue full is deleted and its send fails. TCP resends it and
+     * other senders see the failure, as they would for any other dropped frame.
+     *
+     * Setting arp_pendingQueueSize to zero turns parking off. Lookups from normal code then
+     * wait in the caller for up to arp_replyTimeout for each of arp_retries requests, and
+     * lookups from an IRQ fail.
      */
 
     template<class TDatalinkLayer>
@@ -34,7 +48,11 @@ namespace stm32plus {
           E_UNCONFIGURED,               ///< Our MAC/IP are not configured
           E_REQUEST_NOT_PERMITTED,      ///< not permitted to do a request due to IRQ context
           E_IP_ADDRESS_CLASH,           ///< Another station on the net has our IP address
-          E_TIMED_OUT                   ///< timed out waiting for a response
+          E_TIMED_OUT,                  ///< timed out waiting for a response
+          E_TOO_MANY_PENDING,           ///< too many addresses are already being resolved
+          E_PENDING_QUEUE_FULL,         ///< too many frames are already waiting for this address
+          E_INVALID_PARAMETERS,         ///< arp_retryInterval is zero
+          E_OUT_OF_MEMORY               ///< no memory to copy the data of a frame that's being parked
         };
 
         /**
@@ -46,8 +64,11 @@ namespace stm32plus {
           bool arp_startupBroadcast;        ///< true if we broadcast our own address on startup, default is true
           uint16_t arp_cacheSize;           ///< number of entries to include in the ARP cache, default is 10
           uint32_t arp_cacheExpirySeconds;  ///< The max seconds to keep an ARP cache entry, default is 600
-          uint32_t arp_replyTimeout;        ///< how long in ms to wait for an ARP reply, default is 5000
+          uint32_t arp_replyTimeout;        ///< how long in ms to wait for an ARP reply when lookups wait, default is 5000
           uint8_t arp_retries;              ///< number of times to retry, default is 5
+          uint8_t arp_pendingQueueSize;     ///< frames that can wait for each address being resolved, zero to wait in the caller instead. default is 4
+          uint8_t arp_pendingAddresses;     ///< addresses that can be resolved at the same time, default is 4
+          uint8_t arp_retryInterval;        ///< seconds between requests for a pending address, must not be zero. default is 1
 
           Parameters() {
             arp_startupBroadcast=true;
@@ -55,11 +76,47 @@ namespace stm32plus {
             arp_replyTimeout=5000;          ///< 5 seconds for an ARP timeout
             arp_cacheExpirySeconds=600;     ///< 10 minute default cache lifetime
             arp_retries=5;                  ///< 5 times to retry
+            arp_pendingQueueSize=4;
+            arp_pendingAddresses=4;
+            arp_retryInterval=1;
           }
         };
 
+
+
+        /**
+         * ARP counters
+         */
+
+        struct Statistics {
+          uint32_t requestsSent;            ///< requests sent to resolve an address
+          uint32_t requestsAnswered;        ///< requests for our address that we replied to
+          uint32_t repliesReceived;         ///< replies from other stations
+          uint32_t framesMalformed;         ///< frames too short to be ARP
+          uint32_t cacheHits;               ///< lookups found in the cache
+          uint32_t cacheMisses;             ///< lookups that needed a request
+          uint32_t framesQueued;            ///< frames parked while their next hop was resolved
+          uint32_t framesDropped;           ///< parked frames deleted because the queue was full or there was no reply
+          uint32_t resolutionsFailed;       ///< addresses that did not reply to any request
+        };
+
         DECLARE_EVENT_SOURCE(ArpReceive);
 
+      protected:
+
+        /**
+         * An address that is being resolved and the frames waiting for it
+         */
+
+        struct PendingAddress {
+          IpAddress ipAddress;
+          NetBuffer **frames;               ///< arp_pendingQueueSize entries in _pendingFrames
+          uint8_t frameCount;
+          uint8_t retriesLeft;              ///< requests still to send after the last one
+          uint8_t retryTimer;               ///< seconds until the next request, or until we give up
+          bool active;
+        };
+
       protected:
         Parameters _params;
         IpAddress _myIpAddress;
@@ -67,6 +124,9 @@ namespace stm32plus {
         IpSubnetMask _mySubnetMask;
         MacAddress _myMacAddress;
         ArpCache _arpCache;
+        scoped_array<PendingAddress> _pendingAddresses;
+        scoped_array<NetBuffer *> _pendingFrames;
+        Statistics _statistics;
 
       protected:
         void handleIpAddressAnnouncement(IpAddressAnnouncementEvent& event);
@@ -75,10 +135,18 @@ namespace stm32plus {
         void handleDefaultGatewayAnnouncement(IpDefaultGatewayAnnouncementEvent& event);
         void handleNewAddressMapping(IpAddressMappingEvent& event);
         bool handleAddressMappingRequest(ArpMappingRequestEvent& event);
+        bool handlePendingFrame(ArpPendingFrameEvent& event);
         bool handleIncomingFrame(const DatalinkFrame& frame);
 
+        bool getNextHop(const IpAddress& ipAddress,IpAddress& nextHop);
+        bool startResolving(const IpAddress& ipAddress);
+        PendingAddress *findPendingAddress(const IpAddress& ipAddress);
+        void cacheInsert(const MacAddress& mac,const IpAddress& ip);
+        void sendPendingFrames(const IpAddress& ip,const MacAddress& mac);
+
         void onReceive(NetEventDescriptor& ned);
         void onNotification(NetEventDescriptor& ned);
+        void onTick(NetworkIntervalTickData& nitd);
 
       public:
         bool initialise(const Parameters&);
@@ -87,6 +155,8 @@ namespace stm32plus {
         void arpBroadcastMyAddress();
         void arpSendRequest(IpAddress& ipaddress);
         void arpSendProbe(IpAddress& ipaddress);
+
+        const Statistics& getArpStatistics() const;
     };
 
 
@@ -102,15 +172,45 @@ namespace stm32plus {
       // save the parameters
 
       _params=params;
+      memset(&_statistics,0,sizeof(_statistics));
+
+      // the ticker counts the retry interval down to zero
+
+      if(_params.arp_pendingQueueSize && _params.arp_retryInterval==0)
+        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_INVALID_PARAMETERS);
 
       // initialise the cache
 
       _arpCache.initialise(params.arp_cacheSize,params.arp_cacheExpirySeconds,this->_rtc);
 
+      // create the pending frame queues. each address gets its own slice of the frame array.
+
+      if(_params.arp_pendingQueueSize==0 || _params.arp_pendingAddresses==0)
+        _params.arp_pendingQueueSize=_params.arp_pendingAddresses=0;
+      else {
+
+        uint8_t i;
+
+        _pendingAddresses.reset(new PendingAddress[_params.arp_pendingAddresses]);
+        _pendingFrames.reset(new NetBuffer *[_params.arp_pendingAddresses*_params.arp_pendingQueueSize]);
+
+        for(i=0;i<_params.arp_pendingAddresses;i++) {
+          _pendingAddresses[i].frames=&_pendingFrames[i*_params.arp_pendingQueueSize];
+          _pendingAddresses[i].frameCount=0;
+          _pendingAddresses[i].active=false;
+        }
+      }
+
       // subscribe to receive notification and receive events
 
-      this->NetworkReceiveEventSender.insertSubscriber(NetworkReceiveEventSourceSlot::bind(this,&Arp<TDatalinkLayer>::onReceive));
-      this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Arp<TDatalinkLayer>::onNotification));
+      if(!this->NetworkReceiveEventSender.insertSubscriber(NetworkReceiveEventSourceSlot::bind(this,&Arp<TDatalinkLayer>::onReceive)) ||
+         !this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Arp<TDatalinkLayer>::onNotification)))
+        return false;
+
+      // the one second ticker drives the retries for pending addresses
+
+      if(_params.arp_pendingQueueSize)
+        this->subscribeIntervalTicks(1,NetworkIntervalTicker::TickIntervalSlotType::bind(this,&Arp<TDatalinkLayer>::onTick));
 
       return true;
     }
@@ -160,6 +260,9 @@ namespace stm32plus {
       if(ned.eventType==NetEventDescriptor::NetEventType::ARP_MAPPING_REQUEST)
         handleAddressMappingRequest(static_cast<ArpMappingRequestEvent&>(ned));
 
+      else if(ned.eventType==NetEventDescriptor::NetEventType::ARP_PENDING_FRAME)
+        handlePendingFrame(static_cast<ArpPendingFrameEvent&>(ned));
+
       else if(ned.eventType==NetEventDescriptor::NetEventType::IP_ADDRESS_ANNOUNCEMENT)
         handleIpAddressAnnouncement(static_cast<IpAddressAnnouncementEvent&>(ned));
 
@@ -188,6 +291,11 @@ namespace stm32plus {
       ArpFrameData *afd,*reply;
       NetBuffer *nb;
 
+      if(frame.payloadLength<sizeof(ArpFrameData)) {
+        _statistics.framesMalformed++;
+        return true;
+      }
+
       afd=reinterpret_cast<ArpFrameData *>(frame.payload);
 
       // we respond to ARP requests (code 1)
@@ -221,17 +329,21 @@ namespace stm32plus {
 
         // raise a transmit event for the datalink layer to pick up
 
+        _statistics.requestsAnswered++;
+
         this->NetworkSendEventSender.raiseEvent(
               EthernetTransmitRequestEvent(nb,reply->arp_targetHardwareAddress,EtherType::ARP,DatalinkChecksum::IP_HEADER_AND_PROTOCOL));
       }
       else if(afd->arp_operation==ArpOperation::REPLY) {
 
+        _statistics.repliesReceived++;
+
         // it's a reply, verify that someone is not claiming to own our address
 
         if(afd->arp_senderProtocolAddress==_myIpAddress)
           return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_IP_ADDRESS_CLASH);
         else
-          _arpCache.insert(afd->arp_senderHardwareAddress,afd->arp_senderProtocolAddress);
+          cacheInsert(afd->arp_senderHardwareAddress,afd->arp_senderProtocolAddress);
       }
 
       // send an event to anyone that's interested
@@ -337,53 +449,337 @@ namespace stm32plus {
         return true;
       }
 
+      // use the event IP address or the gateway as the lookup
+
+      if(!getNextHop(event.ipAddress,ip))
+        return false;
+
+      // is the IP address the broadcast address for this subnet?
+
+      if(ip==event.ipAddress && _mySubnetMask.isBroadcastAddress(event.ipAddress)) {
+        event.macAddress=MacAddress::createBroadcastAddress();
+        event.found=true;
+        return true;
+      }
+
+      // first check the cache and return if found or we cannot do a lookup
+
+      if((event.found=_arpCache.findMacAddress(ip,event.macAddress))) {
+        sync_fetch_and_increment(&_statistics.cacheHits);
+        return true;
+      }
+
+      sync_fetch_and_increment(&_statistics.cacheMisses);
+
+      // if frames can be parked then send the request and let the caller queue its frames
+      // with an ArpPendingFrameEvent. Nothing waits for the reply.
+
+      if(_params.arp_pendingQueueSize)
+        return event.pending=startResolving(ip);
+
+      // parking is off. an IRQ can't wait for the reply, normal code can.
+
+      if(Nvic::isAnyIrqActive())
+        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_REQUEST_NOT_PERMITTED);
+
+      // the cache has one watch slot. if another task is using it then the reply it was
+      // waiting for may be the one we want.
+
+      _arpCache.claimWatch();
+
+      if(!(event.found=_arpCache.findMacAddress(ip,event.macAddress))) {
+
+        for(retry=0;retry<_params.arp_retries;retry++) {
+
+          _arpCache.setWatchIp(ip,&event.macAddress);
+
+          // send off the query
+
+          arpSendRequest(ip);
+
+          // wait for our watcher to be triggered, or a timeout
+
+          if((event.found=_arpCache.waitForWatch(_params.arp_replyTimeout)))
+            break;
+        }
+      }
+
+      _arpCache.releaseWatch();
+
+      if(event.found)
+        return true;
+
+      return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_TIMED_OUT);
+    }
+
+
+    /**
+     * Get the address whose MAC we need to send to an IP address. That's the address itself
+     * if it's on our subnet, otherwise it's the default gateway.
+     * @param ipAddress The destination IP address
+     * @param[out] nextHop The address to resolve
+     * @return false if we don't have a subnet mask and gateway
+     */
+
+    template<class TDatalinkLayer>
+    inline bool Arp<TDatalinkLayer>::getNextHop(const IpAddress& ipAddress,IpAddress& nextHop) {
+
       // must be configured with a subnet mask and gateway
 
       if(!_mySubnetMask.isValid() || !_defaultGatewayAddress.isValid())
         return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_UNCONFIGURED);
 
-      // use the event IP address or the gateway as the lookup
+      if(_mySubnetMask.matches(ipAddress,_defaultGatewayAddress))
+        nextHop=ipAddress;                // a local IP address
+      else
+        nextHop=_defaultGatewayAddress;   // a remote IP address
+
+      return true;
+    }
+
+
+    /**
+     * Start resolving an address that's not in the cache. The first request is sent now and the
+     * ticker sends the rest. Nothing is sent if the address is already being resolved so that
+     * a burst of frames to a new address only causes one request.
+     * @param ipAddress The address to resolve
+     * @return true if frames for the address can be parked
+     */
+
+    template<class TDatalinkLayer>
+    inline bool Arp<TDatalinkLayer>::startResolving(const IpAddress& ipAddress) {
 
-      if(_mySubnetMask.matches(event.ipAddress,_defaultGatewayAddress)) {
+      PendingAddress *pa;
+      IpAddress ip;
+      uint8_t i;
 
-        // is the IP address the broadcast address for this subnet?
+      {
+        IrqSuspend suspender;
 
-        if(_mySubnetMask.isBroadcastAddress(event.ipAddress)) {
-          event.macAddress=MacAddress::createBroadcastAddress();
-          event.found=true;
+        if(findPendingAddress(ipAddress)!=nullptr)
           return true;
+
+        for(pa=nullptr,i=0;i<_params.arp_pendingAddresses;i++) {
+          if(!_pendingAddresses[i].active) {
+            pa=&_pendingAddresses[i];
+            break;
+          }
+        }
+
+        if(pa!=nullptr) {
+          pa->ipAddress=ipAddress;
+          pa->frameCount=0;
+          pa->retriesLeft=_params.arp_retries>1 ? _params.arp_retries-1 : 0;
+          pa->retryTimer=_params.arp_retryInterval;
+          pa->active=true;
         }
-        else
-          ip=event.ipAddress;           // a local IP address
       }
-      else
-        ip=_defaultGatewayAddress;      // a remote IP address
 
-      // first check the cache and return if found or we cannot do a lookup
+      if(pa==nullptr)
+        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_TOO_MANY_PENDING);
+
+      // send the first request
+
+      ip=ipAddress;
+      arpSendRequest(ip);
+
+      return true;
+    }
+
+
+    /**
+     * Handle a frame that has to wait for its next hop to be resolved. If the reply has arrived
+     * since the lookup then the frame is sent now. Frames that can't be queued are deleted.
+     * @param event The pending frame event
+     * @return true if it worked
+     */
+
+    template<class TDatalinkLayer>
+    inline bool Arp<TDatalinkLayer>::handlePendingFrame(ArpPendingFrameEvent& event) {
+
+      PendingAddress *pa;
+      IpAddress ip;
+      MacAddress mac;
+      bool found;
+
+      if(!getNextHop(event.ipAddress,ip)) {
+        delete event.networkBuffer;
+        return false;
+      }
+
+      // the frame will outlive the send call so it can't keep pointing at the caller's data
+
+      if(!event.networkBuffer->ownUserBuffer()) {
+        sync_fetch_and_increment(&_statistics.framesDropped);
+        delete event.networkBuffer;
+        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_OUT_OF_MEMORY);
+      }
+
+      pa=nullptr;
+
+      {
+        IrqSuspend suspender;
+
+        if(!(found=_arpCache.findMacAddress(ip,mac))) {
+
+          if((pa=findPendingAddress(ip))!=nullptr && pa->frameCount<_params.arp_pendingQueueSize) {
+            pa->frames[pa->frameCount++]=event.networkBuffer;
+            event.queued=true;
+            _statistics.framesQueued++;
+          }
+        }
+      }
+
+      // send it now if the mapping turned up
+
+      if(found) {
+
+        EthernetTransmitRequestEvent etre(event.networkBuffer,mac,EtherType::IP,event.networkBuffer->getChecksumRequest());
 
-      if((event.found=_arpCache.findMacAddress(ip,event.macAddress)))
+        this->NetworkSendEventSender.raiseEvent(etre);
+        return event.queued=etre.succeeded;
+      }
+
+      if(event.queued)
         return true;
 
-      // if we're in an IRQ then we can't continue because we'd need to do a tx/rx
+      // the frame is ours to delete. if the address isn't pending then it has timed out since the lookup.
 
-      if(Nvic::isAnyIrqActive())
-        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_REQUEST_NOT_PERMITTED);
+      sync_fetch_and_increment(&_statistics.framesDropped);
+      delete event.networkBuffer;
+      return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,pa==nullptr ? E_TIMED_OUT : E_PENDING_QUEUE_FULL);
+    }
 
-      for(retry=0;retry<_params.arp_retries;retry++) {
 
-        _arpCache.setWatchIp(ip,&event.macAddress);
+    /**
+     * Insert a mapping into the cache and send any frames that were waiting for it. This is
+     * IRQ code.
+     * @param mac The MAC address
+     * @param ip The IP address
+     */
 
-        // send off the query
+    template<class TDatalinkLayer>
+    inline void Arp<TDatalinkLayer>::cacheInsert(const MacAddress& mac,const IpAddress& ip) {
 
-        arpSendRequest(ip);
+      _arpCache.insert(mac,ip);
 
-        // wait for our watcher to be triggered, or a timeout
+      if(_params.arp_pendingQueueSize)
+        sendPendingFrames(ip,mac);
+    }
 
-        if((event.found=_arpCache.waitForWatch(_params.arp_replyTimeout)))
-          return true;
+
+    /**
+     * An address has been resolved. Send the frames that were waiting for it in the order
+     * that they were queued. The frames are taken off the queue one at a time so that the
+     * queue is never locked while we send. This is IRQ code.
+     * @param ip The resolved address
+     * @param mac Its MAC address
+     */
+
+    template<class TDatalinkLayer>
+    inline void Arp<TDatalinkLayer>::sendPendingFrames(const IpAddress& ip,const MacAddress& mac) {
+
+      PendingAddress *pa;
+      NetBuffer *nb;
+
+      for(;;) {
+
+        {
+          IrqSuspend suspender;
+
+          if((pa=findPendingAddress(ip))==nullptr)
+            return;
+
+          // the address is done with when the last frame has gone
+
+          if(pa->frameCount==0) {
+            pa->active=false;
+            return;
+          }
+
+          nb=pa->frames[0];
+          pa->frameCount--;
+          memmove(pa->frames,pa->frames+1,sizeof(NetBuffer *)*pa->frameCount);
+        }
+
+        // the link layer deletes the frame if it can't be sent
+
+        this->NetworkSendEventSender.raiseEvent(EthernetTransmitRequestEvent(nb,mac,EtherType::IP,nb->getChecksumRequest()));
       }
+    }
 
-      return this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_TIMED_OUT);
+
+    /**
+     * Find an address that is being resolved. Call with IRQs suspended.
+     * @param ipAddress The address to find
+     * @return The pending address or nullptr if not found
+     */
+
+    template<class TDatalinkLayer>
+    inline typename Arp<TDatalinkLayer>::PendingAddress *Arp<TDatalinkLayer>::findPendingAddress(const IpAddress& ipAddress) {
+
+      uint8_t i;
+
+      for(i=0;i<_params.arp_pendingAddresses;i++)
+        if(_pendingAddresses[i].active && _pendingAddresses[i].ipAddress==ipAddress)
+          return &_pendingAddresses[i];
+
+      return nullptr;
+    }
+
+
+    /**
+     * The one second ticker. Repeat the requests for addresses that haven't replied and give
+     * up on those that have run out of retries, deleting their frames. This is IRQ code.
+     * @param nitd The tick data
+     */
+
+    template<class TDatalinkLayer>
+    inline void Arp<TDatalinkLayer>::onTick(NetworkIntervalTickData& /* nitd */) {
+
+      IpAddress ip;
+      uint8_t i,j;
+      bool resend,timedOut;
+
+      timedOut=false;
+
+      for(i=0;i<_params.arp_pendingAddresses;i++) {
+
+        PendingAddress& pa(_pendingAddresses[i]);
+
+        {
+          IrqSuspend suspender;
+
+          if(!pa.active || --pa.retryTimer!=0)
+            continue;
+
+          if((resend=pa.retriesLeft!=0)) {
+            pa.retriesLeft--;
+            pa.retryTimer=_params.arp_retryInterval;
+            ip=pa.ipAddress;
+          }
+          else {
+
+            // nobody answered. the frames are deleted while we still hold the entry.
+
+            for(j=0;j<pa.frameCount;j++)
+              delete pa.frames[j];
+
+            _statistics.framesDropped+=pa.frameCount;
+            _statistics.resolutionsFailed++;
+
+            pa.frameCount=0;
+            pa.active=false;
+            timedOut=true;
+          }
+        }
+
+        if(resend)
+          arpSendRequest(ip);
+      }
+
+      if(timedOut)
+        this->setError(ErrorProvider::ERROR_PROVIDER_NET_ARP,E_TIMED_OUT);
     }
 
 
@@ -413,6 +809,8 @@ namespace stm32plus {
       afd->initialise();
       afd->createRequest(ipaddress,_myMacAddress,_myIpAddress);
 
+      sync_fetch_and_increment(&_statistics.requestsSent);
+
       // raise a transmit event for the datalink layer to pick up
 
       this->NetworkSendEventSender.raiseEvent(
@@ -461,15 +859,20 @@ namespace stm32plus {
     template<class TDatalinkLayer>
     inline void Arp<TDatalinkLayer>::handleNewAddressMapping(IpAddressMappingEvent& event) {
 
+      IpAddress ip;
+
       if(_mySubnetMask.isValid() && _defaultGatewayAddress.isValid()) {
 
         // insert the association 'as reported' if the host is on this subnet
-        // otherwise the association is between the default gateway and this IP address
+        // otherwise the association is between the default gateway and this IP address.
+        // mappings arrive with every received IP packet so the insert is skipped while the cache
+        // already holds a fresh copy of the mapping. nothing can be waiting for an address that's
+        // in the cache so there are no pending frames to send.
 
-        if(_mySubnetMask.matches(event.ipAddress,_defaultGatewayAddress))
-          _arpCache.insert(event.macAddress,event.ipAddress);
-        else
-          _arpCache.insert(event.macAddress,_defaultGatewayAddress);
+        ip=_mySubnetMask.matches(event.ipAddress,_defaultGatewayAddress) ? event.ipAddress : _defaultGatewayAddress;
+
+        if(_arpCache.needsUpdate(event.macAddress,ip))
+          cacheInsert(event.macAddress,ip);
       }
     }
 
@@ -509,5 +912,16 @@ namespace stm32plus {
       this->NetworkSendEventSender.raiseEvent(
             EthernetTransmitRequestEvent(nb,MacAddress::createBroadcastAddress(),EtherType::ARP,DatalinkChecksum::IP_HEADER_AND_PROTOCOL));
     }
+
+
+    /**
+     * Get the ARP counters
+     * @return The statistics
+     */
+
+    template<class TDatalinkLayer>
+    inline const typename Arp<TDatalinkLayer>::Statistics& Arp<TDatalinkLayer>::getArpStatistics() const {
+      return _statistics;
+    }
   }
 }
@@ -17,6 +17,10 @@ namespace stm32plus {
      * initialisation. Searching is a linear operation from the MRU to the LRU so the
      * number of entries should be kept low. The maximum number of entries is 255.
      * Index #255 is reserved.
+     *
+     * Mappings gleaned from received frames are offered to the cache for every frame so
+     * needsUpdate() lets the caller skip the insert while the cached mapping is still
+     * fresh. An insert that confirms an existing mapping starts its lifetime again.
      */
 
     class ArpCache {
@@ -44,11 +48,13 @@ namespace stm32plus {
         uint8_t _insertionPoint;          ///< next free array slot for new entries (or _maxEntries-1 if full)
         uint8_t _maxEntries;              ///< total entries allowed
         uint32_t _expirySeconds;          ///< seconds to keep in a cache
+        uint32_t _refreshSeconds;         ///< an entry this close to expiry is refreshed by needsUpdate()
         RtcBase *_rtc;                    ///< Pointer to the RTC
 
         scoped_array<CacheEntry> _array;  ///< the array of CacheEntry structures
 
         volatile bool _watchFlag;         ///< set to true when _watchIp is inserted
+        bool _watchClaimed;               ///< a task owns the watch slot
         IpAddress _watchIp;             ///< an IP to watch for
         MacAddress *_foundMac;            ///< MAC address found for the watcher
 
@@ -63,7 +69,10 @@ namespace stm32plus {
 
         void insert(const MacAddress& mac,const IpAddress& ip);
         bool findMacAddress(const IpAddress& ip,MacAddress& found);
+        bool needsUpdate(const MacAddress& mac,const IpAddress& ip) const;
 
+        void claimWatch();
+        void releaseWatch();
         void setWatchIp(const IpAddress& ip,MacAddress *foundMac);
         bool waitForWatch(uint32_t timeout);
     };
@@ -90,8 +99,10 @@ namespace stm32plus {
       _insertionPoint=0;
       _maxEntries=numEntries;
       _expirySeconds=expirySeconds;
+      _refreshSeconds=expirySeconds/4;
       _rtc=rtc;
       _watchFlag=false;
+      _watchClaimed=false;
 
       return _array.get()!=nullptr;
     }
@@ -174,7 +185,10 @@ namespace stm32plus {
 
       if(found!=NO_ENTRY) {
 
-        // take the entry out of the list and put it back at the front
+        // the mapping has been confirmed so it lives again. take the entry out of the list
+        // and put it back at the front
+
+        _array[found].expiryTime=timeNow+_expirySeconds;
 
         unlink(found);
         insertFront(found);
@@ -248,6 +262,31 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Check if inserting a mapping would change the cache. It would if the IP address is not
+     * cached, is cached with a different MAC address or the entry has less than a quarter of
+     * its lifetime left. This is IRQ-safe.
+     * @param mac The MAC address
+     * @param ip The associated IP address
+     * @return true if the mapping should be inserted
+     */
+
+    inline bool ArpCache::needsUpdate(const MacAddress& mac,const IpAddress& ip) const {
+
+      uint8_t i;
+
+      // protect ourselves from re-entrancy
+
+      IrqSuspend suspender;
+
+      for(i=_first;i!=NO_ENTRY;i=_array[i].next)
+        if(_array[i].ipAddress==ip)
+          return _array[i].macAddress!=mac || _rtc->getTick()+_refreshSeconds>_array[i].expiryTime;
+
+      return true;
+    }
+
+
     /**
      * Check if this ARP cache entry has expired
      * @param index The index to check
@@ -260,7 +299,33 @@ namespace stm32plus {
 
 
     /**
-     * Set a watch IP address (will be triggered when inserted)
+     * Take ownership of the watch slot. There's only one so a task that finds it in use
+     * yields until the owner has finished with it. Tasks are not preempted so a plain
+     * flag is enough.
+     */
+
+    inline void ArpCache::claimWatch() {
+
+      while(_watchClaimed)
+        TaskScheduler::yield();
+
+      _watchClaimed=true;
+    }
+
+
+    /**
+     * Give up the watch slot, cancelling any watch that didn't trigger
+     */
+
+    inline void ArpCache::releaseWatch() {
+      _watchFlag=false;
+      _watchClaimed=false;
+    }
+
+
+    /**
+     * Set a watch IP address (will be triggered when inserted). The caller must own the
+     * watch slot.
      * @param ip The IP address to watch for
      * @param foundMac Where to store the found MAC result
      */
@@ -275,7 +340,7 @@ namespace stm32plus {
     /**
      * Wait for a configurable time for a watch ip to be triggered. The idea is that an ARP
      * frame is received over an IRQ and added to the cache, releasing the main CPU that is
-     * waiting on the watch flag.
+     * waiting on the watch flag. Other tasks may run while we wait.
      * @param timeout The timeout value in ms
      * @return true if found in time
      */
@@ -286,10 +351,14 @@ namespace stm32plus {
 
       now=MillisecondTimer::millis();
 
-      while(_watchFlag)
+      while(_watchFlag) {
+
         if(MillisecondTimer::hasTimedOut(now,timeout))
           return false;
 
+        TaskScheduler::yield();
+      }
+
       return true;
     }
 
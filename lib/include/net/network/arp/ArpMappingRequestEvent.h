@@ -12,7 +12,9 @@ namespace stm32plus {
   namespace net {
 
     /**
-     * Request an ARP mapping (get MAC from IP)
+     * Request an ARP mapping (get MAC from IP). If the mapping is not cached then a request
+     * may be sent and the event comes back pending instead of found. Frames for the address
+     * can then be parked with an ArpPendingFrameEvent until the reply arrives.
      */
 
     struct ArpMappingRequestEvent : NetEventDescriptor {
@@ -21,11 +23,13 @@ namespace stm32plus {
 
       MacAddress macAddress;              ///< the returned MAC or nullptr
       bool found;
+      bool pending;                       ///< not found yet but it's being resolved
 
       ArpMappingRequestEvent(const IpAddress& address)
         : NetEventDescriptor(NetEventType::ARP_MAPPING_REQUEST),
           ipAddress(address),
-          found(false) {
+          found(false),
+          pending(false) {
       }
     };
   }
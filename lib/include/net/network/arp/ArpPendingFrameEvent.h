@@ -0,0 +1,45 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+    /**
+     * Ask the ARP layer to hold on to an IP frame until the MAC address of its next hop has
+     * been resolved. Raise this when an ArpMappingRequestEvent comes back pending. The frame
+     * is sent as soon as the ARP reply arrives and is deleted if the address cannot be resolved.
+     */
+
+    struct ArpPendingFrameEvent : NetEventDescriptor {
+
+      NetBuffer *networkBuffer;           ///< the frame to send, the ARP layer owns it from now on
+      const IpAddress& ipAddress;         ///< the destination of the IP packet in the frame
+      bool queued;                        ///< set to true if the frame was accepted
+
+      /**
+       * Constructor
+       * @param nb The frame to send
+       * @param address The destination IP address
+       * @param ckreq The checksum that the MAC must do when the frame is sent
+       */
+
+      ArpPendingFrameEvent(NetBuffer *nb,const IpAddress& address,DatalinkChecksum ckreq)
+        : NetEventDescriptor(NetEventType::ARP_PENDING_FRAME),
+          networkBuffer(nb),
+          ipAddress(address),
+          queued(false) {
+
+        // the checksum request goes with the netbuffer, as it does for a transmit request
+
+        nb->setChecksumRequest(ckreq);
+      }
+    };
+  }
+}
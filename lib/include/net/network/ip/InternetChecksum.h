@@ -10,8 +10,13 @@
 namespace stm32plus {
   namespace net {
 
+    struct IpPacketHeader;
+
+
     /**
-     * Utility class to do the IP checksum algorithm
+     * Utility class to do the IP checksum algorithm. The MAC normally generates and checks
+     * the checksums. These are the software equivalents that are used when it cannot: for
+     * fragmented packets and when the IP layer is configured for software checksums.
      */
 
     class InternetChecksum {
@@ -28,9 +33,19 @@ namespace stm32plus {
 
       protected:
         static void sumit(const void *vptr,uint16_t length,uint32_t& sum);
+        static void sumPseudoHeader(const IpAddress& sourceAddress,const IpAddress& destinationAddress,IpProtocol protocol,uint16_t length,uint32_t& sum);
+        static uint16_t fold(uint32_t sum);
+        static bool hasPseudoHeader(IpProtocol protocol);
+        static uint16_t *getChecksumField(IpProtocol protocol,void *protocolHeader,uint16_t length);
 
       public:
         static void calculate(const IpAddress& sourceAddress,const IpAddress& destinationAddress,NetBuffer& nb);
+        static bool calculate(const IpAddress& sourceAddress,const IpAddress& destinationAddress,IpProtocol protocol,NetBuffer& nb);
+        static void calculateHeader(IpPacketHeader& header);
+        static uint16_t adjust(uint16_t checksum,uint16_t oldValue,uint16_t newValue);
+
+        static bool verifyHeader(const IpPacketHeader& header,uint16_t headerLength);
+        static bool verify(const IpAddress& sourceAddress,const IpAddress& destinationAddress,IpProtocol protocol,const void *payload,uint16_t length);
     };
   }
 }
@@ -13,6 +13,11 @@ namespace stm32plus {
 
     /**
      * Network layer feature that implements IP version 4.
+     *
+     * Received packets are passed up to the transport layer by protocol. ICMP, IGMP, TCP and UDP
+     * each have a slot in a small table that the transport features fill in with
+     * ip_setProtocolHandler() so a packet is delivered straight to its one handler. Packets for
+     * any other protocol are raised on IpReceiveEventSender for anyone that wants them.
      */
 
     DECLARE_EVENT_SIGNATURE(IpReceive,void (IpPacketEvent&));
@@ -33,7 +38,9 @@ namespace stm32plus {
           E_FRAGMENTATION_FAILED,
           E_ARP_LOOKUP_FAILED,
           E_OUT_OF_MEMORY,
-          E_UNCONFIGURED
+          E_UNCONFIGURED,
+          E_NOT_A_MULTICAST_GROUP,
+          E_TOO_MANY_MULTICAST_GROUPS
         };
 
         DECLARE_EVENT_SOURCE(IpReceive);
@@ -46,6 +53,8 @@ namespace stm32plus {
                             Features::Parameters... {
 
           uint8_t ip_initialTtl;                    ///< TTL value inserted into new IP packets. The default is 64.
+          IpChecksumMode ip_checksumMode;           ///< where checksums are done. The default is HARDWARE.
+          uint8_t ip_maxMulticastGroups;            ///< maximum multicast groups that can be joined at once. The default is 4.
 
           /**
            * Constructor, set up parameters
@@ -53,31 +62,108 @@ namespace stm32plus {
 
           Parameters() {
             ip_initialTtl=64;
+            ip_checksumMode=IpChecksumMode::HARDWARE;
+            ip_maxMulticastGroups=4;
           }
         };
 
+        /**
+         * Counters for the checksums done in software
+         */
+
+        struct ChecksumStatistics {
+          uint32_t packetsGenerated;                ///< transmitted packets checksummed in software
+          uint32_t packetsVerified;                 ///< received packets verified in software
+          uint32_t headerErrors;                    ///< received packets dropped for a bad IP header checksum
+          uint32_t payloadErrors;                   ///< received packets dropped for a bad protocol checksum
+        };
+
+
+        /**
+         * Packet counters. Packets dropped for bad checksums are in the ChecksumStatistics.
+         */
+
+        struct Statistics {
+          uint32_t packetsReceived;                 ///< packets passed up to the transport layer
+          uint32_t packetsNotForUs;                 ///< packets dropped because of their destination address
+          uint32_t packetsMalformed;                ///< packets dropped because they were truncated or not IPv4
+          uint32_t fragmentsReceived;               ///< fragments received for reassembly
+          uint32_t reassemblyFailures;              ///< fragments that could not be reassembled
+          uint32_t packetsSent;                     ///< packets, fragments and large send segments handed to the link layer
+          uint32_t sendFailures;                    ///< packets that could not be sent
+        };
+
+      protected:
+
+        /**
+         * A multicast group that we've joined. A free entry has no references.
+         */
+
+        struct MulticastGroup {
+          IpAddress address;
+          uint8_t references;
+        };
+
+        /**
+         * Protocols that have a slot in the dispatch table
+         */
+
+        enum {
+          PROTOCOL_HANDLERS = 4
+        };
+
       protected:
         IpAddress _myIpAddress;
         IpSubnetMask _mySubnetMask;
         MacAddress _myMacAddress;
         uint8_t _initialTtl;
+        IpChecksumMode _checksumMode;
+        ChecksumStatistics _checksumStatistics;
+        Statistics _statistics;
+        scoped_array<MulticastGroup> _multicastGroups;
+        uint8_t _maxMulticastGroups;
+        uint8_t _multicastGroupCount;
+        IpReceiveEventSourceSlot _protocolHandlers[PROTOCOL_HANDLERS];
+        uint8_t _protocolHandlerMask;                  ///< bit n is set if _protocolHandlers[n] is in use
 
       protected:
+        static int8_t getProtocolHandlerIndex(IpProtocol protocol);
+        void dispatchPacket(IpPacket& packet);
+
         void handleAddressMappingEvent(const MacAddress& mac,const IpAddress& ipAddress);
         bool canAcceptPacket(const IpAddress& destinationAddress) const;
+        bool verifyPayloadChecksum(const IpPacket& packet);
+        MulticastGroup *findMulticastGroup(const IpAddress& groupAddress) const;
+        void updateMulticastFilter(const IpAddress& groupAddress,bool add);
 
         void onReceive(NetEventDescriptor& ned);
         void onSend(NetEventDescriptor& ned);
         void onNotification(NetEventDescriptor& ned);
 
         void setCommonTransmitHeaderValues(IpPacketHeader& header,IpTransmitRequestEvent& txevent);
+        void setCommonTransmitHeaderValues(IpPacketHeader& header,const IpAddress& destinationIpAddress,IpProtocol protocol,uint8_t ttl);
         void sendToLocalhost(IpTransmitRequestEvent& txevent);
+        bool sendFrame(NetBuffer *nb,const IpAddress& destinationIpAddress,const ArpMappingRequestEvent& arpRequest,DatalinkChecksum checksum);
+        void sendLargeSend(IpLargeSendRequestEvent& event);
+        void sendLargeSendSegments(IpLargeSendRequestEvent& event);
+        NetBuffer *createLargeSendSegment(const IpLargeSendRequestEvent& event,uint32_t offset,uint16_t size);
 
       public:
         bool initialise(Parameters&);
         bool startup();
 
+        void ip_setProtocolHandler(IpProtocol protocol,const IpReceiveEventSourceSlot& handler);
+
         const IpAddress& getIpAddress() const;
+        const IpSubnetMask& getSubnetMask() const;
+        IpChecksumMode getChecksumMode() const;
+        const ChecksumStatistics& getChecksumStatistics() const;
+        const Statistics& getIpStatistics() const;
+
+        bool joinMulticastGroup(const IpAddress& groupAddress);
+        bool leaveMulticastGroup(const IpAddress& groupAddress);
+        bool isMulticastGroupMember(const IpAddress& groupAddress) const;
+        uint8_t getMaxMulticastGroups() const;
         constexpr uint32_t getIpTransmitHeaderSize() const;
     };
 
@@ -127,12 +213,29 @@ namespace stm32plus {
       // remember parameters
 
       _initialTtl=params.ip_initialTtl;
+      _checksumMode=params.ip_checksumMode;
+
+      memset(&_checksumStatistics,0,sizeof(_checksumStatistics));
+      memset(&_statistics,0,sizeof(_statistics));
+
+      _protocolHandlerMask=0;
+
+      // create the multicast group table
+
+      _maxMulticastGroups=params.ip_maxMulticastGroups;
+      _multicastGroupCount=0;
+
+      if(_maxMulticastGroups) {
+        _multicastGroups.reset(new MulticastGroup[_maxMulticastGroups]);
+        memset(_multicastGroups.get(),0,sizeof(MulticastGroup)*_maxMulticastGroups);
+      }
 
       // subscribe to send/receive/notify events from the network
 
-      this->NetworkReceiveEventSender.insertSubscriber(NetworkReceiveEventSourceSlot::bind(this,&Ip<TDatalinkLayer,Features...>::onReceive));
-      this->NetworkSendEventSender.insertSubscriber(NetworkSendEventSourceSlot::bind(this,&Ip<TDatalinkLayer,Features...>::onSend));
-      this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Ip<TDatalinkLayer,Features...>::onNotification));
+      if(!this->NetworkReceiveEventSender.insertSubscriber(NetworkReceiveEventSourceSlot::bind(this,&Ip<TDatalinkLayer,Features...>::onReceive)) ||
+         !this->NetworkSendEventSender.insertSubscriber(NetworkSendEventSourceSlot::bind(this,&Ip<TDatalinkLayer,Features...>::onSend)) ||
+         !this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Ip<TDatalinkLayer,Features...>::onNotification)))
+        return false;
 
       return true;
     }
@@ -207,14 +310,18 @@ namespace stm32plus {
 
       // IP packets cannot be shorter than 20 bytes
 
-      if(frame.payloadLength<20)
+      if(frame.payloadLength<20) {
+        _statistics.packetsMalformed++;
         return;
+      }
 
       // quickly check the version and get out if it's not IP
 
       header=reinterpret_cast<IpPacketHeader *>(frame.payload);
-      if((header->ip_hdr_version & 0xf0)!=0x40)
+      if((header->ip_hdr_version & 0xf0)!=0x40) {
+        _statistics.packetsMalformed++;
         return;
+      }
 
       // we accept the packet if the destination address...
       // 1. Is our unicast address
@@ -222,8 +329,10 @@ namespace stm32plus {
       // 3. Is the local subnet broadcast address
       // 4. Is a multicast group to which we are subscribed
 
-      if(!canAcceptPacket(header->ip_destinationAddress))
+      if(!canAcceptPacket(header->ip_destinationAddress)) {
+        _statistics.packetsNotForUs++;
         return;
+      }
 
       // now construct the packet structure
 
@@ -237,6 +346,23 @@ namespace stm32plus {
       packet.payload=reinterpret_cast<uint8_t *>(((uint32_t)header)+packet.headerLength);
       packet.payloadLength=NetUtil::ntohs(header->ip_hdr_length)-packet.headerLength;
 
+      // the header and the total length must fit in the frame. the MAC's header checksum does
+      // not cover the case where the lengths are consistent with each other but not the frame.
+
+      if(packet.headerLength<20 ||
+         NetUtil::ntohs(header->ip_hdr_length)<packet.headerLength ||
+         packet.headerLength+packet.payloadLength>frame.payloadLength) {
+        _statistics.packetsMalformed++;
+        return;
+      }
+
+      // the MAC has already checked the header unless we're doing it ourselves
+
+      if(_checksumMode!=IpChecksumMode::HARDWARE && !InternetChecksum::verifyHeader(*header,packet.headerLength)) {
+        _checksumStatistics.headerErrors++;
+        return;
+      }
+
       // if the packet came from ethernet then we notify that there is a potentially
       // new address mapping that can be cached
 
@@ -249,10 +375,13 @@ namespace stm32plus {
 
         IpFragmentedPacket *fp;
 
+        _statistics.fragmentsReceived++;
+
         if(!this->ip_handleFragment(packet,fp)) {
 
           // there was a failure to handle the packet fragment, notify observers and finish
 
+          _statistics.reassemblyFailures++;
           this->setError(errorProvider.getProvider(),errorProvider.getCode(),errorProvider.getCause());
           return;
         }
@@ -267,21 +396,122 @@ namespace stm32plus {
           packet.payload=fp->packet;
           packet.payloadLength=fp->packetLength;
 
-          // notify and free
+          // the MAC could not check the protocol checksum of the whole packet so it's always
+          // done here. notify and free.
+
+          if(verifyPayloadChecksum(packet))
+            dispatchPacket(packet);
 
-          IpReceiveEventSender.raiseEvent(IpPacketEvent(packet));
           this->ip_freePacket(fp);
         }
       }
       else {
 
-        // notify the observers of the incoming packet
+        // pass the incoming packet up to its protocol
 
-        IpReceiveEventSender.raiseEvent(IpPacketEvent(packet));
+        if(_checksumMode==IpChecksumMode::HARDWARE || verifyPayloadChecksum(packet))
+          dispatchPacket(packet);
+      }
+    }
+
+
+    /**
+     * Pass a received packet to the handler for its protocol, or raise it on the generic receive
+     * event if the protocol has no handler. This is IRQ code.
+     * @param packet The received packet
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline void Ip<TDatalinkLayer,Features...>::dispatchPacket(IpPacket& packet) {
+
+      int8_t index;
+
+      _statistics.packetsReceived++;
+
+      IpPacketEvent event(packet);
+
+      if((index=getProtocolHandlerIndex(packet.header->ip_hdr_protocol))>=0 && (_protocolHandlerMask & (1 << index))!=0)
+        _protocolHandlers[index](event);
+      else
+        IpReceiveEventSender.raiseEvent(event);
+    }
+
+
+    /**
+     * Get the slot in the dispatch table for a protocol
+     * @param protocol The protocol
+     * @return The index into the dispatch table, or -1 if the protocol doesn't have one
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline int8_t Ip<TDatalinkLayer,Features...>::getProtocolHandlerIndex(IpProtocol protocol) {
+
+      switch(protocol) {
+
+        case IpProtocol::ICMP:
+          return 0;
+
+        case IpProtocol::IGMP:
+          return 1;
+
+        case IpProtocol::TCP:
+          return 2;
+
+        case IpProtocol::UDP:
+          return 3;
+
+        default:
+          return -1;
+      }
+    }
+
+
+    /**
+     * Set the handler for received packets of one protocol. Each protocol has one handler and
+     * it gets only the packets for that protocol. A protocol that's not in the dispatch table
+     * has its handler subscribed to IpReceiveEventSender instead and that handler must then
+     * check the protocol of each packet it receives.
+     * @param protocol The protocol to handle
+     * @param handler The handler for its packets
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline void Ip<TDatalinkLayer,Features...>::ip_setProtocolHandler(IpProtocol protocol,const IpReceiveEventSourceSlot& handler) {
+
+      int8_t index;
+
+      if((index=getProtocolHandlerIndex(protocol))<0)
+        IpReceiveEventSender.insertSubscriber(handler);
+      else {
+        _protocolHandlers[index]=handler;
+        _protocolHandlerMask|=1 << index;
       }
     }
 
 
+    /**
+     * Verify the protocol checksum of a received packet in software. This is IRQ code.
+     * @param packet The packet with its complete payload
+     * @return true if the checksum is correct, false if the packet must be dropped
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline bool Ip<TDatalinkLayer,Features...>::verifyPayloadChecksum(const IpPacket& packet) {
+
+      _checksumStatistics.packetsVerified++;
+
+      if(InternetChecksum::verify(packet.header->ip_sourceAddress,
+                                  packet.header->ip_destinationAddress,
+                                  packet.header->ip_hdr_protocol,
+                                  packet.payload,
+                                  packet.payloadLength))
+        return true;
+
+      _checksumStatistics.payloadErrors++;
+      return false;
+    }
+
+
     /**
      * Check if we can accept this packet
      * @param destinationAddress Where the packet was addressed to
@@ -297,6 +527,11 @@ namespace stm32plus {
       if(destinationAddress.isBroadcast() || destinationAddress.isAllHostsMulticastGroup())
         return true;
 
+      // multicast groups that we've joined don't need our address either
+
+      if(destinationAddress.isMulticastGroup())
+        return findMulticastGroup(destinationAddress)!=nullptr;
+
       // further checks need our address
 
       if(!_myIpAddress.isValid())
@@ -317,8 +552,6 @@ namespace stm32plus {
       if(_mySubnetMask.isBroadcastAddress(_myIpAddress))
         return true;
 
-      // TODO: support user-joined multicast groups
-
       return false;
     }
 
@@ -332,6 +565,14 @@ namespace stm32plus {
     inline void Ip<TDatalinkLayer,Features...>::onSend(NetEventDescriptor& ned) {
 
       uint16_t packetSize;
+      bool softwareChecksum;
+
+      // runs of segments have their own handler
+
+      if(ned.eventType==NetEventDescriptor::NetEventType::IP_LARGE_SEND_REQUEST) {
+        sendLargeSend(static_cast<IpLargeSendRequestEvent&>(ned));
+        return;
+      }
 
       // must be a send event
 
@@ -351,6 +592,7 @@ namespace stm32plus {
       // we can't do anything without a MAC.
 
       if(!_myMacAddress.isValid()) {
+        sync_fetch_and_increment(&_statistics.sendFailures);
         this->setError(ErrorProvider::ERROR_PROVIDER_NET_IP,E_UNCONFIGURED);
         return;
       }
@@ -359,13 +601,15 @@ namespace stm32plus {
       // because it's going to be the DHCP client
 
       if(!_myIpAddress.isValid() && !txevent.destinationIpAddress.isBroadcast()) {
+        sync_fetch_and_increment(&_statistics.sendFailures);
         this->setError(ErrorProvider::ERROR_PROVIDER_NET_IP,E_UNCONFIGURED);
         return;
       }
 
       // we need the MAC address of the destination. if we came here from an IRQ (a received frame)
-      // then it will already have been put into the ARP cache on the way up the stack. as well as
-      // being efficient this is necessary because we cannot do tx-wait-rx while in an ethernet rx IRQ.
+      // then it will usually already be in the ARP cache. if it's not then the ARP layer sends a
+      // request and holds on to our frames, with a copy of their data, until the reply arrives.
+      // nothing waits here so this is fine in an ethernet rx IRQ.
 
       ArpMappingRequestEvent arpRequest(txevent.destinationIpAddress);
 
@@ -373,11 +617,20 @@ namespace stm32plus {
 
       // did it work?
 
-      if(!arpRequest.found) {
+      if(!arpRequest.found && !arpRequest.pending) {
+        sync_fetch_and_increment(&_statistics.sendFailures);
         this->setError(ErrorProvider::ERROR_PROVIDER_NET_IP,E_ARP_LOOKUP_FAILED);
         return;
       }
 
+      // in software mode the protocol checksum is done here, before the packet is fragmented, and
+      // the MAC is told to leave the frames alone
+
+      if((softwareChecksum=_checksumMode==IpChecksumMode::SOFTWARE)) {
+        if(InternetChecksum::calculate(_myIpAddress,txevent.destinationIpAddress,txevent.protocol,*txevent.networkBuffer))
+          sync_fetch_and_increment(&_checksumStatistics.packetsGenerated);
+      }
+
       // get the total IP packet size and check if we must fragment
 
       packetSize=getIpTransmitHeaderSize()+txevent.networkBuffer->getSizeFromWritePointerToEnd()+txevent.networkBuffer->getUserBufferSize();
@@ -397,6 +650,7 @@ namespace stm32plus {
                                       outputBuffers,
                                       outputBufferCount)) {
 
+          sync_fetch_and_increment(&_statistics.sendFailures);
           this->setError(ErrorProvider::ERROR_PROVIDER_NET_IP,E_FRAGMENTATION_FAILED);
           return;
         }
@@ -405,25 +659,26 @@ namespace stm32plus {
 
         for(i=0;i<outputBufferCount;i++) {
 
-          setCommonTransmitHeaderValues(
-              *reinterpret_cast<IpPacketHeader *>(outputBuffers[i]->getWritePointer()),
-              txevent);
+          IpPacketHeader *header=reinterpret_cast<IpPacketHeader *>(outputBuffers[i]->getWritePointer());
 
-          // send the fragment. fragmented packets cannot have auto protocol checksum calculation because
-          // they are incomplete.
+          setCommonTransmitHeaderValues(*header,txevent);
 
-          EthernetTransmitRequestEvent etre(outputBuffers[i],
-                                            arpRequest.macAddress,
-                                            EtherType::IP,
-                                            DatalinkChecksum::IP_HEADER);
+          if(softwareChecksum)
+            InternetChecksum::calculateHeader(*header);
 
-          // raise the event and fail if it failed (the link layer will already have set an error)
+          // send the fragment. fragmented packets cannot have auto protocol checksum calculation because
+          // they are incomplete. fail if it failed (the lower layer will already have set an error)
 
-          this->NetworkSendEventSender.raiseEvent(etre);
-          if(!etre.succeeded) {
+          if(!sendFrame(outputBuffers[i],
+                        txevent.destinationIpAddress,
+                        arpRequest,
+                        softwareChecksum ? DatalinkChecksum::NONE : DatalinkChecksum::IP_HEADER)) {
+            sync_fetch_and_increment(&_statistics.sendFailures);
             free(outputBuffers);
             return;
           }
+
+          sync_fetch_and_increment(&_statistics.packetsSent);
         }
 
         // free memory used to hold the array of netbuffers who's ownership is now transferred to
@@ -445,18 +700,20 @@ namespace stm32plus {
         header->ip_hdr_identification=0;
         header->ip_hdr_flagsAndOffset=0;                                  // we will not fragment
 
-        // cool, now we have enough info to ask the datalink layer to send the packet
+        if(softwareChecksum)
+          InternetChecksum::calculateHeader(*header);
 
-        EthernetTransmitRequestEvent etre(txevent.networkBuffer,
-                                          arpRequest.macAddress,
-                                          EtherType::IP,
-                                          DatalinkChecksum::IP_HEADER_AND_PROTOCOL);
+        // cool, now we have enough info to ask the datalink layer to send the packet
 
-        // raise the event
+        if(!sendFrame(txevent.networkBuffer,
+                      txevent.destinationIpAddress,
+                      arpRequest,
+                      softwareChecksum ? DatalinkChecksum::NONE : DatalinkChecksum::IP_HEADER_AND_PROTOCOL)) {
+          sync_fetch_and_increment(&_statistics.sendFailures);
+          return;             // error code already set by the lower layer
+        }
 
-        this->NetworkSendEventSender.raiseEvent(etre);
-        if(!etre.succeeded)
-          return;             // error code already set by link layer
+        sync_fetch_and_increment(&_statistics.packetsSent);
       }
 
       // it worked
@@ -465,6 +722,34 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Send a finished frame to the link layer, or park it with the ARP layer if the destination
+     * MAC address is still being resolved. The frame belongs to the lower layer from here on.
+     * @param nb The frame
+     * @param destinationIpAddress Where the packet is going
+     * @param arpRequest The result of the ARP lookup
+     * @param checksum The checksums that the MAC must do
+     * @return true if the frame was accepted
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline bool Ip<TDatalinkLayer,Features...>::sendFrame(NetBuffer *nb,const IpAddress& destinationIpAddress,const ArpMappingRequestEvent& arpRequest,DatalinkChecksum checksum) {
+
+      if(arpRequest.found) {
+
+        EthernetTransmitRequestEvent etre(nb,arpRequest.macAddress,EtherType::IP,checksum);
+
+        this->NetworkSendEventSender.raiseEvent(etre);
+        return etre.succeeded;
+      }
+
+      ArpPendingFrameEvent apfe(nb,destinationIpAddress,checksum);
+
+      this->NetworkNotificationEventSender.raiseEvent(apfe);
+      return apfe.queued;
+    }
+
+
     /**
      * Send this event to the localhost. i.e. don't send it at all, just raise a
      * receive event for the NetBuffer then clean it up afterwards. This has the side effect
@@ -542,14 +827,204 @@ namespace stm32plus {
 
     template<class TDatalinkLayer,class... Features>
     inline void Ip<TDatalinkLayer,Features...>::setCommonTransmitHeaderValues(IpPacketHeader& header,IpTransmitRequestEvent& txevent) {
+      setCommonTransmitHeaderValues(header,txevent.destinationIpAddress,txevent.protocol,txevent.ttl);
+    }
+
+
+    /**
+     * Set the header values that are common to all transmitted packets
+     * @param header The header to set
+     * @param destinationIpAddress Where it's going
+     * @param protocol The protocol in the payload
+     * @param ttl The TTL, or zero for the configured default
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline void Ip<TDatalinkLayer,Features...>::setCommonTransmitHeaderValues(IpPacketHeader& header,const IpAddress& destinationIpAddress,IpProtocol protocol,uint8_t ttl) {
 
       header.ip_hdr_version=0x45;                                     // uint8_t
       header.ip_hdr_typeOfService=0;
-      header.ip_hdr_ttl=txevent.ttl ? txevent.ttl : _initialTtl;        // uint8_t
-      header.ip_hdr_protocol=txevent.protocol;                          // uint8_t
-      header.ip_hdr_checksum=0;                                       // MAC will calculate this
+      header.ip_hdr_ttl=ttl ? ttl : _initialTtl;                      // uint8_t
+      header.ip_hdr_protocol=protocol;                                // uint8_t
+      header.ip_hdr_checksum=0;                                       // MAC or software will calculate this
       header.ip_sourceAddress=_myIpAddress;
-      header.ip_destinationAddress=txevent.destinationIpAddress;
+      header.ip_destinationAddress=destinationIpAddress;
+    }
+
+
+    /**
+     * Send a run of segments. The ARP lookup and the IP header are done once for the whole run.
+     * Each segment gets a copy of the IP header and the protocol header template with its own
+     * sequence number. Only the last segment can have a different length and its IP header
+     * checksum is adjusted for that instead of being recalculated. The segments go to the link
+     * layer in batches so that it can fill consecutive transmit descriptors in one go. The
+     * batches are small so that only a few segments are ever waiting in memory.
+     * @param event The large send event
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline void Ip<TDatalinkLayer,Features...>::sendLargeSend(IpLargeSendRequestEvent& event) {
+
+      static const uint16_t BATCH_SIZE=8;
+
+      NetBuffer *buffers[BATCH_SIZE];
+      IpPacketHeader ipHeader;
+      uint32_t offset;
+      uint16_t segmentSize,size,count,fullLength,length;
+      bool softwareChecksum;
+
+      // localhost and the error cases are left to the normal path one segment at a time
+
+      if(event.destinationIpAddress.isLocalNetwork() || !_myMacAddress.isValid() || !_myIpAddress.isValid()) {
+        sendLargeSendSegments(event);
+        return;
+      }
+
+      // get the MAC address of the destination
+
+      ArpMappingRequestEvent arpRequest(event.destinationIpAddress);
+
+      this->NetworkNotificationEventSender.raiseEvent(arpRequest);
+
+      if(!arpRequest.found) {
+
+        // while the address is being resolved the segments are parked one at a time
+
+        if(arpRequest.pending)
+          sendLargeSendSegments(event);
+        else {
+          sync_fetch_and_increment(&_statistics.sendFailures);
+          this->setError(ErrorProvider::ERROR_PROVIDER_NET_IP,E_ARP_LOOKUP_FAILED);
+        }
+
+        return;
+      }
+
+      // segments must not need fragmenting
+
+      segmentSize=std::min(static_cast<uint32_t>(event.segmentSize),this->getDatalinkMtuSize()-getIpTransmitHeaderSize()-event.protocolHeaderSize);
+
+      // the IP header template is for a full sized segment
+
+      fullLength=NetUtil::htons(static_cast<uint16_t>(getIpTransmitHeaderSize()+event.protocolHeaderSize+segmentSize));
+
+      setCommonTransmitHeaderValues(ipHeader,event.destinationIpAddress,event.protocol,0);
+      ipHeader.ip_hdr_length=fullLength;
+      ipHeader.ip_hdr_identification=0;
+      ipHeader.ip_hdr_flagsAndOffset=0;                                 // we will not fragment
+
+      if((softwareChecksum=_checksumMode==IpChecksumMode::SOFTWARE))
+        InternetChecksum::calculateHeader(ipHeader);
+
+      for(offset=0,count=0;offset<event.dataSize;offset+=size) {
+
+        size=std::min(event.dataSize-offset,static_cast<uint32_t>(segmentSize));
+
+        NetBuffer *nb=createLargeSendSegment(event,offset,size);
+
+        if(softwareChecksum) {
+          if(InternetChecksum::calculate(_myIpAddress,event.destinationIpAddress,event.protocol,*nb))
+            sync_fetch_and_increment(&_checksumStatistics.packetsGenerated);
+        }
+
+        // copy in the IP header and fix up the length of a short segment
+
+        IpPacketHeader *header=reinterpret_cast<IpPacketHeader *>(nb->moveWritePointerBack(getIpTransmitHeaderSize()));
+        *header=ipHeader;
+
+        if(size!=segmentSize) {
+
+          length=NetUtil::htons(static_cast<uint16_t>(getIpTransmitHeaderSize()+event.protocolHeaderSize+size));
+          header->ip_hdr_length=length;
+
+          if(softwareChecksum)
+            header->ip_hdr_checksum=InternetChecksum::adjust(header->ip_hdr_checksum,fullLength,length);
+        }
+
+        buffers[count++]=nb;
+
+        // send a batch when it's full or there's no more data
+
+        if(count==BATCH_SIZE || offset+size==event.dataSize) {
+
+          EthernetBatchTransmitRequestEvent etre(buffers,
+                                                 count,
+                                                 arpRequest.macAddress,
+                                                 EtherType::IP,
+                                                 softwareChecksum ? DatalinkChecksum::NONE : DatalinkChecksum::IP_HEADER_AND_PROTOCOL);
+
+          this->NetworkSendEventSender.raiseEvent(etre);
+
+          event.segmentsSent+=etre.sentCount;
+          sync_fetch_and_add(&_statistics.packetsSent,etre.sentCount);
+
+          if(!etre.succeeded) {
+            sync_fetch_and_add(&_statistics.sendFailures,count-etre.sentCount);
+            return;             // error code already set by link layer
+          }
+
+          count=0;
+        }
+      }
+
+      event.succeeded=true;
+    }
+
+
+    /**
+     * Send a run of segments one at a time through the normal transmit path
+     * @param event The large send event
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline void Ip<TDatalinkLayer,Features...>::sendLargeSendSegments(IpLargeSendRequestEvent& event) {
+
+      uint32_t offset;
+      uint16_t size;
+
+      for(offset=0;offset<event.dataSize;offset+=size) {
+
+        size=std::min(event.dataSize-offset,static_cast<uint32_t>(event.segmentSize));
+
+        IpTransmitRequestEvent iptre(createLargeSendSegment(event,offset,size),event.destinationIpAddress,event.protocol);
+        onSend(iptre);
+
+        if(!iptre.succeeded)
+          return;
+
+        event.segmentsSent++;
+      }
+
+      event.succeeded=true;
+    }
+
+
+    /**
+     * Create the NetBuffer for one segment of a large send. The protocol header is copied from
+     * the template and its sequence number is moved on by the offset. The payload is referenced
+     * in-place.
+     * @param event The large send event
+     * @param offset The offset of the segment's payload
+     * @param size The size of the segment's payload
+     * @return The new NetBuffer with its write pointer at the protocol header
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline NetBuffer *Ip<TDatalinkLayer,Features...>::createLargeSendSegment(const IpLargeSendRequestEvent& event,uint32_t offset,uint16_t size) {
+
+      NetBuffer *nb;
+      uint8_t *header;
+      uint32_t *sequenceNumber;
+
+      nb=new NetBuffer(this->getDatalinkTransmitHeaderSize()+getIpTransmitHeaderSize()+event.protocolHeaderSize,0,event.data+offset,size);
+
+      header=reinterpret_cast<uint8_t *>(nb->moveWritePointerBack(event.protocolHeaderSize));
+      memcpy(header,event.protocolHeader,event.protocolHeaderSize);
+
+      sequenceNumber=reinterpret_cast<uint32_t *>(header+event.sequenceNumberOffset);
+      *sequenceNumber=NetUtil::htonl(NetUtil::ntohl(*sequenceNumber)+offset);
+
+      return nb;
     }
 
 
@@ -576,5 +1051,193 @@ namespace stm32plus {
     inline const IpAddress& Ip<TDatalinkLayer,Features...>::getIpAddress() const {
       return _myIpAddress;
     }
+
+
+    /**
+     * Get my subnet mask
+     * @return My subnet mask. Not valid until one has been announced.
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline const IpSubnetMask& Ip<TDatalinkLayer,Features...>::getSubnetMask() const {
+      return _mySubnetMask;
+    }
+
+
+    /**
+     * Get the checksum mode
+     * @return The mode set in the parameters
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline IpChecksumMode Ip<TDatalinkLayer,Features...>::getChecksumMode() const {
+      return _checksumMode;
+    }
+
+
+    /**
+     * Get the counters for the checksums done in software
+     * @return A reference to the statistics
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline const typename Ip<TDatalinkLayer,Features...>::ChecksumStatistics& Ip<TDatalinkLayer,Features...>::getChecksumStatistics() const {
+      return _checksumStatistics;
+    }
+
+
+    /**
+     * Get the packet counters
+     * @return The statistics
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline const typename Ip<TDatalinkLayer,Features...>::Statistics& Ip<TDatalinkLayer,Features...>::getIpStatistics() const {
+      return _statistics;
+    }
+
+
+    /**
+     * Join a multicast group. Joins are reference counted so that independent users of the same
+     * group can each join and leave it. The first join programs the MAC's multicast hash
+     * filter and, if IGMP is in the stack, sends a membership report.
+     * @param groupAddress The group address in the range 224.0.0.1 to 239.255.255.255. The
+     *   all-hosts group is always received and cannot be joined.
+     * @return true if it worked
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline bool Ip<TDatalinkLayer,Features...>::joinMulticastGroup(const IpAddress& groupAddress) {
+
+      MulticastGroup *group;
+      uint8_t i;
+
+      if(!groupAddress.isMulticastGroup() || groupAddress.isAllHostsMulticastGroup())
+        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_IP,E_NOT_A_MULTICAST_GROUP);
+
+      // already joined?
+
+      if((group=findMulticastGroup(groupAddress))!=nullptr) {
+        group->references++;
+        return true;
+      }
+
+      // find a free entry
+
+      for(i=0;i<_maxMulticastGroups;i++) {
+
+        if(_multicastGroups[i].references==0) {
+
+          // the entry is seen by the receive IRQ as soon as it has a reference
+
+          {
+            IrqSuspend suspender;
+
+            _multicastGroups[i].address=groupAddress;
+            _multicastGroups[i].references=1;
+          }
+
+          // the all-hosts group must pass the MAC filter once we start filtering
+
+          if(_multicastGroupCount++==0)
+            updateMulticastFilter(IpAddress(IpAddress::ALL_HOSTS_MULTICAST_GROUP),true);
+
+          updateMulticastFilter(groupAddress,true);
+
+          this->NetworkNotificationEventSender.raiseEvent(IpMulticastMembershipEvent(groupAddress,true));
+          return true;
+        }
+      }
+
+      return this->setError(ErrorProvider::ERROR_PROVIDER_NET_IP,E_TOO_MANY_MULTICAST_GROUPS);
+    }
+
+
+    /**
+     * Leave a multicast group. The group is left when the last reference to it is released.
+     * @param groupAddress The group address
+     * @return true if it worked, false if we are not a member of the group
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline bool Ip<TDatalinkLayer,Features...>::leaveMulticastGroup(const IpAddress& groupAddress) {
+
+      MulticastGroup *group;
+
+      if((group=findMulticastGroup(groupAddress))==nullptr)
+        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_IP,E_NOT_A_MULTICAST_GROUP);
+
+      if(--group->references!=0)
+        return true;
+
+      // that was the last reference
+
+      this->NetworkNotificationEventSender.raiseEvent(IpMulticastMembershipEvent(groupAddress,false));
+
+      updateMulticastFilter(groupAddress,false);
+
+      if(--_multicastGroupCount==0)
+        updateMulticastFilter(IpAddress(IpAddress::ALL_HOSTS_MULTICAST_GROUP),false);
+
+      return true;
+    }
+
+
+    /**
+     * Check if we have joined a multicast group
+     * @param groupAddress The group address
+     * @return true if we are a member
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline bool Ip<TDatalinkLayer,Features...>::isMulticastGroupMember(const IpAddress& groupAddress) const {
+      return findMulticastGroup(groupAddress)!=nullptr;
+    }
+
+
+    /**
+     * Get the maximum number of multicast groups that can be joined at once
+     * @return The group limit from the parameters
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline uint8_t Ip<TDatalinkLayer,Features...>::getMaxMulticastGroups() const {
+      return _maxMulticastGroups;
+    }
+
+
+    /**
+     * Find a multicast group that we've joined. This is called from IRQ code.
+     * @param groupAddress The group address
+     * @return The group entry or nullptr if we're not a member
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline typename Ip<TDatalinkLayer,Features...>::MulticastGroup *Ip<TDatalinkLayer,Features...>::findMulticastGroup(const IpAddress& groupAddress) const {
+
+      uint8_t i;
+
+      for(i=0;i<_maxMulticastGroups;i++)
+        if(_multicastGroups[i].references!=0 && _multicastGroups[i].address==groupAddress)
+          return &_multicastGroups[i];
+
+      return nullptr;
+    }
+
+
+    /**
+     * Ask the datalink layer to start or stop receiving the MAC address for a group
+     * @param groupAddress The group address
+     * @param add true to start receiving, false to stop
+     */
+
+    template<class TDatalinkLayer,class... Features>
+    inline void Ip<TDatalinkLayer,Features...>::updateMulticastFilter(const IpAddress& groupAddress,bool add) {
+
+      MacAddress mac;
+
+      mac.createMulticastAddress(groupAddress.ipAddressBytes);
+      this->NetworkNotificationEventSender.raiseEvent(DatalinkMulticastFilterEvent(mac,add));
+    }
   }
 }
@@ -23,6 +23,16 @@ namespace stm32plus {
       };
 
 
+      /**
+       * Well known multicast groups, in the same byte order as ipAddress
+       */
+
+      enum : uint32_t {
+        ALL_HOSTS_MULTICAST_GROUP   = 0x010000E0,     ///< 224.0.0.1
+        ALL_ROUTERS_MULTICAST_GROUP = 0x020000E0      ///< 224.0.0.2
+      };
+
+
       /**
        * Constructor, ensure address is zero when we start up
        */
@@ -41,6 +51,15 @@ namespace stm32plus {
       }
 
 
+      /**
+       * Construct from a 32-bit address that's already in network byte order
+       * @param address The address
+       */
+
+      explicit IpAddress(uint32_t address) : ipAddress(address) {
+      }
+
+
       /**
        * Construct from a dotted IP address
        * @param dottedIp The a.b.c.d address
@@ -76,7 +95,7 @@ namespace stm32plus {
        */
 
       bool isAllHostsMulticastGroup() const {
-        return ipAddress==0x010000E0;
+        return ipAddress==ALL_HOSTS_MULTICAST_GROUP;
       }
 
 
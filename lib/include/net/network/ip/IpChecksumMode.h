@@ -0,0 +1,45 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * Where the IP layer gets its IP header and UDP/TCP/ICMP checksums done. Whatever the
+     * mode, the protocol checksum of a reassembled packet is always verified in software
+     * because the MAC only sees the fragments.
+     */
+
+    enum class IpChecksumMode : uint8_t {
+
+      /**
+       * The MAC inserts checksums into transmitted frames and checks received frames. This
+       * is the default and relies on the MAC having ETH_ChecksumOffload enabled.
+       */
+
+      HARDWARE,
+
+      /**
+       * Checksums are calculated and verified in software and the MAC is told to leave
+       * them alone. Use this if the MAC's checksum offload is disabled.
+       */
+
+      SOFTWARE,
+
+      /**
+       * The MAC does the work as in HARDWARE mode and received packets are verified again in
+       * software. Packets that the MAC passed and software fails are dropped and counted as
+       * errors in the checksum statistics, which should stay at zero.
+       */
+
+      SELF_TEST
+    };
+  }
+}
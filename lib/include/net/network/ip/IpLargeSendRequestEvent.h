@@ -0,0 +1,69 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * Request to the IP layer to transmit a run of segments that differ only in their payload and
+     * sequence number. The IP layer builds each segment's headers from the template and hands
+     * them to the link layer in batches instead of each segment making its own trip down the stack.
+     * The payload is transmitted in-place from the caller's buffer.
+     */
+
+    struct IpLargeSendRequestEvent : NetEventDescriptor {
+
+      const IpAddress& destinationIpAddress;      ///< destination IP address (will be copied out)
+      IpProtocol protocol;                        ///< protocol number for the request
+      const void *protocolHeader;                 ///< header for the first segment. the checksum is ignored.
+      uint16_t protocolHeaderSize;                ///< size of the header
+      uint16_t sequenceNumberOffset;              ///< offset of a 32-bit network order field in the header that goes up by the payload size of each segment
+      const uint8_t *data;                        ///< the payload of all the segments
+      uint32_t dataSize;                          ///< total payload size
+      uint16_t segmentSize;                       ///< payload in each segment. the last can be smaller.
+
+      uint16_t segmentsSent;                      ///< set to the number of segments handed to the link layer
+      bool succeeded;                             ///< set to true if all segments were sent
+
+      /**
+       * Constructor
+       * @param address The destination address
+       * @param proto The IP protocol encapsulated here
+       * @param header The protocol header template
+       * @param headerSize The protocol header size
+       * @param seqOffset The offset of the sequence number in the header
+       * @param payload The payload for all the segments
+       * @param payloadSize The total payload size
+       * @param segSize The maximum payload in each segment
+       */
+
+      IpLargeSendRequestEvent(const IpAddress& address,
+                              IpProtocol proto,
+                              const void *header,
+                              uint16_t headerSize,
+                              uint16_t seqOffset,
+                              const void *payload,
+                              uint32_t payloadSize,
+                              uint16_t segSize)
+        : NetEventDescriptor(NetEventType::IP_LARGE_SEND_REQUEST),
+          destinationIpAddress(address),
+          protocol(proto),
+          protocolHeader(header),
+          protocolHeaderSize(headerSize),
+          sequenceNumberOffset(seqOffset),
+          data(reinterpret_cast<const uint8_t *>(payload)),
+          dataSize(payloadSize),
+          segmentSize(segSize),
+          segmentsSent(0),
+          succeeded(false) {
+      }
+    };
+  }
+}
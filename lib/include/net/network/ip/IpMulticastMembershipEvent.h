@@ -0,0 +1,30 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+    /**
+     * Notification that this host has joined or left a multicast group. It's raised when the
+     * first reference to a group is taken and when the last one is released.
+     */
+
+    struct IpMulticastMembershipEvent : NetEventDescriptor {
+
+      const IpAddress& groupAddress;      ///< the multicast group
+      bool joined;                        ///< true if joined, false if left
+
+      IpMulticastMembershipEvent(const IpAddress& group,bool join)
+        : NetEventDescriptor(NetEventType::IP_MULTICAST_MEMBERSHIP),
+          groupAddress(group),
+          joined(join) {
+      }
+    };
+  }
+}
@@ -21,6 +21,9 @@ namespace stm32plus {
      * This class requires 512 bytes of SRAM for the port bitmap.
      *
      * You can customise the above numbers using the ip_ephemeralPortCount variable in the parameters class.
+     *
+     * The port lists are changed with interrupts suspended because the transport layers may check
+     * them from the receive IRQ to drop traffic for ports that nobody has acquired.
      */
 
     class IpPorts {
@@ -79,6 +82,8 @@ namespace stm32plus {
         bool ip_acquireDefinedPort(uint16_t portNumber);
         bool ip_releaseDefinedPort(uint16_t portNumber);
         bool ip_isDefinedPortInUse(uint16_t portNumber) const;
+
+        bool ip_isPortInUse(uint16_t portNumber) const;
     };
 
 
@@ -145,7 +150,12 @@ namespace stm32plus {
       // found one
 
       portNumber=_nextEphemeralPort;
-      _ephemeralPortsInUse.push_back(portNumber);
+
+      {
+        IrqSuspend suspender;
+        _ephemeralPortsInUse.push_back(portNumber);
+      }
+
       incrementNextEphemeralPort();
 
       return true;
@@ -162,6 +172,8 @@ namespace stm32plus {
 
       std::vector<uint16_t>::iterator it;
 
+      IrqSuspend suspender;
+
       if((it=std::find(_ephemeralPortsInUse.begin(),_ephemeralPortsInUse.end(),portNumber))!=_ephemeralPortsInUse.end()) {
         _ephemeralPortsInUse.erase(it);
         return true;
@@ -193,6 +205,8 @@ namespace stm32plus {
       if(ip_isDefinedPortInUse(portNumber))
         return errorProvider.set(ErrorProvider::ERROR_PROVIDER_NET_IPPORTS,E_ALL_PORTS_IN_USE);
 
+      IrqSuspend suspender;
+
       _definedPortsInUse.push_back(portNumber);
       return true;
     }
@@ -208,6 +222,8 @@ namespace stm32plus {
 
       std::vector<uint16_t>::iterator it;
 
+      IrqSuspend suspender;
+
       if((it=std::find(_definedPortsInUse.begin(),_definedPortsInUse.end(),portNumber))!=_definedPortsInUse.end()) {
         _definedPortsInUse.erase(it);
         return true;
@@ -225,5 +241,21 @@ namespace stm32plus {
     inline bool IpPorts::ip_isDefinedPortInUse(uint16_t portNumber) const {
       return std::find(_definedPortsInUse.begin(),_definedPortsInUse.end(),portNumber)!=_definedPortsInUse.end();
     }
+
+
+    /**
+     * Check if the given port has been acquired, either as a defined port or as an ephemeral port.
+     * The ephemeral list is only searched if the port is in the ephemeral range.
+     * @param portNumber the port to check
+     * @return true if in use
+     */
+
+    inline bool IpPorts::ip_isPortInUse(uint16_t portNumber) const {
+
+      if(portNumber>=_params.ip_firstEphemeralPort && portNumber<=_params.ip_lastEphemeralPort && ip_isEphemeralPortInUse(portNumber))
+        return true;
+
+      return ip_isDefinedPortInUse(portNumber);
+    }
   }
 }
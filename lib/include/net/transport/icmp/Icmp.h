@@ -37,8 +37,24 @@ namespace stm32plus {
           }
         };
 
+
+        /**
+         * ICMP counters
+         */
+
+        struct Statistics {
+          uint32_t packetsReceived;             ///< ICMP packets received
+          uint32_t packetsMalformed;            ///< packets too short for their ICMP header
+          uint32_t echoRequestsReceived;        ///< ping requests received
+          uint32_t echoRepliesSent;             ///< ping replies sent
+          uint32_t destinationUnreachableReceived;  ///< destination unreachable messages received
+          uint32_t packetsSent;                 ///< packets sent, including echo requests and replies
+          uint32_t sendFailures;                ///< packets that could not be sent
+        };
+
       protected:
         Parameters _params;
+        Statistics _statistics;
 
       protected:
         bool handleEchoReply(IcmpEchoRequest *echoRequest,IpPacket& ipPacket);
@@ -54,6 +70,8 @@ namespace stm32plus {
                                   const uint8_t *data,
                                   uint32_t dataSize,
                                   uint8_t ttl=0);
+
+        const Statistics& getIcmpStatistics() const;
     };
 
 
@@ -67,14 +85,16 @@ namespace stm32plus {
     inline bool Icmp<TNetworkLayer>::initialise(const Parameters& params) {
 
       _params=params;
+      memset(&_statistics,0,sizeof(_statistics));
 
-      // subscribe for receive events from the IP implementation
+      // receive ICMP packets from the IP implementation
 
-      this->IpReceiveEventSender.insertSubscriber(IpReceiveEventSourceSlot::bind(this,&Icmp<TNetworkLayer>::onReceive));
+      this->ip_setProtocolHandler(IpProtocol::ICMP,IpReceiveEventSourceSlot::bind(this,&Icmp<TNetworkLayer>::onReceive));
 
       // subscribe to send events from the stack
 
-      this->NetworkSendEventSender.insertSubscriber(NetworkSendEventSourceSlot::bind(this,&Icmp<TNetworkLayer>::onSend));
+      if(!this->NetworkSendEventSender.insertSubscriber(NetworkSendEventSourceSlot::bind(this,&Icmp<TNetworkLayer>::onSend)))
+        return false;
 
       return true;
     }
@@ -125,6 +145,11 @@ namespace stm32plus {
 
       this->NetworkSendEventSender.raiseEvent(iptre);
       icmptre.succeeded=iptre.succeeded;
+
+      if(iptre.succeeded)
+        sync_fetch_and_increment(&_statistics.packetsSent);
+      else
+        sync_fetch_and_increment(&_statistics.sendFailures);
     }
 
 
@@ -138,22 +163,40 @@ namespace stm32plus {
 
       IpPacket& ipPacket(ipe.ipPacket);
 
-      // protocol/type of service == 1/0
+      // type of service == 0. IP only gives us ICMP packets.
 
-      if(ipPacket.header->ip_hdr_protocol!=IpProtocol::ICMP || ipPacket.header->ip_hdr_typeOfService!=0)
+      if(ipPacket.header->ip_hdr_typeOfService!=0)
         return;
 
+      if(ipPacket.payloadLength<sizeof(IcmpPacket)) {
+        _statistics.packetsMalformed++;
+        return;
+      }
+
+      _statistics.packetsReceived++;
+
       IcmpPacket *icmpPacket=reinterpret_cast<IcmpPacket *>(ipPacket.payload);
 
       // is it an echo request
 
       if(IcmpEchoRequest::isPacket(*icmpPacket)) {
 
+        // the reply echoes the data after the header so the header must be all there
+
+        if(ipPacket.payloadLength<IcmpEchoRequest::getHeaderSize()) {
+          _statistics.packetsMalformed++;
+          return;
+        }
+
+        _statistics.echoRequestsReceived++;
+
         // are we supporting replies to echo (ping) requests?
 
-        if(_params.icmp_enableEchoReply)
-          handleEchoReply(reinterpret_cast<IcmpEchoRequest *>(icmpPacket),ipPacket);
+        if(_params.icmp_enableEchoReply && handleEchoReply(reinterpret_cast<IcmpEchoRequest *>(icmpPacket),ipPacket))
+          _statistics.echoRepliesSent++;
       }
+      else if(IcmpDestinationUnreachable::isPacket(*icmpPacket))
+        _statistics.destinationUnreachableReceived++;
 
       // all packets are pushed up the stack in the form of events including the echo
       // request even though it may be in the process of having a reply packet pushed out
@@ -207,7 +250,14 @@ namespace stm32plus {
           IpProtocol::ICMP);
 
       this->NetworkSendEventSender.raiseEvent(iptre);
-      return iptre.succeeded;
+
+      if(!iptre.succeeded) {
+        sync_fetch_and_increment(&_statistics.sendFailures);
+        return false;
+      }
+
+      sync_fetch_and_increment(&_statistics.packetsSent);
+      return true;
     }
 
 
@@ -264,7 +314,25 @@ namespace stm32plus {
           ttl);
 
       this->NetworkSendEventSender.raiseEvent(iptre);
-      return iptre.succeeded;
+
+      if(!iptre.succeeded) {
+        sync_fetch_and_increment(&_statistics.sendFailures);
+        return false;
+      }
+
+      sync_fetch_and_increment(&_statistics.packetsSent);
+      return true;
+    }
+
+
+    /**
+     * Get the ICMP counters
+     * @return The statistics
+     */
+
+    template<class TNetworkLayer>
+    inline const typename Icmp<TNetworkLayer>::Statistics& Icmp<TNetworkLayer>::getIcmpStatistics() const {
+      return _statistics;
     }
   }
 }
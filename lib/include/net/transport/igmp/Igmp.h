@@ -0,0 +1,370 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * IGMPv2 host implementation (RFC 2236). Groups are joined and left through the IP
+     * layer's joinMulticastGroup() and leaveMulticastGroup() methods. This class sends the
+     * membership reports and leave messages that go with them and answers queries from
+     * multicast routers so that the routers keep forwarding the groups to our segment.
+     *
+     * Limitations: the router alert IP option is not sent because the IP layer only
+     * builds option-less headers. Routers generally accept reports without it. IGMPv1
+     * queries are answered with IGMPv2 reports.
+     */
+
+    template<class TNetworkLayer>
+    class Igmp : public virtual TNetworkLayer {
+
+      public:
+
+        /**
+         * Parameters class
+         */
+
+        struct Parameters {
+          uint8_t igmp_unsolicitedReportCount;        ///< reports sent when a group is joined. default is 2 (the RFC robustness variable)
+          uint8_t igmp_unsolicitedReportInterval;     ///< seconds between those reports. default is 10.
+
+          /**
+           * Constructor: create default settings
+           */
+
+          Parameters() {
+            igmp_unsolicitedReportCount=2;
+            igmp_unsolicitedReportInterval=10;
+          }
+        };
+
+      protected:
+
+        /**
+         * Report state for a joined group
+         */
+
+        struct Group {
+          IpAddress address;
+          uint8_t reportTimer;          ///< seconds until the next report, zero if none is due
+          uint8_t unsolicitedReports;   ///< unsolicited reports still to send after the next one
+          bool joined;
+        };
+
+        Parameters _params;
+        scoped_array<Group> _groups;
+        uint8_t _groupCount;
+
+      protected:
+        void onReceive(IpPacketEvent& ipe);
+        void onNotification(NetEventDescriptor& ned);
+        void onTick(NetworkIntervalTickData& nitd);
+
+        void handleJoin(const IpAddress& groupAddress);
+        void handleLeave(const IpAddress& groupAddress);
+        void handleQuery(const IgmpPacket& query);
+        void handleReport(const IgmpPacket& report);
+
+        bool sendMessage(uint8_t type,const IpAddress& groupAddress,const IpAddress& destinationAddress);
+        Group *findGroup(const IpAddress& groupAddress);
+
+      public:
+        bool initialise(const Parameters& params);
+        bool startup();
+    };
+
+
+    /**
+     * Initialise the class
+     * @param params The parameters class
+     * @return true if it worked
+     */
+
+    template<class TNetworkLayer>
+    inline bool Igmp<TNetworkLayer>::initialise(const Parameters& params) {
+
+      _params=params;
+
+      // one entry per group that the IP layer allows
+
+      _groupCount=this->getMaxMulticastGroups();
+
+      if(_groupCount) {
+        _groups.reset(new Group[_groupCount]);
+        memset(_groups.get(),0,sizeof(Group)*_groupCount);
+      }
+
+      // receive IGMP packets, membership changes and the one second ticker
+
+      this->ip_setProtocolHandler(IpProtocol::IGMP,IpReceiveEventSourceSlot::bind(this,&Igmp<TNetworkLayer>::onReceive));
+      if(!this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Igmp<TNetworkLayer>::onNotification)))
+        return false;
+      this->subscribeIntervalTicks(1,NetworkIntervalTicker::TickIntervalSlotType::bind(this,&Igmp<TNetworkLayer>::onTick));
+
+      return true;
+    }
+
+
+    /**
+     * Startup the class
+     * @return true if it worked
+     */
+
+    template<class TNetworkLayer>
+    inline bool Igmp<TNetworkLayer>::startup() {
+      return true;
+    }
+
+
+    /**
+     * Notification event from the stack
+     * @param ned The event descriptor
+     */
+
+    template<class TNetworkLayer>
+    inline void Igmp<TNetworkLayer>::onNotification(NetEventDescriptor& ned) {
+
+      if(ned.eventType==NetEventDescriptor::NetEventType::IP_MULTICAST_MEMBERSHIP) {
+
+        IpMulticastMembershipEvent& event(static_cast<IpMulticastMembershipEvent&>(ned));
+
+        if(event.joined)
+          handleJoin(event.groupAddress);
+        else
+          handleLeave(event.groupAddress);
+      }
+    }
+
+
+    /**
+     * A group has been joined. Send the first report now and schedule the rest.
+     * @param groupAddress The group address
+     */
+
+    template<class TNetworkLayer>
+    inline void Igmp<TNetworkLayer>::handleJoin(const IpAddress& groupAddress) {
+
+      uint8_t i;
+
+      for(i=0;i<_groupCount;i++) {
+
+        if(!_groups[i].joined) {
+
+          {
+            IrqSuspend suspender;
+
+            _groups[i].address=groupAddress;
+            _groups[i].reportTimer=0;
+            _groups[i].unsolicitedReports=0;
+            _groups[i].joined=true;
+
+            if(_params.igmp_unsolicitedReportCount>1 && _params.igmp_unsolicitedReportInterval) {
+              _groups[i].reportTimer=_params.igmp_unsolicitedReportInterval;
+              _groups[i].unsolicitedReports=_params.igmp_unsolicitedReportCount-2;
+            }
+          }
+
+          if(_params.igmp_unsolicitedReportCount)
+            sendMessage(IgmpPacket::V2_MEMBERSHIP_REPORT,groupAddress,groupAddress);
+
+          return;
+        }
+      }
+    }
+
+
+    /**
+     * A group has been left. Stop reporting it and tell the routers.
+     * @param groupAddress The group address
+     */
+
+    template<class TNetworkLayer>
+    inline void Igmp<TNetworkLayer>::handleLeave(const IpAddress& groupAddress) {
+
+      Group *group;
+
+      if((group=findGroup(groupAddress))==nullptr)
+        return;
+
+      {
+        IrqSuspend suspender;
+        group->joined=false;
+      }
+
+      sendMessage(IgmpPacket::LEAVE_GROUP,groupAddress,IpAddress(IpAddress::ALL_ROUTERS_MULTICAST_GROUP));
+    }
+
+
+    /**
+     * Receive event notification from the stack. This is IRQ code.
+     * @param ipe The IP packet event
+     */
+
+    template<class TNetworkLayer>
+    inline void Igmp<TNetworkLayer>::onReceive(IpPacketEvent& ipe) {
+
+      IpPacket& ipPacket(ipe.ipPacket);
+
+      if(ipPacket.payloadLength<sizeof(IgmpPacket))
+        return;
+
+      // the MAC does not check IGMP checksums
+
+      if(!InternetChecksum::verify(ipPacket.header->ip_sourceAddress,
+                                   ipPacket.header->ip_destinationAddress,
+                                   IpProtocol::IGMP,
+                                   ipPacket.payload,
+                                   ipPacket.payloadLength))
+        return;
+
+      const IgmpPacket& packet(*reinterpret_cast<const IgmpPacket *>(ipPacket.payload));
+
+      if(packet.igmp_type==IgmpPacket::MEMBERSHIP_QUERY)
+        handleQuery(packet);
+      else if(packet.igmp_type==IgmpPacket::V1_MEMBERSHIP_REPORT || packet.igmp_type==IgmpPacket::V2_MEMBERSHIP_REPORT)
+        handleReport(packet);
+    }
+
+
+    /**
+     * A router is asking who's listening. Schedule a report at a random time up to the maximum
+     * response time for each group being asked about, unless one is due sooner. This is IRQ code.
+     * @param query The query
+     */
+
+    template<class TNetworkLayer>
+    inline void Igmp<TNetworkLayer>::handleQuery(const IgmpPacket& query) {
+
+      uint32_t maxSeconds,delay;
+      uint8_t i;
+
+      // IGMPv1 queries have no response time and mean 10 seconds. we work in whole seconds.
+
+      maxSeconds=query.igmp_maxResponseTime==0 ? 10 : (query.igmp_maxResponseTime+9)/10;
+
+      for(i=0;i<_groupCount;i++) {
+
+        Group& group(_groups[i]);
+
+        if(!group.joined)
+          continue;
+
+        // a general query has a zero group address
+
+        if(query.igmp_groupAddress.isValid() && query.igmp_groupAddress!=group.address)
+          continue;
+
+        this->nextRandom(delay);
+        delay=1+(delay % maxSeconds);
+
+        if(group.reportTimer==0 || group.reportTimer>delay)
+          group.reportTimer=delay;
+      }
+    }
+
+
+    /**
+     * Another host has reported a group that we're a member of. The router knows that the group
+     * has listeners so we can suppress our own pending report. This is IRQ code.
+     * @param report The report
+     */
+
+    template<class TNetworkLayer>
+    inline void Igmp<TNetworkLayer>::handleReport(const IgmpPacket& report) {
+
+      Group *group;
+
+      if((group=findGroup(report.igmp_groupAddress))!=nullptr) {
+        group->reportTimer=0;
+        group->unsolicitedReports=0;
+      }
+    }
+
+
+    /**
+     * The one second ticker. Send the reports that are due. This is IRQ code.
+     * @param nitd The tick data
+     */
+
+    template<class TNetworkLayer>
+    inline void Igmp<TNetworkLayer>::onTick(NetworkIntervalTickData& /* nitd */) {
+
+      uint8_t i;
+
+      for(i=0;i<_groupCount;i++) {
+
+        Group& group(_groups[i]);
+
+        if(!group.joined || group.reportTimer==0 || --group.reportTimer!=0)
+          continue;
+
+        sendMessage(IgmpPacket::V2_MEMBERSHIP_REPORT,group.address,group.address);
+
+        if(group.unsolicitedReports) {
+          group.unsolicitedReports--;
+          group.reportTimer=_params.igmp_unsolicitedReportInterval;
+        }
+      }
+    }
+
+
+    /**
+     * Send an IGMP message. IGMP messages are never forwarded by routers so the TTL is 1.
+     * @param type The message type
+     * @param groupAddress The group address that goes in the message
+     * @param destinationAddress Where to send it
+     * @return true if it worked
+     */
+
+    template<class TNetworkLayer>
+    inline bool Igmp<TNetworkLayer>::sendMessage(uint8_t type,const IpAddress& groupAddress,const IpAddress& destinationAddress) {
+
+      NetBuffer *nb;
+      IgmpPacket *packet;
+
+      nb=new NetBuffer(this->getDatalinkTransmitHeaderSize()+this->getIpTransmitHeaderSize(),sizeof(IgmpPacket));
+
+      packet=reinterpret_cast<IgmpPacket *>(nb->moveWritePointerBack(sizeof(IgmpPacket)));
+      packet->igmp_type=type;
+      packet->igmp_maxResponseTime=0;
+      packet->igmp_groupAddress=groupAddress;
+
+      // the MAC only offloads checksums for TCP, UDP and ICMP so this one is done here
+
+      InternetChecksum::calculate(this->getIpAddress(),destinationAddress,IpProtocol::IGMP,*nb);
+
+      // raise a transmit event for the IP layer to pick up
+
+      IpTransmitRequestEvent iptre(nb,destinationAddress,IpProtocol::IGMP,1);
+
+      this->NetworkSendEventSender.raiseEvent(iptre);
+      return iptre.succeeded;
+    }
+
+
+    /**
+     * Find a group that we're a member of
+     * @param groupAddress The group address
+     * @return The group or nullptr if not found
+     */
+
+    template<class TNetworkLayer>
+    inline typename Igmp<TNetworkLayer>::Group *Igmp<TNetworkLayer>::findGroup(const IpAddress& groupAddress) {
+
+      uint8_t i;
+
+      for(i=0;i<_groupCount;i++)
+        if(_groups[i].joined && _groups[i].address==groupAddress)
+          return &_groups[i];
+
+      return nullptr;
+    }
+  }
+}
@@ -0,0 +1,38 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+    /**
+     * IGMPv2 message (RFC 2236). This structure can be cast directly on to the payload of
+     * an IP packet.
+     */
+
+    struct IgmpPacket {
+
+      /**
+       * Message types
+       */
+
+      enum {
+        MEMBERSHIP_QUERY     = 0x11,
+        V1_MEMBERSHIP_REPORT = 0x12,
+        V2_MEMBERSHIP_REPORT = 0x16,
+        LEAVE_GROUP          = 0x17
+      };
+
+      uint8_t igmp_type;
+      uint8_t igmp_maxResponseTime;         ///< in tenths of a second. zero in an IGMPv1 query.
+      uint16_t igmp_checksum;
+      IpAddress igmp_groupAddress;          ///< zero in a general query
+
+    } __attribute__((packed));
+  }
+}
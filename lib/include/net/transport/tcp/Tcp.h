@@ -22,6 +22,14 @@ namespace stm32plus {
                 public TcpEvents {
 
       public:
+        /**
+         * Constants
+         */
+
+        enum {
+          ACK_TIMER_INTERVAL = 100                ///< tcpCheckTimers() checks for delayed ACKs and keep-alive probes at most this often, in millis
+        };
+
         /**
          * Error codes
          */
@@ -44,6 +52,7 @@ namespace stm32plus {
           uint16_t tcp_msl;                       ///< maximum segment lifetime, in seconds. default is 30
           uint16_t tcp_connectRetryInterval;      ///< the time, in millis to wait for a SYN-ACK before sending another. Default is 4000.
           uint16_t tcp_connectMaxRetries;         ///< number of times to retry a connect if SYN-ACK not received. Default is 5.
+          bool tcp_dropUnboundPorts;              ///< segments for ports that have not been acquired from IpPorts are not offered to the connections and servers. Connections on a local port that you chose must acquire it. Default is false.
 
           /**
            * Constructor
@@ -54,18 +63,35 @@ namespace stm32plus {
             tcp_msl=30;
             tcp_connectRetryInterval=4000;
             tcp_connectMaxRetries=5;
+            tcp_dropUnboundPorts=false;
           }
         };
 
+
+        /**
+         * Counters for the segments that arrive at the TCP layer. Each connection has its own
+         * counters too, see TcpConnection::getSegmentStatistics().
+         */
+
+        struct Statistics {
+          uint32_t segmentsReceived;              ///< segments passed to the connections and servers
+          uint32_t segmentsMalformed;             ///< segments dropped because their header did not fit
+          uint32_t segmentsUnmatched;             ///< segments for no connection or server that we know of
+          uint32_t resetsSent;                    ///< RST segments sent in reply to unmatched segments
+        };
+
       protected:
         Parameters _params;
+        Statistics _statistics;
         uint16_t _serverCount;
+        uint32_t _lastTimerCheck;
         std::slist<TcpClosingConnectionState> _closingConnections;
 
       protected:
         void onNotification(NetEventDescriptor& ned);
         void onReceive(IpPacketEvent& event);
         void onTick(NetworkIntervalTickData& nitd);
+        void onAckTick(NetworkIntervalTickData& nitd);
         void handleConnectionReleased(const TcpConnectionReleasedEvent& tcre);
         bool rejectWithRst(const TcpSegmentEvent& event);
         void handleFinWait1(const TcpHeader& header,TcpConnectionState& rstate);
@@ -101,7 +127,10 @@ namespace stm32plus {
         bool initialise(const Parameters& params);
         bool startup();
 
+        void tcpCheckTimers();
+
         Parameters& tcpGetParameters();
+        const Statistics& getTcpStatistics() const;
     };
 
 
@@ -120,14 +149,17 @@ namespace stm32plus {
 
       _params=params;
       _serverCount=0;
+      _lastTimerCheck=0;
+      memset(&_statistics,0,sizeof(_statistics));
 
       // subscribe to notify events from the network
 
-      this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Tcp<TNetworkLayer>::onNotification));
+      if(!this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Tcp<TNetworkLayer>::onNotification)))
+        return false;
 
-      // subscribe to packet events from the IP module
+      // receive TCP packets from the IP module
 
-      this->IpReceiveEventSender.insertSubscriber(IpReceiveEventSourceSlot::bind(this,&Tcp<TNetworkLayer>::onReceive));
+      this->ip_setProtocolHandler(IpProtocol::TCP,IpReceiveEventSourceSlot::bind(this,&Tcp<TNetworkLayer>::onReceive));
 
       // subscribe to the second ticker so we can clean up closed connections. the ticker has a granularity of
       // 10 seconds or msl/4, whichever is the greater. the lower limit prevents us taking up too much CPU checking
@@ -136,6 +168,12 @@ namespace stm32plus {
       tickSeconds=std::max(10,params.tcp_msl/4);
       this->subscribeIntervalTicks(tickSeconds,NetworkIntervalTicker::TickIntervalSlotType::bind(this,&Tcp<TNetworkLayer>::onTick));
 
+      // connections check their delayed ACKs whenever the application calls send() or receive() and
+      // whenever the application calls tcpCheckTimers(). This once-a-second tick makes sure that a delayed
+      // ACK still goes out if the application does neither. It also drives the keep-alive probes.
+
+      this->subscribeIntervalTicks(1,NetworkIntervalTicker::TickIntervalSlotType::bind(this,&Tcp<TNetworkLayer>::onAckTick));
+
       return true;
     }
 
@@ -159,21 +197,26 @@ namespace stm32plus {
     template<class TNetworkLayer>
     inline void Tcp<TNetworkLayer>::onReceive(IpPacketEvent& ipe) {
 
-      // must be a TCP packet
-
-      if(ipe.ipPacket.header->ip_hdr_protocol!=IpProtocol::TCP)
-        return;
-
       // sending an event of our own saves each interested recipient from having
       // to decode the ip structure and reduces the number of events sent to something
       // that only cares for TCP receive events
 
       TcpHeader *header=reinterpret_cast<TcpHeader *>(ipe.ipPacket.payload);
+
+      // the header, including its options, must fit in the IP payload
+
+      if(ipe.ipPacket.payloadLength<TcpHeader::getNoOptionsHeaderSize() ||
+         header->getHeaderSize()<TcpHeader::getNoOptionsHeaderSize() ||
+         header->getHeaderSize()>ipe.ipPacket.payloadLength) {
+        _statistics.segmentsMalformed++;
+        return;
+      }
+
+      _statistics.segmentsReceived++;
+
       uint8_t *data=ipe.ipPacket.payload+header->getDataOffset();
       uint16_t datalen=ipe.ipPacket.payloadLength-header->getHeaderSize();
 
-      // send the event
-
       TcpSegmentEvent event(ipe.ipPacket,
                              *header,
                              data,
@@ -181,12 +224,18 @@ namespace stm32plus {
                              NetUtil::ntohs(header->tcp_sourcePort),
                              NetUtil::ntohs(header->tcp_destinationPort));
 
-      TcpReceiveEventSender.raiseEvent(event);
+      // send the event unless we've been asked to skip the connections and servers when nobody
+      // has acquired the destination port. a closing connection may still be interested.
 
-      // if a connection or server handled it then we don't need to go further
+      if(!_params.tcp_dropUnboundPorts || this->ip_isPortInUse(event.destinationPort)) {
 
-      if(event.handled)
-        return;
+        TcpReceiveEventSender.raiseEvent(event);
+
+        // if a connection or server handled it then we don't need to go further
+
+        if(event.handled)
+          return;
+      }
 
       // check if this segment is for one of the closing connections
 
@@ -213,8 +262,13 @@ namespace stm32plus {
       // if not one of ours then a segment has arrived for an unknown connection
       // we reply with RST
 
-      if(notfound)
-        rejectWithRst(event);
+      if(notfound) {
+
+        _statistics.segmentsUnmatched++;
+
+        if(rejectWithRst(event))
+          _statistics.resetsSent++;
+      }
       else {
         // do something with it
 
@@ -384,6 +438,36 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Network interval ticker callback for delayed ACKs and keep-alive probes. This is IRQ code.
+     * @param nitd The tick data
+     */
+
+    template<class TNetworkLayer>
+    inline void Tcp<TNetworkLayer>::onAckTick(NetworkIntervalTickData& /* nitd */) {
+      this->NetworkNotificationEventSender.raiseEvent(TcpDelayedAckTimerEvent());
+    }
+
+
+    /**
+     * Tell the connections to send any ACK that has been held for too long and any keep-alive
+     * probe that is due. Call this from your main loop. RFC 1122 limits the ACK delay to 500ms,
+     * which the once-a-second network ticker cannot guarantee by itself, so call it at least
+     * every 500-tcp_delayedAckTimeout millis. Calls that come sooner than ACK_TIMER_INTERVAL
+     * after the last check do nothing.
+     */
+
+    template<class TNetworkLayer>
+    inline void Tcp<TNetworkLayer>::tcpCheckTimers() {
+
+      if(!MillisecondTimer::hasTimedOut(_lastTimerCheck,ACK_TIMER_INTERVAL))
+        return;
+
+      _lastTimerCheck=MillisecondTimer::millis();
+      this->NetworkNotificationEventSender.raiseEvent(TcpDelayedAckTimerEvent());
+    }
+
+
     /**
      * A connection is released. The destructor for the connection is underway and we must now
      * decide if we need to go into the closing sequence based on the state of this connection.
@@ -772,6 +856,17 @@ namespace stm32plus {
     typename Tcp<TNetworkLayer>::Parameters& Tcp<TNetworkLayer>::tcpGetParameters() {
       return _params;
     }
+
+
+    /**
+     * Get the TCP layer counters
+     * @return The statistics
+     */
+
+    template<class TNetworkLayer>
+    inline const typename Tcp<TNetworkLayer>::Statistics& Tcp<TNetworkLayer>::getTcpStatistics() const {
+      return _statistics;
+    }
   }
 }
 
@@ -40,7 +40,7 @@ namespace stm32plus {
 
       /**
        * The client MUST call this to accept the connection. If not then the server
-       * will delete the connection.
+       * will put the connection in its accept queue or delete it if the queue is full.
        * @return the connection
        */
 
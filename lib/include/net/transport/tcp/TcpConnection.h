@@ -20,8 +20,14 @@ namespace stm32plus {
     DECLARE_EVENT_SIGNATURE(TcpConnectionClosed,void (TcpConnectionClosedEvent&));
     DECLARE_EVENT_SIGNATURE(TcpConnectionDataReady,void (TcpConnectionDataReadyEvent&));
 
+    template<class TConnection,class TUser> class TcpServer;
+
     class TcpConnection {
 
+      // the server passes on the segment that completes a queued handshake
+
+      template<class TConnection,class TUser> friend class TcpServer;
+
       public:
 
       /**
@@ -46,6 +52,12 @@ namespace stm32plus {
         uint32_t tcp_maxResendDelay;        ///< the resend delay exponential backoff is capped at this value. default is 60 (1 minute)
         bool tcp_push;                      ///< if true, set the PSH flag in sent segments. Default is false.
         bool tcp_nagleAvoidance;            ///< if true, single packet sends are broken into 2 to force the receiver's Nagle algorithm to generate an ACK without delay. Default is true.
+        uint16_t tcp_delayedAckTimeout;     ///< longest time, in millis, that an ACK for received data may be delayed. Zero ACKs every segment immediately. The RFC 1122 limit is 500ms, see Tcp::tcpCheckTimers(). Default is 200.
+        uint8_t tcp_delayedAckSegments;     ///< ACK immediately when this many data segments are unacknowledged. Default is 2.
+        uint32_t tcp_keepAliveIdleTime;     ///< millis without hearing from the other end before a keep-alive probe is sent. Zero disables keep-alive. Default is zero.
+        uint32_t tcp_keepAliveInterval;     ///< millis between unanswered keep-alive probes. Default is 75000.
+        uint8_t tcp_keepAliveProbes;        ///< unanswered probes after which the connection is reset. Default is 9.
+        bool tcp_largeSend;                 ///< if true, the segments of a send() batch go to the IP layer as one request. Default is true.
 
         /**
          * Constructor
@@ -57,9 +69,42 @@ namespace stm32plus {
           tcp_initialResendDelay=4000;
           tcp_nagleAvoidance=true;
           tcp_push=false;
+          tcp_delayedAckTimeout=200;
+          tcp_delayedAckSegments=2;
+          tcp_keepAliveIdleTime=0;          // RFC 1122: keep-alive must default to off
+          tcp_keepAliveInterval=75000;
+          tcp_keepAliveProbes=9;
+          tcp_largeSend=true;
         }
       };
 
+
+      /**
+       * Counters for the ACKs that this connection has sent. Compare acksSent with
+       * segmentsReceived to see the effect of delayed ACKs.
+       */
+
+      struct AckStatistics {
+        uint32_t segmentsReceived;          ///< in-order data segments accepted into the receive buffer
+        uint32_t acksSent;                  ///< segments sent just to ACK (no data)
+        uint32_t acksDelayed;               ///< data segments whose ACK was delayed
+        uint32_t acksPiggybacked;           ///< delayed ACKs that went out with our own data
+        uint32_t windowUpdates;             ///< ACKs sent because the application made room in the receive buffer
+      };
+
+
+      /**
+       * Counters for the data segments that this connection has sent and received
+       */
+
+      struct SegmentStatistics {
+        uint32_t segmentsSent;              ///< data segments sent, including resends
+        uint32_t retransmitTimeouts;        ///< batches sent again because their ACK did not arrive in time
+        uint32_t outOfOrderDropped;         ///< received data segments dropped because they were not next in sequence
+        uint32_t bufferFullDropped;         ///< received data segments dropped because the receive buffer was full
+        uint32_t duplicateAcks;             ///< ACKs without data that did not acknowledge anything new
+      };
+
       protected:
         NetworkUtilityObjects *_networkUtilityObjects;
         TcpEvents *_tcpEvents;
@@ -74,6 +119,15 @@ namespace stm32plus {
         TcpConnectionState _state;
         const Parameters& _params;
         bool _receiveWindowIsClosed;
+        uint16_t _advertisedWindow;                 // the window in the last segment that we sent
+        uint8_t _unackedSegments;                   // data segments received since our last ACK
+        uint32_t _delayedAckTime;                   // when the first unacknowledged segment arrived
+        AckStatistics _ackStatistics;
+        SegmentStatistics _segmentStatistics;
+        uint32_t _keepAliveIdleTime;                // zero if keep-alive is off
+        uint32_t _lastReceiveTime;                  // when we last received any segment
+        uint32_t _lastKeepAliveTime;                // when we sent the last keep-alive probe
+        uint8_t _keepAliveProbesSent;               // unanswered probes
 
       protected:
         void onNotification(NetEventDescriptor& ned);
@@ -85,14 +139,18 @@ namespace stm32plus {
         void handleIncomingRst();
         void handleIncomingData(const TcpSegmentEvent& event);
 
-        void initialise(const IpAddress& remoteAddress,uint16_t remotePort,uint16_t localPort);
+        bool initialise(const IpAddress& remoteAddress,uint16_t remotePort,uint16_t localPort);
         void handleFindConnectionEvent(TcpFindConnectionNotificationEvent& tfcne);
 
-        bool sendSynAck();
-
         uint16_t getReceiveBufferSpaceAvailable() const;
         uint16_t sillyWindowAvoidance();
         bool receiveWindowCanBeOpened() const;
+        uint16_t getWindowUpdateThreshold() const;
+        bool delayAck();
+        void sendAck();
+        void checkKeepAlive();
+        void initialiseDataHeader(TcpHeader& header,uint32_t sequenceNumber,TcpHeaderFlags flags);
+        bool sendSegments(const uint8_t *data,uint32_t dataSize,uint32_t sequenceNumber,uint16_t segmentSize,TcpHeaderFlags flags);
 
       public:
         TcpConnection(const Parameters& params);
@@ -102,7 +160,9 @@ namespace stm32plus {
 
         bool initialise(NetworkUtilityObjects& networkUtilityObjects,
                         TcpEvents& tcpEvents,
-                        TcpSegmentEvent& segmentEvent,
+                        const TcpHalfOpenConnection& halfOpen,
+                        uint16_t localPort,
+                        uint16_t sendWindow,
                         uint16_t segmentSizeLimit,
                         uint16_t additionalHeaderSize);
 
@@ -131,6 +191,12 @@ namespace stm32plus {
 
         uint32_t getLastActiveTime() const;
 
+        void checkDelayedAck();
+        const AckStatistics& getAckStatistics() const;
+        const SegmentStatistics& getSegmentStatistics() const;
+
+        void setKeepAliveIdleTime(uint32_t idleTime);
+
         DECLARE_EVENT_SOURCE(TcpConnectionClosed);
         DECLARE_EVENT_SOURCE(TcpConnectionDataReady);
     };
@@ -321,7 +387,54 @@ namespace stm32plus {
      */
 
     inline bool TcpConnection::receiveWindowCanBeOpened() const {
-      return _state.rxWindow.receiveWindow>=std::min(_params.tcp_receiveBufferSize/2,(int)_segmentSizeLimit);
+      return _state.rxWindow.receiveWindow>=getWindowUpdateThreshold();
+    }
+
+
+    /**
+     * Get the amount by which the receive window must grow before it's worth telling the
+     * other side about it. This is the lesser of half the buffer size and 1 segment (RFC 1122).
+     * @return The threshold in bytes
+     */
+
+    inline uint16_t TcpConnection::getWindowUpdateThreshold() const {
+      return std::min(_params.tcp_receiveBufferSize/2,(int)_segmentSizeLimit);
+    }
+
+
+    /**
+     * Get the ACK counters for this connection
+     * @return A reference to the counters
+     */
+
+    inline const TcpConnection::AckStatistics& TcpConnection::getAckStatistics() const {
+      return _ackStatistics;
+    }
+
+
+    /**
+     * Get the segment counters for this connection
+     * @return A reference to the counters
+     */
+
+    inline const TcpConnection::SegmentStatistics& TcpConnection::getSegmentStatistics() const {
+      return _segmentStatistics;
+    }
+
+
+    /**
+     * Change the keep-alive idle time for this connection. The initial value comes from the
+     * tcp_keepAliveIdleTime parameter, which may be shared with other connections.
+     * @param idleTime millis without hearing from the other end before a probe is sent. Zero disables keep-alive.
+     */
+
+    inline void TcpConnection::setKeepAliveIdleTime(uint32_t idleTime) {
+
+      IrqSuspend suspender;
+
+      _keepAliveIdleTime=idleTime;
+      _keepAliveProbesSent=0;
+      _lastReceiveTime=MillisecondTimer::millis();
     }
 
 
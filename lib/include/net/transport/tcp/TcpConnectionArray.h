@@ -182,13 +182,14 @@ namespace stm32plus {
       if(_subscribedServer!=nullptr)
         return errorProvider.set(ErrorProvider::ERROR_PROVIDER_NET_TCP_CONNECTION_ARRAY,E_ALREADY_SUBSCRIBED);
 
-      _subscribedServer=&server;
-      _idleTimeout=server.getParameters().tcp_idleConnectionTimeout;
-
       // subscribe to accept events from the server
 
-      server.TcpAcceptEventSender.insertSubscriber(
-          TcpAcceptEventSourceSlot::bind(this,&TcpConnectionArray<TConnection>::onAccept));
+      if(!server.TcpAcceptEventSender.insertSubscriber(
+          TcpAcceptEventSourceSlot::bind(this,&TcpConnectionArray<TConnection>::onAccept)))
+        return false;
+
+      _subscribedServer=&server;
+      _idleTimeout=server.getParameters().tcp_idleConnectionTimeout;
 
       return true;
     }
@@ -409,6 +410,10 @@ namespace stm32plus {
 
           delete conn;
         }
+
+        // let other tasks run before the next pass
+
+        TaskScheduler::yield();
       }
     }
 
@@ -0,0 +1,383 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * Class to keep client connections open between requests to the same server. acquire() hands
+     * out a pooled connection to the remote address and port if there's an idle one that is still
+     * established, otherwise it connects a new one. release() gives the connection back to the pool
+     * instead of deleting it. An application that talks to the same server every few seconds
+     * saves the handshake and ARP traffic of each request.
+     *
+     * Pooled connections have keep-alive switched on so that a server that goes away is noticed
+     * while the connection is idle. Idle connections are deleted after tcp_poolIdleTimeout by
+     * acquire(), release() and evictIdle(). Connections are only deleted from the caller's context,
+     * never from an interrupt.
+     *
+     * The pool is keyed on the IP address, so resolve host names before calling acquire().
+     *
+     * @tparam TNetworkStack Your network stack type, which must include the Tcp feature.
+     * @tparam TConnection Your client connection type, derived from TcpClientConnection.
+     */
+
+    template<class TNetworkStack,class TConnection>
+    class TcpConnectionPool {
+
+      public:
+
+        /**
+         * Possible error codes
+         */
+
+        enum {
+          E_FULL = 1,             ///< all pooled connections are in use
+          E_NOT_FOUND             ///< the connection is not in this pool
+        };
+
+
+        /**
+         * Parameters class
+         */
+
+        struct Parameters {
+          uint16_t tcp_poolMaxConnections;      ///< maximum connections in the pool, idle or in use. Default is 4.
+          uint32_t tcp_poolIdleTimeout;         ///< millis after which an idle pooled connection is closed. Default is 30000.
+          uint32_t tcp_poolKeepAliveIdleTime;   ///< keep-alive idle time set on pooled connections, zero to leave the connection's setting alone. Default is 10000.
+
+          /**
+           * Constructor
+           */
+
+          Parameters() {
+            tcp_poolMaxConnections=4;
+            tcp_poolIdleTimeout=30000;
+            tcp_poolKeepAliveIdleTime=10000;
+          }
+        };
+
+
+        /**
+         * Pool counters
+         */
+
+        struct Statistics {
+          uint32_t reused;                      ///< acquire() calls satisfied by a pooled connection
+          uint32_t connected;                   ///< acquire() calls that had to connect
+          uint32_t evicted;                     ///< pooled connections closed because they were idle, broken or not reusable
+        };
+
+      protected:
+
+        /**
+         * A pooled connection
+         */
+
+        struct Entry {
+          TConnection *connection;              ///< nullptr if this entry is free
+          IpAddress remoteAddress;
+          uint16_t remotePort;
+          uint32_t releasedTime;                ///< when the connection was last returned to the pool
+          bool inUse;
+        };
+
+        TNetworkStack& _networkStack;
+        Parameters _params;
+        scoped_array<Entry> _entries;
+        Statistics _statistics;
+
+      protected:
+        void onNotification(NetEventDescriptor& ned);
+
+        Entry *findEntry(const TcpConnection& connection);
+        Entry *allocateEntry();
+        void evict(Entry& entry);
+        static bool isReusable(const TConnection& connection);
+
+      public:
+        TcpConnectionPool(TNetworkStack& networkStack,const Parameters& params=Parameters());
+        ~TcpConnectionPool();
+
+        bool acquire(const IpAddress& remoteAddress,uint16_t remotePort,TConnection *& connection);
+        bool release(TConnection *connection,bool reusable=true);
+        void evictIdle();
+
+        const Statistics& getStatistics() const;
+    };
+
+
+    /**
+     * Constructor
+     * @param networkStack The network stack that will make the connections
+     * @param params The pool parameters
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline TcpConnectionPool<TNetworkStack,TConnection>::TcpConnectionPool(TNetworkStack& networkStack,const Parameters& params)
+      : _networkStack(networkStack),
+        _params(params) {
+
+      _entries.reset(new Entry[_params.tcp_poolMaxConnections]);
+      memset(_entries.get(),0,sizeof(Entry)*_params.tcp_poolMaxConnections);
+      memset(&_statistics,0,sizeof(_statistics));
+
+      // subscribe to notifications so we know when the user deletes a connection that we're tracking
+
+      _networkStack.NetworkNotificationEventSender.insertSubscriber(
+          NetworkNotificationEventSourceSlot::bind(this,&TcpConnectionPool<TNetworkStack,TConnection>::onNotification));
+    }
+
+
+    /**
+     * Destructor. Idle connections are closed. Connections that are in use now belong to the caller.
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline TcpConnectionPool<TNetworkStack,TConnection>::~TcpConnectionPool() {
+
+      uint16_t i;
+
+      _networkStack.NetworkNotificationEventSender.removeSubscriber(
+          NetworkNotificationEventSourceSlot::bind(this,&TcpConnectionPool<TNetworkStack,TConnection>::onNotification));
+
+      for(i=0;i<_params.tcp_poolMaxConnections;i++)
+        if(_entries[i].connection!=nullptr && !_entries[i].inUse)
+          evict(_entries[i]);
+    }
+
+
+    /**
+     * A connection that we're tracking has been deleted by someone else. Forget about it.
+     * @param ned The notification descriptor
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline void TcpConnectionPool<TNetworkStack,TConnection>::onNotification(NetEventDescriptor& ned) {
+
+      Entry *entry;
+
+      if(ned.eventType==NetEventDescriptor::NetEventType::TCP_CONNECTION_RELEASED) {
+
+        TcpConnectionReleasedEvent& tcre(static_cast<TcpConnectionReleasedEvent&>(ned));
+
+        if((entry=findEntry(tcre.connection))!=nullptr)
+          entry->connection=nullptr;
+      }
+    }
+
+
+    /**
+     * Get a connection to the remote address and port. An idle pooled connection is used if there
+     * is one, otherwise a new connection is made with tcpConnect(). Give the connection back with
+     * release() when you're done. This is not IRQ safe.
+     * @param remoteAddress The server address
+     * @param remotePort The server port
+     * @param[out] connection The connection
+     * @return true if it worked
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline bool TcpConnectionPool<TNetworkStack,TConnection>::acquire(const IpAddress& remoteAddress,uint16_t remotePort,TConnection *& connection) {
+
+      Entry *entry;
+      uint16_t i;
+
+      // close the connections that have expired or broken while idle
+
+      evictIdle();
+
+      // look for an idle connection to this server
+
+      for(i=0;i<_params.tcp_poolMaxConnections;i++) {
+
+        entry=&_entries[i];
+
+        if(entry->connection!=nullptr && !entry->inUse && entry->remotePort==remotePort && entry->remoteAddress==remoteAddress) {
+
+          entry->inUse=true;
+          connection=entry->connection;
+
+          _statistics.reused++;
+          return true;
+        }
+      }
+
+      // need a new one
+
+      if((entry=allocateEntry())==nullptr)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_NET_TCP_CONNECTION_POOL,E_FULL);
+
+      if(!_networkStack.tcpConnect(remoteAddress,remotePort,connection))
+        return false;
+
+      if(_params.tcp_poolKeepAliveIdleTime)
+        connection->setKeepAliveIdleTime(_params.tcp_poolKeepAliveIdleTime);
+
+      entry->connection=connection;
+      entry->remoteAddress=remoteAddress;
+      entry->remotePort=remotePort;
+      entry->inUse=true;
+
+      _statistics.connected++;
+      return true;
+    }
+
+
+    /**
+     * Give a connection back to the pool. The connection is closed instead of being kept if the
+     * caller says that it can't be reused, if the other end has closed it or if there is unread data
+     * waiting in it. For HTTP, pass HttpClient::isPersistent() as the reusable flag after reading
+     * the whole response body. This is not IRQ safe.
+     * @param connection The connection from acquire()
+     * @param reusable false to close the connection instead of keeping it
+     * @return false if the connection was not from this pool
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline bool TcpConnectionPool<TNetworkStack,TConnection>::release(TConnection *connection,bool reusable) {
+
+      Entry *entry;
+
+      if((entry=findEntry(*connection))==nullptr)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_NET_TCP_CONNECTION_POOL,E_NOT_FOUND);
+
+      entry->inUse=false;
+      entry->releasedTime=MillisecondTimer::millis();
+
+      if(!reusable || !isReusable(*connection))
+        evict(*entry);
+
+      return true;
+    }
+
+
+    /**
+     * Close idle connections that have been in the pool for longer than tcp_poolIdleTimeout or that
+     * can no longer be used, e.g. because keep-alive found that the server has gone. acquire() and
+     * release() call this, you can also call it from your main loop. This is not IRQ safe.
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline void TcpConnectionPool<TNetworkStack,TConnection>::evictIdle() {
+
+      uint16_t i;
+
+      for(i=0;i<_params.tcp_poolMaxConnections;i++) {
+
+        Entry& entry(_entries[i]);
+
+        if(entry.connection==nullptr || entry.inUse)
+          continue;
+
+        if(!isReusable(*entry.connection) || MillisecondTimer::hasTimedOut(entry.releasedTime,_params.tcp_poolIdleTimeout))
+          evict(entry);
+      }
+    }
+
+
+    /**
+     * Get the pool counters
+     * @return The statistics
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline const typename TcpConnectionPool<TNetworkStack,TConnection>::Statistics& TcpConnectionPool<TNetworkStack,TConnection>::getStatistics() const {
+      return _statistics;
+    }
+
+
+    /**
+     * Find the entry for a connection
+     * @param connection The connection to find
+     * @return The entry or nullptr if not found
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline typename TcpConnectionPool<TNetworkStack,TConnection>::Entry *TcpConnectionPool<TNetworkStack,TConnection>::findEntry(const TcpConnection& connection) {
+
+      uint16_t i;
+
+      for(i=0;i<_params.tcp_poolMaxConnections;i++)
+        if(_entries[i].connection==&connection)
+          return &_entries[i];
+
+      return nullptr;
+    }
+
+
+    /**
+     * Get a free entry. If there isn't one then the idle connection that has been in the pool
+     * the longest is closed to make room.
+     * @return The entry or nullptr if all connections are in use
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline typename TcpConnectionPool<TNetworkStack,TConnection>::Entry *TcpConnectionPool<TNetworkStack,TConnection>::allocateEntry() {
+
+      Entry *oldest;
+      uint16_t i;
+
+      oldest=nullptr;
+
+      for(i=0;i<_params.tcp_poolMaxConnections;i++) {
+
+        Entry& entry(_entries[i]);
+
+        if(entry.connection==nullptr)
+          return &entry;
+
+        if(!entry.inUse && (oldest==nullptr || MillisecondTimer::difference(entry.releasedTime)>MillisecondTimer::difference(oldest->releasedTime)))
+          oldest=&entry;
+      }
+
+      if(oldest!=nullptr)
+        evict(*oldest);
+
+      return oldest;
+    }
+
+
+    /**
+     * Close a pooled connection and free its entry
+     * @param entry The entry
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline void TcpConnectionPool<TNetworkStack,TConnection>::evict(Entry& entry) {
+
+      TConnection *connection;
+
+      // clear the entry first so that the release notification does not find it
+
+      connection=entry.connection;
+      entry.connection=nullptr;
+      entry.inUse=false;
+
+      _statistics.evicted++;
+      delete connection;
+    }
+
+
+    /**
+     * Check if a connection can be handed out again
+     * @param connection The connection
+     * @return true if it's established, open at the remote end and has no unread data
+     */
+
+    template<class TNetworkStack,class TConnection>
+    inline bool TcpConnectionPool<TNetworkStack,TConnection>::isReusable(const TConnection& connection) {
+
+      return connection.getConnectionState().state==TcpState::ESTABLISHED &&
+             !connection.isRemoteEndClosed() &&
+             connection.getDataAvailable()==0;
+    }
+  }
+}
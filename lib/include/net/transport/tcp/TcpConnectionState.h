@@ -77,6 +77,19 @@ namespace stm32plus {
       }
 
 
+      /**
+       * Send a keep-alive probe. This is an ACK with a sequence number that the other end has
+       * already acknowledged (RFC 1122 4.2.3.6) so a live peer must answer it with an ACK.
+       * @param netutils The network utils
+       * @param windowSize the current receive window size
+       * @return true if it was sent
+       */
+
+      bool sendKeepAlive(NetworkUtilityObjects& netutils,uint16_t windowSize) {
+        return sendHeaderOnly(netutils,TcpHeaderFlags::ACK,windowSize,txWindow.sendNext-1);
+      }
+
+
       /**
        * Send a FIN and ACK
        * @param netutils The network utils
@@ -114,6 +127,23 @@ namespace stm32plus {
       bool sendHeaderOnly(NetworkUtilityObjects& netutils,
                           TcpHeaderFlags flags,
                           uint16_t windowSize) {
+        return sendHeaderOnly(netutils,flags,windowSize,txWindow.sendNext);
+      }
+
+
+      /**
+       * Send header-with-flags and a specific sequence number
+       * @param netutils The network utils
+       * @param flags The flags to set in the header
+       * @param windowSize the current receive window size
+       * @param sequenceNumber The sequence number to put in the header
+       * @return true if it was sent
+       */
+
+      bool sendHeaderOnly(NetworkUtilityObjects& netutils,
+                          TcpHeaderFlags flags,
+                          uint16_t windowSize,
+                          uint32_t sequenceNumber) {
 
         // create a NetBuffer to hold the RST segment
 
@@ -125,7 +155,7 @@ namespace stm32plus {
 
         header->initialise(localPort,
                            remotePort,
-                           txWindow.sendNext,           // where we are sending from
+                           sequenceNumber,              // where we are sending from
                            (flags & TcpHeaderFlags::ACK)==0 ? 0 : rxWindow.receiveNext, //  ack up to receiveNext
                            windowSize,                  // data space available
                            flags);
@@ -0,0 +1,27 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+
+    /**
+     * Event raised periodically by the TCP module so that connections can send any ACK that
+     * they've been delaying for longer than the configured timeout and any keep-alive probes
+     * that are due.
+     */
+
+    struct TcpDelayedAckTimerEvent : NetEventDescriptor {
+
+      TcpDelayedAckTimerEvent()
+        : NetEventDescriptor(NetEventType::TCP_DELAYED_ACK_TIMER) {
+      }
+    };
+  }
+}
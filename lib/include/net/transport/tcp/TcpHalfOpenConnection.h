@@ -0,0 +1,32 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+  namespace net {
+
+    /**
+     * The state that a server holds for a connection between receiving the client's SYN and
+     * receiving the ACK of our SYN-ACK. It's deliberately small because a server holds an
+     * array of these and no connection object is created until the handshake completes.
+     */
+
+    struct TcpHalfOpenConnection {
+      IpAddress remoteAddress;            ///< the client address
+      uint16_t remotePort;                ///< the client port. zero if this entry is free.
+      uint16_t remoteMss;                 ///< the client's maximum segment size
+      uint32_t initialSendSequence;       ///< our ISN, the sequence number of our SYN
+      uint32_t initialReceiveSequence;    ///< the client's ISN, the sequence number of its SYN
+      uint32_t createdTime;               ///< millisecond timer value when the SYN arrived
+
+      bool isFree() const {
+        return remotePort==0;
+      }
+    };
+  }
+}
@@ -142,15 +142,37 @@ namespace stm32plus {
       }
 
 
+      /**
+       * Get a view of the options in the header
+       * @return The options, empty if there are none or the data offset is invalid
+       */
+
+      NetView getOptions() const {
+
+        uint16_t headerSize;
+
+        if((headerSize=getHeaderSize())<getNoOptionsHeaderSize())
+          return NetView();
+
+        return NetView(reinterpret_cast<const uint8_t *>(this)+getNoOptionsHeaderSize(),headerSize-getNoOptionsHeaderSize());
+      }
+
+
       /**
        * Search for an option in the header
-       * @param optionKind The option id to search for
-       * @return a pointer to the option or nullptr if it's not there
+       * @return a pointer to the option or nullptr if it's not there or is too short
+       * @tparam TOption The option structure
        */
 
       template<class TOption>
       const TOption *findOption() const {
-        return reinterpret_cast<const TOption *>(findOption(TOption::getOptionKind()));
+
+        TcpOptionIterator it(getOptions());
+
+        if(!it.find(static_cast<uint8_t>(TOption::getOptionKind())))
+          return nullptr;
+
+        return it.overlay<TOption>();
       }
 
 
@@ -162,29 +184,12 @@ namespace stm32plus {
 
       const void *findOption(TcpOptionKind optionKind) const {
 
-        const uint8_t *ptr,*endptr;
-
-        ptr=reinterpret_cast<const uint8_t *>(this)+getNoOptionsHeaderSize();
-        endptr=ptr+getHeaderSize()-getNoOptionsHeaderSize();
-
-        while(ptr!=endptr) {
-
-          if(*ptr==0)       // end of options
-            break;
-          else if(*ptr==1)  // padding
-            ptr++;
-          else {
-
-            if(*ptr==optionKind)
-              return ptr;
-            else
-              ptr+=ptr[1];      // step past length
-          }
-        }
+        TcpOptionIterator it(getOptions());
 
-        // not found
+        if(!it.find(static_cast<uint8_t>(optionKind)))
+          return nullptr;
 
-        return nullptr;
+        return it.getValue().getData()-2;     // the option starts at the kind byte
       }
 
     } __attribute__((packed));
@@ -34,6 +34,13 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Iterator over the options in a TCP header. The option length includes the kind and length bytes.
+     */
+
+    typedef NetOptionIterator<static_cast<uint8_t>(TcpOptionKind::END_OF_OPTIONS),static_cast<uint8_t>(TcpOptionKind::NOP),true> TcpOptionIterator;
+
+
     /**
      * Base structure for the header options
      */
@@ -15,7 +15,8 @@ namespace stm32plus {
      * State management for the resend algorithm. This implements the algorithm in RFC2988 as
      * best we can here. Round-trip times are used to calculate an adaptive value that defines
      * how long to wait before a packet is considered lost and should be retransmitted for the
-     * first time.
+     * first time. Round trips are timed in microseconds by the MonotonicTimer because LAN round
+     * trips are usually well under a millisecond.
      */
 
     class TcpResendDelayCalculator {
@@ -24,9 +25,9 @@ namespace stm32plus {
         uint16_t _initialDelay;
         uint16_t _maxDelay;
 
-        uint32_t _srtt;
-        uint32_t _rttvar;
-        uint32_t _timerStart;
+        uint32_t _srtt;           // microseconds
+        uint32_t _rttvar;         // microseconds
+        uint64_t _timerStart;
         bool _first;
 
       public:
@@ -49,6 +50,7 @@ namespace stm32plus {
     inline bool TcpResendDelayCalculator::initialise(uint16_t initialDelay,uint16_t maxDelay) {
       _initialDelay=initialDelay;
       _maxDelay=maxDelay;
+      _first=true;
       return true;
     }
 
@@ -58,7 +60,7 @@ namespace stm32plus {
      */
 
     inline void TcpResendDelayCalculator::startTimer() {
-      _timerStart=MillisecondTimer::millis();
+      _timerStart=MonotonicTimer::micros();
     }
 
 
@@ -70,7 +72,7 @@ namespace stm32plus {
 
       uint32_t r;
 
-      r=MillisecondTimer::difference(_timerStart);
+      r=static_cast<uint32_t>(MonotonicTimer::difference(_timerStart));
 
       if(_first) {
         _srtt=r;
@@ -94,7 +96,7 @@ namespace stm32plus {
       if(_first)
         return _initialDelay;
 
-      return std::min((uint32_t)_maxDelay,(_srtt+std::max(1ul,4*_rttvar))/1000);
+      return std::min((uint32_t)_maxDelay,(_srtt+std::max(1ul,4*_rttvar))/1000000);
     }
   }
 }
@@ -12,13 +12,17 @@ namespace stm32plus {
 
     /**
      * Class to manage a listening TCP server. Each TCP server has a port on which
-     * it listens for incoming connections. When a remote client attempts a SYN with the
-     * server we create a connection object to handle the interaction and leave it to
-     * handle the state machine.
+     * it listens for incoming connections. When a remote client sends a SYN the handshake
+     * is held in a small SYN queue and no connection object is created. The connection
+     * object is created when the client ACKs our SYN-ACK, so a flood of SYNs costs a few
+     * bytes per queue entry instead of a connection and its receive buffer. If the SYN
+     * queue is full and tcp_synCookies is set then the handshake state is encoded in our
+     * initial sequence number (a SYN cookie) instead.
      *
-     * Unlike the common berkeley sockets implementation there is no concept of a 'listen'
-     * backlog because the API is entirely event based. The server is created in an unstarted
-     * state. The user should subscribe to accept events and then call start().
+     * The server is created in an unstarted state. The user should subscribe to accept events
+     * and then call start(). Accept events are raised for established connections. A connection
+     * that is not claimed by an accept event handler can wait in an accept queue of
+     * tcp_acceptBacklog entries, from where the user can collect it with acceptBatch().
      *
      * @tparam TConnection The user's derivation of the library-supplied connection class.
      * @tparam TUser optional type of a pointer that the user would like to be passed to the connection constructor.
@@ -33,6 +37,7 @@ namespace stm32plus {
 
       protected:
         void onReceive(TcpSegmentEvent&);
+        void completeHandshake(TcpSegmentEvent& event);
 
       public:
         TcpServer(uint16_t listeningPort,
@@ -44,6 +49,8 @@ namespace stm32plus {
                   TUser *userptr);
 
         ~TcpServer();
+
+        uint16_t acceptBatch(TConnection **connections,uint16_t maxCount);
     };
 
 
@@ -101,6 +108,10 @@ namespace stm32plus {
                       additionalHeaderSize),
         _userptr(userptr) {
 
+      // SYN-ACKs sent from the SYN queue advertise the empty receive buffer of the connection to come
+
+      _initialWindow=_connectionParams.tcp_receiveBufferSize;
+
       // subscribe to receive events
 
       _tcpEvents.TcpReceiveEventSender.insertSubscriber(TcpReceiveEventSourceSlot::bind(this,&TcpServer::onReceive));
@@ -118,6 +129,13 @@ namespace stm32plus {
 
       _tcpEvents.TcpReceiveEventSender.removeSubscriber(TcpReceiveEventSourceSlot::bind(this,&TcpServer::onReceive));
 
+      // delete the connections that nobody collected
+
+      TcpConnection *connection;
+
+      while((connection=dequeueAccepted())!=nullptr)
+        delete static_cast<TConnection *>(connection);
+
       // raise the event that we're going away
 
       _networkUtilityObjects.NetworkNotificationEventSender.raiseEvent(TcpServerReleasedEvent(*this));
@@ -125,8 +143,30 @@ namespace stm32plus {
 
 
     /**
-     * Network receive event
-     * @param ned The event descriptor
+     * Collect established connections from the accept queue. Connections get here when
+     * tcp_acceptBacklog is not zero and no accept event handler claimed them. The caller
+     * owns the connections that are returned.
+     * @param connections Where to store the connections
+     * @param maxCount The size of the connections array
+     * @return The number of connections stored
+     */
+
+    template<class TConnection,class TUser>
+    inline uint16_t TcpServer<TConnection,TUser>::acceptBatch(TConnection **connections,uint16_t maxCount) {
+
+      TcpConnection *connection;
+      uint16_t count;
+
+      for(count=0;count<maxCount && (connection=dequeueAccepted())!=nullptr;count++)
+        connections[count]=static_cast<TConnection *>(connection);
+
+      return count;
+    }
+
+
+    /**
+     * Network receive event. This is IRQ code.
+     * @param event The segment event
      */
 
     template<class TConnection,class TUser>
@@ -137,35 +177,68 @@ namespace stm32plus {
       if(event.destinationPort!=_listeningPort)
         return;
 
-      // we are only interested in segments that have the SYN flag set (but no ACK)
+      // a SYN (but no ACK) starts a handshake
 
-      if(!(event.tcpHeader.hasSyn() && !event.tcpHeader.hasAck()))
-        return;
+      if(event.tcpHeader.hasSyn() && !event.tcpHeader.hasAck()) {
 
-      // this event is handled here
+        // this event is handled here
 
-      event.handled=true;
+        event.handled=true;
 
-      // we are doing nothing unless we are started
+        // we are doing nothing unless we are started
+
+        if(_started)
+          handleSyn(event);
 
-      if(!_started)
         return;
+      }
 
-      // if an existing connection already has this source/dest port combo then this
-      // segment is a retransmit and we're going to drop it
+      // a RST can abort a queued handshake. existing connections handle their own.
 
-      TcpFindConnectionNotificationEvent findconn(event.ipPacket.header->ip_sourceAddress,event.sourcePort,event.destinationPort);
-      _networkUtilityObjects.NetworkNotificationEventSender.raiseEvent(findconn);
+      if(event.tcpHeader.hasRst()) {
+        releaseHandshake(event);
+        return;
+      }
+
+      // an ACK (but no SYN) can complete a handshake
+
+      if(_started && event.tcpHeader.hasAck() && !event.tcpHeader.hasSyn())
+        completeHandshake(event);
+    }
+
+
+    /**
+     * Check if an ACK completes a handshake and create the connection if it does. Segments
+     * for established connections are left for the connection to handle. This is IRQ code.
+     * @param event The segment event
+     */
+
+    template<class TConnection,class TUser>
+    inline void TcpServer<TConnection,TUser>::completeHandshake(TcpSegmentEvent& event) {
 
-      // if there's a connection, return now as we have a dupe SYN
+      TcpHalfOpenConnection halfOpen,*entry;
 
-      if(findconn.tcpConnection!=nullptr)
+      if(!findHandshake(event,halfOpen,entry))
         return;
 
-      // if we've hit the maximum number of connections then we have to ignore it
+      // this event is handled here
+
+      event.handled=true;
+
+      // if we've hit the maximum number of connections then we have to ignore it. the entry stays
+      // in the SYN queue and the client will retransmit.
 
-      if(_connectionCount==_params.tcp_maxConnectionsPerServer)
+      if(_connectionCount==_params.tcp_maxConnectionsPerServer) {
+        _backlogStatistics.handshakesDeferred++;
         return;
+      }
+
+      // the SYN queue entry has done its job
+
+      if(entry)
+        entry->remotePort=0;
+      else
+        _backlogStatistics.cookiesAccepted++;
 
       // new connection to record
 
@@ -180,7 +253,9 @@ namespace stm32plus {
       if(!connection->initialise(
             _networkUtilityObjects,
             _tcpEvents,
-            event,
+            halfOpen,
+            _listeningPort,
+            NetUtil::ntohs(event.tcpHeader.tcp_windowSize),
             _segmentSizeLimit,
             _additionalHeaderSize)) {
 
@@ -188,14 +263,20 @@ namespace stm32plus {
         return;
       }
 
+      // the ACK can carry the first data. the connection has just subscribed to receive events
+      // but that does not include the event being raised now, so pass it on.
+
+      if(event.payloadLength>0 || event.tcpHeader.hasFin())
+        connection->onReceive(event);
+
       // send a notification event so the caller can claim the connection
 
       TcpAcceptEvent acceptEvent(*this,connection);
       TcpAcceptEventSender.raiseEvent(acceptEvent);
 
-      // if the caller does not want this connection then we delete it
+      // if the caller does not want this connection then we queue it for acceptBatch() or delete it
 
-      if(!acceptEvent.accepted)
+      if(!acceptEvent.accepted && !queueForAccept(connection))
         delete connection;
     }
   }
@@ -27,6 +27,10 @@ namespace stm32plus {
 
           uint16_t tcp_maxConnectionsPerServer;       ///< maximum number of connections to accept per server. Default is 5
           uint32_t tcp_idleConnectionTimeout;         ///< the time in millis after which an idle connection will be auto-closed. Zero never times out. The default is zero.
+          uint16_t tcp_synBacklog;                    ///< half-open handshakes that can be queued per server. Default is 8.
+          uint32_t tcp_synReceivedTimeout;            ///< millis after which a queued handshake that has not completed can be discarded. Default is 10000.
+          bool tcp_synCookies;                        ///< if true, answer SYNs with a SYN cookie when the SYN queue is full. Default is false.
+          uint16_t tcp_acceptBacklog;                 ///< established connections that nobody accepted can wait here for acceptBatch(). Zero deletes them. Default is zero.
 
           /**
            * Constructor
@@ -35,9 +39,27 @@ namespace stm32plus {
           Parameters() {
             tcp_maxConnectionsPerServer=5;      // 5 simultaneous connections per server
             tcp_idleConnectionTimeout=0;        // never time out
+            tcp_synBacklog=8;
+            tcp_synReceivedTimeout=10000;
+            tcp_synCookies=false;
+            tcp_acceptBacklog=0;
           }
         };
 
+
+        /**
+         * Counters for the SYN and accept queues
+         */
+
+        struct BacklogStatistics {
+          uint32_t synsQueued;                        ///< SYNs that got a SYN queue entry
+          uint32_t synsDropped;                       ///< SYNs ignored because the SYN queue was full
+          uint32_t cookiesSent;                       ///< SYN-ACKs sent with a SYN cookie
+          uint32_t cookiesAccepted;                   ///< connections created from a valid SYN cookie
+          uint32_t handshakesDeferred;                ///< handshake ACKs dropped because the server was at its connection limit
+          uint32_t connectionsQueued;                 ///< established connections put in the accept queue
+        };
+
       protected:
         uint16_t _listeningPort;                              // listener port for this server
         NetworkUtilityObjects& _networkUtilityObjects;        // various utils
@@ -48,6 +70,14 @@ namespace stm32plus {
 
         volatile bool _started;                               // true if the server has been started
         uint16_t _connectionCount;                            // total number of connections for this server
+        uint16_t _initialWindow;                              // receive window advertised in SYN-ACKs
+
+        scoped_array<TcpHalfOpenConnection> _synQueue;        // handshakes waiting for the final ACK
+        scoped_array<TcpConnection *> _acceptQueue;           // circular buffer of connections waiting for acceptBatch()
+        uint16_t _acceptQueueFirst;
+        volatile uint16_t _acceptQueueCount;
+        uint32_t _cookieSecret;                               // random key for the SYN cookie hash
+        BacklogStatistics _backlogStatistics;
 
       public:
         TcpServerBase(uint16_t listeningPort,
@@ -64,10 +94,27 @@ namespace stm32plus {
         uint16_t getListeningPort() const;
         const Parameters& getParameters() const;
         NetworkUtilityObjects& getNetworkUtilityObjects() const;
+        uint16_t getAcceptQueueCount() const;
+        const BacklogStatistics& getBacklogStatistics() const;
 
       protected:
         void onNotification(NetEventDescriptor& ned);
         void handleConnectionReleased(const TcpConnectionReleasedEvent& tcre);
+
+        void handleSyn(TcpSegmentEvent& event);
+        bool findHandshake(const TcpSegmentEvent& event,TcpHalfOpenConnection& halfOpen,TcpHalfOpenConnection *& entry);
+        void releaseHandshake(const TcpSegmentEvent& event);
+        TcpHalfOpenConnection *findHalfOpen(const IpAddress& remoteAddress,uint16_t remotePort);
+        TcpHalfOpenConnection *allocateHalfOpen();
+        bool connectionExists(const TcpSegmentEvent& event) const;
+
+        uint32_t createSynCookie(const IpAddress& remoteAddress,uint16_t remotePort,uint32_t counter,uint8_t mssIndex) const;
+        bool checkSynCookie(const TcpSegmentEvent& event,uint16_t& mss) const;
+        bool sendSynAck(const TcpHalfOpenConnection& halfOpen);
+        static uint16_t getCookieMss(uint8_t mssIndex);
+
+        bool queueForAccept(TcpConnection *connection);
+        TcpConnection *dequeueAccepted();
     };
 
 
@@ -91,6 +138,23 @@ namespace stm32plus {
 
       _started=false;
       _connectionCount=0;
+      _initialWindow=0;
+
+      // create the SYN and accept queues
+
+      if(_params.tcp_synBacklog) {
+        _synQueue.reset(new TcpHalfOpenConnection[_params.tcp_synBacklog]);
+        memset(_synQueue.get(),0,sizeof(TcpHalfOpenConnection)*_params.tcp_synBacklog);
+      }
+
+      if(_params.tcp_acceptBacklog)
+        _acceptQueue.reset(new TcpConnection *[_params.tcp_acceptBacklog]);
+
+      _acceptQueueFirst=0;
+      _acceptQueueCount=0;
+
+      memset(&_backlogStatistics,0,sizeof(_backlogStatistics));
+      _networkUtilityObjects.nextRandom(_cookieSecret);
 
       // subscribe to network notifications
 
@@ -173,5 +237,376 @@ namespace stm32plus {
     inline const TcpServerBase::Parameters& TcpServerBase::getParameters() const {
       return _params;
     }
+
+
+    /**
+     * Get the number of established connections waiting to be collected by acceptBatch()
+     * @return The number of connections in the accept queue
+     */
+
+    inline uint16_t TcpServerBase::getAcceptQueueCount() const {
+      return _acceptQueueCount;
+    }
+
+
+    /**
+     * Get the SYN and accept queue counters
+     * @return A reference to the statistics
+     */
+
+    inline const TcpServerBase::BacklogStatistics& TcpServerBase::getBacklogStatistics() const {
+      return _backlogStatistics;
+    }
+
+
+    /**
+     * Handle a SYN sent to our port. A SYN for a handshake that's already queued is a retransmit
+     * because our SYN-ACK was lost, so we send another. Otherwise the handshake is queued without
+     * creating a connection. If the queue is full then we either send a SYN cookie or drop the SYN
+     * and let the client retry. This is IRQ code.
+     * @param event The segment event
+     */
+
+    inline void TcpServerBase::handleSyn(TcpSegmentEvent& event) {
+
+      TcpHalfOpenConnection *halfOpen;
+      const TcpOptionMaximumSegmentSize *mss;
+      uint16_t remoteMss;
+      uint8_t mssIndex;
+
+      // is our SYN-ACK for this handshake lost?
+
+      if((halfOpen=findHalfOpen(event.ipPacket.header->ip_sourceAddress,event.sourcePort))!=nullptr) {
+        halfOpen->createdTime=MillisecondTimer::millis();
+        sendSynAck(*halfOpen);
+        return;
+      }
+
+      // if an existing connection already has this source/dest port combo then this
+      // segment is a retransmit and we're going to drop it
+
+      if(connectionExists(event))
+        return;
+
+      // get the MSS option
+
+      if((mss=event.tcpHeader.findOption<TcpOptionMaximumSegmentSize>())==nullptr)
+        remoteMss=536;                  // default from the RFC
+      else
+        remoteMss=NetUtil::ntohs(mss->tcp_optionMss);
+
+      // queue it if there's room
+
+      if((halfOpen=allocateHalfOpen())!=nullptr) {
+
+        halfOpen->remoteAddress=event.ipPacket.header->ip_sourceAddress;
+        halfOpen->remotePort=event.sourcePort;
+        halfOpen->remoteMss=remoteMss;
+        halfOpen->initialReceiveSequence=NetUtil::ntohl(event.tcpHeader.tcp_sequenceNumber);
+        halfOpen->createdTime=MillisecondTimer::millis();
+
+        // see TcpConnection::initialise() for why this is a random number
+
+        _networkUtilityObjects.nextRandom(halfOpen->initialSendSequence);
+        halfOpen->initialSendSequence&=0x7FFFFFFF;
+
+        _backlogStatistics.synsQueued++;
+        sendSynAck(*halfOpen);
+        return;
+      }
+
+      // the queue is full
+
+      if(!_params.tcp_synCookies) {
+        _backlogStatistics.synsDropped++;
+        return;
+      }
+
+      // encode the largest MSS in the cookie table that does not exceed the client's MSS
+
+      for(mssIndex=7;mssIndex>0 && getCookieMss(mssIndex)>remoteMss;mssIndex--);
+
+      TcpHalfOpenConnection cookie;
+
+      cookie.remoteAddress=event.ipPacket.header->ip_sourceAddress;
+      cookie.remotePort=event.sourcePort;
+      cookie.remoteMss=getCookieMss(mssIndex);
+      cookie.initialReceiveSequence=NetUtil::ntohl(event.tcpHeader.tcp_sequenceNumber);
+      cookie.initialSendSequence=createSynCookie(cookie.remoteAddress,cookie.remotePort,MillisecondTimer::millis()/64000,mssIndex);
+
+      _backlogStatistics.cookiesSent++;
+      sendSynAck(cookie);
+    }
+
+
+    /**
+     * Check if an ACK completes a handshake that we've sent a SYN-ACK for. The ACK must
+     * acknowledge our SYN and either match a SYN queue entry or carry a valid SYN cookie.
+     * This is IRQ code.
+     * @param event The segment event
+     * @param[out] halfOpen The handshake state
+     * @param[out] entry The SYN queue entry to release once the connection is created, or nullptr
+     *   if the handshake came from a SYN cookie.
+     * @return true if the ACK completes a handshake
+     */
+
+    inline bool TcpServerBase::findHandshake(const TcpSegmentEvent& event,TcpHalfOpenConnection& halfOpen,TcpHalfOpenConnection *& entry) {
+
+      uint32_t ack;
+      uint16_t mss;
+
+      ack=NetUtil::ntohl(event.tcpHeader.tcp_ackNumber);
+
+      // look in the SYN queue
+
+      if((entry=findHalfOpen(event.ipPacket.header->ip_sourceAddress,event.sourcePort))!=nullptr) {
+
+        if(ack!=entry->initialSendSequence+1)
+          return false;
+
+        halfOpen=*entry;
+        return true;
+      }
+
+      // try it as a SYN cookie. a valid cookie is also seen on the early segments of the connection
+      // that it created so check that the connection doesn't already exist.
+
+      if(!_params.tcp_synCookies || !checkSynCookie(event,mss) || connectionExists(event))
+        return false;
+
+      halfOpen.remoteAddress=event.ipPacket.header->ip_sourceAddress;
+      halfOpen.remotePort=event.sourcePort;
+      halfOpen.remoteMss=mss;
+      halfOpen.initialSendSequence=ack-1;
+      halfOpen.initialReceiveSequence=NetUtil::ntohl(event.tcpHeader.tcp_sequenceNumber)-1;
+      halfOpen.createdTime=MillisecondTimer::millis();
+
+      return true;
+    }
+
+
+    /**
+     * A RST aborts a queued handshake. This is IRQ code.
+     * @param event The segment event
+     */
+
+    inline void TcpServerBase::releaseHandshake(const TcpSegmentEvent& event) {
+
+      TcpHalfOpenConnection *entry;
+
+      if((entry=findHalfOpen(event.ipPacket.header->ip_sourceAddress,event.sourcePort))!=nullptr)
+        entry->remotePort=0;
+    }
+
+
+    /**
+     * Find a handshake in the SYN queue
+     * @param remoteAddress The client address
+     * @param remotePort The client port
+     * @return The entry or nullptr if not found
+     */
+
+    inline TcpHalfOpenConnection *TcpServerBase::findHalfOpen(const IpAddress& remoteAddress,uint16_t remotePort) {
+
+      uint16_t i;
+
+      for(i=0;i<_params.tcp_synBacklog;i++)
+        if(_synQueue[i].remotePort==remotePort && _synQueue[i].remoteAddress==remoteAddress)
+          return &_synQueue[i];
+
+      return nullptr;
+    }
+
+
+    /**
+     * Get a free SYN queue entry. Entries for handshakes that have not completed within the
+     * timeout are reused.
+     * @return The entry or nullptr if the queue is full
+     */
+
+    inline TcpHalfOpenConnection *TcpServerBase::allocateHalfOpen() {
+
+      uint16_t i;
+
+      for(i=0;i<_params.tcp_synBacklog;i++)
+        if(_synQueue[i].isFree() || MillisecondTimer::hasTimedOut(_synQueue[i].createdTime,_params.tcp_synReceivedTimeout))
+          return &_synQueue[i];
+
+      return nullptr;
+    }
+
+
+    /**
+     * Check if there's already a connection for the segment's remote address and ports
+     * @param event The segment event
+     * @return true if there's a connection
+     */
+
+    inline bool TcpServerBase::connectionExists(const TcpSegmentEvent& event) const {
+
+      TcpFindConnectionNotificationEvent findconn(event.ipPacket.header->ip_sourceAddress,event.sourcePort,event.destinationPort);
+      _networkUtilityObjects.NetworkNotificationEventSender.raiseEvent(findconn);
+
+      return findconn.tcpConnection!=nullptr;
+    }
+
+
+    /**
+     * Create a SYN cookie. The top 5 bits are a counter that increments every 64 seconds, the next
+     * 3 bits are the index of an MSS from getCookieMss() and the low 24 bits are a keyed hash of
+     * the connection endpoints and the counter. The hash stops a client from guessing a valid
+     * cookie but it is not a cryptographic MAC.
+     * @param remoteAddress The client address
+     * @param remotePort The client port
+     * @param counter The time counter
+     * @param mssIndex The MSS table index
+     * @return The cookie, which is used as our initial sequence number
+     */
+
+    inline uint32_t TcpServerBase::createSynCookie(const IpAddress& remoteAddress,uint16_t remotePort,uint32_t counter,uint8_t mssIndex) const {
+
+      uint32_t hash;
+
+      counter&=0x1f;
+
+      // murmur3 finalizer over the inputs mixed with the secret
+
+      hash=_cookieSecret ^ remoteAddress.ipAddress;
+      hash^=(static_cast<uint32_t>(remotePort) << 16) | _listeningPort;
+      hash+=(counter << 3) | mssIndex;
+
+      hash^=hash >> 16;
+      hash*=0x85EBCA6B;
+      hash^=hash >> 13;
+      hash*=0xC2B2AE35;
+      hash^=hash >> 16;
+
+      return (counter << 27) | (static_cast<uint32_t>(mssIndex) << 24) | (hash & 0xFFFFFF);
+    }
+
+
+    /**
+     * Check if the ACK of a segment is one more than a valid SYN cookie. Cookies are valid for
+     * between 64 and 128 seconds.
+     * @param event The segment event
+     * @param[out] mss The MSS encoded in the cookie
+     * @return true if the cookie is valid
+     */
+
+    inline bool TcpServerBase::checkSynCookie(const TcpSegmentEvent& event,uint16_t& mss) const {
+
+      uint32_t cookie,counter,now;
+      uint8_t mssIndex;
+
+      cookie=NetUtil::ntohl(event.tcpHeader.tcp_ackNumber)-1;
+      counter=cookie >> 27;
+      mssIndex=(cookie >> 24) & 7;
+
+      now=MillisecondTimer::millis()/64000;
+
+      if(((now-counter) & 0x1f)>1)
+        return false;
+
+      if(createSynCookie(event.ipPacket.header->ip_sourceAddress,event.sourcePort,counter,mssIndex)!=cookie)
+        return false;
+
+      mss=getCookieMss(mssIndex);
+      return true;
+    }
+
+
+    /**
+     * Get one of the eight MSS values that a SYN cookie can encode. These are the values that
+     * are commonly seen so that little is lost by rounding the client's MSS down to one of them.
+     * @param mssIndex The index, 0..7
+     * @return The MSS
+     */
+
+    inline uint16_t TcpServerBase::getCookieMss(uint8_t mssIndex) {
+
+      static const uint16_t mssTable[8]={ 536,768,1024,1220,1300,1400,1440,1460 };
+      return mssTable[mssIndex];
+    }
+
+
+    /**
+     * Send a SYN-ACK for a queued handshake or a SYN cookie. This is IRQ code.
+     * @param halfOpen The handshake state
+     * @return true if it was sent
+     */
+
+    inline bool TcpServerBase::sendSynAck(const TcpHalfOpenConnection& halfOpen) {
+
+      NetBuffer *nb=new NetBuffer(_additionalHeaderSize+TcpHeader::getNoOptionsHeaderSize(),TcpOptionMaximumSegmentSize::getSize());
+
+      // set up MSS (maximum segment size) option
+
+      TcpOptionMaximumSegmentSize *mssOption=reinterpret_cast<TcpOptionMaximumSegmentSize *>(nb->moveWritePointerBack(TcpOptionMaximumSegmentSize::getSize()));
+      mssOption->initialise(_segmentSizeLimit);
+
+      // construct the header. the SYN consumed a sequence number from the client.
+
+      TcpHeader *header=reinterpret_cast<TcpHeader *>(nb->moveWritePointerBack(TcpHeader::getNoOptionsHeaderSize()));
+
+      header->initialise(_listeningPort,
+                         halfOpen.remotePort,
+                         halfOpen.initialSendSequence,
+                         halfOpen.initialReceiveSequence+1,
+                         _initialWindow,
+                         TcpHeaderFlags::SYN | TcpHeaderFlags::ACK);
+
+      header->setSize(TcpHeader::getNoOptionsHeaderSize()+TcpOptionMaximumSegmentSize::getSize());
+
+      // ask the IP layer to send the packet
+
+      IpTransmitRequestEvent iptre(
+            nb,
+            halfOpen.remoteAddress,
+            IpProtocol::TCP);
+
+      _networkUtilityObjects.NetworkSendEventSender.raiseEvent(iptre);
+      return iptre.succeeded;
+    }
+
+
+    /**
+     * Put an established connection that nobody accepted into the accept queue. This is IRQ code.
+     * @param connection The connection
+     * @return false if the queue is full or disabled
+     */
+
+    inline bool TcpServerBase::queueForAccept(TcpConnection *connection) {
+
+      if(_acceptQueueCount==_params.tcp_acceptBacklog)
+        return false;
+
+      _acceptQueue[(_acceptQueueFirst+_acceptQueueCount) % _params.tcp_acceptBacklog]=connection;
+      _acceptQueueCount++;
+      _backlogStatistics.connectionsQueued++;
+
+      return true;
+    }
+
+
+    /**
+     * Take the oldest connection out of the accept queue
+     * @return The connection or nullptr if the queue is empty
+     */
+
+    inline TcpConnection *TcpServerBase::dequeueAccepted() {
+
+      TcpConnection *connection;
+
+      IrqSuspend suspender;
+
+      if(_acceptQueueCount==0)
+        return nullptr;
+
+      connection=_acceptQueue[_acceptQueueFirst];
+      _acceptQueueFirst=(_acceptQueueFirst+1) % _params.tcp_acceptBacklog;
+      _acceptQueueCount--;
+
+      return connection;
+    }
   }
 }
@@ -31,9 +31,11 @@ namespace stm32plus {
         struct Parameters {
 
           bool udp_sendPortUnreachable;     ///< datagrams sent to ports with no handler will get an ICMP error message (if ICMP is configured in). default is true
+          bool udp_dropUnboundPorts;        ///< drop datagrams for ports that have not been acquired from IpPorts without raising the receive event. Receivers must acquire their port. default is false
 
           Parameters() {
             udp_sendPortUnreachable=true;
+            udp_dropUnboundPorts=false;
           }
         };
 
@@ -47,6 +49,19 @@ namespace stm32plus {
           E_MSG_SIZE,         ///< data was received, but more is available and has been lost
         };
 
+
+        /**
+         * UDP counters
+         */
+
+        struct Statistics {
+          uint32_t datagramsReceived;     ///< datagrams passed up the stack
+          uint32_t datagramsMalformed;    ///< datagrams dropped because their length is wrong
+          uint32_t datagramsNoPort;       ///< datagrams that nobody was listening for
+          uint32_t datagramsSent;         ///< datagrams accepted for sending
+          uint32_t sendFailures;          ///< datagrams that could not be sent
+        };
+
         DECLARE_EVENT_SOURCE(UdpReceive);
 
       protected:
@@ -57,6 +72,7 @@ namespace stm32plus {
         volatile uint16_t *_awaitingBufferSize;       ///< buffer size, updated with actual value
         volatile uint16_t _awaitingDatagramSize;      ///< the actual size received
         volatile IpPacketHeader _ipPacketHeader;      ///< the underlying IP packet header
+        Statistics _statistics;
 
       protected:
         void onReceive(IpPacketEvent& ned);
@@ -81,6 +97,8 @@ namespace stm32plus {
         bool udpReceive(uint16_t portNumber,void *buffer,uint16_t& size,uint32_t receiveTimeout=0);
         const volatile IpPacketHeader& udpGetIpPacketHeader() const;
         const volatile IpAddress& udpGetRemoteAddress() const;
+
+        const Statistics& getUdpStatistics() const;
     };
 
 
@@ -96,16 +114,18 @@ namespace stm32plus {
       // remember parameters
 
       _params=params;
+      memset(&_statistics,0,sizeof(_statistics));
 
       // not waiting for anything
 
       _waitForThisBuffer=nullptr;
       _awaiting=false;
 
-      // subscribe for receive and notification events from the IP implementation
+      // receive UDP packets and notification events from the IP implementation
 
-      this->IpReceiveEventSender.insertSubscriber(IpReceiveEventSourceSlot::bind(this,&Udp<TNetworkLayer>::onReceive));
-      this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Udp<TNetworkLayer>::onNotification));
+      this->ip_setProtocolHandler(IpProtocol::UDP,IpReceiveEventSourceSlot::bind(this,&Udp<TNetworkLayer>::onReceive));
+      if(!this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&Udp<TNetworkLayer>::onNotification)))
+        return false;
 
       return true;
     }
@@ -132,15 +152,21 @@ namespace stm32plus {
 
       bool handled;
 
-      // is this UDP?
-
-      if(ipe.ipPacket.header->ip_hdr_protocol!=IpProtocol::UDP)
-        return;
-
       // notify upwards that a UDP datagram has arrived
 
       UdpDatagram *datagram=reinterpret_cast<UdpDatagram *>(ipe.ipPacket.payload);
 
+      // the UDP length must cover the header and fit in the IP payload
+
+      if(ipe.ipPacket.payloadLength<UdpDatagram::getHeaderSize() ||
+         NetUtil::ntohs(datagram->udp_length)<UdpDatagram::getHeaderSize() ||
+         NetUtil::ntohs(datagram->udp_length)>ipe.ipPacket.payloadLength) {
+        _statistics.datagramsMalformed++;
+        return;
+      }
+
+      _statistics.datagramsReceived++;
+
       // are we waiting for a datagram?
 
       if(_awaiting) {
@@ -165,15 +191,26 @@ namespace stm32plus {
       else
         handled=false;
 
-      // raise the receive event
+      // on a busy network most broadcasts are for ports that we don't listen on. if we've been
+      // asked to then those are dropped here without troubling the receivers.
 
-      UdpDatagramEvent ude(*datagram,ipe.ipPacket);
-      UdpReceiveEventSender.raiseEvent(ude);
+      if(!handled && _params.udp_dropUnboundPorts && !this->ip_isPortInUse(NetUtil::ntohs(datagram->udp_destinationPort)))
+        _statistics.datagramsNoPort++;
+      else {
+
+        // raise the receive event
+
+        UdpDatagramEvent ude(*datagram,ipe.ipPacket);
+        UdpReceiveEventSender.raiseEvent(ude);
+
+        // merge the handled flag
 
-      // merge the handled flag
+        if(!handled) {
 
-      if(!handled)
-        handled=ude.handled;
+          if(!(handled=ude.handled))
+            _statistics.datagramsNoPort++;
+        }
+      }
 
       // if nobody could handle this packet and we are configured to do so then we will
       // raise an ICMP port unreachable event which, if ICMP is configured into the stack,
@@ -304,8 +341,12 @@ namespace stm32plus {
 
       // check that it was accepted for sending
 
-      if(!iptre.succeeded)
+      if(!iptre.succeeded) {
+        sync_fetch_and_increment(&_statistics.sendFailures);
         return false;
+      }
+
+      sync_fetch_and_increment(&_statistics.datagramsSent);
 
       // in sync mode we need to wait for the event raised by the datalink layer that indicates
       // the datagram has gone on to the wire
@@ -397,6 +438,17 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Get the UDP counters
+     * @return The statistics
+     */
+
+    template<class TNetworkLayer>
+    inline const typename Udp<TNetworkLayer>::Statistics& Udp<TNetworkLayer>::getUdpStatistics() const {
+      return _statistics;
+    }
+
+
     /**
      * Notification event notification from the stack
      * @param ned The network event descriptor
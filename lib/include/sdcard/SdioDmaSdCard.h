@@ -27,6 +27,31 @@ namespace stm32plus {
       volatile int _dmaErrorCode;
       volatile bool _dmaFinished;
       volatile bool _sdioFinished;
+      bool _transferBusy;
+
+      /*
+       * Holds the card for the duration of a transfer. The completion flags and the DMA channel
+       * are shared, so a task that wants the card while another task is waiting for a transfer
+       * yields until it's free. Tasks are not preempted so a plain flag is enough.
+       */
+
+      struct TransferOwner {
+
+        SdioDmaSdCard& _card;
+
+        TransferOwner(SdioDmaSdCard& card)
+          : _card(card) {
+
+          while(_card._transferBusy)
+            TaskScheduler::yield();
+
+          _card._transferBusy=true;
+        }
+
+        ~TransferOwner() {
+          _card._transferBusy=false;
+        }
+      };
 
     public:
       enum { BLOCK_SIZE = 512 };
@@ -29,7 +29,8 @@ namespace stm32plus {
 
     public:
       enum {
-        E_SPI_ERROR = 1
+        E_SPI_ERROR = 1,
+        E_SPI_INVALID_TRANSACTION = 2     ///< a bus transaction's count was zero or too big for one DMA transfer
       };
 
     protected:
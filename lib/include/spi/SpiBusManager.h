@@ -0,0 +1,304 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * Owner of a shared SPI bus. Devices (displays, flash, SD cards...) submit SpiTransaction
+   * descriptors which are run back-to-back by DMA. The next transaction is started from the
+   * DMA completion interrupt of the previous one so the caller never waits on the bus.
+   *
+   * The peripheral is reconfigured for CPOL, CPHA and speed only when the next device needs
+   * different settings from the current one. Chip select lines are driven by the manager.
+   *
+   * The DMA channels must include the interrupt feature and the SPI reader/writer feature
+   * for the same peripheral in 8-bit mode. For example:
+   *
+   *   Spi1<> spi(params);
+   *   Spi1TxDmaChannel<Spi1TxDmaChannelInterruptFeature,SpiDmaWriterFeature<Spi1PeripheralTraits> > txDma;
+   *   Spi1RxDmaChannel<Spi1RxDmaChannelInterruptFeature,SpiDmaReaderFeature<Spi1PeripheralTraits> > rxDma;
+   *   SpiBusManager<decltype(txDma),decltype(rxDma)> bus(spi,txDma,rxDma);
+   *
+   * @tparam TTxDma The DMA channel class that has the SpiDmaWriterFeature
+   * @tparam TRxDma The DMA channel class that has the SpiDmaReaderFeature
+   */
+
+  template<class TTxDma,class TRxDma>
+  class SpiBusManager : public SpiTransactionEventSource {
+
+    protected:
+
+      /**
+       * Mask of the CR1 bits that we manage per device
+       */
+
+      enum {
+        CONFIGURATION_MASK = SPI_CR1_CPOL | SPI_CR1_CPHA | SPI_CR1_BR
+      };
+
+      Spi& _spi;
+      TTxDma& _txDma;
+      TRxDma& _rxDma;
+      SpiTransaction * volatile _head;
+      SpiTransaction * volatile _tail;
+      SpiBusDevice *_selected;
+      uint8_t _fill;
+      uint8_t _discard;
+
+    protected:
+      void startNext();
+      void configure(const SpiBusDevice& device);
+      void complete(SpiTransaction::Status status);
+
+    public:
+      SpiBusManager(Spi& spi,TTxDma& txDma,TRxDma& rxDma);
+      ~SpiBusManager();
+
+      bool submit(SpiTransaction& transaction);
+      bool isIdle() const;
+
+      // DMA event subscription
+
+      void onRxDmaEvent(DmaEventType det);
+      void onTxDmaEvent(DmaEventType det);
+  };
+
+
+  /**
+   * Constructor. Subscribe to the DMA interrupts. Completion is detected from the RX channel
+   * because the last received byte proves the last transmitted byte has left the shift register.
+   * @param spi The SPI peripheral. It must be a full duplex master.
+   * @param txDma The TX DMA channel
+   * @param rxDma The RX DMA channel
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline SpiBusManager<TTxDma,TRxDma>::SpiBusManager(Spi& spi,TTxDma& txDma,TRxDma& rxDma)
+    : _spi(spi),
+      _txDma(txDma),
+      _rxDma(rxDma),
+      _head(nullptr),
+      _tail(nullptr),
+      _selected(nullptr),
+      _fill(0xff),
+      _discard(0) {
+
+    _rxDma.DmaInterruptEventSender.insertSubscriber(DmaInterruptEventSourceSlot::bind(this,&SpiBusManager::onRxDmaEvent));
+    _txDma.DmaInterruptEventSender.insertSubscriber(DmaInterruptEventSourceSlot::bind(this,&SpiBusManager::onTxDmaEvent));
+
+    _rxDma.enableInterrupts(TRxDma::COMPLETE | TRxDma::TRANSFER_ERROR);
+    _txDma.enableInterrupts(TTxDma::TRANSFER_ERROR);
+  }
+
+
+  /**
+   * Destructor, unsubscribe from the DMA interrupts
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline SpiBusManager<TTxDma,TRxDma>::~SpiBusManager() {
+    _rxDma.DmaInterruptEventSender.removeSubscriber(DmaInterruptEventSourceSlot::bind(this,&SpiBusManager::onRxDmaEvent));
+    _txDma.DmaInterruptEventSender.removeSubscriber(DmaInterruptEventSourceSlot::bind(this,&SpiBusManager::onTxDmaEvent));
+  }
+
+
+  /**
+   * Check if the bus has nothing queued or in progress
+   * @return true if idle
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline bool SpiBusManager<TTxDma,TRxDma>::isIdle() const {
+    return _head==nullptr;
+  }
+
+
+  /**
+   * Submit a transaction. It starts immediately if the bus is idle, otherwise it's queued.
+   * This method does not block.
+   * @param transaction The transaction. It must remain valid until complete.
+   * @return false if the transaction is already queued or in progress, or its count is
+   *   zero or more than 65535. A zero count would never raise the DMA complete interrupt
+   *   and the queue would stop.
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline bool SpiBusManager<TTxDma,TRxDma>::submit(SpiTransaction& transaction) {
+
+    IrqSuspend suspender;
+
+    if(transaction.isBusy())
+      return false;
+
+    if(transaction.count==0 || transaction.count>0xffff)
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_SPI,Spi::E_SPI_INVALID_TRANSACTION);
+
+    transaction.next=nullptr;
+    transaction.status=SpiTransaction::Status::QUEUED;
+
+    if(_head==nullptr) {
+      _head=_tail=&transaction;
+      startNext();
+    }
+    else {
+      _tail->next=&transaction;
+      _tail=&transaction;
+    }
+
+    return true;
+  }
+
+
+  /**
+   * Reconfigure the peripheral for a device if it's not already set up that way. The
+   * clock settings can only be changed while the peripheral is disabled.
+   * @param device The device about to be selected
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline void SpiBusManager<TTxDma,TRxDma>::configure(const SpiBusDevice& device) {
+
+    SPI_TypeDef *spi;
+    uint16_t config;
+
+    spi=_spi;
+    config=device.getConfiguration();
+
+    if((spi->CR1 & CONFIGURATION_MASK)==config)
+      return;
+
+    _spi.disablePeripheral();
+    spi->CR1=(spi->CR1 & ~CONFIGURATION_MASK) | config;
+    _spi.enablePeripheral();
+  }
+
+
+  /**
+   * Start the transaction at the head of the queue. Must be called with interrupts
+   * suspended or from IRQ context.
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline void SpiBusManager<TTxDma,TRxDma>::startNext() {
+
+    SpiTransaction *t;
+    SPI_TypeDef *spi;
+
+    if((t=_head)==nullptr)
+      return;
+
+    // a device that kept its CS asserted gives up the bus if someone else is next
+
+    if(_selected && _selected!=t->device) {
+      _selected->chipSelect.set();
+      _selected=nullptr;
+    }
+
+    if(_selected==nullptr) {
+      configure(*t->device);
+      t->device->chipSelect.reset();
+      _selected=t->device;
+    }
+
+    t->status=SpiTransaction::Status::IN_PROGRESS;
+
+    // flush any stale received data and overrun status
+
+    spi=_spi;
+    (void)spi->DR;
+    (void)spi->SR;
+
+    // receiver first so it's ready for the first byte clocked by the transmitter
+
+    if(t->rxData)
+      _rxDma.beginRead(t->rxData,t->count);
+    else
+      _rxDma.beginRead(&_discard,t->count,false);
+
+    if(t->txData)
+      _txDma.beginWrite(t->txData,t->count);
+    else
+      _txDma.beginWrite(&_fill,t->count,false);
+  }
+
+
+  /**
+   * Finish the transaction at the head of the queue and start the next one
+   * @param status The final status
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline void SpiBusManager<TTxDma,TRxDma>::complete(SpiTransaction::Status status) {
+
+    SpiTransaction *t;
+
+    if((t=_head)==nullptr)
+      return;
+
+    _head=t->next;
+    if(_head==nullptr)
+      _tail=nullptr;
+
+    // release CS unless asked to keep it for a follow-on transaction to the same device
+
+    if(!t->keepSelected || _head==nullptr || _head->device!=t->device || status!=SpiTransaction::Status::COMPLETE) {
+      _selected->chipSelect.set();
+      _selected=nullptr;
+    }
+
+    t->next=nullptr;
+    t->status=status;
+
+    SpiTransactionCompleteEventSender.raiseEvent(*t);
+
+    // a handler that submitted to an empty queue has already started it
+
+    if(_head && _head->status==SpiTransaction::Status::QUEUED)
+      startNext();
+  }
+
+
+  /**
+   * RX DMA interrupt. Completion of the receive means the whole transfer is done.
+   * @param det The event type
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline void SpiBusManager<TTxDma,TRxDma>::onRxDmaEvent(DmaEventType det) {
+
+    if(_head==nullptr)
+      return;
+
+    if(det==DmaEventType::EVENT_COMPLETE)
+      complete(SpiTransaction::Status::COMPLETE);
+    else if(det==DmaEventType::EVENT_TRANSFER_ERROR)
+      complete(SpiTransaction::Status::FAILED);
+  }
+
+
+  /**
+   * TX DMA interrupt. Only errors are of interest.
+   * @param det The event type
+   */
+
+  template<class TTxDma,class TRxDma>
+  inline void SpiBusManager<TTxDma,TRxDma>::onTxDmaEvent(DmaEventType det) {
+
+    if(_head!=nullptr && det==DmaEventType::EVENT_TRANSFER_ERROR) {
+
+      // the receiver is still waiting for bytes that won't come. stop it before the next
+      // transaction reprograms it so that it can't raise a stale completion.
+
+      _rxDma.stopRead();
+
+      errorProvider.set(ErrorProvider::ERROR_PROVIDER_SPI,Spi::E_SPI_ERROR);
+      complete(SpiTransaction::Status::FAILED);
+    }
+  }
+}
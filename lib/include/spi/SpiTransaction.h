@@ -0,0 +1,156 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * A device on a shared SPI bus. Each device has its own chip select line and its own
+   * clock polarity, phase and speed. The bus manager only reconfigures the peripheral
+   * when consecutive transactions are for devices with different settings.
+   */
+
+  struct SpiBusDevice {
+
+    GpioPinRef chipSelect;            ///< active low chip select
+    uint16_t cpol;                    ///< SPI_CPOL_High / SPI_CPOL_Low
+    uint16_t cpha;                    ///< SPI_CPHA_2Edge / SPI_CPHA_1Edge
+    uint16_t baudRatePrescaler;       ///< SPI_BaudRatePrescaler_2 .. 256
+
+    SpiBusDevice(const GpioPinRef& cs,
+                 uint16_t baudRatePrescaler,
+                 uint16_t cpol=SPI_CPOL_High,
+                 uint16_t cpha=SPI_CPHA_2Edge);
+
+    uint16_t getConfiguration() const;
+  };
+
+
+  /**
+   * Descriptor for a single transfer on a shared SPI bus. The transfer is full duplex:
+   * txData may be null to clock out 0xFF bytes and rxData may be null to discard what
+   * comes back. Transactions are linked through 'next' so queueing never touches the
+   * heap. The descriptor and its buffers must remain valid until it's no longer busy.
+   */
+
+  struct SpiTransaction {
+
+    /**
+     * Possible states of the transaction
+     */
+
+    enum class Status : uint8_t {
+      IDLE,             ///< never been submitted
+      QUEUED,           ///< waiting for the bus
+      IN_PROGRESS,      ///< currently on the bus
+      COMPLETE,         ///< finished successfully
+      FAILED            ///< DMA error
+    };
+
+    SpiBusDevice *device;
+    const void *txData;
+    void *rxData;
+    uint32_t count;
+    bool keepSelected;        ///< leave CS asserted if the next queued transaction is for the same device
+    volatile Status status;
+    void *userData;           ///< not used by the library, for your own use
+    SpiTransaction *next;     ///< queue linkage, owned by the bus manager
+
+    SpiTransaction();
+
+    void set(SpiBusDevice& dev,const void *tx,void *rx,uint32_t cnt,bool keep=false);
+    bool isBusy() const;
+  };
+
+
+  /**
+   * The signature for transaction completion: void myHandler(SpiTransaction& transaction)
+   * Completion events are raised from IRQ context.
+   */
+
+  DECLARE_EVENT_SIGNATURE(SpiTransactionComplete,void(SpiTransaction&));
+
+
+  /**
+   * Base structure that holds just the event subscriber/publisher for transaction completion
+   */
+
+  struct SpiTransactionEventSource {
+    DECLARE_EVENT_SOURCE(SpiTransactionComplete);
+  };
+
+
+  /**
+   * Constructor
+   * @param cs The chip select pin. It must already be configured as an output.
+   * @param baudRate The SPI_BaudRatePrescaler_* value for this device
+   * @param polarity The clock polarity
+   * @param phase The clock phase
+   */
+
+  inline SpiBusDevice::SpiBusDevice(const GpioPinRef& cs,uint16_t baudRate,uint16_t polarity,uint16_t phase)
+    : chipSelect(cs),
+      cpol(polarity),
+      cpha(phase),
+      baudRatePrescaler(baudRate) {
+  }
+
+
+  /**
+   * Get the CR1 bits that this device needs
+   * @return The CPOL, CPHA and BR bits
+   */
+
+  inline uint16_t SpiBusDevice::getConfiguration() const {
+    return cpol | cpha | baudRatePrescaler;
+  }
+
+
+  /**
+   * Constructor
+   */
+
+  inline SpiTransaction::SpiTransaction()
+    : device(nullptr),
+      txData(nullptr),
+      rxData(nullptr),
+      count(0),
+      keepSelected(false),
+      status(Status::IDLE),
+      userData(nullptr),
+      next(nullptr) {
+  }
+
+
+  /**
+   * Set up the transaction
+   * @param dev The device to talk to
+   * @param tx The data to send, or nullptr to send 0xFF
+   * @param rx Where to put the received data, or nullptr to discard it
+   * @param cnt The number of bytes to transfer
+   * @param keep true to keep CS asserted if the next transaction is for the same device
+   */
+
+  inline void SpiTransaction::set(SpiBusDevice& dev,const void *tx,void *rx,uint32_t cnt,bool keep) {
+    device=&dev;
+    txData=tx;
+    rxData=rx;
+    count=cnt;
+    keepSelected=keep;
+  }
+
+
+  /**
+   * Check if the transaction is queued or on the bus
+   * @return true if it's not finished yet
+   */
+
+  inline bool SpiTransaction::isBusy() const {
+    return status==Status::QUEUED || status==Status::IN_PROGRESS;
+  }
+}
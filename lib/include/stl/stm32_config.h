@@ -32,7 +32,11 @@ namespace stm32plus {
   inline size_t Stm32DequeBufferSize() { return 20; }
 
 // alloc-ahead additional memory increment for strings. The default SGI implementation will add
-// the old size, doubling memory each time. We don't have memory to burn, so add 20 types each time
+// the old size, doubling memory each time. We don't have memory to burn so we double only up to
+// a 1Kb increment, and never add less than 20 types. A fixed increment makes building a large
+// string quadratic in time.
 
-  template<typename T> size_t Stm32StringAllocAheadIncrement(size_t) { return 20; }
+  template<typename T> size_t Stm32StringAllocAheadIncrement(size_t oldSize_) {
+    return oldSize_<20 ? 20 : (oldSize_>1024 ? 1024 : oldSize_);
+  }
 }
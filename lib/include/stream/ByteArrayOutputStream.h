@@ -13,8 +13,13 @@ namespace stm32plus {
    * @brief output stream for writing to an auto-resizing memory block
    *
    * This stream writes to a memory block allocated on the heap that automatically
-   * increases to take new data. The intial size and the size of subsequent
-   * resizes are customizable.
+   * increases to take new data. The block grows geometrically: each resize adds the
+   * current size, but never less than resizeAmount and never more than maxResizeAmount.
+   * Set maxResizeAmount equal to resizeAmount for fixed size increments. If you know
+   * roughly how big the output will be then call reserve() up front.
+   *
+   * If the data is going to be sent somewhere in pieces anyway then ChunkedOutputStream
+   * avoids the copying altogether.
    */
 
   class ByteArrayOutputStream : public OutputStream {
@@ -23,15 +28,18 @@ namespace stm32plus {
       ByteMemblock _memblock;
       uint32_t _currentUsage;
       uint32_t _resizeAmount;
+      uint32_t _maxResizeAmount;
       uint32_t _initialSize;
 
     public:
-      ByteArrayOutputStream(uint32_t initialSize=100,uint32_t resizeAmount=100);
+      ByteArrayOutputStream(uint32_t initialSize=100,uint32_t resizeAmount=100,uint32_t maxResizeAmount=8192);
       virtual ~ByteArrayOutputStream() {}
 
       uint32_t getSize() const;
+      uint32_t getCapacity() const;
       uint8_t *getBuffer() const;
 
+      void reserve(uint32_t capacity);
       void clear();
 
       // overrides from OutputStream
@@ -0,0 +1,106 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * An output stream that writes to a list of heap allocated chunks. Unlike ByteArrayOutputStream
+   * the data already written is never moved: when the current chunk fills up a new one is linked
+   * on the end. Chunk sizes start at chunkSize and double up to maxChunkSize.
+   *
+   * The data is not contiguous. Walk the chunks with getFirstChunk() and send each one in turn,
+   * or use writeTo() to copy the whole lot into another stream.
+   */
+
+  class ChunkedOutputStream : public OutputStream {
+
+    public:
+
+      /**
+       * A chunk header. The data immediately follows the header in the same allocation.
+       */
+
+      struct Chunk {
+        Chunk *next;
+        uint32_t size;
+        uint32_t capacity;
+
+        uint8_t *data() {
+          return reinterpret_cast<uint8_t *>(this+1);
+        }
+
+        const uint8_t *data() const {
+          return reinterpret_cast<const uint8_t *>(this+1);
+        }
+      };
+
+    protected:
+      Chunk *_first;
+      Chunk *_last;
+      uint32_t _size;
+      uint32_t _chunkCount;
+      uint32_t _nextChunkSize;
+      uint32_t _chunkSize;
+      uint32_t _maxChunkSize;
+
+    protected:
+      void addChunk(uint32_t minimumSize);
+
+    public:
+      ChunkedOutputStream(uint32_t chunkSize=128,uint32_t maxChunkSize=2048);
+      virtual ~ChunkedOutputStream();
+
+      ChunkedOutputStream(const ChunkedOutputStream&)=delete;
+      ChunkedOutputStream& operator=(const ChunkedOutputStream&)=delete;
+
+      uint32_t getSize() const;
+      uint32_t getChunkCount() const;
+      const Chunk *getFirstChunk() const;
+
+      bool writeTo(OutputStream& os) const;
+      void clear();
+
+      // overrides from OutputStream
+
+      virtual bool write(uint8_t c) override;
+      virtual bool write(const void *buffer,uint32_t size) override;
+      virtual bool close() override;
+      virtual bool flush() override;
+  };
+
+
+  /**
+   * Get the total number of bytes written
+   * @return The size of the data in all chunks
+   */
+
+  inline uint32_t ChunkedOutputStream::getSize() const {
+    return _size;
+  }
+
+
+  /**
+   * Get the number of chunks allocated
+   * @return The chunk count
+   */
+
+  inline uint32_t ChunkedOutputStream::getChunkCount() const {
+    return _chunkCount;
+  }
+
+
+  /**
+   * Get the first chunk in the list. Follow the next pointers for the rest.
+   * @return The first chunk, or nullptr if nothing has been written.
+   */
+
+  inline const ChunkedOutputStream::Chunk *ChunkedOutputStream::getFirstChunk() const {
+    return _first;
+  }
+}
@@ -0,0 +1,275 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * Batch statistics accumulated by the InputCaptureProcessor. All times are in timer
+   * ticks. Call reset() to begin a new measurement window.
+   */
+
+  struct InputCaptureStatistics {
+
+    uint32_t count;             ///< number of complete periods measured
+    uint32_t minPeriod;
+    uint32_t maxPeriod;
+    uint64_t totalPeriod;
+    uint64_t totalHigh;         ///< total high time, only when edges or pulse widths are captured
+
+    InputCaptureStatistics();
+
+    void reset();
+    void addPeriod(uint32_t period);
+
+    uint32_t getMeanPeriod() const;
+    float getFrequency(uint32_t timerClock) const;
+    float getDutyCycle() const;
+  };
+
+
+  /**
+   * Convert blocks of raw capture register values into periods, high times and statistics.
+   * Captures are differenced modulo the timer's period so the counter wrapping between two
+   * edges is handled. The signal period must be shorter than the timer period otherwise
+   * whole timer overflows are invisible in the captured values.
+   *
+   * The processor remembers the last capture of each block so blocks may be fed in as they
+   * arrive from TimerInputCaptureDmaFeature without losing the period that spans the join.
+   * It has no hardware dependencies.
+   *
+   * The capture type is a template parameter of the process methods so that the uint16_t
+   * captures of 16-bit timers and the uint32_t captures of 32-bit timers are both accepted
+   * as they come out of the DMA buffer.
+   */
+
+  class InputCaptureProcessor {
+
+    protected:
+      uint32_t _modulus;
+      uint32_t _lastRise;
+      uint32_t _pendingHigh;
+      bool _haveRise;
+      bool _haveHigh;
+      bool _nextRising;
+
+    public:
+      InputCaptureProcessor(uint32_t modulus=0x10000);
+
+      void reset(bool firstEdgeRising=true);
+      uint32_t difference(uint32_t from,uint32_t to) const;
+
+      template<typename TCapture>
+      void processPeriods(const TCapture *captures,uint32_t count,InputCaptureStatistics& stats);
+
+      template<typename TCapture>
+      void processEdges(const TCapture *captures,uint32_t count,InputCaptureStatistics& stats);
+
+      template<typename TCapture>
+      void processPwmInput(const TCapture *periods,const TCapture *pulses,uint32_t count,InputCaptureStatistics& stats) const;
+  };
+
+
+  /**
+   * Constructor
+   */
+
+  inline InputCaptureStatistics::InputCaptureStatistics() {
+    reset();
+  }
+
+
+  /**
+   * Reset to an empty window
+   */
+
+  inline void InputCaptureStatistics::reset() {
+    count=0;
+    minPeriod=UINT32_MAX;
+    maxPeriod=0;
+    totalPeriod=0;
+    totalHigh=0;
+  }
+
+
+  /**
+   * Accumulate a period
+   * @param period The period in ticks
+   */
+
+  inline void InputCaptureStatistics::addPeriod(uint32_t period) {
+
+    count++;
+    totalPeriod+=period;
+
+    if(period<minPeriod)
+      minPeriod=period;
+
+    if(period>maxPeriod)
+      maxPeriod=period;
+  }
+
+
+  /**
+   * Get the mean period
+   * @return The mean period in ticks, or zero if nothing was measured
+   */
+
+  inline uint32_t InputCaptureStatistics::getMeanPeriod() const {
+    return count ? totalPeriod/count : 0;
+  }
+
+
+  /**
+   * Get the mean frequency
+   * @param timerClock The counter tick rate in Hz, e.g. Timer::getClock()
+   * @return The frequency in Hz, zero if nothing was measured
+   */
+
+  inline float InputCaptureStatistics::getFrequency(uint32_t timerClock) const {
+    return totalPeriod ? (static_cast<float>(timerClock)*count)/totalPeriod : 0;
+  }
+
+
+  /**
+   * Get the mean duty cycle
+   * @return The duty cycle as a fraction 0..1
+   */
+
+  inline float InputCaptureStatistics::getDutyCycle() const {
+    return totalPeriod ? static_cast<float>(totalHigh)/totalPeriod : 0;
+  }
+
+
+  /**
+   * Constructor
+   * @param modulus The timer period plus one (ARR+1). The default is correct for a 16-bit
+   *   timer that counts all the way to 0xFFFF. For a 32-bit timer that counts all the way to
+   *   0xFFFFFFFF pass zero, which is ARR+1 wrapped to 32 bits.
+   */
+
+  inline InputCaptureProcessor::InputCaptureProcessor(uint32_t modulus)
+    : _modulus(modulus) {
+    reset();
+  }
+
+
+  /**
+   * Forget the last captures, e.g. after the stream was restarted
+   * @param firstEdgeRising For processEdges(): true if the first capture is a rising edge
+   */
+
+  inline void InputCaptureProcessor::reset(bool firstEdgeRising) {
+    _lastRise=0;
+    _pendingHigh=0;
+    _haveRise=false;
+    _haveHigh=false;
+    _nextRising=firstEdgeRising;
+  }
+
+
+  /**
+   * Get the number of ticks from one capture to a later one, allowing for one counter wrap
+   * @param from The earlier capture
+   * @param to The later capture
+   * @return The difference in ticks
+   */
+
+  inline uint32_t InputCaptureProcessor::difference(uint32_t from,uint32_t to) const {
+    return to>=from ? to-from : _modulus-from+to;
+  }
+
+
+  /**
+   * Process a block of captures taken on the same edge of each cycle (rising or falling)
+   * @tparam TCapture The capture type, uint16_t or uint32_t to match the timer width
+   * @param captures The captured values
+   * @param count The number of captures
+   * @param stats The statistics to update
+   */
+
+  template<typename TCapture>
+  inline void InputCaptureProcessor::processPeriods(const TCapture *captures,uint32_t count,InputCaptureStatistics& stats) {
+
+    while(count--) {
+
+      if(_haveRise)
+        stats.addPeriod(difference(_lastRise,*captures));
+
+      _lastRise=*captures++;
+      _haveRise=true;
+    }
+  }
+
+
+  /**
+   * Process a block of captures taken on both edges so that they alternate between rising
+   * and falling. A period is counted at each rising edge after the first and the high time
+   * of that cycle is added to the duty cycle total.
+   * @tparam TCapture The capture type, uint16_t or uint32_t to match the timer width
+   * @param captures The captured values
+   * @param count The number of captures
+   * @param stats The statistics to update
+   */
+
+  template<typename TCapture>
+  inline void InputCaptureProcessor::processEdges(const TCapture *captures,uint32_t count,InputCaptureStatistics& stats) {
+
+    uint32_t capture;
+
+    while(count--) {
+
+      capture=*captures++;
+
+      if(_nextRising) {
+
+        // a complete cycle needs a previous rising edge and the falling edge in between
+
+        if(_haveRise && _haveHigh) {
+          stats.addPeriod(difference(_lastRise,capture));
+          stats.totalHigh+=_pendingHigh;
+        }
+
+        _lastRise=capture;
+        _haveRise=true;
+        _haveHigh=false;
+      }
+      else if(_haveRise) {
+        _pendingHigh=difference(_lastRise,capture);
+        _haveHigh=true;
+      }
+
+      _nextRising=!_nextRising;
+    }
+  }
+
+
+  /**
+   * Process captures taken in PWM input mode where the counter is reset by the slave
+   * controller on each rising edge. One channel captures the period and the other the
+   * pulse width directly so no differencing is needed. This is the mode to use on
+   * devices that cannot capture both edges on one channel.
+   * @tparam TCapture The capture type, uint16_t or uint32_t to match the timer width
+   * @param periods The period captures
+   * @param pulses The pulse width captures, may be nullptr
+   * @param count The number of captures in each array
+   * @param stats The statistics to update
+   */
+
+  template<typename TCapture>
+  inline void InputCaptureProcessor::processPwmInput(const TCapture *periods,const TCapture *pulses,uint32_t count,InputCaptureStatistics& stats) const {
+
+    while(count--) {
+
+      stats.addPeriod(*periods++);
+
+      if(pulses)
+        stats.totalHigh+=*pulses++;
+    }
+  }
+}
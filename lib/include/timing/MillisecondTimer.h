@@ -21,6 +21,7 @@ namespace stm32plus {
 
     public:
       volatile static uint32_t _counter;
+      volatile static uint32_t _counterHigh;      // incremented each time _counter wraps
 
     public:
       static void initialise();
@@ -48,6 +49,7 @@ namespace stm32plus {
 
   inline void MillisecondTimer::reset() {
     _counter=0;
+    _counterHigh=0;
   }
 
 
@@ -0,0 +1,132 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#pragma once
+
+
+namespace stm32plus {
+
+  /**
+   * @brief 64-bit monotonic clock with microsecond resolution.
+   *
+   * The clock is built from the MillisecondTimer SysTick counter plus the SysTick down-counter
+   * so it costs no extra peripheral and no extra interrupts. MillisecondTimer::initialise() must
+   * have been called. The 64-bit value will not wrap in the lifetime of the device.
+   *
+   * On the Cortex-M3/M4 the DWT cycle counter is also available for measuring very short
+   * intervals at CPU clock resolution. It's 32 bits wide so use the wrap-safe helpers.
+   */
+
+  class MonotonicTimer {
+
+    protected:
+
+#if !defined(STM32PLUS_F0)
+
+      /*
+       * DWT and debug registers. The F1 CMSIS does not define the DWT so we address it directly.
+       */
+
+      enum {
+        DWT_CTRL     = 0xE0001000,
+        DWT_CYCCNT   = 0xE0001004,
+        DEBUG_DEMCR  = 0xE000EDFC,
+
+        DWT_CTRL_CYCCNTENA = 0x00000001,
+        DEBUG_DEMCR_TRCENA = 0x01000000
+      };
+
+#endif
+
+    public:
+      static void initialise();
+
+      static uint64_t micros();
+      static uint64_t difference(uint64_t start);
+      static bool hasTimedOut(uint64_t start,uint64_t timeout);
+
+#if !defined(STM32PLUS_F0)
+      static uint32_t cycles();
+      static uint32_t cyclesToMicros(uint32_t cycles);
+#endif
+
+      static uint32_t elapsed(uint32_t start,uint32_t now);
+      static bool isBefore(uint32_t a,uint32_t b);
+  };
+
+
+  /**
+   * Get the time elapsed since a start time
+   * @param start The start time from micros()
+   * @return The difference in microseconds
+   */
+
+  inline uint64_t MonotonicTimer::difference(uint64_t start) {
+    return micros()-start;
+  }
+
+
+  /**
+   * Check if a timeout has expired
+   * @param start The start time from micros()
+   * @param timeout The timeout in microseconds
+   * @return true if it's expired
+   */
+
+  inline bool MonotonicTimer::hasTimedOut(uint64_t start,uint64_t timeout) {
+    return difference(start)>timeout;
+  }
+
+
+#if !defined(STM32PLUS_F0)
+
+  /**
+   * Get the DWT cycle counter. initialise() must have been called to enable it.
+   * @return The current cycle count
+   */
+
+  inline uint32_t MonotonicTimer::cycles() {
+    return *reinterpret_cast<volatile uint32_t *>(DWT_CYCCNT);
+  }
+
+
+  /**
+   * Convert a cycle count (usually the result of elapsed()) to microseconds
+   * @param cycles The number of core clock cycles
+   * @return The number of microseconds
+   */
+
+  inline uint32_t MonotonicTimer::cyclesToMicros(uint32_t cycles) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(cycles)*1000000)/SystemCoreClock);
+  }
+
+#endif
+
+
+  /**
+   * Wrap-safe difference between two samples of a free running 32-bit counter
+   * @param start The earlier sample
+   * @param now The later sample
+   * @return The number of ticks between them
+   */
+
+  inline uint32_t MonotonicTimer::elapsed(uint32_t start,uint32_t now) {
+    return now-start;
+  }
+
+
+  /**
+   * Wrap-safe comparison of two samples of a free running 32-bit counter. Valid as long as
+   * the samples are less than half the counter range apart.
+   * @param a The first sample
+   * @param b The second sample
+   * @return true if a is earlier than b
+   */
+
+  inline bool MonotonicTimer::isBefore(uint32_t a,uint32_t b) {
+    return static_cast<int32_t>(a-b)<0;
+  }
+}
@@ -0,0 +1,171 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/concurrent.h"
+
+
+/*
+ * The FPU callee-saved registers must be preserved across a switch if the compiler
+ * might be using them
+ */
+
+#if defined(__VFP_FP__) && !defined(__SOFTFP__)
+#define STM32PLUS_TASK_SAVE_FPU
+#endif
+
+
+/**
+ * Save the callee-saved registers on the current stack, store the stack pointer in
+ * *saveSp then switch to newSp and restore the registers saved there. Only Thumb-1
+ * instructions are used for the core registers so this works on the M0 as well.
+ * @param saveSp Where to store the outgoing stack pointer
+ * @param newSp The incoming stack pointer
+ */
+
+extern "C" void __attribute__((naked,noinline)) stm32plus_task_switch(uint32_t ** /* saveSp */,uint32_t * /* newSp */) {
+
+  asm volatile(
+    ".syntax unified            \n\t"
+    "push  {r4-r7,lr}           \n\t"
+    "mov   r4,r8                \n\t"
+    "mov   r5,r9                \n\t"
+    "mov   r6,r10               \n\t"
+    "mov   r7,r11               \n\t"
+    "push  {r4-r7}              \n\t"
+#if defined(STM32PLUS_TASK_SAVE_FPU)
+    "vpush {s16-s31}            \n\t"
+#endif
+    "mov   r2,sp                \n\t"
+    "str   r2,[r0]              \n\t"
+    "mov   sp,r1                \n\t"
+#if defined(STM32PLUS_TASK_SAVE_FPU)
+    "vpop  {s16-s31}            \n\t"
+#endif
+    "pop   {r4-r7}              \n\t"
+    "mov   r8,r4                \n\t"
+    "mov   r9,r5                \n\t"
+    "mov   r10,r6               \n\t"
+    "mov   r11,r7               \n\t"
+    "pop   {r4-r7,pc}           \n\t"
+  );
+}
+
+
+namespace stm32plus {
+
+  /*
+   * The main program's context. It is always in the task list. Both are constant-initialised
+   * so they're valid before any static constructor runs.
+   */
+
+  Task TaskScheduler::_mainTask;
+  Task *TaskScheduler::_current=&TaskScheduler::_mainTask;
+
+
+  /**
+   * Constructor. Build an initial frame at the top of the stack that looks as if
+   * the task had called stm32plus_task_switch() from taskEntry(). The first switch to
+   * this task will then "return" into taskEntry().
+   * @param stack The stack memory
+   * @param stackSize The size of the stack memory in bytes
+   * @param function The task entry point
+   * @param param Parameter passed to the entry point
+   */
+
+  Task::Task(void *stack,uint32_t stackSize,TaskFunction function,void *param)
+    : _function(function),
+      _param(param),
+      _next(this),
+      _state(State::READY) {
+
+    uint32_t *sp;
+    int i;
+
+    // the stack is full-descending and the AAPCS wants 8 byte alignment at public interfaces
+
+    sp=reinterpret_cast<uint32_t *>((reinterpret_cast<uint32_t>(stack)+stackSize) & ~7);
+
+    // pc, r7-r4, r11-r8
+
+    *--sp=reinterpret_cast<uint32_t>(&TaskScheduler::taskEntry);
+
+    for(i=0;i<8;i++)
+      *--sp=0;
+
+#if defined(STM32PLUS_TASK_SAVE_FPU)
+
+    // s31-s16
+
+    for(i=0;i<16;i++)
+      *--sp=0;
+
+#endif
+
+    _sp=sp;
+  }
+
+
+  /**
+   * Add a task to the scheduler. It will run after the current task next yields.
+   * @param task The task to add. It must not already be scheduled.
+   */
+
+  void TaskScheduler::addTask(Task& task) {
+
+    IrqSuspend suspender;
+
+    task._state=Task::State::READY;
+    task._next=_current->_next;
+    _current->_next=&task;
+  }
+
+
+  /**
+   * Switch to the next ready task. Returns immediately if there isn't one or if we're
+   * in an interrupt handler. Finished tasks are unlinked from the list as we pass them.
+   */
+
+  void TaskScheduler::yield() {
+
+    Task *current,*next;
+
+    if(inHandlerMode())
+      return;
+
+    current=_current;
+    next=current->_next;
+
+    while(next!=current && next->_state==Task::State::FINISHED) {
+      current->_next=next->_next;
+      next=current->_next;
+    }
+
+    if(next==current)
+      return;
+
+    _current=next;
+    stm32plus_task_switch(&current->_sp,next->_sp);
+  }
+
+
+  /**
+   * All tasks start here. Run the task function then mark the task finished and
+   * give up the CPU. A finished task is never switched back to.
+   */
+
+  void TaskScheduler::taskEntry() {
+
+    Task *task;
+
+    task=_current;
+    task->_function(task->_param);
+    task->_state=Task::State::FINISHED;
+
+    for(;;)
+      yield();
+  }
+}
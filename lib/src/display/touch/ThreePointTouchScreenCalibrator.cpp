@@ -42,7 +42,8 @@ namespace stm32plus {
 
       _clicked=true;
 
-      _ts.TouchScreenReadyEventSender.insertSubscriber(TouchScreenReadyEventSourceSlot::bind(this,&ThreePointTouchScreenCalibrator::onTouchScreenReady));
+      if(!_ts.TouchScreenReadyEventSender.insertSubscriber(TouchScreenReadyEventSourceSlot::bind(this,&ThreePointTouchScreenCalibrator::onTouchScreenReady)))
+        return false;
 
       // point 1 is at 25%,50%, 2 is at 75%,25% and 3 is at 75%,75%
 
@@ -39,6 +39,7 @@ namespace stm32plus {
   bool FileSystem::getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,FileSystem*& newFileSystem) {
 
     fat::FatFileSystem *fatFs;
+    exfat::ExFatFileSystem *exfatFs;
 
     // is it FAT?
 
@@ -47,6 +48,48 @@ namespace stm32plus {
       return true;
     }
 
+    // is it exFAT?
+
+    if(exfat::ExFatFileSystem::getInstance(blockDevice,timeProvider,exfatFs)) {
+      newFileSystem=exfatFs;
+      return true;
+    }
+
+    // nothing else supported
+
+    return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_UNKNOWN_FILESYSTEM);
+  }
+
+  /**
+   * Get a filesystem instance for the volume that starts at the given sector. Use this to mount
+   * partitions other than the first.
+   *
+   * @param[in] blockDevice The block device that holds the filesystem.
+   * @param[in] timeProvider The provider of time information for write operations.
+   * @param[in] firstSectorIndex The sector index on the device of the volume's boot sector.
+   * @param[out] newFileSystem The pointer to the new file system that the caller can use. Caller must delete when finished.
+   * @return false if it fails.
+   */
+
+  bool FileSystem::getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,uint32_t firstSectorIndex,FileSystem*& newFileSystem) {
+
+    fat::FatFileSystem *fatFs;
+    exfat::ExFatFileSystem *exfatFs;
+
+    // is it FAT?
+
+    if(fat::FatFileSystem::getInstance(blockDevice,timeProvider,firstSectorIndex,fatFs)) {
+      newFileSystem=fatFs;
+      return true;
+    }
+
+    // is it exFAT?
+
+    if(exfat::ExFatFileSystem::getInstance(blockDevice,timeProvider,firstSectorIndex,exfatFs)) {
+      newFileSystem=exfatFs;
+      return true;
+    }
+
     // nothing else supported
 
     return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_UNKNOWN_FILESYSTEM);
@@ -90,6 +133,34 @@ namespace stm32plus {
     }
   }
 
+  /**
+   * Read a run of consecutive sectors from the file system. Where the block size equals the sector
+   * size this is a single multi-block read on the device.
+   *
+   * @param[in] sectorIndex The first sector index on the file system to read.
+   * @param[in,out] buffer Caller supplied buffer large enough to hold count sectors.
+   * @param[in] count The number of sectors to read.
+   * @return false if it fails.
+   */
+
+  bool FileSystem::readSectors(uint32_t sectorIndex,void *buffer,uint32_t count) {
+
+    uint8_t *ptr;
+
+    if(count==1 || _blockDevice.getBlockSizeInBytes() != getSectorSizeInBytes()) {
+
+      // fall back to reading one at a time
+
+      for(ptr=static_cast<uint8_t *>(buffer);count;count--,sectorIndex++,ptr+=getSectorSizeInBytes())
+        if(!readSector(sectorIndex,ptr))
+          return false;
+
+      return true;
+    }
+
+    return _blockDevice.readBlocks(buffer,sectorIndexToBlockIndex(_firstSectorIndex + sectorIndex),count);
+  }
+
   /**
    * Write a sector to the file system.
    *
@@ -118,6 +189,28 @@ namespace stm32plus {
     return _blockDevice.writeBlock(buffer,blockIndex);
   }
 
+  /**
+   * Write a run of consecutive sectors to the file system with a single multi-block write.
+   *
+   * @param[in] sectorIndex The first sector index on the file system to write.
+   * @param[in] buffer Buffer that holds count sectors of data to write.
+   * @param[in] count The number of sectors to write.
+   * @return false if it fails.
+   */
+
+  bool FileSystem::writeSectors(uint32_t sectorIndex,void *buffer,uint32_t count) {
+
+    errorProvider.clear();
+
+    if(_blockDevice.getBlockSizeInBytes() != getSectorSizeInBytes())
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_UNEQUAL_BLOCK_SECTOR_SIZES);
+
+    if(count==1)
+      return _blockDevice.writeBlock(buffer,sectorIndexToBlockIndex(_firstSectorIndex + sectorIndex));
+
+    return _blockDevice.writeBlocks(buffer,sectorIndexToBlockIndex(_firstSectorIndex + sectorIndex),count);
+  }
+
   /*
    * Convert a sector index to a block index
    */
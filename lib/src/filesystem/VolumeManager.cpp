@@ -0,0 +1,154 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+
+  /**
+   * Constructor
+   */
+
+  VolumeManager::VolumeManager()
+    : _volumeCount(0) {
+  }
+
+
+  /**
+   * Destructor, delete the volumes
+   */
+
+  VolumeManager::~VolumeManager() {
+    unmount();
+  }
+
+
+  /**
+   * Delete all the mounted volumes
+   */
+
+  void VolumeManager::unmount() {
+
+    while(_volumeCount)
+      delete _volumes[--_volumeCount];
+  }
+
+
+  /**
+   * Mount all the volumes on a device. Partitions that don't hold a supported file system
+   * are skipped.
+   * @param[in] blockDevice The block device.
+   * @param[in] timeProvider The provider of time information for write operations.
+   * @return false if nothing could be mounted.
+   */
+
+  bool VolumeManager::mount(BlockDevice& blockDevice,const TimeProvider& timeProvider) {
+
+    ByteMemblock block(blockDevice.getBlockSizeInBytes());
+    const Mbr *mbr;
+    FileSystem *fs;
+    uint8_t i;
+
+    unmount();
+
+    // a device without an MBR has a single volume starting at sector zero
+
+    if(FileSystem::getInstance(blockDevice,timeProvider,0,fs)) {
+      _volumes[_volumeCount++]=fs;
+      return true;
+    }
+
+    // read the MBR
+
+    if(!blockDevice.readBlock(block,0))
+      return false;
+
+    mbr=reinterpret_cast<const Mbr *>(block.getData());
+
+    if(mbr->signature!=MBR_SIGNATURE)
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_BLOCK_DEVICE,BlockDevice::E_INVALID_MBR);
+
+    // try each primary partition in turn
+
+    for(i=0;i<4;i++)
+      if(isMountablePartition(mbr->partitions[i]) && FileSystem::getInstance(blockDevice,timeProvider,mbr->partitions[i].lbaFirstSector,fs))
+        _volumes[_volumeCount++]=fs;
+
+    if(_volumeCount==0)
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_VOLUME_MANAGER,E_NO_VOLUMES);
+
+    errorProvider.clear();
+    return true;
+  }
+
+
+  /*
+   * Check if a partition could hold a file system. Empty and extended partitions are skipped.
+   */
+
+  bool VolumeManager::isMountablePartition(const MbrPartition& partition) {
+
+    if(partition.numSectors==0 || partition.lbaFirstSector==0)
+      return false;
+
+    switch(partition.partitionType) {
+      case 0x00:      // empty
+      case 0x05:      // extended (CHS)
+      case 0x0f:      // extended (LBA)
+        return false;
+
+      default:
+        return true;
+    }
+  }
+
+
+  /**
+   * Split a pathname into the volume that holds it and the pathname on that volume
+   * @param[in] pathname The pathname, optionally prefixed with "N:"
+   * @param[out] fs The volume
+   * @param[out] volumePathname The pathname with the prefix removed. Points into pathname.
+   * @return false if the volume number is not valid.
+   */
+
+  bool VolumeManager::resolve(const char *pathname,FileSystem*& fs,const char*& volumePathname) const {
+
+    uint8_t index;
+
+    if(pathname[0]>='0' && pathname[0]<='9' && pathname[1]==':') {
+      index=pathname[0]-'0';
+      volumePathname=pathname+2;
+    }
+    else {
+      index=0;
+      volumePathname=pathname;
+    }
+
+    if(index>=_volumeCount)
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_VOLUME_MANAGER,E_INVALID_VOLUME);
+
+    fs=_volumes[index];
+    return true;
+  }
+
+
+  /**
+   * Open a file on any volume
+   * @param[in] pathname The pathname, optionally prefixed with "N:"
+   * @param[out] newFile The new file. The caller must delete it when finished.
+   * @return false if it fails.
+   */
+
+  bool VolumeManager::openFile(const char *pathname,File*& newFile) const {
+
+    FileSystem *fs;
+    const char *volumePathname;
+
+    return resolve(pathname,fs,volumePathname) && fs->openFile(volumePathname,newFile);
+  }
+}
@@ -0,0 +1,138 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * Constructor
+     * @param[in] fs The file system.
+     * @param[in] dir The location of the directory to iterate over.
+     */
+
+    ExFatDirectoryIterator::ExFatDirectoryIterator(ExFatFileSystem& fs,const ExFatDirectory& dir) :
+      _fs(fs),
+      _dir(dir) {
+
+      _nextIndex=0;
+    }
+
+
+    /**
+     * @copydoc Iterator::next
+     */
+
+    bool ExFatDirectoryIterator::next() {
+
+      ExFatDirectoryEntry entry;
+
+      for(;;) {
+
+        // reading past the allocation sets the end of entries error for us
+
+        if(!_fs.readEntry(_dir,_nextIndex,entry))
+          return false;
+
+        if(entry.EntryType==ExFatDirectoryEntry::TYPE_END_OF_DIRECTORY)
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_ITERATOR,E_END_OF_ENTRIES);
+
+        if(entry.EntryType!=ExFatDirectoryEntry::TYPE_FILE) {
+          _nextIndex++;
+          continue;
+        }
+
+        _nextIndex+=1+entry.File.SecondaryCount;
+
+        if(_fs.readEntrySet(_dir,_nextIndex-1-entry.File.SecondaryCount,_set)) {
+          assign(_set);
+          return true;
+        }
+      }
+    }
+
+
+    /**
+     * @copydoc Iterator::current
+     */
+
+    const FileInformation& ExFatDirectoryIterator::current() {
+      return *this;
+    }
+
+
+    /**
+     * @copydoc DirectoryIterator::getSubdirectoryIterator
+     */
+
+    bool ExFatDirectoryIterator::getSubdirectoryIterator(DirectoryIterator*& newIterator) {
+
+      ExFatDirectory dir;
+
+      if(!_set.isDirectory())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_DIRECTORY_ITERATOR,E_NOT_A_DIRECTORY);
+
+      _set.getDirectory(dir);
+      newIterator=new ExFatDirectoryIterator(_fs,dir);
+      return true;
+    }
+
+
+    /**
+     * exFAT has no "." entry
+     * @return false
+     */
+
+    bool ExFatDirectoryIterator::isCurrentDirectory() {
+      return false;
+    }
+
+
+    /**
+     * exFAT has no ".." entry
+     * @return false
+     */
+
+    bool ExFatDirectoryIterator::isParentDirectory() {
+      return false;
+    }
+
+
+    /**
+     * @copydoc DirectoryIterator::moveTo
+     */
+
+    bool ExFatDirectoryIterator::moveTo(const char *filename) {
+
+      while(next()) {
+
+        if(!strcasecmp(getFilename(),filename))
+          return true;
+      }
+
+      // not found
+
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_DIRECTORY_ITERATOR,E_ENTRY_NOT_FOUND);
+    }
+
+
+    /**
+     * @copydoc DirectoryIterator::openFile
+     */
+
+    bool ExFatDirectoryIterator::openFile(File*& newFile) {
+
+      if(_set.isDirectory())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,ExFatFileSystem::E_NOT_A_FILE);
+
+      newFile=new ExFatFile(_fs,_set);
+      return true;
+    }
+  }
+}
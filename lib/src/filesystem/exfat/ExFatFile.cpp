@@ -0,0 +1,420 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * Constructor.
+     * @param[in] fs The file system.
+     * @param[in] set The entry set that describes this file.
+     */
+
+    ExFatFile::ExFatFile(ExFatFileSystem& fs,const ExFatEntrySet& set) :
+      _fs(fs),
+      _set(set),
+      _sectorBuffer(fs.getSectorSizeInBytes()),
+      _cluster(0),
+      _clusterIndex(0),
+      _nextOpen(nullptr),
+      _writer(false) {
+
+      _fs.fileOpened(*this);
+    }
+
+
+    /**
+     * Destructor. Unregister from the file system, releasing the write lock if we have it.
+     */
+
+    ExFatFile::~ExFatFile() {
+      _fs.fileClosed(*this);
+    }
+
+
+    /*
+     * Another handle on this file has written to it. Take a copy of the new entry set and
+     * forget the cached cluster if the allocation has been restarted.
+     */
+
+    void ExFatFile::entrySetUpdated(const ExFatEntrySet& set) {
+
+      if(set.stream.FirstCluster!=_set.stream.FirstCluster)
+        _cluster=0;
+
+      _set.file=set.file;         // struct copy
+      _set.stream=set.stream;
+    }
+
+
+    /*
+     * Get the number of clusters allocated to the file
+     */
+
+    uint32_t ExFatFile::getAllocatedClusters() const {
+
+      uint32_t clusterSize;
+
+      clusterSize=_fs.getClusterSizeInBytes();
+      return static_cast<uint32_t>((_set.stream.DataLength+clusterSize-1)/clusterSize);
+    }
+
+
+    /*
+     * Get the cluster number of a cluster within the file. This is arithmetic for a
+     * contiguous file. A FAT chained file is walked from the last cluster looked up, so
+     * sequential access reads each FAT entry once.
+     */
+
+    bool ExFatFile::getCluster(uint32_t clusterIndex,uint32_t& cluster) {
+
+      uint32_t next;
+
+      if(_set.isContiguous()) {
+        cluster=_set.stream.FirstCluster+clusterIndex;
+        return true;
+      }
+
+      if(_cluster==0 || _clusterIndex>clusterIndex) {
+        _cluster=_set.stream.FirstCluster;
+        _clusterIndex=0;
+      }
+
+      while(_clusterIndex<clusterIndex) {
+
+        if(!_fs.readFatEntry(_cluster,next))
+          return false;
+
+        if(!_fs.isValidCluster(next))
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,E_BAD_CLUSTER);
+
+        _cluster=next;
+        _clusterIndex++;
+      }
+
+      if(!_fs.isValidCluster(_cluster))
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,E_BAD_CLUSTER);
+
+      cluster=_cluster;
+      return true;
+    }
+
+
+    /*
+     * Get the sector that holds a file offset and the number of consecutive sectors from
+     * there, up to maxSectors, that can be transferred in one operation.
+     */
+
+    bool ExFatFile::getSectorRun(uint32_t offset,uint32_t maxSectors,uint32_t& sectorIndex,uint32_t& count) {
+
+      uint32_t clusterSize,sectorsPerCluster,clusterIndex,sectorInCluster,cluster,next,available;
+
+      clusterSize=_fs.getClusterSizeInBytes();
+      sectorsPerCluster=_fs.getSectorsPerCluster();
+      clusterIndex=offset/clusterSize;
+      sectorInCluster=(offset % clusterSize)/_fs.getSectorSizeInBytes();
+
+      if(!getCluster(clusterIndex,cluster))
+        return false;
+
+      sectorIndex=_fs.clusterToSector(cluster)+sectorInCluster;
+
+      if(_set.isContiguous()) {
+
+        // the run extends to the end of the allocation
+
+        available=(getAllocatedClusters()-clusterIndex)*sectorsPerCluster-sectorInCluster;
+        count=maxSectors<available ? maxSectors : available;
+        return true;
+      }
+
+      // extend the run through the chain while the clusters are consecutive
+
+      available=sectorsPerCluster-sectorInCluster;
+      count=maxSectors<available ? maxSectors : available;
+
+      while(count<maxSectors) {
+
+        if(!_fs.readFatEntry(_cluster,next))
+          return false;
+
+        if(next!=_cluster+1)
+          break;
+
+        _cluster=next;
+        _clusterIndex++;
+
+        available=maxSectors-count;
+        count+=sectorsPerCluster<available ? sectorsPerCluster : available;
+      }
+
+      return true;
+    }
+
+
+    /**
+     * @copydoc File::read
+     */
+
+    bool ExFatFile::read(void *ptr,uint32_t size,uint32_t& actuallyRead) {
+
+      uint32_t sectorSize,fileLength,validLength,sectorOffset,amount,sectorIndex,count;
+      uint8_t *current;
+
+      sectorSize=_fs.getSectorSizeInBytes();
+      fileLength=getLength();
+
+      // early fail for zero length file
+
+      if(fileLength==0)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,E_END_OF_FILE);
+
+      // data after the valid data length has never been written and reads as zero
+
+      validLength=_set.stream.ValidDataLength<fileLength ? static_cast<uint32_t>(_set.stream.ValidDataLength) : fileLength;
+
+      current=static_cast<uint8_t *>(ptr);
+      actuallyRead=0;
+
+      while(size>0 && _offset<fileLength) {
+
+        sectorOffset=_offset % sectorSize;
+
+        if(_offset>=validLength) {
+
+          amount=fileLength-_offset;
+          if(amount>size)
+            amount=size;
+
+          memset(current,0,amount);
+        }
+        else if(sectorOffset==0 && size>=sectorSize && validLength-_offset>=sectorSize) {
+
+          // whole sectors go straight into the caller's buffer
+
+          amount=validLength-_offset;
+          if(amount>size)
+            amount=size;
+
+          if(!getSectorRun(_offset,amount/sectorSize,sectorIndex,count) || !_fs.readSectors(sectorIndex,current,count))
+            return false;
+
+          amount=count*sectorSize;
+        }
+        else {
+
+          // part of a sector
+
+          if(!getSectorRun(_offset,1,sectorIndex,count) || !_fs.readSector(sectorIndex,_sectorBuffer))
+            return false;
+
+          amount=sectorSize-sectorOffset;
+          if(amount>size)
+            amount=size;
+          if(amount>validLength-_offset)
+            amount=validLength-_offset;
+
+          memcpy(current,_sectorBuffer+sectorOffset,amount);
+        }
+
+        current+=amount;
+        size-=amount;
+        _offset+=amount;
+        actuallyRead+=amount;
+      }
+
+      return true;
+    }
+
+
+    /*
+     * Write data to allocated clusters. Whole sectors are written directly from the caller's
+     * buffer. A null ptr writes zeros.
+     */
+
+    bool ExFatFile::writeData(const uint8_t *ptr,uint32_t offset,uint32_t size) {
+
+      uint32_t sectorSize,sectorOffset,amount,sectorIndex,count;
+
+      sectorSize=_fs.getSectorSizeInBytes();
+
+      while(size>0) {
+
+        sectorOffset=offset % sectorSize;
+
+        if(sectorOffset==0 && size>=sectorSize && ptr!=nullptr) {
+
+          if(!getSectorRun(offset,size/sectorSize,sectorIndex,count)
+              || !_fs.writeSectors(sectorIndex,const_cast<uint8_t *>(ptr),count))
+            return false;
+
+          amount=count*sectorSize;
+        }
+        else {
+
+          amount=sectorSize-sectorOffset;
+          if(amount>size)
+            amount=size;
+
+          if(!getSectorRun(offset,1,sectorIndex,count))
+            return false;
+
+          // the existing content only matters if some of the sector has been written before
+
+          if(amount<sectorSize) {
+
+            if(offset-sectorOffset<_set.stream.ValidDataLength) {
+              if(!_fs.readSector(sectorIndex,_sectorBuffer))
+                return false;
+            }
+            else
+              memset(_sectorBuffer,0,sectorSize);
+          }
+
+          if(ptr)
+            memcpy(_sectorBuffer+sectorOffset,ptr,amount);
+          else
+            memset(_sectorBuffer+sectorOffset,0,amount);
+
+          if(!_fs.writeSector(sectorIndex,_sectorBuffer))
+            return false;
+        }
+
+        offset+=amount;
+        size-=amount;
+
+        if(ptr)
+          ptr+=amount;
+      }
+
+      return true;
+    }
+
+
+    /**
+     * @copydoc File::write
+     */
+
+    bool ExFatFile::write(const void *ptr,uint32_t size) {
+
+      uint64_t end;
+      uint32_t clusterSize,allocated,needed,lastCluster,firstNewCluster;
+      uint16_t d,t;
+
+      // only one handle may write to a file
+
+      if(!_writer && !_fs.claimWriter(*this))
+        return false;
+
+      if(size==0)
+        return true;
+
+      end=static_cast<uint64_t>(_offset)+size;
+
+      if(end>0xFFFFFFFF)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,E_INVALID_FILE_POSITION);
+
+      // allocate all the clusters needed for this write up front so that the
+      // data can go out in as few multi-sector writes as possible
+
+      clusterSize=_fs.getClusterSizeInBytes();
+      allocated=getAllocatedClusters();
+      needed=static_cast<uint32_t>((end+clusterSize-1)/clusterSize);
+
+      if(needed>allocated) {
+
+        lastCluster=0;
+
+        if(allocated>0 && !getCluster(allocated-1,lastCluster))
+          return false;
+
+        if(!_fs.allocateClusters(_set,lastCluster,needed-allocated,firstNewCluster))
+          return false;
+      }
+
+      if(end>_set.stream.DataLength)
+        _set.stream.DataLength=end;
+
+      // a seek past the valid data leaves a gap that must be zeroed
+
+      if(_offset>_set.stream.ValidDataLength) {
+
+        if(!writeData(nullptr,static_cast<uint32_t>(_set.stream.ValidDataLength),_offset-static_cast<uint32_t>(_set.stream.ValidDataLength)))
+          return false;
+
+        _set.stream.ValidDataLength=_offset;
+      }
+
+      if(!writeData(static_cast<const uint8_t *>(ptr),_offset,size))
+        return false;
+
+      _offset+=size;
+
+      if(_offset>_set.stream.ValidDataLength)
+        _set.stream.ValidDataLength=_offset;
+
+      // set the last modified time and write back the entry set
+
+      fat::DirectoryEntryIterator::calculateFatDateTime(_fs.getTimeProvider().getTime(),d,t);
+      _set.file.LastModifiedTimestamp=(static_cast<uint32_t>(d) << 16) | t;
+      _set.file.FileAttributes|=FileInformation::ATTR_ARCHIVE;
+
+      if(!_fs.writeEntrySet(_set))
+        return false;
+
+      _fs.entrySetUpdated(*this);
+      return true;
+    }
+
+
+    /**
+     * @copydoc File::seek
+     */
+
+    bool ExFatFile::seek(int32_t offset,SeekFrom origin) {
+
+      uint32_t newOffset;
+
+      switch(origin) {
+
+        case SeekCurrent:
+          newOffset=_offset+offset;
+          break;
+
+        case SeekEnd:
+          newOffset=getLength()-1+offset;
+          break;
+
+        case SeekStart:
+        default:
+          newOffset=offset;
+          break;
+      }
+
+      // validate (one past the end is a valid "position"). The cluster is found
+      // when it's needed so seeking does not walk the FAT.
+
+      if(newOffset>getLength())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,E_INVALID_FILE_POSITION);
+
+      _offset=newOffset;
+      return true;
+    }
+
+
+    /**
+     * @copydoc File::getLength
+     */
+
+    uint32_t ExFatFile::getLength() {
+      return _set.stream.DataLength>0xFFFFFFFF ? 0xFFFFFFFF : static_cast<uint32_t>(_set.stream.DataLength);
+    }
+  }
+}
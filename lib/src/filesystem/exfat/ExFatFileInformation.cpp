@@ -0,0 +1,94 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * Constructor.
+     * @param[in] set The entry set of the file or directory.
+     */
+
+    ExFatFileInformation::ExFatFileInformation(const ExFatEntrySet& set) {
+      assign(set);
+    }
+
+
+    /*
+     * Take the information from an entry set. exFAT timestamps hold the FAT date in the
+     * high word and the FAT time in the low word.
+     */
+
+    void ExFatFileInformation::assign(const ExFatEntrySet& set) {
+
+      _attributes=set.file.FileAttributes;
+      _length=set.stream.DataLength>0xFFFFFFFF ? 0xFFFFFFFF : static_cast<uint32_t>(set.stream.DataLength);
+      strcpy(_filename,set.name);
+
+      fat::DirectoryEntryIterator::calculateUnixTime(set.file.CreateTimestamp >> 16,set.file.CreateTimestamp & 0xFFFF,_creationDate);
+      fat::DirectoryEntryIterator::calculateUnixTime(set.file.LastModifiedTimestamp >> 16,set.file.LastModifiedTimestamp & 0xFFFF,_lastWriteDateTime);
+      fat::DirectoryEntryIterator::calculateUnixTime(set.file.LastAccessedTimestamp >> 16,set.file.LastAccessedTimestamp & 0xFFFF,_lastAccessDateTime);
+    }
+
+
+    /**
+     * @copydoc FileInformation::getAttributes
+     */
+
+    uint32_t ExFatFileInformation::getAttributes() const {
+      return _attributes;
+    }
+
+
+    /**
+     * @copydoc FileInformation::getFilename
+     */
+
+    const char *ExFatFileInformation::getFilename() const {
+      return _filename;
+    }
+
+
+    /**
+     * @copydoc FileInformation::getCreationDateTime
+     */
+
+    time_t ExFatFileInformation::getCreationDateTime() const {
+      return _creationDate;
+    }
+
+
+    /**
+     * @copydoc FileInformation::getLastWriteDateTime
+     */
+
+    time_t ExFatFileInformation::getLastWriteDateTime() const {
+      return _lastWriteDateTime;
+    }
+
+
+    /**
+     * @copydoc FileInformation::getLastAccessDateTime
+     */
+
+    time_t ExFatFileInformation::getLastAccessDateTime() const {
+      return _lastAccessDateTime;
+    }
+
+
+    /**
+     * @copydoc FileInformation::getLength
+     */
+
+    uint32_t ExFatFileInformation::getLength() const {
+      return _length;
+    }
+  }
+}
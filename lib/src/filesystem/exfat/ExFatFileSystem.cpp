@@ -0,0 +1,1561 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /*
+     * Constructor
+     */
+
+    ExFatFileSystem::ExFatFileSystem(BlockDevice& blockDevice,const TimeProvider& timeProvider,const ExFatBootSector& bootSector,uint32_t firstSectorIndex) :
+      FileSystem(blockDevice,timeProvider,firstSectorIndex),
+      _fatSector(1 << bootSector.BytesPerSectorShift),
+      _bitmapSector(1 << bootSector.BytesPerSectorShift),
+      _directorySector(1 << bootSector.BytesPerSectorShift) {
+
+      _fatOffset=bootSector.FatOffset;
+      _clusterHeapOffset=bootSector.ClusterHeapOffset;
+      _clusterCount=bootSector.ClusterCount;
+      _rootCluster=bootSector.FirstClusterOfRootDirectory;
+      _sectorShift=bootSector.BytesPerSectorShift;
+      _sectorSize=1 << _sectorShift;
+      _clusterShift=bootSector.SectorsPerClusterShift;
+      _sectorsPerBlock=blockDevice.getBlockSizeInBytes() / _sectorSize;
+
+      _bitmapFirstSector=0;
+      _bitmapLength=0;
+      _fatSectorIndex=NO_SECTOR;
+      _bitmapSectorIndex=NO_SECTOR;
+      _directorySectorIndex=NO_SECTOR;
+      _directorySectorDirty=false;
+      _nextFreeCluster=2;
+      _openFiles=nullptr;
+    }
+
+
+    /**
+     * Destructor. Write back the cached directory sector.
+     */
+
+    ExFatFileSystem::~ExFatFileSystem() {
+      flushDirectory();
+    }
+
+
+    /**
+     * Get an exFAT file system for the block device. The volume may start at sector zero or
+     * be the first partition in an MBR.
+     *
+     * @param[in] blockDevice The block device that holds the file system.
+     * @param[in] timeProvider A provider of the current time for timestamping changes.
+     * @param[out] newFileSystem The new file system. The caller owns this pointer and must delete it when finished.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,ExFatFileSystem*& newFileSystem) {
+
+      ByteMemblock bootSectorBytes(blockDevice.getBlockSizeInBytes());
+
+      if(!blockDevice.readBlock(bootSectorBytes,0))
+        return false;
+
+      if(bootSectorBytes[510]!=0x55 || bootSectorBytes[511]!=0xaa)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_UNSUPPORTED_VOLUME);
+
+      // if it's not an exFAT boot sector then it's an MBR, use the first partition
+
+      if(memcmp(reinterpret_cast<ExFatBootSector *>(bootSectorBytes.getData())->FileSystemName,"EXFAT   ",8)!=0)
+        return getInstance(blockDevice,timeProvider,reinterpret_cast<Mbr *>(bootSectorBytes.getData())->partitions[0].lbaFirstSector,newFileSystem);
+
+      return getInstance(blockDevice,timeProvider,0,newFileSystem);
+    }
+
+
+    /**
+     * Get an exFAT file system for the volume whose boot sector is at the given index.
+     * The boot region checksum is verified.
+     *
+     * @param[in] blockDevice The block device that holds the file system.
+     * @param[in] timeProvider A provider of the current time for timestamping changes.
+     * @param[in] firstSectorIndex The block index of the boot sector, e.g. the first sector of an MBR partition.
+     * @param[out] newFileSystem The new file system. The caller owns this pointer and must delete it when finished.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,uint32_t firstSectorIndex,ExFatFileSystem*& newFileSystem) {
+
+      ByteMemblock sector(blockDevice.getBlockSizeInBytes());
+      ExFatBootSector bs;
+      uint32_t i,checksum;
+
+      if(!blockDevice.readBlock(sector,firstSectorIndex))
+        return false;
+
+      memcpy(&bs,sector,sizeof(bs));
+
+      // check that this is a volume we can handle
+
+      if(memcmp(bs.FileSystemName,"EXFAT   ",8)!=0
+          || bs.BootSignature!=0xaa55
+          || (bs.FileSystemRevision >> 8)!=1
+          || bs.BytesPerSectorShift<9 || bs.BytesPerSectorShift>12
+          || (1U << bs.BytesPerSectorShift)!=blockDevice.getBlockSizeInBytes()
+          || bs.BytesPerSectorShift+bs.SectorsPerClusterShift>25
+          || bs.NumberOfFats!=1
+          || bs.ClusterCount==0
+          || bs.FirstClusterOfRootDirectory<2 || bs.FirstClusterOfRootDirectory>=bs.ClusterCount+2)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_UNSUPPORTED_VOLUME);
+
+      // verify the checksum of sectors 0..10 against the repeated value in sector 11
+
+      checksum=calculateBootChecksum(sector,blockDevice.getBlockSizeInBytes(),0,0);
+
+      for(i=1;i<11;i++) {
+        if(!blockDevice.readBlock(sector,firstSectorIndex+i))
+          return false;
+
+        checksum=calculateBootChecksum(sector,blockDevice.getBlockSizeInBytes(),i,checksum);
+      }
+
+      if(!blockDevice.readBlock(sector,firstSectorIndex+11))
+        return false;
+
+      if(*reinterpret_cast<uint32_t *>(sector.getData())!=checksum)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_BAD_CHECKSUM);
+
+      // create and find the allocation bitmap
+
+      newFileSystem=new ExFatFileSystem(blockDevice,timeProvider,bs,firstSectorIndex);
+
+      if(!newFileSystem->initialise()) {
+        delete newFileSystem;
+        return false;
+      }
+
+      return true;
+    }
+
+
+    /*
+     * Find the allocation bitmap in the root directory
+     */
+
+    bool ExFatFileSystem::initialise() {
+
+      ExFatDirectory root;
+      ExFatDirectoryEntry entry;
+      uint32_t index;
+
+      getRootDirectory(root);
+
+      for(index=0;;index++) {
+
+        if(!readEntry(root,index,entry))
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_UNSUPPORTED_VOLUME);
+
+        if(entry.EntryType==ExFatDirectoryEntry::TYPE_END_OF_DIRECTORY)
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_UNSUPPORTED_VOLUME);
+
+        if(entry.EntryType==ExFatDirectoryEntry::TYPE_BITMAP && (entry.Bitmap.BitmapFlags & 1)==0)
+          break;
+      }
+
+      if(!isValidCluster(entry.Bitmap.FirstCluster) || entry.Bitmap.DataLength<(_clusterCount+7)/8)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_UNSUPPORTED_VOLUME);
+
+      _bitmapFirstSector=clusterToSector(entry.Bitmap.FirstCluster);
+      _bitmapLength=static_cast<uint32_t>(entry.Bitmap.DataLength);
+
+      return true;
+    }
+
+
+    /**
+     * @copydoc FileSystem::getFileSystemType
+     */
+
+    FileSystem::FileSystemType ExFatFileSystem::getFileSystemType() const {
+      return ExFat;
+    }
+
+
+    /**
+     * @copydoc FileSystem::getSectorSizeInBytes
+     */
+
+    uint32_t ExFatFileSystem::getSectorSizeInBytes() const {
+      return _sectorSize;
+    }
+
+
+    /**
+     * Get the free space. The allocation bitmap is counted so this reads ClusterCount/8 bytes.
+     * @param[out] freeUnits The number of free clusters.
+     * @param[out] unitsMultiplier The cluster size in bytes.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::getFreeSpace(uint32_t& freeUnits,uint32_t& unitsMultiplier) {
+
+      uint32_t sectorIndex,i,clusters,used;
+      const uint8_t *ptr;
+
+      used=0;
+      clusters=0;
+
+      for(sectorIndex=0;clusters<_clusterCount;sectorIndex++) {
+
+        if(!loadBitmapSector(sectorIndex))
+          return false;
+
+        ptr=_bitmapSector;
+
+        for(i=0;i<_sectorSize && clusters<_clusterCount;i++) {
+
+          // the last byte may be partly used
+
+          if(_clusterCount-clusters<8) {
+            used+=__builtin_popcount(ptr[i] & ((1 << (_clusterCount-clusters))-1));
+            clusters=_clusterCount;
+          }
+          else {
+            used+=__builtin_popcount(ptr[i]);
+            clusters+=8;
+          }
+        }
+      }
+
+      freeUnits=_clusterCount-used;
+      unitsMultiplier=getClusterSizeInBytes();
+      return true;
+    }
+
+
+    /*
+     * Load a FAT sector into the cache
+     */
+
+    bool ExFatFileSystem::loadFatSector(uint32_t sectorIndex) {
+
+      if(sectorIndex==_fatSectorIndex)
+        return true;
+
+      _fatSectorIndex=NO_SECTOR;
+
+      if(!readSector(_fatOffset+sectorIndex,_fatSector))
+        return false;
+
+      _fatSectorIndex=sectorIndex;
+      return true;
+    }
+
+
+    /*
+     * Load an allocation bitmap sector into the cache
+     */
+
+    bool ExFatFileSystem::loadBitmapSector(uint32_t sectorIndex) {
+
+      if(sectorIndex==_bitmapSectorIndex)
+        return true;
+
+      _bitmapSectorIndex=NO_SECTOR;
+
+      if(!readSector(_bitmapFirstSector+sectorIndex,_bitmapSector))
+        return false;
+
+      _bitmapSectorIndex=sectorIndex;
+      return true;
+    }
+
+
+    /*
+     * Load a directory sector into the cache, writing back the one that's there if it was modified
+     */
+
+    bool ExFatFileSystem::loadDirectorySector(uint32_t sectorIndex) {
+
+      if(sectorIndex==_directorySectorIndex)
+        return true;
+
+      if(!flushDirectory())
+        return false;
+
+      _directorySectorIndex=NO_SECTOR;
+
+      if(!readSector(sectorIndex,_directorySector))
+        return false;
+
+      _directorySectorIndex=sectorIndex;
+      return true;
+    }
+
+
+    /**
+     * Write back the cached directory sector if it has been modified
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::flushDirectory() {
+
+      if(!_directorySectorDirty)
+        return true;
+
+      if(!writeSector(_directorySectorIndex,_directorySector))
+        return false;
+
+      _directorySectorDirty=false;
+      return true;
+    }
+
+
+    /**
+     * Read a FAT entry. The FAT is only meaningful for clusters that are not part of a
+     * NoFatChain allocation.
+     * @param[in] cluster The cluster number.
+     * @param[out] next The next cluster in the chain or the end of chain marker.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::readFatEntry(uint32_t cluster,uint32_t& next) {
+
+      uint32_t offset;
+
+      offset=cluster*4;
+
+      if(!loadFatSector(offset >> _sectorShift))
+        return false;
+
+      next=*reinterpret_cast<uint32_t *>(_fatSector.getData()+(offset & (_sectorSize-1)));
+      return true;
+    }
+
+
+    /**
+     * Write a FAT entry
+     * @param[in] cluster The cluster number.
+     * @param[in] next The new content.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::writeFatEntry(uint32_t cluster,uint32_t next) {
+
+      uint32_t offset;
+
+      offset=cluster*4;
+
+      if(!loadFatSector(offset >> _sectorShift))
+        return false;
+
+      *reinterpret_cast<uint32_t *>(_fatSector.getData()+(offset & (_sectorSize-1)))=next;
+      return writeSector(_fatOffset+_fatSectorIndex,_fatSector);
+    }
+
+
+    /*
+     * Chain a run of consecutive clusters together and terminate it. Each FAT sector is
+     * written once.
+     */
+
+    bool ExFatFileSystem::writeFatRun(uint32_t firstCluster,uint32_t count) {
+
+      uint32_t i,offset;
+
+      for(i=0;i<count;i++) {
+
+        offset=(firstCluster+i)*4;
+
+        if((offset >> _sectorShift)!=_fatSectorIndex) {
+
+          if(i>0 && !writeSector(_fatOffset+_fatSectorIndex,_fatSector))
+            return false;
+
+          if(!loadFatSector(offset >> _sectorShift))
+            return false;
+        }
+
+        *reinterpret_cast<uint32_t *>(_fatSector.getData()+(offset & (_sectorSize-1)))=i==count-1 ? END_OF_CHAIN : firstCluster+i+1;
+      }
+
+      return count==0 || writeSector(_fatOffset+_fatSectorIndex,_fatSector);
+    }
+
+
+    /*
+     * Set or clear a run of bits in the allocation bitmap. Each bitmap sector is written once.
+     */
+
+    bool ExFatFileSystem::setClustersAllocated(uint32_t firstCluster,uint32_t count,bool allocated) {
+
+      uint32_t bit,i;
+      uint8_t mask;
+
+      for(i=0;i<count;i++) {
+
+        bit=firstCluster+i-2;
+
+        if((bit >> (_sectorShift+3))!=_bitmapSectorIndex) {
+
+          if(i>0 && !writeSector(_bitmapFirstSector+_bitmapSectorIndex,_bitmapSector))
+            return false;
+
+          if(!loadBitmapSector(bit >> (_sectorShift+3)))
+            return false;
+        }
+
+        mask=1 << (bit & 7);
+
+        if(allocated)
+          _bitmapSector[(bit >> 3) & (_sectorSize-1)]|=mask;
+        else
+          _bitmapSector[(bit >> 3) & (_sectorSize-1)]&=~mask;
+      }
+
+      return count==0 || writeSector(_bitmapFirstSector+_bitmapSectorIndex,_bitmapSector);
+    }
+
+
+    /**
+     * Find a run of free clusters in the allocation bitmap. The search starts after the last
+     * allocation and wraps around. Fully allocated bytes of the bitmap are skipped.
+     * @param[in] wanted The maximum number of clusters wanted.
+     * @param[out] firstCluster The first free cluster.
+     * @param[out] count The length of the run, from 1 to wanted.
+     * @return false if it fails or the volume is full.
+     */
+
+    bool ExFatFileSystem::findFreeClusters(uint32_t wanted,uint32_t& firstCluster,uint32_t& count) {
+
+      uint32_t cluster,bit,scanned;
+      uint8_t b;
+
+      cluster=isValidCluster(_nextFreeCluster) ? _nextFreeCluster : 2;
+
+      for(scanned=0;;) {
+
+        if(scanned>=_clusterCount)
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_VOLUME_FULL);
+
+        bit=cluster-2;
+
+        if(!loadBitmapSector(bit >> (_sectorShift+3)))
+          return false;
+
+        b=_bitmapSector[(bit >> 3) & (_sectorSize-1)];
+
+        if((bit & 7)==0 && b==0xff) {
+          cluster+=8;
+          scanned+=8;
+        }
+        else if((b & (1 << (bit & 7)))==0)
+          break;
+        else {
+          cluster++;
+          scanned++;
+        }
+
+        if(cluster>=_clusterCount+2)
+          cluster=2;
+      }
+
+      // extend the run
+
+      firstCluster=cluster;
+
+      for(count=1;count<wanted && isValidCluster(cluster+count);count++) {
+
+        bit=cluster+count-2;
+
+        if(!loadBitmapSector(bit >> (_sectorShift+3)))
+          return false;
+
+        if(_bitmapSector[(bit >> 3) & (_sectorSize-1)] & (1 << (bit & 7)))
+          break;
+      }
+
+      return true;
+    }
+
+
+    /**
+     * Check if a run of clusters is entirely free
+     * @param[in] firstCluster The first cluster.
+     * @param[in] count The number of clusters.
+     * @param[out] isFree true if they're all free and inside the cluster heap.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::areClustersFree(uint32_t firstCluster,uint32_t count,bool& isFree) {
+
+      uint32_t i,bit;
+
+      isFree=false;
+
+      if(!isValidCluster(firstCluster) || !isValidCluster(firstCluster+count-1))
+        return true;
+
+      for(i=0;i<count;i++) {
+
+        bit=firstCluster+i-2;
+
+        if(!loadBitmapSector(bit >> (_sectorShift+3)))
+          return false;
+
+        if(_bitmapSector[(bit >> 3) & (_sectorSize-1)] & (1 << (bit & 7)))
+          return true;
+      }
+
+      isFree=true;
+      return true;
+    }
+
+
+    /**
+     * Add clusters to the end of a file's allocation. The allocation stays contiguous
+     * (NoFatChain) if the clusters after its end are free. Otherwise the existing clusters
+     * are written to the FAT and the file becomes a normal FAT chain. The stream extension
+     * in the set is updated in memory but the caller must write it and the new DataLength.
+     *
+     * @param[in,out] set The entry set for the file.
+     * @param[in] lastCluster The current last cluster, or zero if there are none.
+     * @param[in] count The number of clusters to add.
+     * @param[out] firstNewCluster The first of the new clusters.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::allocateClusters(ExFatEntrySet& set,uint32_t lastCluster,uint32_t count,uint32_t& firstNewCluster) {
+
+      uint32_t first,n;
+      bool isFree;
+
+      firstNewCluster=0;
+
+      // an empty file gets the first free run and is contiguous to start with
+
+      if(set.stream.FirstCluster==0) {
+
+        if(!findFreeClusters(count,first,n) || !setClustersAllocated(first,n,true))
+          return false;
+
+        set.stream.FirstCluster=first;
+        set.stream.GeneralSecondaryFlags|=ExFatDirectoryEntry::FLAG_ALLOCATION_POSSIBLE | ExFatDirectoryEntry::FLAG_NO_FAT_CHAIN;
+
+        firstNewCluster=first;
+        lastCluster=first+n-1;
+        count-=n;
+        _nextFreeCluster=lastCluster+1;
+      }
+
+      while(count) {
+
+        if(set.isContiguous()) {
+
+          // can it grow in place?
+
+          if(!areClustersFree(lastCluster+1,count,isFree))
+            return false;
+
+          if(isFree) {
+
+            if(!setClustersAllocated(lastCluster+1,count,true))
+              return false;
+
+            if(firstNewCluster==0)
+              firstNewCluster=lastCluster+1;
+
+            _nextFreeCluster=lastCluster+count+1;
+            return true;
+          }
+
+          // no: the existing clusters must be described by the FAT from now on
+
+          if(!writeFatRun(set.stream.FirstCluster,lastCluster-set.stream.FirstCluster+1))
+            return false;
+
+          set.stream.GeneralSecondaryFlags&=~ExFatDirectoryEntry::FLAG_NO_FAT_CHAIN;
+        }
+
+        // allocate a run as close as possible to the end of the chain and link it in.
+        // The bitmap is updated first so that a power loss leaks clusters rather than cross linking them.
+
+        _nextFreeCluster=lastCluster+1;
+
+        if(!findFreeClusters(count,first,n)
+            || !setClustersAllocated(first,n,true)
+            || !writeFatRun(first,n)
+            || !writeFatEntry(lastCluster,first))
+          return false;
+
+        if(firstNewCluster==0)
+          firstNewCluster=first;
+
+        lastCluster=first+n-1;
+        count-=n;
+        _nextFreeCluster=lastCluster+1;
+      }
+
+      return true;
+    }
+
+
+    /**
+     * Free the clusters allocated to a file or directory
+     * @param[in] firstCluster The first cluster.
+     * @param[in] clusterCount The number of clusters allocated.
+     * @param[in] contiguous true if NoFatChain is set.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::freeClusters(uint32_t firstCluster,uint32_t clusterCount,bool contiguous) {
+
+      uint32_t cluster,next,runStart,runLength,i;
+
+      if(!isValidCluster(firstCluster) || clusterCount==0)
+        return true;
+
+      if(contiguous)
+        return setClustersAllocated(firstCluster,clusterCount,false);
+
+      // follow the chain, freeing runs of consecutive clusters together
+
+      runStart=cluster=firstCluster;
+      runLength=0;
+
+      for(i=0;i<clusterCount;i++) {
+
+        if(!readFatEntry(cluster,next))
+          return false;
+
+        runLength++;
+
+        if(next!=cluster+1 || i==clusterCount-1) {
+
+          if(!setClustersAllocated(runStart,runLength,false))
+            return false;
+
+          if(!isValidCluster(next))
+            break;
+
+          runStart=next;
+          runLength=0;
+        }
+
+        cluster=next;
+      }
+
+      return true;
+    }
+
+
+    /*
+     * Fill a cluster with zeros
+     */
+
+    bool ExFatFileSystem::zeroCluster(uint32_t cluster) {
+
+      ByteMemblock zeros(_sectorSize);
+      uint32_t i,sectorIndex;
+
+      memset(zeros,0,_sectorSize);
+      sectorIndex=clusterToSector(cluster);
+
+      for(i=0;i<getSectorsPerCluster();i++) {
+
+        if(!writeSector(sectorIndex+i,zeros))
+          return false;
+
+        // don't leave a stale copy in the directory cache
+
+        if(sectorIndex+i==_directorySectorIndex) {
+          _directorySectorIndex=NO_SECTOR;
+          _directorySectorDirty=false;
+        }
+      }
+
+      return true;
+    }
+
+
+    /*
+     * Find the sector and byte offset of a directory entry. Sets the iterator end-of-entries
+     * error if the index is past the end of the directory's allocation.
+     */
+
+    bool ExFatFileSystem::locateEntry(ExFatDirectory& dir,uint32_t index,uint32_t& sectorIndex,uint32_t& offset) {
+
+      uint32_t byteOffset,clusterIndex,cluster,next;
+
+      byteOffset=index*sizeof(ExFatDirectoryEntry);
+      clusterIndex=byteOffset >> (_sectorShift+_clusterShift);
+
+      if(!isValidCluster(dir.firstCluster) || (dir.length && byteOffset>=dir.length))
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_ITERATOR,Iterator<const FileInformation&>::E_END_OF_ENTRIES);
+
+      if(dir.contiguous)
+        cluster=dir.firstCluster+clusterIndex;
+      else {
+
+        // walk forward from the cached position if we can
+
+        if(dir.cachedCluster==0 || dir.cachedClusterIndex>clusterIndex) {
+          dir.cachedCluster=dir.firstCluster;
+          dir.cachedClusterIndex=0;
+        }
+
+        while(dir.cachedClusterIndex<clusterIndex) {
+
+          if(!readFatEntry(dir.cachedCluster,next))
+            return false;
+
+          if(!isValidCluster(next))
+            return errorProvider.set(ErrorProvider::ERROR_PROVIDER_ITERATOR,Iterator<const FileInformation&>::E_END_OF_ENTRIES);
+
+          dir.cachedCluster=next;
+          dir.cachedClusterIndex++;
+        }
+
+        cluster=dir.cachedCluster;
+      }
+
+      sectorIndex=clusterToSector(cluster)+((byteOffset >> _sectorShift) & (getSectorsPerCluster()-1));
+      offset=byteOffset & (_sectorSize-1);
+      return true;
+    }
+
+
+    /**
+     * Read a directory entry
+     * @param[in,out] dir The directory.
+     * @param[in] index The index of the entry.
+     * @param[out] entry The entry.
+     * @return false if it fails or the index is past the end of the directory.
+     */
+
+    bool ExFatFileSystem::readEntry(ExFatDirectory& dir,uint32_t index,ExFatDirectoryEntry& entry) {
+
+      uint32_t sectorIndex,offset;
+
+      if(!locateEntry(dir,index,sectorIndex,offset) || !loadDirectorySector(sectorIndex))
+        return false;
+
+      memcpy(&entry,_directorySector.getData()+offset,sizeof(entry));
+      return true;
+    }
+
+
+    /**
+     * Write a directory entry. The change is cached until flushDirectory() is called or
+     * another directory sector is needed.
+     * @param[in,out] dir The directory.
+     * @param[in] index The index of the entry.
+     * @param[in] entry The entry.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::writeEntry(ExFatDirectory& dir,uint32_t index,const ExFatDirectoryEntry& entry) {
+
+      uint32_t sectorIndex,offset;
+
+      if(!locateEntry(dir,index,sectorIndex,offset) || !loadDirectorySector(sectorIndex))
+        return false;
+
+      memcpy(_directorySector.getData()+offset,&entry,sizeof(entry));
+      _directorySectorDirty=true;
+      return true;
+    }
+
+
+    /**
+     * Read a file or directory entry set and verify its checksum
+     * @param[in,out] dir The directory.
+     * @param[in] index The index of the file entry.
+     * @param[out] set The entry set.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::readEntrySet(ExFatDirectory& dir,uint32_t index,ExFatEntrySet& set) {
+
+      ExFatDirectoryEntry entry;
+      uint32_t i,j,nameLength;
+      uint16_t checksum,c;
+
+      if(!readEntry(dir,index,entry))
+        return false;
+
+      if(entry.EntryType!=ExFatDirectoryEntry::TYPE_FILE
+          || entry.File.SecondaryCount<2
+          || entry.File.SecondaryCount>ExFatDirectoryEntry::MAX_SECONDARY_COUNT)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_BAD_CHECKSUM);
+
+      set.file=entry.File;
+      checksum=calculateEntryChecksum(entry,true,0);
+      nameLength=0;
+
+      for(i=1;i<=set.file.SecondaryCount;i++) {
+
+        if(!readEntry(dir,index+i,entry))
+          return false;
+
+        checksum=calculateEntryChecksum(entry,false,checksum);
+
+        if(i==1) {
+
+          if(entry.EntryType!=ExFatDirectoryEntry::TYPE_STREAM)
+            return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_BAD_CHECKSUM);
+
+          set.stream=entry.Stream;
+        }
+        else if(entry.EntryType==ExFatDirectoryEntry::TYPE_FILE_NAME) {
+
+          for(j=0;j<ExFatDirectoryEntry::NAME_CHARS_PER_ENTRY && nameLength<set.stream.NameLength;j++) {
+            c=entry.FileName.FileName[j];
+            set.name[nameLength++]=c<0x80 ? c : '?';
+          }
+        }
+      }
+
+      if(checksum!=set.file.SetChecksum)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_BAD_CHECKSUM);
+
+      set.name[nameLength]='\0';
+      set.parent=dir;
+      set.entryIndex=index;
+      return true;
+    }
+
+
+    /**
+     * Write the file and stream extension entries of a set back to the directory with a
+     * recalculated checksum. The name entries are not changed.
+     * @param[in,out] set The entry set.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::writeEntrySet(ExFatEntrySet& set) {
+
+      ExFatDirectoryEntry entry;
+      uint16_t checksum;
+      uint32_t i;
+
+      // file entry
+
+      memcpy(&entry,&set.file,sizeof(entry));
+      checksum=calculateEntryChecksum(entry,true,0);
+
+      // stream extension entry
+
+      memcpy(&entry,&set.stream,sizeof(entry));
+      checksum=calculateEntryChecksum(entry,false,checksum);
+
+      if(!writeEntry(set.parent,set.entryIndex+1,entry))
+        return false;
+
+      // the name entries are included in the checksum
+
+      for(i=2;i<=set.file.SecondaryCount;i++) {
+
+        if(!readEntry(set.parent,set.entryIndex+i,entry))
+          return false;
+
+        checksum=calculateEntryChecksum(entry,false,checksum);
+      }
+
+      set.file.SetChecksum=checksum;
+      memcpy(&entry,&set.file,sizeof(entry));
+
+      return writeEntry(set.parent,set.entryIndex,entry) && flushDirectory();
+    }
+
+
+    /*
+     * Search a directory for a name
+     */
+
+    bool ExFatFileSystem::findInDirectory(ExFatDirectory& dir,const char *name,ExFatEntrySet& set) {
+
+      ExFatDirectoryEntry entry;
+      uint32_t index,nameLength;
+      uint16_t hash;
+
+      hash=calculateNameHash(name);
+      nameLength=strlen(name);
+
+      for(index=0;;) {
+
+        if(!readEntry(dir,index,entry)) {
+
+          if(errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,Iterator<const FileInformation&>::E_END_OF_ENTRIES))
+            break;
+
+          return false;
+        }
+
+        if(entry.EntryType==ExFatDirectoryEntry::TYPE_END_OF_DIRECTORY)
+          break;
+
+        if(entry.EntryType!=ExFatDirectoryEntry::TYPE_FILE) {
+          index++;
+          continue;
+        }
+
+        // the stream extension holds the name hash so most sets are rejected without reading the name
+
+        if(!readEntry(dir,index+1,entry))
+          return false;
+
+        if(entry.EntryType==ExFatDirectoryEntry::TYPE_STREAM
+            && entry.Stream.NameHash==hash
+            && entry.Stream.NameLength==nameLength
+            && readEntrySet(dir,index,set)
+            && strcasecmp(set.name,name)==0)
+          return true;
+
+        // move to the next entry after this set
+
+        if(!readEntry(dir,index,entry))
+          return false;
+
+        index+=1+entry.File.SecondaryCount;
+      }
+
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_NOT_FOUND);
+    }
+
+
+    /*
+     * Find the entry set for the first tokenCount components of a path. isRoot is set if
+     * tokenCount is zero, in which case set is not valid.
+     */
+
+    bool ExFatFileSystem::findEntrySet(const TokenisedPathname& tp,int tokenCount,ExFatEntrySet& set,bool& isRoot) {
+
+      ExFatDirectory dir;
+      int i;
+
+      getRootDirectory(dir);
+      isRoot=tokenCount==0;
+
+      for(i=0;i<tokenCount;i++) {
+
+        if(i>0) {
+
+          if(!set.isDirectory())
+            return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_NOT_A_DIRECTORY);
+
+          set.getDirectory(dir);
+        }
+
+        if(!findInDirectory(dir,tp[i],set))
+          return false;
+      }
+
+      return true;
+    }
+
+
+    /*
+     * Add a cluster to a directory. The root directory is extended through the FAT. Other
+     * directories are extended like files and have their size updated.
+     */
+
+    bool ExFatFileSystem::extendDirectory(ExFatDirectory& dir,ExFatEntrySet *owner) {
+
+      uint32_t last,next,first,count,newCluster;
+
+      if(!flushDirectory())
+        return false;
+
+      if(owner) {
+
+        last=owner->stream.FirstCluster+static_cast<uint32_t>(owner->stream.DataLength >> (_sectorShift+_clusterShift))-1;
+
+        if(!owner->isContiguous()) {
+
+          for(last=owner->stream.FirstCluster;;last=next) {
+
+            if(!readFatEntry(last,next))
+              return false;
+
+            if(!isValidCluster(next))
+              break;
+          }
+        }
+
+        if(!allocateClusters(*owner,last,1,newCluster) || !zeroCluster(newCluster))
+          return false;
+
+        owner->stream.DataLength+=getClusterSizeInBytes();
+        owner->stream.ValidDataLength=owner->stream.DataLength;
+
+        if(!writeEntrySet(*owner))
+          return false;
+
+        owner->getDirectory(dir);
+        return true;
+      }
+
+      // root directory
+
+      for(last=dir.firstCluster;;last=next) {
+
+        if(!readFatEntry(last,next))
+          return false;
+
+        if(!isValidCluster(next))
+          break;
+      }
+
+      _nextFreeCluster=last+1;
+
+      return findFreeClusters(1,first,count)
+          && setClustersAllocated(first,1,true)
+          && zeroCluster(first)
+          && writeFatEntry(first,END_OF_CHAIN)
+          && writeFatEntry(last,first);
+    }
+
+
+    /*
+     * Find a run of unused entries in a directory, extending it if necessary
+     */
+
+    bool ExFatFileSystem::findFreeEntries(ExFatDirectory& dir,ExFatEntrySet *owner,uint32_t count,uint32_t& index) {
+
+      ExFatDirectoryEntry entry;
+      uint32_t i,run;
+
+      for(i=run=0;;i++) {
+
+        if(!readEntry(dir,i,entry)) {
+
+          if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,Iterator<const FileInformation&>::E_END_OF_ENTRIES))
+            return false;
+
+          if(!extendDirectory(dir,owner) || !readEntry(dir,i,entry))
+            return false;
+        }
+
+        if(entry.EntryType & ExFatDirectoryEntry::TYPE_IN_USE)
+          run=0;
+        else if(++run==count) {
+          index=i-count+1;
+          return true;
+        }
+      }
+    }
+
+
+    /*
+     * Create the entry set for a new file or directory
+     */
+
+    bool ExFatFileSystem::createEntrySet(const char *pathname,uint16_t attributes,uint32_t firstCluster,uint32_t length) {
+
+      ExFatEntrySet parent,existing;
+      ExFatDirectory dir;
+      ExFatDirectoryEntry entries[2+(ExFatDirectoryEntry::MAX_NAME_LENGTH+ExFatDirectoryEntry::NAME_CHARS_PER_ENTRY-1)/ExFatDirectoryEntry::NAME_CHARS_PER_ENTRY];
+      const char *name;
+      uint32_t nameLength,count,index,i,timestamp;
+      uint16_t date,time,checksum;
+      bool isRoot;
+
+      TokenisedPathname tp(pathname);
+
+      if(tp.getNumTokens()==0)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,FileSystem::E_INVALID_PATHNAME);
+
+      name=tp[tp.getNumTokens()-1];
+      nameLength=strlen(name);
+
+      if(nameLength==0 || nameLength>ExFatDirectoryEntry::MAX_NAME_LENGTH)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_INVALID_NAME);
+
+      // find the parent directory
+
+      if(!findEntrySet(tp,tp.getNumTokens()-1,parent,isRoot))
+        return false;
+
+      if(isRoot)
+        getRootDirectory(dir);
+      else if(!parent.isDirectory())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_NOT_A_DIRECTORY);
+      else
+        parent.getDirectory(dir);
+
+      // it must not exist
+
+      if(findInDirectory(dir,name,existing))
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,FileSystem::E_FILE_EXISTS);
+
+      if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_NOT_FOUND))
+        return false;
+
+      // build the set
+
+      count=2+(nameLength+ExFatDirectoryEntry::NAME_CHARS_PER_ENTRY-1)/ExFatDirectoryEntry::NAME_CHARS_PER_ENTRY;
+      memset(entries,0,count*sizeof(ExFatDirectoryEntry));
+
+      fat::DirectoryEntryIterator::calculateFatDateTime(_timeProvider.getTime(),date,time);
+      timestamp=(static_cast<uint32_t>(date) << 16) | time;
+
+      entries[0].File.EntryType=ExFatDirectoryEntry::TYPE_FILE;
+      entries[0].File.SecondaryCount=count-1;
+      entries[0].File.FileAttributes=attributes;
+      entries[0].File.CreateTimestamp=timestamp;
+      entries[0].File.LastModifiedTimestamp=timestamp;
+      entries[0].File.LastAccessedTimestamp=timestamp;
+
+      entries[1].Stream.EntryType=ExFatDirectoryEntry::TYPE_STREAM;
+      entries[1].Stream.GeneralSecondaryFlags=ExFatDirectoryEntry::FLAG_ALLOCATION_POSSIBLE;
+      entries[1].Stream.NameLength=nameLength;
+      entries[1].Stream.NameHash=calculateNameHash(name);
+      entries[1].Stream.FirstCluster=firstCluster;
+      entries[1].Stream.DataLength=length;
+      entries[1].Stream.ValidDataLength=length;
+
+      if(firstCluster)
+        entries[1].Stream.GeneralSecondaryFlags|=ExFatDirectoryEntry::FLAG_NO_FAT_CHAIN;
+
+      for(i=0;i<nameLength;i++) {
+        entries[2+i/ExFatDirectoryEntry::NAME_CHARS_PER_ENTRY].FileName.EntryType=ExFatDirectoryEntry::TYPE_FILE_NAME;
+        entries[2+i/ExFatDirectoryEntry::NAME_CHARS_PER_ENTRY].FileName.FileName[i % ExFatDirectoryEntry::NAME_CHARS_PER_ENTRY]=static_cast<uint8_t>(name[i]);
+      }
+
+      for(i=0,checksum=0;i<count;i++)
+        checksum=calculateEntryChecksum(entries[i],i==0,checksum);
+
+      entries[0].File.SetChecksum=checksum;
+
+      // find space and write it. The file entry goes last so the set is only in use once it's complete.
+
+      if(!findFreeEntries(dir,isRoot ? nullptr : &parent,count,index))
+        return false;
+
+      for(i=1;i<count;i++)
+        if(!writeEntry(dir,index+i,entries[i]))
+          return false;
+
+      return writeEntry(dir,index,entries[0]) && flushDirectory();
+    }
+
+
+    /*
+     * Check if a directory contains any files or directories
+     */
+
+    bool ExFatFileSystem::directoryIsEmpty(const ExFatEntrySet& set,bool& isEmpty) {
+
+      ExFatDirectory dir;
+      ExFatDirectoryEntry entry;
+      uint32_t index;
+
+      set.getDirectory(dir);
+      isEmpty=true;
+
+      for(index=0;;index++) {
+
+        if(!readEntry(dir,index,entry))
+          return errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,Iterator<const FileInformation&>::E_END_OF_ENTRIES);
+
+        if(entry.EntryType==ExFatDirectoryEntry::TYPE_END_OF_DIRECTORY)
+          return true;
+
+        if(entry.EntryType==ExFatDirectoryEntry::TYPE_FILE) {
+          isEmpty=false;
+          return true;
+        }
+      }
+    }
+
+
+    /*
+     * Delete a file or an empty directory. The entries are marked unused before the clusters
+     * are freed so that a power loss cannot leave an entry pointing at free clusters.
+     */
+
+    bool ExFatFileSystem::deleteEntrySet(const char *pathname,bool directory) {
+
+      ExFatEntrySet set;
+      ExFatDirectoryEntry entry;
+      uint32_t i,clusters;
+      bool isRoot,isEmpty;
+
+      TokenisedPathname tp(pathname);
+
+      if(tp.getNumTokens()==0)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,FileSystem::E_INVALID_PATHNAME);
+
+      if(!findEntrySet(tp,tp.getNumTokens(),set,isRoot))
+        return false;
+
+      if(directory) {
+
+        if(!set.isDirectory())
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_NOT_A_DIRECTORY);
+
+        if(!directoryIsEmpty(set,isEmpty))
+          return false;
+
+        if(!isEmpty)
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_DIRECTORY_NOT_EMPTY);
+      }
+      else {
+
+        if(set.isDirectory())
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_NOT_A_FILE);
+
+        if(isFileOpen(set))
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,FileSystem::E_FILE_IN_USE);
+      }
+
+      // mark the entries unused
+
+      for(i=0;i<=set.file.SecondaryCount;i++) {
+
+        if(!readEntry(set.parent,set.entryIndex+i,entry))
+          return false;
+
+        entry.EntryType&=~ExFatDirectoryEntry::TYPE_IN_USE;
+
+        if(!writeEntry(set.parent,set.entryIndex+i,entry))
+          return false;
+      }
+
+      if(!flushDirectory())
+        return false;
+
+      // free the clusters
+
+      clusters=static_cast<uint32_t>((set.stream.DataLength+getClusterSizeInBytes()-1) >> (_sectorShift+_clusterShift));
+      return freeClusters(set.stream.FirstCluster,clusters,set.isContiguous());
+    }
+
+
+    /**
+     * Create a new, empty file.
+     * @param[in] filename The full pathname of the file.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::createFile(const char *filename) {
+      return createEntrySet(filename,FileInformation::ATTR_ARCHIVE,0,0);
+    }
+
+
+    /**
+     * Create a new directory. One zeroed cluster is allocated to it.
+     * @param[in] dirname The full pathname of the directory.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::createDirectory(const char *dirname) {
+
+      uint32_t cluster,count;
+
+      if(!findFreeClusters(1,cluster,count) || !zeroCluster(cluster) || !setClustersAllocated(cluster,1,true))
+        return false;
+
+      _nextFreeCluster=cluster+1;
+
+      if(createEntrySet(dirname,FileInformation::ATTR_DIRECTORY,cluster,getClusterSizeInBytes()))
+        return true;
+
+      setClustersAllocated(cluster,1,false);
+      return false;
+    }
+
+
+    /**
+     * Delete a file. The file must not be open.
+     * @param[in] filename The full pathname of the file.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::deleteFile(const char *filename) {
+      return deleteEntrySet(filename,false);
+    }
+
+
+    /**
+     * Delete a directory. It must be empty.
+     * @param[in] dirname The full pathname of the directory.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::deleteDirectory(const char *dirname) {
+
+      if(!deleteEntrySet(dirname,true))
+        return false;
+
+      // the directory's clusters are free now, don't keep them cached
+
+      _directorySectorIndex=NO_SECTOR;
+      return true;
+    }
+
+
+    /**
+     * Open a file
+     * @param[in] filename The full pathname of the file.
+     * @param[out] newFile The new file. The caller must delete it when finished.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::openFile(const char *filename,File*& newFile) {
+
+      ExFatEntrySet set;
+      bool isRoot;
+
+      TokenisedPathname tp(filename);
+
+      if(!findEntrySet(tp,tp.getNumTokens(),set,isRoot))
+        return false;
+
+      if(isRoot || set.isDirectory())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_NOT_A_FILE);
+
+      newFile=new ExFatFile(*this,set);
+      return true;
+    }
+
+
+    /**
+     * Get information about a file or directory
+     * @param[in] filename The full pathname.
+     * @param[out] finfo The information. The caller must delete it when finished.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::getFileInformation(const char *filename,FileInformation*& finfo) {
+
+      ExFatEntrySet set;
+      bool isRoot;
+
+      TokenisedPathname tp(filename);
+
+      if(!findEntrySet(tp,tp.getNumTokens(),set,isRoot))
+        return false;
+
+      if(isRoot)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,FileSystem::E_INVALID_PATHNAME);
+
+      finfo=new ExFatFileInformation(set);
+      return true;
+    }
+
+
+    /**
+     * Get an iterator over a directory
+     * @param[in] pathname The full pathname of the directory. "/" is the root.
+     * @param[out] newIterator The new iterator. The caller must delete it when finished.
+     * @return false if it fails.
+     */
+
+    bool ExFatFileSystem::getDirectoryIterator(const char *pathname,DirectoryIterator*& newIterator) {
+
+      ExFatEntrySet set;
+      ExFatDirectory dir;
+      bool isRoot;
+
+      TokenisedPathname tp(pathname);
+
+      if(!findEntrySet(tp,tp.getNumTokens(),set,isRoot))
+        return false;
+
+      if(isRoot)
+        getRootDirectory(dir);
+      else if(!set.isDirectory())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM,E_NOT_A_DIRECTORY);
+      else
+        set.getDirectory(dir);
+
+      newIterator=new ExFatDirectoryIterator(*this,dir);
+      return true;
+    }
+
+
+    /**
+     * A file has been opened
+     * @param[in] file The new file.
+     */
+
+    void ExFatFileSystem::fileOpened(ExFatFile& file) {
+      file._nextOpen=_openFiles;
+      _openFiles=&file;
+    }
+
+
+    /**
+     * A file is being closed
+     * @param[in] file The file.
+     */
+
+    void ExFatFileSystem::fileClosed(ExFatFile& file) {
+
+      ExFatFile **ptr;
+
+      for(ptr=&_openFiles;*ptr;ptr=&(*ptr)->_nextOpen) {
+        if(*ptr==&file) {
+          *ptr=file._nextOpen;
+          break;
+        }
+      }
+    }
+
+
+    /**
+     * Check if the file described by an entry set is open
+     * @param[in] set The entry set.
+     * @return true if it's open.
+     */
+
+    bool ExFatFileSystem::isFileOpen(const ExFatEntrySet& set) const {
+
+      const ExFatFile *file;
+
+      for(file=_openFiles;file;file=file->_nextOpen)
+        if(file->isSameFile(set))
+          return true;
+
+      return false;
+    }
+
+
+    /**
+     * Make a file handle the writer for its file. This fails if another handle on the same
+     * file is already the writer.
+     * @param[in] file The file handle that wants to write.
+     * @return false if the file is locked by another handle.
+     */
+
+    bool ExFatFileSystem::claimWriter(ExFatFile& file) {
+
+      ExFatFile *f;
+
+      for(f=_openFiles;f;f=f->_nextOpen)
+        if(f!=&file && f->_writer && f->isSameFile(file._set))
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,File::E_FILE_LOCKED);
+
+      file._writer=true;
+      return true;
+    }
+
+
+    /**
+     * The writer has updated its entry set. Pass it on to the other handles on the same file.
+     * @param[in] file The writer
+     */
+
+    void ExFatFileSystem::entrySetUpdated(const ExFatFile& file) {
+
+      ExFatFile *f;
+
+      for(f=_openFiles;f;f=f->_nextOpen)
+        if(f!=&file && f->isSameFile(file._set))
+          f->entrySetUpdated(file._set);
+    }
+
+
+    /**
+     * Calculate the hash of a name as stored in the stream extension. The hash is of the
+     * up-cased UTF-16 name, here limited to ASCII.
+     * @param[in] name The name.
+     * @return The hash.
+     */
+
+    uint16_t ExFatFileSystem::calculateNameHash(const char *name) {
+
+      uint16_t hash;
+      uint8_t c;
+
+      for(hash=0;*name;name++) {
+
+        c=*name;
+        if(c>='a' && c<='z')
+          c-='a'-'A';
+
+        hash=((hash & 1) ? 0x8000 : 0)+(hash >> 1)+c;
+        hash=((hash & 1) ? 0x8000 : 0)+(hash >> 1);       // high byte is zero
+      }
+
+      return hash;
+    }
+
+
+    /**
+     * Add a directory entry to an entry set checksum
+     * @param[in] entry The entry.
+     * @param[in] primary true if this is the first entry in the set. Its checksum field is skipped.
+     * @param[in] checksum The checksum so far.
+     * @return The new checksum.
+     */
+
+    uint16_t ExFatFileSystem::calculateEntryChecksum(const ExFatDirectoryEntry& entry,bool primary,uint16_t checksum) {
+
+      uint32_t i;
+
+      for(i=0;i<sizeof(entry.Raw);i++) {
+
+        if(primary && (i==2 || i==3))
+          continue;
+
+        checksum=((checksum & 1) ? 0x8000 : 0)+(checksum >> 1)+entry.Raw[i];
+      }
+
+      return checksum;
+    }
+
+
+    /**
+     * Add a boot region sector to the boot checksum
+     * @param[in] sector The sector data.
+     * @param[in] sectorSize The sector size.
+     * @param[in] sectorNumber The sector number in the boot region, 0..10. The flags and
+     * percent-in-use fields in sector 0 are excluded.
+     * @param[in] checksum The checksum so far.
+     * @return The new checksum.
+     */
+
+    uint32_t ExFatFileSystem::calculateBootChecksum(const uint8_t *sector,uint32_t sectorSize,uint32_t sectorNumber,uint32_t checksum) {
+
+      uint32_t i;
+
+      for(i=0;i<sectorSize;i++) {
+
+        if(sectorNumber==0 && (i==106 || i==107 || i==112))
+          continue;
+
+        checksum=((checksum & 1) ? 0x80000000 : 0)+(checksum >> 1)+sector[i];
+      }
+
+      return checksum;
+    }
+
+
+    /**
+     * Add bytes of the up-case table to its checksum
+     * @param[in] table The table data.
+     * @param[in] length The number of bytes.
+     * @param[in] checksum The checksum so far.
+     * @return The new checksum.
+     */
+
+    uint32_t ExFatFileSystem::calculateUpcaseChecksum(const uint8_t *table,uint32_t length,uint32_t checksum) {
+
+      uint32_t i;
+
+      for(i=0;i<length;i++)
+        checksum=((checksum & 1) ? 0x80000000 : 0)+(checksum >> 1)+table[i];
+
+      return checksum;
+    }
+  }
+}
@@ -0,0 +1,352 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace exfat {
+
+    /**
+     * @brief Initialise the class and do the format.
+     *
+     * Check the error provider status to find out whether the format worked. The boot
+     * regions are written last so that an interrupted format does not leave a volume that
+     * looks valid.
+     *
+     * @param[in] blockDevice The device to format. The block size must be 512 bytes.
+     * @param[in] firstSectorIndex The zero-based index of the first sector of the partition, or the device as a whole if partitions are not supported.
+     * @param[in] numSectors The total number of sectors to format on this device.
+     * @param[in] volumeLabel The new name for the volume, max 11 characters.
+     * @param[in] alignment The cluster heap will start on a multiple of this many sectors. Use the erase block size of the device, e.g. 8192 for most SD cards.
+     * @param[in] sectorsPerCluster The cluster size in sectors, a power of 2. Zero selects a size from the volume size.
+     */
+
+    ExFatFileSystemFormatter::ExFatFileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel,uint32_t alignment,uint32_t sectorsPerCluster)
+      : _blockDevice(blockDevice) {
+
+      uint32_t upcaseChecksum;
+
+      errorProvider.clear();
+
+      strncpy(_volumeLabel,volumeLabel,11);
+      _volumeLabel[11]='\0';
+
+      _firstSectorIndex=firstSectorIndex;
+      _numSectors=numSectors;
+      _alignment=alignment ? alignment : 1;
+
+      if(blockDevice.getBlockSizeInBytes()!=SECTOR_SIZE) {
+        errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,FileSystem::E_INVALID_BLOCK_SIZE);
+        return;
+      }
+
+      if(!createBootSector(sectorsPerCluster)
+          || !writeFat()
+          || !writeBitmap()
+          || !writeUpcaseTable(upcaseChecksum)
+          || !writeRootDirectory(upcaseChecksum))
+        return;
+
+      // main and backup boot regions
+
+      if(!writeBootRegion(_firstSectorIndex))
+        return;
+
+      writeBootRegion(_firstSectorIndex+12);
+    }
+
+
+    /*
+     * Calculate the layout and prepare the boot sector
+     */
+
+    bool ExFatFileSystemFormatter::createBootSector(uint32_t sectorsPerCluster) {
+
+      uint32_t clusterShift,fatLength,heapOffset,remainder,clusterCount,maxClusters;
+
+      // the volume must be at least 1Mb
+
+      if(_numSectors<2048)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM_FORMATTER,E_INVALID_DISK_SIZE);
+
+      if(sectorsPerCluster==0) {
+
+        if(_numSectors<=524288)             // 256Mb
+          sectorsPerCluster=8;
+        else if(_numSectors<=67108864)      // 32Gb
+          sectorsPerCluster=64;
+        else
+          sectorsPerCluster=256;
+      }
+
+      if((sectorsPerCluster & (sectorsPerCluster-1))!=0 || sectorsPerCluster>65536)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM_FORMATTER,E_INVALID_CLUSTER_SIZE);
+
+      for(clusterShift=0;(1U << clusterShift)<sectorsPerCluster;clusterShift++);
+
+      // size the FAT for the largest possible heap, then place the heap after it
+
+      maxClusters=(_numSectors-24) >> clusterShift;
+      fatLength=((maxClusters+2)*4+SECTOR_SIZE-1)/SECTOR_SIZE;
+
+      heapOffset=24+fatLength;
+      remainder=(_firstSectorIndex+heapOffset) % _alignment;
+
+      if(remainder)
+        heapOffset+=_alignment-remainder;
+
+      if(heapOffset>=_numSectors)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM_FORMATTER,E_INVALID_DISK_SIZE);
+
+      clusterCount=(_numSectors-heapOffset) >> clusterShift;
+
+      // the bitmap, up-case table and root directory must fit with room to spare
+
+      _bitmapClusters=((clusterCount+7)/8+(SECTOR_SIZE << clusterShift)-1)/(SECTOR_SIZE << clusterShift);
+      _usedClusters=_bitmapClusters+2;
+
+      if(clusterCount<=_usedClusters)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_EXFAT_FILESYSTEM_FORMATTER,E_INVALID_DISK_SIZE);
+
+      memset(&_bootSector,0,sizeof(_bootSector));
+
+      _bootSector.JumpBoot[0]=0xeb;
+      _bootSector.JumpBoot[1]=0x76;
+      _bootSector.JumpBoot[2]=0x90;
+
+      memcpy(_bootSector.FileSystemName,"EXFAT   ",8);
+
+      _bootSector.PartitionOffset=_firstSectorIndex;
+      _bootSector.VolumeLength=_numSectors;
+      _bootSector.FatOffset=24;
+      _bootSector.FatLength=fatLength;
+      _bootSector.ClusterHeapOffset=heapOffset;
+      _bootSector.ClusterCount=clusterCount;
+      _bootSector.FirstClusterOfRootDirectory=3+_bitmapClusters;
+      _bootSector.VolumeSerialNumber=0xBADF00D;
+      _bootSector.FileSystemRevision=0x0100;
+      _bootSector.BytesPerSectorShift=SECTOR_SHIFT;
+      _bootSector.SectorsPerClusterShift=clusterShift;
+      _bootSector.NumberOfFats=1;
+      _bootSector.DriveSelect=0x80;
+      _bootSector.PercentInUse=0;
+      memset(_bootSector.BootCode,0xf4,sizeof(_bootSector.BootCode));     // HLT
+      _bootSector.BootSignature=0xaa55;
+
+      return true;
+    }
+
+
+    /*
+     * Zero a run of sectors using multi-block writes from a zeroed buffer
+     */
+
+    bool ExFatFileSystemFormatter::zeroSectors(uint32_t firstSectorIndex,uint32_t count) {
+
+      ByteMemblock zeros(SECTOR_SIZE*ZERO_BUFFER_SECTORS);
+      uint32_t batch;
+
+      memset(zeros,0,SECTOR_SIZE*ZERO_BUFFER_SECTORS);
+
+      while(count) {
+
+        batch=count<ZERO_BUFFER_SECTORS ? count : ZERO_BUFFER_SECTORS;
+
+        if(!_blockDevice.writeBlocks(zeros,firstSectorIndex,batch))
+          return false;
+
+        firstSectorIndex+=batch;
+        count-=batch;
+      }
+
+      return true;
+    }
+
+
+    /*
+     * Write the FAT. The media and reserved entries are followed by chains for the bitmap,
+     * the up-case table and the root directory.
+     */
+
+    bool ExFatFileSystemFormatter::writeFat() {
+
+      ByteMemblock sector(SECTOR_SIZE);
+      uint32_t *fat,entries,sectorIndex,i,index;
+
+      entries=_usedClusters+2;
+      sectorIndex=_firstSectorIndex+_bootSector.FatOffset;
+      fat=reinterpret_cast<uint32_t *>(sector.getData());
+
+      for(index=0;index<entries;sectorIndex++) {
+
+        memset(sector,0,SECTOR_SIZE);
+
+        for(i=0;i<SECTOR_SIZE/4 && index<entries;i++,index++) {
+
+          if(index==0)
+            fat[i]=0xFFFFFFF8;            // media type
+          else if(index==1)
+            fat[i]=0xFFFFFFFF;
+          else if(index>=_bitmapClusters+1)
+            fat[i]=0xFFFFFFFF;            // end of the bitmap, the up-case table and the root directory
+          else
+            fat[i]=index+1;
+        }
+
+        if(!_blockDevice.writeBlock(sector,sectorIndex))
+          return false;
+      }
+
+      return zeroSectors(sectorIndex,_firstSectorIndex+_bootSector.FatOffset+_bootSector.FatLength-sectorIndex);
+    }
+
+
+    /*
+     * Write the allocation bitmap with the system clusters marked as used
+     */
+
+    bool ExFatFileSystemFormatter::writeBitmap() {
+
+      ByteMemblock sector(SECTOR_SIZE);
+      uint32_t firstSector,sectorIndex,bit,i;
+
+      firstSector=_firstSectorIndex+_bootSector.ClusterHeapOffset;
+      sectorIndex=firstSector;
+
+      for(bit=0;bit<_usedClusters;sectorIndex++) {
+
+        memset(sector,0,SECTOR_SIZE);
+
+        for(i=0;i<SECTOR_SIZE*8 && bit<_usedClusters;i++,bit++)
+          sector[i/8]|=1 << (i & 7);
+
+        if(!_blockDevice.writeBlock(sector,sectorIndex))
+          return false;
+      }
+
+      return zeroSectors(sectorIndex,firstSector+(_bitmapClusters << _bootSector.SectorsPerClusterShift)-sectorIndex);
+    }
+
+
+    /*
+     * Write an up-case table that maps the ASCII lower case letters. Other characters are
+     * not in the table and map to themselves.
+     */
+
+    bool ExFatFileSystemFormatter::writeUpcaseTable(uint32_t& checksum) {
+
+      ByteMemblock sector(SECTOR_SIZE);
+      uint16_t *table;
+      uint32_t i,firstSector;
+
+      memset(sector,0,SECTOR_SIZE);
+      table=reinterpret_cast<uint16_t *>(sector.getData());
+
+      for(i=0;i<UPCASE_ENTRIES;i++)
+        table[i]=i>='a' && i<='z' ? i-('a'-'A') : i;
+
+      checksum=ExFatFileSystem::calculateUpcaseChecksum(sector,UPCASE_ENTRIES*2,0);
+
+      firstSector=_firstSectorIndex+_bootSector.ClusterHeapOffset+(_bitmapClusters << _bootSector.SectorsPerClusterShift);
+
+      return _blockDevice.writeBlock(sector,firstSector)
+          && zeroSectors(firstSector+1,(1 << _bootSector.SectorsPerClusterShift)-1);
+    }
+
+
+    /*
+     * Write the root directory with the volume label, bitmap and up-case table entries
+     */
+
+    bool ExFatFileSystemFormatter::writeRootDirectory(uint32_t upcaseChecksum) {
+
+      ByteMemblock sector(SECTOR_SIZE);
+      ExFatDirectoryEntry *entries;
+      uint32_t i,firstSector;
+
+      memset(sector,0,SECTOR_SIZE);
+      entries=reinterpret_cast<ExFatDirectoryEntry *>(sector.getData());
+
+      // volume label. An empty label is still recorded so that other systems don't create one.
+
+      entries[0].VolumeLabel.EntryType=ExFatDirectoryEntry::TYPE_VOLUME_LABEL;
+
+      for(i=0;_volumeLabel[i];i++)
+        entries[0].VolumeLabel.VolumeLabel[i]=static_cast<uint8_t>(_volumeLabel[i]);
+
+      while(i>0 && _volumeLabel[i-1]==' ')
+        i--;
+
+      entries[0].VolumeLabel.CharacterCount=i;
+
+      // allocation bitmap
+
+      entries[1].Bitmap.EntryType=ExFatDirectoryEntry::TYPE_BITMAP;
+      entries[1].Bitmap.FirstCluster=2;
+      entries[1].Bitmap.DataLength=(_bootSector.ClusterCount+7)/8;
+
+      // up-case table
+
+      entries[2].Upcase.EntryType=ExFatDirectoryEntry::TYPE_UPCASE;
+      entries[2].Upcase.TableChecksum=upcaseChecksum;
+      entries[2].Upcase.FirstCluster=2+_bitmapClusters;
+      entries[2].Upcase.DataLength=UPCASE_ENTRIES*2;
+
+      firstSector=_firstSectorIndex+_bootSector.ClusterHeapOffset+((_bitmapClusters+1) << _bootSector.SectorsPerClusterShift);
+
+      return _blockDevice.writeBlock(sector,firstSector)
+          && zeroSectors(firstSector+1,(1 << _bootSector.SectorsPerClusterShift)-1);
+    }
+
+
+    /*
+     * Write a boot region: the boot sector, 8 extended boot sectors, the OEM parameters,
+     * a reserved sector and the checksum sector
+     */
+
+    bool ExFatFileSystemFormatter::writeBootRegion(uint32_t sectorIndex) {
+
+      ByteMemblock sector(SECTOR_SIZE);
+      uint32_t i,checksum;
+
+      // boot sector
+
+      memset(sector,0,SECTOR_SIZE);
+      memcpy(sector,&_bootSector,sizeof(_bootSector));
+
+      checksum=ExFatFileSystem::calculateBootChecksum(sector,SECTOR_SIZE,0,0);
+
+      if(!_blockDevice.writeBlock(sector,sectorIndex))
+        return false;
+
+      for(i=1;i<11;i++) {
+
+        // extended boot sectors end with a signature, the OEM parameters and reserved sector are empty
+
+        memset(sector,0,SECTOR_SIZE);
+
+        if(i<9) {
+          sector[SECTOR_SIZE-2]=0x55;
+          sector[SECTOR_SIZE-1]=0xaa;
+        }
+
+        checksum=ExFatFileSystem::calculateBootChecksum(sector,SECTOR_SIZE,i,checksum);
+
+        if(!_blockDevice.writeBlock(sector,sectorIndex+i))
+          return false;
+      }
+
+      // the checksum sector is the checksum repeated
+
+      for(i=0;i<SECTOR_SIZE/4;i++)
+        reinterpret_cast<uint32_t *>(sector.getData())[i]=checksum;
+
+      return _blockDevice.writeBlock(sector,sectorIndex+11);
+    }
+  }
+}
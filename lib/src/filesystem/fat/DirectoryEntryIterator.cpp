@@ -231,18 +231,25 @@ namespace stm32plus {
 
             _options=oldOptions;
 
-            // now write the dirents
+            // now write the dirents, each sector is written once
+
+            DirectorySectorBatch batch(_fs);
 
             for(i=0;i < foundCount;i++) {
 
               entries[i].Dirent=dirents_[i]; // struct copy
 
-              if(!_fs.writeDirectoryEntry(entries[i])) {
+              if(!batch.writeEntry(entries[i])) {
                 delete[] entries;
                 return false;
               }
             }
 
+            if(!batch.flush()) {
+              delete[] entries;
+              return false;
+            }
+
             delete[] entries;
             return true;
           }
@@ -255,10 +262,174 @@ namespace stm32plus {
       delete[] entries;
       _options=oldOptions;
 
+      // the scan must have stopped at the end of the directory
+
+      if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,E_END_OF_ENTRIES))
+        return false;
+
       // not enough contiguous deleted entries available
-      // extend the directory to make space for them
+      // extend the directory to make space for them. we're positioned on the end.
 
       return extendDirectory(dirents_,direntCount_);
     }
+
+    /**
+     * Create the entries for several new files in one pass over this directory. Each generator
+     * is given every existing entry so that it can check for a duplicate name and collect the
+     * numeric tails in use, and the runs of deleted entries are found in the same pass. The new
+     * entries are staged in one DirectorySectorBatch and the files that did not fit into deleted
+     * entries are appended with one extension of the directory.
+     *
+     * Files are created in order. If a generator fails then the files before it are still
+     * created, createdCount_ says how many and false is returned with the generator's error.
+     *
+     * @param[in] generators_ Generators constructed without a target directory, one per new file.
+     * @param[in] count_ The number of generators.
+     * @param[out] createdCount_ The number of files that were created.
+     * @return false if it fails.
+     */
+
+    bool DirectoryEntryIterator::createEntries(LongNameDirentGenerator **generators_,uint32_t count_,uint32_t& createdCount_) {
+
+      DirectoryEntryWithLocation *entries;
+      DirectoryEntry *dirents,*appended;
+      Options oldOptions;
+      uint32_t i,j,limit,placed,entryCount,runLength,direntCount;
+      uint16_t failure;
+      bool retval;
+
+      createdCount_=0;
+      failure=0;
+
+      // room for the locations of the deleted entries that we reuse
+
+      for(i=entryCount=0;i<count_;i++)
+        entryCount+=generators_[i]->getDirentCount();
+
+      entries=new DirectoryEntryWithLocation[entryCount];
+
+      // save old options and make sure we see deleted entries now
+
+      oldOptions=_options;
+      _options=OPT_PARSE_LONG_NAMES;
+
+      reset();
+
+      limit=count_;       // generators from here on failed or follow one that did
+      placed=0;           // generators that have a run of deleted entries, in order
+      entryCount=0;       // entries taken by the placed generators
+      runLength=0;
+
+      while(next()) {
+
+        if(current().Dirent.sdir.DIR_Name[0] == 0xE5) {
+
+          // extend the run for the next generator. when it's long enough the generator is placed.
+
+          if(placed<limit) {
+
+            entries[entryCount+runLength++]=current(); // struct copy
+
+            if(runLength == static_cast<uint32_t>(generators_[placed]->getDirentCount())) {
+              entryCount+=runLength;
+              runLength=0;
+              placed++;
+            }
+          }
+        }
+        else {
+
+          runLength=0;
+
+          for(i=0;i<limit;i++) {
+            if(!generators_[i]->scanEntry(getFilename(),current().Dirent.sdir.DIR_Name)) {
+              failure=errorProvider.getCode();
+              limit=i;
+            }
+          }
+        }
+      }
+
+      _options=oldOptions;
+
+      // the scan must have stopped at the end of the directory
+
+      if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,E_END_OF_ENTRIES)) {
+        delete[] entries;
+        return false;
+      }
+
+      // choose the short names in order. each file must also avoid the names chosen before it.
+
+      for(i=0;i<limit;i++) {
+
+        for(j=0;j<i;j++) {
+
+          dirents=generators_[j]->getDirents();
+
+          if(!generators_[i]->scanEntry(generators_[j]->getLongName(),dirents[generators_[j]->getDirentCount()-1].sdir.DIR_Name))
+            break;
+        }
+
+        if(j<i || !generators_[i]->generate()) {
+          failure=errorProvider.getCode();
+          limit=i;
+        }
+      }
+
+      // stage the files that fit into deleted entries, each sector is written once
+
+      DirectorySectorBatch batch(_fs);
+
+      retval=true;
+      placed=std::min(placed,limit);
+
+      for(i=entryCount=0;i<placed && retval;i++) {
+
+        dirents=generators_[i]->getDirents();
+        direntCount=generators_[i]->getDirentCount();
+
+        for(j=0;j<direntCount && retval;j++) {
+          entries[entryCount].Dirent=dirents[j]; // struct copy
+          retval=batch.writeEntry(entries[entryCount++]);
+        }
+      }
+
+      delete[] entries;
+
+      if(!retval || !batch.flush())
+        return false;
+
+      createdCount_=placed;
+
+      // append the rest to the directory in one go. we're positioned on the end.
+
+      if(placed<limit) {
+
+        for(i=placed,entryCount=0;i<limit;i++)
+          entryCount+=generators_[i]->getDirentCount();
+
+        appended=new DirectoryEntry[entryCount];
+
+        for(i=placed,entryCount=0;i<limit;i++) {
+          direntCount=generators_[i]->getDirentCount();
+          memcpy(&appended[entryCount],generators_[i]->getDirents(),direntCount*sizeof(DirectoryEntry));
+          entryCount+=direntCount;
+        }
+
+        retval=extendDirectory(appended,entryCount);
+        delete[] appended;
+
+        if(!retval)
+          return false;
+
+        createdCount_=limit;
+      }
+
+      if(failure)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_LONG_FILENAME_GENERATOR,failure);
+
+      return true;
+    }
   }
 }
@@ -0,0 +1,144 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace fat {
+
+    /**
+     * Constructor
+     * @param[in] fs_ The file system. Must stay in scope.
+     * @param[in] capacity_ The maximum number of sectors to stage before writing.
+     */
+
+    DirectorySectorBatch::DirectorySectorBatch(FatFileSystem& fs_,uint32_t capacity_)
+      : _fs(fs_),
+        _buffer(fs_.getSectorSizeInBytes()*capacity_),
+        _sectorIndices(capacity_),
+        _chains(capacity_*(fs_.getSectorSizeInBytes()/sizeof(DirectoryEntry))),
+        _capacity(capacity_),
+        _sectorCount(0),
+        _chainCount(0) {
+    }
+
+
+    /*
+     * Get the staged copy of a sector, reading it in if this is the first change to it
+     */
+
+    uint8_t *DirectorySectorBatch::getSector(uint32_t sectorIndex_) {
+
+      uint32_t i;
+      uint8_t *sector;
+
+      for(i=0;i<_sectorCount;i++)
+        if(_sectorIndices[i]==sectorIndex_)
+          return _buffer.getData()+i*_fs.getSectorSizeInBytes();
+
+      // make room
+
+      if(_sectorCount==_capacity && !flush())
+        return nullptr;
+
+      sector=_buffer.getData()+_sectorCount*_fs.getSectorSizeInBytes();
+
+      if(!_fs.readSector(sectorIndex_,sector))
+        return nullptr;
+
+      _sectorIndices[_sectorCount++]=sectorIndex_;
+      return sector;
+    }
+
+
+    /**
+     * Stage a change to a directory entry
+     * @param[in] dirent_ The new entry and its location.
+     * @return false if it fails.
+     */
+
+    bool DirectorySectorBatch::writeEntry(const DirectoryEntryWithLocation& dirent_) {
+
+      uint8_t *sector;
+
+      if((sector=getSector(dirent_.SectorNumber))==nullptr)
+        return false;
+
+      memcpy(sector+dirent_.IndexWithinSector*sizeof(DirectoryEntry),&dirent_.Dirent,sizeof(DirectoryEntry));
+      return true;
+    }
+
+
+    /**
+     * Stage the deletion of the entries that make up a filename
+     * @param[in] fh_ The filename handler that holds the locations of the entries.
+     * @param[in] firstCluster_ The first cluster of the file, freed after the entries are written. Zero if there is none.
+     * @return false if it fails.
+     */
+
+    bool DirectorySectorBatch::deleteEntries(FilenameHandler& fh_,uint32_t firstCluster_) {
+
+      uint32_t i;
+      uint8_t *sector;
+      DirectoryEntry *de;
+
+      for(i=0;i<fh_.getDirentCount();i++) {
+
+        if((sector=getSector(fh_.getSectorIndices()[i]))==nullptr)
+          return false;
+
+        de=reinterpret_cast<DirectoryEntry *>(sector+fh_.getSectorOffsetIndices()[i]*sizeof(DirectoryEntry));
+        de->sdir.DIR_Name[0]=0xe5;
+      }
+
+      // there's room for one chain per staged entry so this can't overflow
+
+      if(firstCluster_!=0)
+        _chains[_chainCount++]=firstCluster_;
+
+      return true;
+    }
+
+
+    /**
+     * Write back the staged sectors, then free the cluster chains of deleted files
+     * @return false if it fails.
+     */
+
+    bool DirectorySectorBatch::flush() {
+
+      uint32_t i,run,sectorSize;
+      bool retval;
+
+      sectorSize=_fs.getSectorSizeInBytes();
+      retval=true;
+
+      for(i=0;i<_sectorCount && retval;i+=run) {
+
+        // staged sectors are usually in ascending order, find the run of consecutive ones
+
+        for(run=1;i+run<_sectorCount && _sectorIndices[i+run]==_sectorIndices[i]+run;run++);
+
+        if(run==1)
+          retval=_fs.writeSector(_sectorIndices[i],_buffer.getData()+i*sectorSize);
+        else
+          retval=_fs.writeSectors(_sectorIndices[i],_buffer.getData()+i*sectorSize,run);
+      }
+
+      // the entries are gone from the device, the clusters can be freed
+
+      if(retval && _chainCount)
+        retval=_fs.deAllocateClusterChains(_chains,_chainCount);
+
+      _sectorCount=0;
+      _chainCount=0;
+
+      return retval;
+    }
+  }
+}
@@ -0,0 +1,102 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace fat {
+
+    /**
+     * Constructor
+     * @param[in] fs_ The file system. Must stay in scope.
+     * @param[in] capacity_ The maximum number of sectors to hold.
+     */
+
+    DirectorySectorCache::DirectorySectorCache(FatFileSystem& fs_,uint32_t capacity_)
+      : _fs(fs_),
+        _buffer(fs_.getSectorSizeInBytes()*capacity_),
+        _capacity(capacity_),
+        _next(nullptr) {
+
+      invalidate();
+      _fs.cacheCreated(*this);
+    }
+
+
+    /**
+     * Destructor, unregister from the file system
+     */
+
+    DirectorySectorCache::~DirectorySectorCache() {
+      _fs.cacheDestroyed(*this);
+    }
+
+
+    /**
+     * A sector has been written through the file system. Update our copy if we have it.
+     * @param[in] sectorIndex_ The sector that was written.
+     * @param[in] data_ The new content of the sector.
+     */
+
+    void DirectorySectorCache::sectorWritten(uint32_t sectorIndex_,const void *data_) {
+
+      uint8_t *sector;
+
+      if(sectorIndex_>=_firstSector && sectorIndex_-_firstSector<_count) {
+
+        sector=_buffer.getData()+(sectorIndex_-_firstSector)*_fs.getSectorSizeInBytes();
+
+        if(sector!=data_)
+          memcpy(sector,data_,_fs.getSectorSizeInBytes());
+      }
+    }
+
+
+    /**
+     * Discard the cached sectors. Must be called if the sectors may have been written
+     * by someone else.
+     */
+
+    void DirectorySectorCache::invalidate() {
+      _firstSector=0;
+      _count=0;
+    }
+
+
+    /**
+     * Get a pointer to a sector's data, reading it and the sectors that follow it if necessary
+     * @param[in] sectorIndex_ The sector index.
+     * @param[in] runLength_ The number of consecutive sectors, starting at sectorIndex_, that
+     *   belong to the same contiguous run and may be read ahead. Must be at least 1.
+     * @return The sector data, or nullptr if the read failed.
+     */
+
+    uint8_t *DirectorySectorCache::getSector(uint32_t sectorIndex_,uint32_t runLength_) {
+
+      // hit?
+
+      if(sectorIndex_>=_firstSector && sectorIndex_-_firstSector<_count)
+        return _buffer.getData()+(sectorIndex_-_firstSector)*_fs.getSectorSizeInBytes();
+
+      // read as much of the run as we can hold
+
+      if(runLength_>_capacity)
+        runLength_=_capacity;
+
+      if(!_fs.readSectors(sectorIndex_,_buffer.getData(),runLength_)) {
+        invalidate();
+        return nullptr;
+      }
+
+      _firstSector=sectorIndex_;
+      _count=runLength_;
+
+      return _buffer.getData();
+    }
+  }
+}
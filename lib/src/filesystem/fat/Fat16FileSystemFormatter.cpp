@@ -21,24 +21,43 @@ namespace stm32plus {
      * @param[in] firstSectorIndex The zero-based index of the first sector of the partition, or the device as a whole if partitions are not supported.
      * @param[in] numSectors The total number of sectors to format on this device.
      * @param[in] volumeLabel The new name for the volume, max 11 characters.
+     * @param[in] alignment The data region will start on a multiple of this many sectors. Use the erase block size of the device, e.g. 8192 for most SD cards.
+     * @param[in] progress Optional slot to be called with the number of sectors written so far and the total to be written.
      */
 
-    Fat16FileSystemFormatter::Fat16FileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel)
-      : FatFileSystemFormatter(blockDevice,firstSectorIndex,numSectors,volumeLabel) {
+    Fat16FileSystemFormatter::Fat16FileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel,uint32_t alignment,const FatFormatProgressEventSourceSlot *progress)
+      : FatFileSystemFormatter(blockDevice,firstSectorIndex,numSectors,volumeLabel,alignment,progress) {
+
+      uint32_t padding,rootDirSectors;
+
+      // create the boot sector
+
+      if(!createNewBootSector())
+        return;
+
+      // pad the reserved area to align the data region unless that leaves too few clusters for FAT16
+
+      rootDirSectors=(_bootSector.BPB_RootEntCnt*32)/512;
+      padding=getAlignmentPadding(_bootSector.BPB_NumFATs*_bootSector.BPB_FATSz16+rootDirSectors);
+
+      if(padding && (_numSectors-_bootSector.BPB_RsvdSecCnt-padding-_bootSector.BPB_NumFATs*_bootSector.BPB_FATSz16-rootDirSectors)/_bootSector.BPB_SecPerClus>=4085)
+        _bootSector.BPB_RsvdSecCnt+=padding;
+
+      beginProgress(_bootSector.BPB_RsvdSecCnt+(_bootSector.BPB_NumFATs*_bootSector.BPB_FATSz16)+rootDirSectors);
 
       // write the reserved sectors
 
       if(!writeReservedSectors())
         return;
 
-      // the two FAT tables start at sector #1, write them
+      // the two FAT tables follow the reserved sectors, write them
 
       if(!writeFats(_firstSectorIndex+_bootSector.BPB_RsvdSecCnt,_bootSector.BPB_FATSz16))
         return;
 
-      // write the root directory entry, which comes right after the two FATs
+      // write the root directory entries, which come right after the two FATs
 
-      writeRootDirectoryEntries(_firstSectorIndex+_bootSector.BPB_RsvdSecCnt+(_bootSector.BPB_FATSz16*2));
+      writeRootDirectoryEntries(_firstSectorIndex+_bootSector.BPB_RsvdSecCnt+(_bootSector.BPB_FATSz16*2),rootDirSectors);
     }
 
 
@@ -108,9 +127,9 @@ namespace stm32plus {
 
     bool Fat16FileSystemFormatter::writeReservedSectors() {
 
-      // FAT16 only has the boot sector and nothing else
+      // FAT16 only has the boot sector and any alignment padding
 
-      return writeBootSector(_firstSectorIndex);
+      return writeBootSector(_firstSectorIndex) && zeroSectors(_firstSectorIndex+1,_bootSector.BPB_RsvdSecCnt-1);
     }
 
 
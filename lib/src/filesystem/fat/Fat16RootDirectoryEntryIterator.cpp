@@ -19,7 +19,7 @@ namespace stm32plus {
 
     Fat16RootDirectoryEntryIterator::Fat16RootDirectoryEntryIterator(FatFileSystem& fs_,Options options_) :
       DirectoryEntryIterator(fs_,options_),
-      _currentSector(fs_.getBootSector().BPB_BytsPerSec) {
+      _cache(fs_,DirectorySectorCache::DEFAULT_CAPACITY) {
 
       _entriesPerSector=_fs.getBootSector().BPB_BytsPerSec/sizeof(DirectoryEntry);
       _rootDirMaxEntries=_fs.getBootSector().BPB_RootEntCnt;
@@ -34,6 +34,8 @@ namespace stm32plus {
     void Fat16RootDirectoryEntryIterator::reset() {
       _currentIndex=-1;
       _firstEntryInCurrentSector=-1;
+      _currentSector=nullptr;
+      _cache.invalidate();
     }
 
     /*
@@ -92,7 +94,7 @@ namespace stm32plus {
 
       offset=entryOffsetInSector(_currentIndex);
 
-      memcpy(&_currentEntry.Dirent,static_cast<uint8_t *> (_currentSector)+offset,sizeof(DirectoryEntry));
+      memcpy(&_currentEntry.Dirent,_currentSector+offset,sizeof(DirectoryEntry));
       _currentEntry.SectorNumber=sectorIndexForEntry(_currentIndex);
       _currentEntry.IndexWithinSector=_currentIndex%_entriesPerSector;
 
@@ -110,20 +112,29 @@ namespace stm32plus {
 
     bool Fat16RootDirectoryEntryIterator::readSectorForEntry(uint32_t entryIndex_) {
 
-      uint32_t sectorIndex;
+      uint32_t sectorIndex,rootDirSectors;
 
       // check if reached the end
 
-      if(entryIndex_/_entriesPerSector>=((Fat16FileSystem&)_fs).getRootDirSectors())
+      rootDirSectors=((Fat16FileSystem&)_fs).getRootDirSectors();
+
+      if(entryIndex_/_entriesPerSector>=rootDirSectors)
         return false;
 
+      // the rest of the root directory is contiguous and may be read ahead
+
       sectorIndex=sectorIndexForEntry(entryIndex_);
-      return _fs.readSector(sectorIndex,_currentSector);
+
+      if((_currentSector=_cache.getSector(sectorIndex,rootDirSectors-entryIndex_/_entriesPerSector))==nullptr)
+        return false;
+
+      _firstEntryInCurrentSector=entryIndex_-(entryIndex_%_entriesPerSector);
+      return true;
     }
 
     /*
      * 'extend' the directory to include space for new entries. The directory has a fixed number sectors
-     *  so we cannot allocate more if the end is reached
+     *  so we cannot allocate more if the end is reached. The iterator is positioned on the end marker.
      */
 
     bool Fat16RootDirectoryEntryIterator::extendDirectory(DirectoryEntry *dirents_,uint32_t direntCount_) {
@@ -131,19 +142,13 @@ namespace stm32plus {
       DirectoryEntryWithLocation dloc;
       uint32_t i;
 
-      // go to the end
-
-      reset();
-      while(next())
-        ;
-      if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,Iterator<DirectoryEntryWithLocation>::E_END_OF_ENTRIES))
-        return false;
-
       // have we got space?
 
       if(_currentIndex>_rootDirMaxEntries-direntCount_)
         return errorProvider.set(ErrorProvider::ERROR_PROVIDER_ITERATOR,E_ROOT_DIRECTORY_FULL);
 
+      DirectorySectorBatch batch(_fs);
+
       for(i=0;i<=direntCount_;i++) {
 
         if(_currentIndex+i<_rootDirMaxEntries) { // may not be space for the end marker
@@ -156,11 +161,18 @@ namespace stm32plus {
           else
             dloc.Dirent=dirents_[i]; // struct copy
 
-          if(!_fs.writeDirectoryEntry(dloc))
+          if(!batch.writeEntry(dloc))
             return false;
         }
       }
 
+      if(!batch.flush())
+        return false;
+
+      // the cache may hold the sectors that we just wrote
+
+      _cache.invalidate();
+
       return true;
     }
   }
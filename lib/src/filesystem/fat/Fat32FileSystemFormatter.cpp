@@ -22,19 +22,37 @@ namespace stm32plus {
      * @param[in] firstSectorIndex The zero-based index of the first sector of the partition, or the device as a whole if partitions are not supported.
      * @param[in] numSectors The total number of sectors to format on this device.
      * @param[in] volumeLabel The new name for the volume, max 11 characters.
+     * @param[in] alignment The data region will start on a multiple of this many sectors. Use the erase block size of the device, e.g. 8192 for most SD cards.
+     * @param[in] progress Optional slot to be called with the number of sectors written so far and the total to be written.
      */
 
-    Fat32FileSystemFormatter::Fat32FileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel)
-      : FatFileSystemFormatter(blockDevice,firstSectorIndex,numSectors,volumeLabel) {
+    Fat32FileSystemFormatter::Fat32FileSystemFormatter(BlockDevice& blockDevice,uint32_t firstSectorIndex,uint32_t numSectors,const char *volumeLabel,uint32_t alignment,const FatFormatProgressEventSourceSlot *progress)
+      : FatFileSystemFormatter(blockDevice,firstSectorIndex,numSectors,volumeLabel,alignment,progress) {
 
-      uint32_t rootDirFirstSector,firstDataSector;
+      uint32_t rootDirFirstSector,firstDataSector,padding;
+
+      // create the boot sector
+
+      if(!createNewBootSector())
+        return;
+
+      // pad the reserved area to align the data region unless that leaves too few clusters for FAT32
+
+      padding=getAlignmentPadding(_bootSector.BPB_NumFATs*_bootSector.fat32.BPB_FATSz32);
+
+      if(padding && (_numSectors-_bootSector.BPB_RsvdSecCnt-padding-_bootSector.BPB_NumFATs*_bootSector.fat32.BPB_FATSz32)/_bootSector.BPB_SecPerClus>=65525)
+        _bootSector.BPB_RsvdSecCnt+=padding;
+
+      // everything up to the end of the root directory cluster is written
+
+      beginProgress(_bootSector.BPB_RsvdSecCnt+(_bootSector.BPB_NumFATs*_bootSector.fat32.BPB_FATSz32)+_bootSector.BPB_SecPerClus);
 
       // write the reserved sectors
 
       if(!writeReservedSectors())
         return;
 
-      // the two FAT tables start at sector #6, write them
+      // the two FAT tables follow the reserved sectors, write them
 
       if(!writeFats(_firstSectorIndex+_bootSector.BPB_RsvdSecCnt,_bootSector.fat32.BPB_FATSz32))
         return;
@@ -44,9 +62,9 @@ namespace stm32plus {
       firstDataSector=_bootSector.BPB_RsvdSecCnt+(_bootSector.BPB_NumFATs*_bootSector.fat32.BPB_FATSz32);
       rootDirFirstSector=firstDataSector+((_bootSector.fat32.BPB_RootClus-2)*_bootSector.BPB_SecPerClus);
 
-      // write the root directory entry
+      // write the root directory entry and zero the rest of its cluster
 
-      writeRootDirectoryEntries(_firstSectorIndex+rootDirFirstSector);
+      writeRootDirectoryEntries(_firstSectorIndex+rootDirFirstSector,_bootSector.BPB_SecPerClus);
     }
 
 
@@ -117,6 +135,11 @@ namespace stm32plus {
 
       ByteMemblock fsinfo(512);
 
+      // clear out the whole reserved area
+
+      if(!zeroSectors(_firstSectorIndex,_bootSector.BPB_RsvdSecCnt))
+        return false;
+
       // boot sector and backup
 
       if(!writeBootSector(_firstSectorIndex) || !writeBootSector(_firstSectorIndex+6))
@@ -125,7 +148,7 @@ namespace stm32plus {
       // fsinfo structure at reserved #1
 
       createNewFsInfo(*reinterpret_cast<Fat32FsInfo *>(fsinfo.getData()));
-      return _blockDevice.writeBlock(fsinfo,1);
+      return writeSector(fsinfo,_firstSectorIndex+1);
     }
 
 
@@ -0,0 +1,356 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace fat {
+
+    /**
+     * Constructor. Use FatFileSystem::openAppendFile() to create instances.
+     * @param[in] fs_ The file system.
+     * @param[in] dirent_ The file's directory entry.
+     * @param[in] journal_ The journal for cluster chain updates. Must be open.
+     * @param[in] batchSectors_ The number of sectors to buffer.
+     * @param[in] preallocateClusters_ The number of clusters to allocate at a time.
+     */
+
+    FatAppendFile::FatAppendFile(FatFileSystem& fs_,DirectoryEntryWithLocation& dirent_,FatJournal& journal_,uint32_t batchSectors_,uint32_t preallocateClusters_)
+      : FatFile(fs_,dirent_),
+        _journal(journal_),
+        _batch(fs_.getSectorSizeInBytes()*(batchSectors_ ? batchSectors_ : 1)),
+        _batchSectors(batchSectors_ ? batchSectors_ : 1),
+        _preallocateClusters(preallocateClusters_ ? preallocateClusters_ : 1),
+        _sectorSize(fs_.getSectorSizeInBytes()),
+        _clusterSize(fs_.getSectorSizeInBytes()*fs_.getBootSector().BPB_SecPerClus),
+        _batchStart(0),
+        _batchCluster(0),
+        _tailCluster(0),
+        _chainClusters(0) {
+    }
+
+
+    /**
+     * Destructor. Commit the data and free the preallocated clusters that were not used.
+     */
+
+    FatAppendFile::~FatAppendFile() {
+
+      if(_writer && commit())
+        trim();
+    }
+
+
+    /*
+     * Walk the cluster chain to find its length, its tail and the cluster that holds the
+     * end of the file. Load the partially filled last sector into the batch buffer.
+     */
+
+    bool FatAppendFile::initialise() {
+
+      uint32_t cluster,next,batchIndex,size;
+
+      size=_dirent.Dirent.sdir.DIR_FileSize;
+
+      _offset=size;
+      _batchStart=size-(size % _sectorSize);
+      batchIndex=_batchStart/_clusterSize;
+
+      for(cluster=getFirstCluster();cluster>=2 && cluster<_fs.getCountOfClusters()+2 && _chainClusters<_fs.getCountOfClusters();cluster=next) {
+
+        if(_chainClusters==batchIndex)
+          _batchCluster=cluster;
+
+        _tailCluster=cluster;
+        _chainClusters++;
+
+        if(!_fs.readFatEntry(cluster,next))
+          return false;
+
+        if(_fs.isEndOfClusterChainMarker(next))
+          break;
+      }
+
+      // the chain must be long enough to hold the data
+
+      if(_chainClusters*_clusterSize<size)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,E_BAD_CLUSTER);
+
+      if(size % _sectorSize)
+        return _fs.readSectorFromCluster(_batchCluster,(_batchStart % _clusterSize)/_sectorSize,_batch);
+
+      return true;
+    }
+
+
+    /**
+     * Append data to the file. Data is buffered and only written when the buffer is full or
+     * commit() is called.
+     * @param[in] ptr The data to append.
+     * @param[in] size The number of bytes.
+     * @return false if it fails.
+     */
+
+    bool FatAppendFile::write(const void *ptr,uint32_t size) {
+
+      const uint8_t *current;
+      uint32_t position,count,batchSize;
+
+      current=static_cast<const uint8_t *>(ptr);
+      batchSize=_batchSectors*_sectorSize;
+
+      while(size) {
+
+        position=_offset-_batchStart;
+        count=batchSize-position;
+
+        if(count>size)
+          count=size;
+
+        memcpy(_batch+position,current,count);
+
+        current+=count;
+        size-=count;
+        _offset+=count;
+
+        if(_offset-_batchStart==batchSize && !flushBatch())
+          return false;
+      }
+
+      return true;
+    }
+
+
+    /**
+     * Write all buffered data to the device and update the file size in the directory entry.
+     * @return false if it fails.
+     */
+
+    bool FatAppendFile::commit() {
+
+      uint16_t d,t;
+      DirectoryEntry& dirent=_dirent.Dirent;
+
+      if(!flushBatch())
+        return false;
+
+      if(dirent.sdir.DIR_FileSize==_offset)
+        return true;
+
+      dirent.sdir.DIR_FileSize=_offset;
+
+      DirectoryEntryIterator::calculateFatDateTime(_fs.getTimeProvider().getTime(),d,t);
+      dirent.sdir.DIR_WrtDate=d;
+      dirent.sdir.DIR_WrtTime=t;
+
+      if(!_fs.writeDirectoryEntry(_dirent))
+        return false;
+
+      _fs.directoryEntryUpdated(*this);
+      return true;
+    }
+
+
+    /*
+     * Write the batch buffer to the device with as few multi-block writes as the cluster
+     * layout allows. A partially filled last sector stays in the buffer so that later
+     * appends can complete it.
+     */
+
+    bool FatAppendFile::flushBatch() {
+
+      uint32_t bytes,sectors,remaining,sectorsPerCluster,sectorInCluster,cluster,lastCluster;
+      uint32_t firstSector,run,count,next;
+      uint8_t *ptr;
+
+      if((bytes=_offset-_batchStart)==0)
+        return true;
+
+      sectors=(bytes+_sectorSize-1)/_sectorSize;
+
+      if(!ensureCapacity(_batchStart+sectors*_sectorSize))
+        return false;
+
+      // don't write stale buffer content after the end of the data
+
+      memset(_batch+bytes,0,sectors*_sectorSize-bytes);
+
+      sectorsPerCluster=_clusterSize/_sectorSize;
+      sectorInCluster=(_batchStart % _clusterSize)/_sectorSize;
+      cluster=_batchCluster;
+      lastCluster=cluster;
+      ptr=_batch;
+      remaining=sectors;
+
+      while(remaining) {
+
+        // build a run of physically consecutive sectors, following the chain through clusters that are adjacent
+
+        firstSector=_fs.clusterToSector(cluster)+sectorInCluster;
+        run=0;
+
+        for(;;) {
+
+          count=sectorsPerCluster-sectorInCluster;
+          if(count>remaining-run)
+            count=remaining-run;
+
+          run+=count;
+          sectorInCluster+=count;
+          lastCluster=cluster;
+
+          if(sectorInCluster<sectorsPerCluster)
+            break;
+
+          // reached the end of this cluster, move to the next one in the chain
+
+          if(!_fs.readFatEntry(cluster,next))
+            return false;
+
+          sectorInCluster=0;
+          cluster=_fs.isEndOfClusterChainMarker(next) ? 0 : next;
+
+          if(run==remaining || cluster!=lastCluster+1)
+            break;
+        }
+
+        if(!_fs.writeSectors(firstSector,ptr,run))
+          return false;
+
+        ptr+=run*_sectorSize;
+        remaining-=run;
+      }
+
+      // set up the buffer for the next batch
+
+      if(bytes % _sectorSize) {
+
+        // keep the partial last sector
+
+        if(sectors>1)
+          memmove(_batch,_batch+(sectors-1)*_sectorSize,bytes % _sectorSize);
+
+        _batchStart+=(sectors-1)*_sectorSize;
+        _batchCluster=lastCluster;
+      }
+      else {
+        _batchStart=_offset;
+        _batchCluster=cluster;
+      }
+
+      return true;
+    }
+
+
+    /*
+     * Make sure the cluster chain can hold the given number of bytes, allocating runs of
+     * clusters through the journal as required.
+     */
+
+    bool FatAppendFile::ensureCapacity(uint32_t bytesNeeded) {
+
+      uint32_t needed,first,count;
+
+      while(_chainClusters*_clusterSize<bytesNeeded) {
+
+        needed=(bytesNeeded-_chainClusters*_clusterSize+_clusterSize-1)/_clusterSize;
+        if(needed<_preallocateClusters)
+          needed=_preallocateClusters;
+
+        if(!_fs.findFreeClusterRun(needed,first,count) || !_journal.extendChain(_tailCluster,first,count,_dirent))
+          return false;
+
+        // the journal has written the first cluster to the directory entry on the device
+
+        if(_tailCluster==0) {
+          _dirent.Dirent.sdir.DIR_FstClusLO=first & 0xFFFF;
+          _dirent.Dirent.sdir.DIR_FstClusHI=first >> 16;
+        }
+
+        // the end of the file was at the end of the chain
+
+        if(_batchCluster==0 && _batchStart/_clusterSize==_chainClusters)
+          _batchCluster=first;
+
+        _tailCluster=first+count-1;
+        _chainClusters+=count;
+      }
+
+      return true;
+    }
+
+
+    /*
+     * Free the clusters after the one that holds the last byte of the file
+     */
+
+    bool FatAppendFile::trim() {
+
+      uint32_t keep,cluster,i;
+
+      keep=(_offset+_clusterSize-1)/_clusterSize;
+
+      if(keep>=_chainClusters)
+        return true;
+
+      // find the last cluster to keep
+
+      cluster=0;
+
+      if(keep>0) {
+        for(cluster=getFirstCluster(),i=1;i<keep;i++)
+          if(!_fs.readFatEntry(cluster,cluster))
+            return false;
+      }
+
+      if(!_journal.trimChain(cluster,_dirent))
+        return false;
+
+      if(keep==0) {
+        _dirent.Dirent.sdir.DIR_FstClusLO=0;
+        _dirent.Dirent.sdir.DIR_FstClusHI=0;
+        _fs.directoryEntryUpdated(*this);
+      }
+
+      _tailCluster=cluster;
+      _chainClusters=keep;
+      return true;
+    }
+
+
+    /**
+     * Reading is not supported, open another handle on the file to read it
+     * @return false
+     */
+
+    bool FatAppendFile::read(void * /* ptr */,uint32_t /* size */,uint32_t& actuallyRead) {
+      actuallyRead=0;
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,E_NOT_SUPPORTED);
+    }
+
+
+    /**
+     * Seeking is not supported, all writes are appended
+     * @return false
+     */
+
+    bool FatAppendFile::seek(int32_t /* offset */,SeekFrom /* origin */) {
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,E_NOT_SUPPORTED);
+    }
+
+
+    /**
+     * Get the length of the file including data that has not been committed
+     * @return The length
+     */
+
+    uint32_t FatAppendFile::getLength() {
+      return _offset;
+    }
+  }
+}
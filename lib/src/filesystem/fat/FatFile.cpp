@@ -22,9 +22,41 @@ namespace stm32plus {
       _sectorBuffer(_fs.getSectorSizeInBytes()),
       _iterator(fs_,
                 (static_cast<uint32_t> (dirent_.Dirent.sdir.DIR_FstClusHI) << 16) | dirent_.Dirent.sdir.DIR_FstClusLO,
-                ClusterChainIterator::extensionExtend) {
+                ClusterChainIterator::extensionExtend),
+      _nextOpen(nullptr),
+      _writer(false) {
 
       _dirent=dirent_; // struct copy
+      _fs.fileOpened(*this);
+    }
+
+
+    /**
+     * Destructor. Unregister from the file system, releasing the write lock if we have it.
+     */
+
+    FatFile::~FatFile() {
+      _fs.fileClosed(*this);
+    }
+
+
+    /**
+     * Another handle on this file has updated the directory entry. Take a copy so that the
+     * new length is visible and restart the sector iterator if the file just got its first cluster.
+     * @param[in] dirent The new directory entry
+     */
+
+    void FatFile::directoryEntryUpdated(const DirectoryEntry& dirent) {
+
+      bool firstClusterChanged;
+
+      firstClusterChanged=dirent.sdir.DIR_FstClusLO!=_dirent.Dirent.sdir.DIR_FstClusLO
+                       || dirent.sdir.DIR_FstClusHI!=_dirent.Dirent.sdir.DIR_FstClusHI;
+
+      _dirent.Dirent=dirent;      // struct copy
+
+      if(firstClusterChanged)
+        seek(_offset,SeekStart);
     }
 
 
@@ -108,6 +140,11 @@ namespace stm32plus {
       DirectoryEntry& dirent=_dirent.Dirent;
       uint32_t sectorOffset,amountToCopy,sectorSize=_fs.getSectorSizeInBytes();
 
+      // only one handle may write to a file
+
+      if(!_writer && !_fs.claimWriter(*this))
+        return false;
+
       // need to get the file pointer on to a sector boundary
 
       if(_offset % sectorSize > 0) {
@@ -202,9 +239,13 @@ namespace stm32plus {
       dirent.sdir.DIR_WrtDate=d;
       dirent.sdir.DIR_WrtTime=t;
 
-      // write back the modified dirent
+      // write back the modified dirent and let the readers know
 
-      return _fs.writeDirectoryEntry(_dirent);
+      if(!_fs.writeDirectoryEntry(_dirent))
+        return false;
+
+      _fs.directoryEntryUpdated(*this);
+      return true;
     }
 
     /**
@@ -16,8 +16,12 @@ namespace stm32plus {
      */
 
     FatFileSystem::FatFileSystem(BlockDevice& blockDevice,const TimeProvider& timeProvider,const fat::BootSector& bootSector,uint32_t firstSectorIndex,uint32_t countOfClusters) :
-      FileSystem(blockDevice,timeProvider,firstSectorIndex) {
+      FileSystem(blockDevice,timeProvider,firstSectorIndex),
+      _fatSector(bootSector.BPB_BytsPerSec) {
 
+      _fatSectorIndex=NO_SECTOR;
+      _openFiles=nullptr;
+      _directoryCaches=nullptr;
       _countOfClusters=countOfClusters;
       _bootSector=bootSector; // struct copy
       _fatFirstSector=_bootSector.BPB_RsvdSecCnt; // sector index of the FAT
@@ -46,7 +50,6 @@ namespace stm32plus {
 
       ByteMemblock bootSectorBytes(blockDevice.getBlockSizeInBytes());
       fat::BootSector bs;
-      uint32_t rootDirSectors,fatSize,totalSectors,dataSectors,countOfClusters,firstSectorIndex;
 
       // read block zero
 
@@ -62,23 +65,45 @@ namespace stm32plus {
 
       memcpy(&bs,bootSectorBytes,sizeof(bs));
 
-      // is this REALLY a boot sector and not an MBR?
+      // is this REALLY a boot sector and not an MBR? If it's an MBR then use the first partition
 
-      if((bs.BS_jmpBoot[0]!=0xe9 && bs.BS_jmpBoot[0]!=0xeb) || bs.BPB_BytsPerSec!=512) {
+      if((bs.BS_jmpBoot[0]!=0xe9 && bs.BS_jmpBoot[0]!=0xeb) || bs.BPB_BytsPerSec!=512)
+        return getInstance(blockDevice,timeProvider,reinterpret_cast<Mbr *>(bootSectorBytes.getData())->partitions[0].lbaFirstSector,newFileSystem);
 
-        Mbr *mbr=reinterpret_cast<Mbr *>(bootSectorBytes.getData());
+      return getInstance(blockDevice,timeProvider,0,newFileSystem);
+    }
 
-        firstSectorIndex=mbr->partitions[0].lbaFirstSector;
-        if(!blockDevice.readBlock(bootSectorBytes,firstSectorIndex))
-          return false;
 
-        if(bootSectorBytes[510] != 0x55 || bootSectorBytes[511] != 0xaa)
-          return false;
+    /**
+     * Get the correct FAT implementation for the volume whose boot sector is at the given
+     * index on the block device.
+     *
+     * @param[in] blockDevice The block device that holds the file system.
+     * @param[in] timeProvider A provider of the current time.
+     * @param[in] firstSectorIndex The block index of the boot sector, e.g. the first sector of an MBR partition.
+     * @param[out] newFileSystem Reference to a caller supplied pointer that will be filled in with the appropriate FatFileSystem instance.
+     * The caller owns this pointer and must delete it when finished.
+     * @return false if it fails.
+     */
 
-        memcpy(&bs,bootSectorBytes,sizeof(bs));
-      }
-      else
-        firstSectorIndex=0;
+    bool FatFileSystem::getInstance(BlockDevice& blockDevice,const TimeProvider& timeProvider,uint32_t firstSectorIndex,FatFileSystem*& newFileSystem) {
+
+      ByteMemblock bootSectorBytes(blockDevice.getBlockSizeInBytes());
+      fat::BootSector bs;
+      uint32_t rootDirSectors,fatSize,totalSectors,dataSectors,countOfClusters;
+
+      // read the boot sector
+
+      if(!blockDevice.readBlock(bootSectorBytes,firstSectorIndex))
+        return false;
+
+      if(bootSectorBytes[510] != 0x55 || bootSectorBytes[511] != 0xaa)
+        return false;
+
+      memcpy(&bs,bootSectorBytes,sizeof(bs));
+
+      if((bs.BS_jmpBoot[0]!=0xe9 && bs.BS_jmpBoot[0]!=0xeb) || bs.BPB_SecPerClus==0)
+        return false;
 
       // check that the sector size matches
 
@@ -117,6 +142,15 @@ namespace stm32plus {
       else
         newFileSystem=new Fat32FileSystem(blockDevice,timeProvider,bs,firstSectorIndex,countOfClusters);
 
+      // complete any cluster chain update that was interrupted by a power loss. A failure here
+      // leaves the journal in place to be tried again next time.
+
+      FatJournal journal(*newFileSystem);
+
+      if(journal.locate(false))
+        journal.replay();
+
+      errorProvider.clear();
       return true;
     }
 
@@ -172,7 +206,6 @@ namespace stm32plus {
     bool FatFileSystem::readFatEntry(uint32_t clusterNumber,uint32_t& fatEntryForCluster) {
 
       uint32_t sectorIndex,fatEntOffset,fatOffset;
-      ByteMemblock sector(_bootSector.BPB_BytsPerSec);
 
       // get the byte offset into the fat of the cluster entry
 
@@ -183,14 +216,33 @@ namespace stm32plus {
       sectorIndex=_bootSector.BPB_RsvdSecCnt + (fatOffset / _bootSector.BPB_BytsPerSec);
       fatEntOffset=fatOffset % _bootSector.BPB_BytsPerSec;
 
-      // read the sector
+      // get the sector into the cache
 
-      if(!readSector(sectorIndex,sector))
+      if(!loadFatSector(sectorIndex))
         return false;
 
       // get the value from the fat
 
-      fatEntryForCluster=getFatEntryFromMemory(static_cast<uint8_t *> (sector) + fatEntOffset);
+      fatEntryForCluster=getFatEntryFromMemory(_fatSector.getData() + fatEntOffset);
+      return true;
+    }
+
+
+    /*
+     * Make sure the FAT sector cache holds the given sector
+     */
+
+    bool FatFileSystem::loadFatSector(uint32_t sectorIndex) {
+
+      if(sectorIndex==_fatSectorIndex)
+        return true;
+
+      if(!readSector(sectorIndex,_fatSector)) {
+        _fatSectorIndex=NO_SECTOR;
+        return false;
+      }
+
+      _fatSectorIndex=sectorIndex;
       return true;
     }
 
@@ -234,7 +286,9 @@ namespace stm32plus {
 
 
     /**
-     * Create a new directory.
+     * Create a new directory. The cluster is written with the "." and ".." entries before the
+     * entry is pointed at it so that a failure part way through cannot leave a directory
+     * that holds rubbish.
      * @param[in] dirname The full pathname to the new directory.
      * @return false if it fails.
      */
@@ -242,9 +296,8 @@ namespace stm32plus {
     bool FatFileSystem::createDirectory(const char *dirname) {
 
       DirectoryEntryWithLocation dirent;
-      DirectoryEntry dot,dotDot;
-      ByteMemblock sector(getSectorSizeInBytes());
-      uint8_t i;
+      DirectoryEntry *dots;
+      uint32_t cluster,firstSector,sectorSize,sectorsPerWrite,count,i;
 
       // create a file for this directory
 
@@ -257,53 +310,63 @@ namespace stm32plus {
       if(!getDirectoryEntry(tp,dirent))
         return false;
 
-      // open the file and write a single zero'd cluster
+      // allocate the cluster that will hold the directory
 
-      FatFile file(*this,dirent);
-      memset(sector,0,getSectorSizeInBytes());
+      if(!allocateNewCluster(0,cluster))
+        return false;
 
-      for(i=0;i < _bootSector.BPB_SecPerClus;i++)
-        if(!file.write(sector,getSectorSizeInBytes()))
-          return false;
+      // the cluster is written from a zero'd buffer of a few sectors
 
-      // copy back the dirent from the modified file
+      sectorSize=getSectorSizeInBytes();
+      sectorsPerWrite=std::min(static_cast<uint32_t>(DirectorySectorBatch::DEFAULT_CAPACITY),static_cast<uint32_t>(_bootSector.BPB_SecPerClus));
 
-      dirent=file.getDirectoryEntryWithLocation();
+      ByteMemblock sectors(sectorSize*sectorsPerWrite);
+      memset(sectors,0,sectorSize*sectorsPerWrite);
 
-      // create the "." and ".." entries
+      // create the "." and ".." entries at the start of the first sector
 
-      memset(&dot,0,sizeof(dot));
-      memset(&dotDot,0,sizeof(dotDot));
+      dots=reinterpret_cast<DirectoryEntry *>(sectors.getData());
 
-      memset(dot.sdir.DIR_Name,' ',sizeof(dot.sdir.DIR_Name));
-      dot.sdir.DIR_Name[0]='.';
-      dot.sdir.DIR_Attr=DirectoryEntry::ATTR_DIRECTORY;
-      dot.sdir.DIR_FstClusLO=dirent.Dirent.sdir.DIR_FstClusLO;
-      dot.sdir.DIR_FstClusHI=dirent.Dirent.sdir.DIR_FstClusHI;
-      dirent.copyTimesTo(dot);
+      memset(dots[0].sdir.DIR_Name,' ',sizeof(dots[0].sdir.DIR_Name));
+      dots[0].sdir.DIR_Name[0]='.';
+      dots[0].sdir.DIR_Attr=DirectoryEntry::ATTR_DIRECTORY;
+      dots[0].sdir.DIR_FstClusLO=cluster & 0xffff;
+      dots[0].sdir.DIR_FstClusHI=cluster >> 16;
+      dirent.copyTimesTo(dots[0]);
 
       // get the cluster number of the parent
 
-      if(!getParentDirectoryFirstCluster(tp,&dotDot.sdir.DIR_FstClusLO,&dotDot.sdir.DIR_FstClusHI))
+      if(!getParentDirectoryFirstCluster(tp,&dots[1].sdir.DIR_FstClusLO,&dots[1].sdir.DIR_FstClusHI))
         return false;
 
-      memset(dotDot.sdir.DIR_Name,' ',sizeof(dotDot.sdir.DIR_Name));
-      dotDot.sdir.DIR_Name[0]='.';
-      dotDot.sdir.DIR_Name[1]='.';
-      dotDot.sdir.DIR_Attr=DirectoryEntry::ATTR_DIRECTORY;
-      dirent.copyTimesTo(dotDot);
+      memset(dots[1].sdir.DIR_Name,' ',sizeof(dots[1].sdir.DIR_Name));
+      dots[1].sdir.DIR_Name[0]='.';
+      dots[1].sdir.DIR_Name[1]='.';
+      dots[1].sdir.DIR_Attr=DirectoryEntry::ATTR_DIRECTORY;
+      dirent.copyTimesTo(dots[1]);
 
-      // write the two special directories
+      // write the cluster, the rest of it is zeros
 
-      if(!file.seek(0,File::SeekStart))
-        return false;
+      firstSector=clusterToSector(cluster);
 
-      if(!file.write(&dot,sizeof(dot)) || !file.write(&dotDot,sizeof(dotDot)))
-        return false;
+      for(i=0;i<_bootSector.BPB_SecPerClus;i+=count) {
+
+        count=_bootSector.BPB_SecPerClus-i;
+        if(count>sectorsPerWrite)
+          count=sectorsPerWrite;
+
+        if(!(count==1 ? writeSector(firstSector+i,sectors) : writeSectors(firstSector+i,sectors,count)))
+          return false;
 
-      // now change the 'file' to be a directory and we're complete
+        if(i==0)
+          memset(dots,0,sizeof(DirectoryEntry)*2);
+      }
+
+      // now point the entry at the cluster and change the 'file' to be a directory
 
       dirent.Dirent.sdir.DIR_Attr=DirectoryEntry::ATTR_DIRECTORY;
+      dirent.Dirent.sdir.DIR_FstClusLO=cluster & 0xffff;
+      dirent.Dirent.sdir.DIR_FstClusHI=cluster >> 16;
       dirent.Dirent.sdir.DIR_FileSize=0;
 
       return writeDirectoryEntry(dirent);
@@ -345,20 +408,104 @@ namespace stm32plus {
 
       tp.resetRange();
 
-      // create the dirents for this new file
+      // create and write the dirents for this new file
+
+      retval=createDirents(it->getDirectoryEntryIterator(),tp.last());
+      delete it;
+      return retval;
+    }
+
+    /**
+     * Create several new files in the same directory. The path to the directory is followed
+     * once. Up to CREATE_BATCH_SIZE names are checked and placed in one pass over the directory
+     * and their entries are written with one flush. The new files have zero length. Files are
+     * created in order and it stops at the first failure, so the files before the one that
+     * failed will exist.
+     * @param[in] dirname The full pathname of the directory, "/" for the root.
+     * @param[in] filenames The names of the new files. These are names, not paths.
+     * @param[in] count The number of names.
+     * @return false if it fails.
+     */
+
+    bool FatFileSystem::createFiles(const char *dirname,const char *const *filenames,uint32_t count) {
+
+      FatDirectoryIterator *it;
+      LongNameDirentGenerator *generators[CREATE_BATCH_SIZE];
+      bool retval;
+      uint32_t i,j,batchSize,created;
+
+      if(!FatDirectoryIterator::getInstance(*this,dirname,it))
+        return false;
+
+      DirectoryEntryIterator& dir(it->getDirectoryEntryIterator());
+
+      retval=true;
+
+      for(i=0;i<count && retval;i+=created) {
+
+        // the batch ends before the first bad name
+
+        for(batchSize=0;batchSize<CREATE_BATCH_SIZE && i+batchSize<count;batchSize++) {
+
+          const char *filename=filenames[i+batchSize];
+
+          if(filename[0]=='\0' || strchr(filename,'/')!=nullptr)
+            break;
+        }
+
+        if(batchSize==0) {
+          retval=errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_INVALID_PATHNAME);
+          break;
+        }
+
+        for(j=0;j<batchSize;j++)
+          generators[j]=new LongNameDirentGenerator(filenames[i+j],0,0);
+
+        retval=dir.createEntries(generators,batchSize,created);
+
+        for(j=0;j<batchSize;j++)
+          delete generators[j];
+
+        if(!retval) {
+
+          if(errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_LONG_FILENAME_GENERATOR,LongNameDirentGenerator::E_FILE_EXISTS))
+            retval=errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_FILE_EXISTS);
+
+          // the short name tails for this name ran out. the single file path can try more
+          // hashes, it scans the directory again for each one.
+
+          else if(errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_LONG_FILENAME_GENERATOR,LongNameDirentGenerator::E_NO_UNIQUE_SHORT_NAME) &&
+                  createDirents(dir,filenames[i+created])) {
+            created++;
+            retval=true;
+          }
+        }
+      }
+
+      delete it;
+      return retval;
+    }
+
+    /*
+     * Generate and write the dirents for a new file. The generator scans the directory for the
+     * short name so it also finds a file that already exists.
+     */
+
+    bool FatFileSystem::createDirents(DirectoryEntryIterator& dir,const char *filename) {
 
-      LongNameDirentGenerator lndg(tp.last(),it->getDirectoryEntryIterator(),0,0);
+      LongNameDirentGenerator lndg(filename,dir,0,0);
 
       if(errorProvider.getLast() != 0) {
-        delete it;
+
+        if(errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_LONG_FILENAME_GENERATOR,LongNameDirentGenerator::E_FILE_EXISTS))
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_FILE_EXISTS);
+
         return false;
       }
 
       // write the dirents to the owning directory
 
-      retval=it->getDirectoryEntryIterator().writeDirents(lndg.getDirents(),lndg.getDirentCount());
-      delete it;
-      return retval;
+      return dir.writeDirents(lndg.getDirents(),lndg.getDirentCount());
     }
 
     /**
@@ -496,6 +643,8 @@ namespace stm32plus {
       DirectoryEntryWithLocation& dirent=it->getDirectoryEntryWithLocation();
       if(!dirent.isFile())
         retval=errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_NOT_A_FILE);
+      else if(isFileOpen(dirent))
+        retval=errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_FILE_IN_USE);
       else
         retval=fullyDelete(*it);
 
@@ -503,68 +652,213 @@ namespace stm32plus {
       return retval;
     }
 
-    /*
-     * deallocate and delete
+    /**
+     * Delete the files in a directory that a filter selects. This is one pass over the
+     * directory and the entries are written back a few sectors at a time, so clearing out
+     * a directory of thousands of files is much faster than calling deleteFile() for each.
+     * Subdirectories and open files are not offered to the filter.
+     * @param[in] dirname The full pathname of the directory, "/" for the root.
+     * @param[in] filter Called for each file. Set the bool parameter to true to delete the file.
+     * @param[out] deletedCount The number of files deleted.
+     * @return false if it fails. Files already deleted stay deleted.
      */
 
-    bool FatFileSystem::fullyDelete(FatDirectoryIterator& it) {
+    bool FatFileSystem::deleteFiles(const char *dirname,const FatDeleteFilterEventSourceSlot& filter,uint32_t& deletedCount) {
+
+      FatDirectoryIterator *it;
+      bool retval,deleteIt;
+
+      if(!FatDirectoryIterator::getInstance(*this,dirname,it))
+        return false;
+
+      DirectorySectorBatch batch(*this);
+
+      deletedCount=0;
+      retval=true;
+
+      while(retval && it->next()) {
+
+        DirectoryEntryWithLocation& dirent=it->getDirectoryEntryWithLocation();
+
+        if(!dirent.isFile() || isFileOpen(dirent))
+          continue;
+
+        deleteIt=false;
+        filter(it->current(),deleteIt);
+
+        if(deleteIt) {
+          retval=batch.deleteEntries(it->getDirectoryEntryIterator().getFilenameHandler(),getFirstCluster(dirent.Dirent));
+          deletedCount++;
+        }
+      }
+
+      // the iterator must have reached the end
+
+      if(retval)
+        retval=errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,DirectoryEntryIterator::E_END_OF_ENTRIES);
+
+      // write whatever is staged even if the scan failed
+
+      if(!batch.flush())
+        retval=false;
+
+      delete it;
+      return retval;
+    }
+
+    /**
+     * Delete a file, or a directory and everything in it. The directory is removed from its
+     * parent before anything in it is freed so a failure part way through can only leave lost
+     * clusters, never a directory that refers to freed ones. It fails without changing anything
+     * if any file in the tree is open.
+     * @param[in] pathname The full pathname of the file or directory.
+     * @return false if it fails.
+     */
 
-      DirectoryEntry& dirent=it.getDirectoryEntryWithLocation().Dirent;
+    bool FatFileSystem::deleteTree(const char *pathname) {
+
+      FatDirectoryIterator *it;
       uint32_t firstCluster;
+      bool retval,inUse;
+
+      // tokenise the path. can't delete the root directory
+
+      TokenisedPathname tp(pathname);
+      if(tp.getNumTokens() == 0)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_INVALID_PATHNAME);
+
+      if(!getDirectoryIteratorPointingToFile(tp,it))
+        return false;
+
+      DirectoryEntryWithLocation& dirent=it->getDirectoryEntryWithLocation();
+      firstCluster=getFirstCluster(dirent.Dirent);
 
-      // deallocate the cluster chain
+      if(it->isParentDirectory() || it->isCurrentDirectory())
+        retval=errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_INVALID_PATHNAME);
+      else if(dirent.isFile())
+        retval=isFileOpen(dirent) ? errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_FILE_IN_USE) : fullyDelete(*it);
+      else if(!dirent.isDirectory())
+        retval=errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_NOT_A_DIRECTORY);
+      else if(!treeHasOpenFile(firstCluster,inUse))
+        retval=false;
+      else if(inUse)
+        retval=errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_FILE_IN_USE);
+      else {
 
-      firstCluster=static_cast<uint32_t> (dirent.sdir.DIR_FstClusHI) << 16 | dirent.sdir.DIR_FstClusLO;
-      if(firstCluster != 0)
-        deAllocateClusterChain(firstCluster);
+        // unlink the directory then free everything that was in it
 
-      // free the dirents that made up this filename
+        retval=deleteDirents(*it) && (firstCluster==0 || deleteTreeClusters(firstCluster));
+      }
 
-      return deleteDirents(it);
+      delete it;
+      return retval;
     }
 
     /*
-     * delete the set of dirents that make up this file
+     * Check if any file in a directory tree is open
      */
 
-    bool FatFileSystem::deleteDirents(FatDirectoryIterator& fdi) {
+    bool FatFileSystem::treeHasOpenFile(uint32_t firstCluster,bool& inUse) {
 
-      uint32_t i;
-      FilenameHandler& fh=fdi.getDirectoryEntryIterator().getFilenameHandler();
-      ByteMemblock sector(getSectorSizeInBytes());
-      DirectoryEntry *de;
-      uint32_t lastSectorIndex,thisSectorIndex;
+      inUse=false;
 
-      lastSectorIndex=0;
-      for(i=0;i < fh.getDirentCount();i++) {
+      // nothing is tracked, nothing can be open
 
-        thisSectorIndex=fh.getSectorIndices()[i];
+      if(_openFiles==nullptr || firstCluster==0)
+        return true;
 
-        // read the sector holding the dirent
+      NormalDirectoryEntryIterator it(*this,firstCluster,DirectoryEntryIterator::OPT_DEFAULT_REAL_ENTRIES);
 
-        if(thisSectorIndex != lastSectorIndex) {
+      while(it.next()) {
 
-          if(lastSectorIndex != 0 && !writeSector(thisSectorIndex,sector))
-            return false;
+        DirectoryEntryWithLocation& dirent=it.current();
 
-          if(!readSector(thisSectorIndex,sector))
+        if(dirent.isFile()) {
+          if(isFileOpen(dirent)) {
+            inUse=true;
+            return true;
+          }
+        }
+        else if(dirent.isDirectory() && dirent.Dirent.sdir.DIR_Name[0]!='.') {
+          if(!treeHasOpenFile(getFirstCluster(dirent.Dirent),inUse))
             return false;
-
-          lastSectorIndex=thisSectorIndex;
+          if(inUse)
+            return true;
         }
+      }
+
+      return errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,DirectoryEntryIterator::E_END_OF_ENTRIES);
+    }
+
+    /*
+     * Free the clusters used by everything in a directory tree that's already been unlinked,
+     * then the directory itself. The entries inside are left alone because nothing can
+     * reach them now.
+     */
 
-        // get a pointer to the dirent and set the 'deleted' byte in the first char of the filename
+    bool FatFileSystem::deleteTreeClusters(uint32_t firstCluster) {
 
-        de=reinterpret_cast<DirectoryEntry *> (sector.getData() + fh.getSectorOffsetIndices()[i] * sizeof(DirectoryEntry));
-        de->sdir.DIR_Name[0]=0xe5;
+      uint32_t chains[16],count,cluster;
+
+      // the directory's own chain is freed after we've finished reading it
+
+      {
+        NormalDirectoryEntryIterator it(*this,firstCluster,DirectoryEntryIterator::OPT_DEFAULT_REAL_ENTRIES);
+
+        count=0;
+        while(it.next()) {
+
+          DirectoryEntryWithLocation& dirent=it.current();
+
+          if((cluster=getFirstCluster(dirent.Dirent))==0)
+            continue;
+
+          if(dirent.isFile()) {
+
+            chains[count++]=cluster;
+
+            if(count==sizeof(chains)/sizeof(chains[0])) {
+              if(!deAllocateClusterChains(chains,count))
+                return false;
+              count=0;
+            }
+          }
+          else if(dirent.isDirectory() && dirent.Dirent.sdir.DIR_Name[0]!='.') {
+            if(!deleteTreeClusters(cluster))
+              return false;
+          }
+        }
+
+        if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,DirectoryEntryIterator::E_END_OF_ENTRIES))
+          return false;
       }
 
-      // write back the sector
+      chains[count++]=firstCluster;
+      return deAllocateClusterChains(chains,count);
+    }
 
-      if(lastSectorIndex != 0 && !writeSector(lastSectorIndex,sector))
-        return false;
+    /*
+     * delete the dirents, then free the cluster chain. The other way around a failure in
+     * between would leave an entry that points at free clusters.
+     */
 
-      return true;
+    bool FatFileSystem::fullyDelete(FatDirectoryIterator& it) {
+
+      DirectorySectorBatch batch(*this);
+
+      return batch.deleteEntries(it.getDirectoryEntryIterator().getFilenameHandler(),getFirstCluster(it.getDirectoryEntryWithLocation().Dirent))
+          && batch.flush();
+    }
+
+    /*
+     * delete the set of dirents that make up this file
+     */
+
+    bool FatFileSystem::deleteDirents(FatDirectoryIterator& fdi) {
+
+      DirectorySectorBatch batch(*this);
+
+      return batch.deleteEntries(fdi.getDirectoryEntryIterator().getFilenameHandler(),0) && batch.flush();
     }
 
     /**
@@ -574,30 +868,69 @@ namespace stm32plus {
      */
 
     bool FatFileSystem::deAllocateClusterChain(uint32_t firstCluster) {
+      return deAllocateClusterChains(&firstCluster,1);
+    }
 
-      uint32_t clusterNumber;
+    /**
+     * De-allocate (free) several cluster chains. Entries are cleared in the cached FAT sector
+     * and it's written back only when the next entry is in a different sector, so a chain of
+     * mostly consecutive clusters costs one pair of sector writes per FAT sector rather than
+     * one pair per cluster. Failure may result in lost clusters.
+     * @param[in] firstClusters The first cluster in each chain.
+     * @param[in] count The number of chains.
+     * @return false if it fails.
+     */
 
-      // de-allocate every cluster in the chain
+    bool FatFileSystem::deAllocateClusterChains(const uint32_t *firstClusters,uint32_t count) {
 
-      ClusterChainIterator cit(*this,firstCluster,ClusterChainIterator::extensionDontExtend);
+      uint32_t i,cluster,next,fatOffset,sectorIndex;
+      uint8_t *entry;
+      bool dirty;
 
-      // free clusters by setting each one in the chain to zero one step behind the iterator
+      dirty=false;
 
-      clusterNumber=0;
-      while(cit.next()) {
+      for(i=0;i<count;i++) {
 
-        // free the last cluster number
+        for(cluster=firstClusters[i];cluster>=2 && cluster<_countOfClusters+2;cluster=next) {
 
-        if(clusterNumber != 0 && !writeFatEntry(clusterNumber,0))
-          return false;
+          fatOffset=cluster*getFatEntrySizeInBytes();
+          sectorIndex=_bootSector.BPB_RsvdSecCnt+fatOffset/_bootSector.BPB_BytsPerSec;
+
+          // write back the current sector before moving to another one
 
-        clusterNumber=cit.current();
+          if(sectorIndex!=_fatSectorIndex) {
+
+            if(dirty && !flushFatSector())
+              return false;
+
+            dirty=false;
+
+            if(!loadFatSector(sectorIndex))
+              return false;
+          }
+
+          entry=_fatSector.getData()+fatOffset%_bootSector.BPB_BytsPerSec;
+          next=getFatEntryFromMemory(entry);
+
+          // a free cluster in a chain means it's corrupt. stop rather than follow it.
+
+          if(next==0)
+            break;
+
+          setFatEntryToMemory(entry,0);
+          dirty=true;
+        }
       }
 
-      if(clusterNumber != 0 && !writeFatEntry(clusterNumber,0))
-        return false;
+      return !dirty || flushFatSector();
+    }
 
-      return true;
+    /*
+     * Get the first cluster from a directory entry
+     */
+
+    uint32_t FatFileSystem::getFirstCluster(const DirectoryEntry& dirent) {
+      return static_cast<uint32_t> (dirent.sdir.DIR_FstClusHI) << 16 | dirent.sdir.DIR_FstClusLO;
     }
 
     /*
@@ -743,9 +1076,9 @@ namespace stm32plus {
 
     bool FatFileSystem::allocateNewCluster(uint32_t anyClusterInChain,uint32_t& newCluster) {
 
-      // find a free cluster
+      // find a free cluster and mark it as the end of a chain before anything points at it
 
-      if(!findFreeCluster(newCluster))
+      if(!findFreeCluster(newCluster) || !writeFatEntry(newCluster,getEndOfClusterChainMarker()))
         return false;
 
       // step to the end of the cluster chain if this is not the first cluster in an empty file
@@ -761,15 +1094,13 @@ namespace stm32plus {
         if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,ClusterChainIterator::E_END_OF_ENTRIES))
           return false;
 
-        // link the free cluster to the previous EOC
+        // link the new cluster to the previous EOC
 
         if(!writeFatEntry(cit.current(),newCluster))
           return false;
       }
 
-      // write EOC to free cluster
-
-      return writeFatEntry(newCluster,getEndOfClusterChainMarker());
+      return true;
     }
 
     /**
@@ -783,7 +1114,6 @@ namespace stm32plus {
     bool FatFileSystem::writeFatEntry(uint32_t fatEntryIndex,uint32_t fatEntryContent) {
 
       uint32_t sectorIndex,fatEntOffset,fatOffset;
-      Memblock<uint8_t> sector(_bootSector.BPB_BytsPerSec);
 
       // get the byte offset into the fat of the cluster entry
 
@@ -794,24 +1124,34 @@ namespace stm32plus {
       sectorIndex=_bootSector.BPB_RsvdSecCnt + (fatOffset / _bootSector.BPB_BytsPerSec);
       fatEntOffset=fatOffset % _bootSector.BPB_BytsPerSec;
 
-      // read the sector from FAT #1
+      // get the sector from FAT #1 into the cache
 
-      if(!readSector(sectorIndex,sector))
+      if(!loadFatSector(sectorIndex))
         return false;
 
       // modify the value in the sector
 
-      setFatEntryToMemory(sector + fatEntOffset,fatEntryContent);
+      setFatEntryToMemory(_fatSector.getData() + fatEntOffset,fatEntryContent);
 
-      // write the sector back to FAT #1
+      // write the sector back to FAT #1 and FAT #2
 
-      if(!writeSector(sectorIndex,sector))
-        return false;
+      return flushFatSector();
+    }
 
-      // write the sector back to FAT #2 - big assumption here that FAT #1 and FAT#2 are identical
 
-      sectorIndex+=getSectorsPerFat();
-      return writeSector(sectorIndex,sector);
+    /*
+     * Write the cached FAT sector back to FAT #1 and FAT #2 - big assumption here that FAT #1 and FAT#2
+     * are identical. The cache is write-through so if this fails it no longer reflects the device.
+     */
+
+    bool FatFileSystem::flushFatSector() {
+
+      if(!writeSector(_fatSectorIndex,_fatSector) || !writeSector(_fatSectorIndex+getSectorsPerFat(),_fatSector)) {
+        _fatSectorIndex=NO_SECTOR;
+        return false;
+      }
+
+      return true;
     }
 
     /**
@@ -902,5 +1242,297 @@ namespace stm32plus {
       unitsMultiplier=static_cast<uint32_t> (_bootSector.BPB_SecPerClus) * getSectorSizeInBytes();
       return true;
     }
+
+
+    /**
+     * Write a sector to the file system. Any cached copy of the sector held by the FAT
+     * sector cache or a live directory sector cache is updated to match.
+     * @param[in] sectorIndex The sector index on the file system.
+     * @param[in] buffer The sector data.
+     * @return false if it fails.
+     */
+
+    bool FatFileSystem::writeSector(uint32_t sectorIndex,void *buffer) {
+
+      DirectorySectorCache *cache;
+
+      if(!FileSystem::writeSector(sectorIndex,buffer))
+        return false;
+
+      if(sectorIndex==_fatSectorIndex && buffer!=_fatSector.getData())
+        memcpy(_fatSector,buffer,getSectorSizeInBytes());
+
+      for(cache=_directoryCaches;cache;cache=cache->_next)
+        cache->sectorWritten(sectorIndex,buffer);
+
+      return true;
+    }
+
+
+    /**
+     * Write a run of sectors with one multi-block write and keep the caches up to date.
+     * @param[in] sectorIndex The first sector index on the file system.
+     * @param[in] buffer The sector data.
+     * @param[in] count The number of sectors.
+     * @return false if it fails.
+     */
+
+    bool FatFileSystem::writeSectors(uint32_t sectorIndex,void *buffer,uint32_t count) {
+
+      DirectorySectorCache *cache;
+      uint8_t *ptr;
+      uint32_t i;
+
+      if(!FileSystem::writeSectors(sectorIndex,buffer,count))
+        return false;
+
+      ptr=static_cast<uint8_t *>(buffer);
+
+      for(i=0;i<count;i++,ptr+=getSectorSizeInBytes()) {
+
+        if(sectorIndex+i==_fatSectorIndex)
+          memcpy(_fatSector,ptr,getSectorSizeInBytes());
+
+        for(cache=_directoryCaches;cache;cache=cache->_next)
+          cache->sectorWritten(sectorIndex+i,ptr);
+      }
+
+      return true;
+    }
+
+
+    /**
+     * Find a run of consecutive free clusters. The run starts at a free cluster located by the
+     * free cluster finder and extends for as long as the following clusters are also free.
+     * @param[in] maxCount The maximum length of the run.
+     * @param[out] firstCluster The first cluster in the run.
+     * @param[out] count The length of the run, between 1 and maxCount.
+     * @return false if there are no free clusters.
+     */
+
+    bool FatFileSystem::findFreeClusterRun(uint32_t maxCount,uint32_t& firstCluster,uint32_t& count) {
+
+      uint32_t entry;
+
+      if(!findFreeCluster(firstCluster))
+        return false;
+
+      // clusters are numbered from 2
+
+      for(count=1;count<maxCount && firstCluster+count<_countOfClusters+2;count++) {
+
+        if(!readFatEntry(firstCluster+count,entry))
+          return false;
+
+        if(entry!=0)
+          break;
+      }
+
+      return true;
+    }
+
+
+    /**
+     * Link a run of consecutive clusters into a chain terminated by the EOC marker. Each
+     * FAT sector touched by the run is written once rather than once per entry.
+     * @param[in] firstCluster The first cluster in the run.
+     * @param[in] count The number of clusters.
+     * @return false if it fails.
+     */
+
+    bool FatFileSystem::writeClusterRun(uint32_t firstCluster,uint32_t count) {
+
+      uint32_t i,cluster,fatOffset,sectorIndex;
+
+      for(i=0;i<count;i++) {
+
+        cluster=firstCluster+i;
+        fatOffset=cluster * getFatEntrySizeInBytes();
+        sectorIndex=_bootSector.BPB_RsvdSecCnt + (fatOffset / _bootSector.BPB_BytsPerSec);
+
+        // moving on to a new FAT sector? write back the one we've been modifying
+
+        if(sectorIndex!=_fatSectorIndex) {
+
+          if(i>0 && !flushFatSector())
+            return false;
+
+          if(!loadFatSector(sectorIndex))
+            return false;
+        }
+
+        setFatEntryToMemory(_fatSector.getData() + (fatOffset % _bootSector.BPB_BytsPerSec),i==count-1 ? getEndOfClusterChainMarker() : cluster+1);
+      }
+
+      return flushFatSector();
+    }
+
+
+    /**
+     * Open an existing file for journaled appending. See FatAppendFile.
+     * @param[in] filename The full pathname of the existing file.
+     * @param[in] journal The journal that protects the cluster chain updates. Must be open.
+     * @param[out] newFile The new file. The caller must delete it when finished.
+     * @param[in] batchSectors The number of sectors of data to buffer before writing.
+     * @param[in] preallocateClusters The number of clusters to allocate at a time.
+     * @return false if it fails, including if another handle is writing to the file.
+     */
+
+    bool FatFileSystem::openAppendFile(const char *filename,FatJournal& journal,FatAppendFile*& newFile,uint32_t batchSectors,uint32_t preallocateClusters) {
+
+      DirectoryEntryWithLocation dirent;
+      FatAppendFile *file;
+
+      TokenisedPathname tp(filename);
+      if(tp.getNumTokens() == 0)
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_INVALID_PATHNAME);
+
+      if(!getDirectoryEntry(tp,dirent))
+        return false;
+
+      if(!dirent.isFile())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILESYSTEM,E_NOT_A_FILE);
+
+      // create the file, take the write lock and locate the end of the data
+
+      file=new FatAppendFile(*this,dirent,journal,batchSectors,preallocateClusters);
+
+      if(!file->initialise() || !claimWriter(*file)) {
+        delete file;
+        return false;
+      }
+
+      newFile=file;
+      return true;
+    }
+
+
+    /**
+     * Register a newly opened file
+     * @param[in] file The file
+     */
+
+    void FatFileSystem::fileOpened(FatFile& file) {
+      file._nextOpen=_openFiles;
+      _openFiles=&file;
+    }
+
+
+    /**
+     * Unregister a file that is being deleted
+     * @param[in] file The file
+     */
+
+    void FatFileSystem::fileClosed(FatFile& file) {
+
+      FatFile **ptr;
+
+      for(ptr=&_openFiles;*ptr;ptr=&(*ptr)->_nextOpen) {
+        if(*ptr==&file) {
+          *ptr=file._nextOpen;
+          return;
+        }
+      }
+    }
+
+
+    /**
+     * Make a file handle the writer for its file. This fails if another handle on the same
+     * file is already the writer.
+     * @param[in] file The file handle that wants to write.
+     * @return false if the file is locked by another handle.
+     */
+
+    bool FatFileSystem::claimWriter(FatFile& file) {
+
+      FatFile *f;
+
+      for(f=_openFiles;f;f=f->_nextOpen)
+        if(f!=&file && f->_writer && f->isSameFile(file._dirent))
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FILE,File::E_FILE_LOCKED);
+
+      file._writer=true;
+      return true;
+    }
+
+
+    /**
+     * The writer has updated its directory entry. Pass it on to the other handles
+     * on the same file.
+     * @param[in] file The writer
+     */
+
+    void FatFileSystem::directoryEntryUpdated(const FatFile& file) {
+
+      FatFile *f;
+
+      for(f=_openFiles;f;f=f->_nextOpen)
+        if(f!=&file && f->isSameFile(file._dirent))
+          f->directoryEntryUpdated(file._dirent.Dirent);
+    }
+
+
+    /**
+     * Check if there's an open handle on the file with this directory entry
+     * @param[in] dirent The directory entry
+     * @return true if it's open
+     */
+
+    bool FatFileSystem::isFileOpen(const DirectoryEntryWithLocation& dirent) const {
+
+      FatFile *f;
+
+      for(f=_openFiles;f;f=f->_nextOpen)
+        if(f->isSameFile(dirent))
+          return true;
+
+      return false;
+    }
+
+
+    /**
+     * Get the number of open file handles
+     * @return The number of handles
+     */
+
+    uint32_t FatFileSystem::getOpenFileCount() const {
+
+      FatFile *f;
+      uint32_t count;
+
+      for(count=0,f=_openFiles;f;f=f->_nextOpen)
+        count++;
+
+      return count;
+    }
+
+
+    /**
+     * Register a directory sector cache so that it's kept up to date with sector writes
+     * @param[in] cache The cache
+     */
+
+    void FatFileSystem::cacheCreated(DirectorySectorCache& cache) {
+      cache._next=_directoryCaches;
+      _directoryCaches=&cache;
+    }
+
+
+    /**
+     * Unregister a directory sector cache
+     * @param[in] cache The cache
+     */
+
+    void FatFileSystem::cacheDestroyed(DirectorySectorCache& cache) {
+
+      DirectorySectorCache **ptr;
+
+      for(ptr=&_directoryCaches;*ptr;ptr=&(*ptr)->_next) {
+        if(*ptr==&cache) {
+          *ptr=cache._next;
+          return;
+        }
+      }
+    }
   }
 }
@@ -16,7 +16,7 @@ namespace stm32plus {
      * Constructor
      */
 
-    FatFileSystemFormatter::FatFileSystemFormatter(BlockDevice& blockDevice_,uint32_t firstSectorIndex_,uint32_t numSectors_,const char *volumeLabel_)
+    FatFileSystemFormatter::FatFileSystemFormatter(BlockDevice& blockDevice_,uint32_t firstSectorIndex_,uint32_t numSectors_,const char *volumeLabel_,uint32_t alignment_,const FatFormatProgressEventSourceSlot *progress_)
       : _blockDevice(blockDevice_) {
 
       int i;
@@ -31,6 +31,10 @@ namespace stm32plus {
 
       _numSectors=numSectors_;
       _firstSectorIndex=firstSectorIndex_;
+      _alignment=alignment_ ? alignment_ : 1;
+      _progress=progress_;
+      _sectorsWritten=0;
+      _sectorsToWrite=0;
     }
 
 
@@ -57,6 +61,84 @@ namespace stm32plus {
       return true;
     }
 
+
+    /*
+     * Get the number of sectors to add to the reserved area so that the data region starts on
+     * an alignment boundary. systemSectors is the number of sectors between the end of the
+     * reserved area and the start of the data region (the FATs and any fixed root directory).
+     */
+
+    uint32_t FatFileSystemFormatter::getAlignmentPadding(uint32_t systemSectors) const {
+
+      uint32_t remainder;
+
+      remainder=(_firstSectorIndex+_bootSector.BPB_RsvdSecCnt+systemSectors) % _alignment;
+      return remainder ? _alignment-remainder : 0;
+    }
+
+
+    /*
+     * Set the total number of sectors that will be written and report the start
+     */
+
+    void FatFileSystemFormatter::beginProgress(uint32_t totalSectors_) {
+
+      _sectorsWritten=0;
+      _sectorsToWrite=totalSectors_;
+
+      if(_progress)
+        (*_progress)(_sectorsWritten,_sectorsToWrite);
+    }
+
+
+    /*
+     * Write a single sector and report progress
+     */
+
+    bool FatFileSystemFormatter::writeSector(const void *sector_,uint32_t sectorIndex_) {
+
+      if(!_blockDevice.writeBlock(sector_,sectorIndex_))
+        return false;
+
+      _sectorsWritten++;
+
+      if(_progress)
+        (*_progress)(_sectorsWritten,_sectorsToWrite);
+
+      return true;
+    }
+
+
+    /*
+     * Zero a run of sectors using multi-block writes from a zeroed buffer
+     */
+
+    bool FatFileSystemFormatter::zeroSectors(uint32_t firstSectorIndex_,uint32_t count_) {
+
+      ByteMemblock zeros(512*ZERO_BUFFER_SECTORS);
+      uint32_t batch;
+
+      memset(zeros,0,512*ZERO_BUFFER_SECTORS);
+
+      while(count_) {
+
+        batch=count_<ZERO_BUFFER_SECTORS ? count_ : ZERO_BUFFER_SECTORS;
+
+        if(!_blockDevice.writeBlocks(zeros,firstSectorIndex_,batch))
+          return false;
+
+        firstSectorIndex_+=batch;
+        count_-=batch;
+        _sectorsWritten+=batch;
+
+        if(_progress)
+          (*_progress)(_sectorsWritten,_sectorsToWrite);
+      }
+
+      return true;
+    }
+
+
     /*
      * Format a boot sector and write it to disk
      */
@@ -67,9 +149,7 @@ namespace stm32plus {
 
     // create a new boot sector at the start of the block
 
-      if(!createNewBootSector())
-        return false;
-
+      memset(sector,0,512);
       memcpy(sector.getData(),&_bootSector,sizeof(_bootSector));
 
     // write signature to sector
@@ -78,7 +158,7 @@ namespace stm32plus {
 
     // write to the device
 
-      return _blockDevice.writeBlock(sector,bootSectorIndex_);
+      return writeSector(sector,bootSectorIndex_);
     }
 
 
@@ -97,10 +177,15 @@ namespace stm32plus {
      * Format the FAT structures
      */
 
-    bool FatFileSystemFormatter::writeFats(uint32_t firstFatFirstSector_,uint32_t sectorsPerFat_) const {
+    bool FatFileSystemFormatter::writeFats(uint32_t firstFatFirstSector_,uint32_t sectorsPerFat_) {
 
       ByteMemblock sector(512);
-      uint32_t i,j,sectorIndex;
+      uint32_t i,sectorIndex;
+
+      // initialise the two reserved clusters
+
+      memset(sector,0,512);
+      initReservedClusters(sector);
 
       // two copies of the FAT, back to back
 
@@ -108,22 +193,12 @@ namespace stm32plus {
 
       for(i=0;i<2;i++) {
 
-        // initialise the two reserved clusters
+        // write the first sector and zero the rest
 
-        memset(sector,0,512);
-        initReservedClusters(sector);
-
-        // write this sector
-        if(!_blockDevice.writeBlock(sector,sectorIndex++))
+        if(!writeSector(sector,sectorIndex) || !zeroSectors(sectorIndex+1,sectorsPerFat_-1))
           return false;
 
-        // write the remaining sectors
-
-        memset(sector,0,512);
-
-        for(j=0;j<sectorsPerFat_;j++)
-          if(!_blockDevice.writeBlock(sector,sectorIndex++))
-            return false;
+        sectorIndex+=sectorsPerFat_;
       }
 
       // done
@@ -149,10 +224,11 @@ namespace stm32plus {
 
 
     /*
-     * Initialise and write the root directory entries
+     * Initialise and write the root directory entries. The whole directory is zeroed
+     * so that no stale entries from a previous format survive.
      */
 
-    bool FatFileSystemFormatter::writeRootDirectoryEntries(uint32_t sectorIndex_) const {
+    bool FatFileSystemFormatter::writeRootDirectoryEntries(uint32_t sectorIndex_,uint32_t sectorCount_) {
 
       ByteMemblock sector(512);
 
@@ -161,9 +237,9 @@ namespace stm32plus {
       memset(sector.getData(),0,512);
       initVolumeLabelDirent(sector);
 
-      // write to the device
+      // write to the device and zero the remainder
 
-      return _blockDevice.writeBlock(sector,sectorIndex_);
+      return writeSector(sector,sectorIndex_) && zeroSectors(sectorIndex_+1,sectorCount_-1);
     }
   }
 }
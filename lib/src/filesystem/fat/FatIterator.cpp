@@ -28,7 +28,7 @@ namespace stm32plus {
       _lastSectorIndex=UINT32_MAX;
       _wrap=wrap_;
       _first=true;
-      _entriesPerFat=_fs.getCountOfClusters();
+      _entriesPerFat=_fs.getCountOfClusters()+2;       // clusters are numbered from 2
     }
 
     /**
@@ -67,10 +67,13 @@ namespace stm32plus {
 
       // read the sector if it's new
 
-      if(sectorIndex!=_lastSectorIndex)
+      if(sectorIndex!=_lastSectorIndex) {
         if(!_fs.readSector(sectorIndex,_sectorBuffer))
           return false;
 
+        _lastSectorIndex=sectorIndex;
+      }
+
       // done
 
       return true;
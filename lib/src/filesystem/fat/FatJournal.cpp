@@ -0,0 +1,360 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/filesystem.h"
+
+
+namespace stm32plus {
+  namespace fat {
+
+    /*
+     * The journal file in the root directory
+     */
+
+    const char *const FatJournal::FILENAME="/FATJRNL.SYS";
+
+
+    /**
+     * Constructor. The journal must be located with open() or locate() before use.
+     * @param[in] fs_ The file system. Must stay in scope.
+     */
+
+    FatJournal::FatJournal(FatFileSystem& fs_)
+      : _fs(fs_),
+        _sector(fs_.getSectorSizeInBytes()),
+        _sectorIndex(0),
+        _sequence(0) {
+    }
+
+
+    /**
+     * Locate or create the journal file and replay any update that was interrupted
+     * @return false if it fails.
+     */
+
+    bool FatJournal::open() {
+      return locate(true) && replay();
+    }
+
+
+    /**
+     * Find the sector that holds the journal record
+     * @param[in] create true to create the journal file if it does not exist
+     * @return false if it fails or the file does not exist and create is false
+     */
+
+    bool FatJournal::locate(bool create) {
+
+      File *file;
+      uint32_t firstCluster;
+      bool retval;
+
+      _sectorIndex=0;
+
+      if(!_fs.openFile(FILENAME,file)) {
+
+        if(!create || !_fs.createFile(FILENAME) || !_fs.openFile(FILENAME,file))
+          return false;
+      }
+
+      // a new journal gets one sector of zeros, which is a clean journal
+
+      retval=true;
+
+      if(file->getLength()<_fs.getSectorSizeInBytes()) {
+        memset(_sector,0,_fs.getSectorSizeInBytes());
+        retval=file->write(_sector,_fs.getSectorSizeInBytes());
+      }
+
+      // the record is in the first sector of the first cluster
+
+      if(retval) {
+        const DirectoryEntry& dirent=static_cast<FatFile *>(file)->getDirectoryEntryWithLocation().Dirent;
+        firstCluster=(static_cast<uint32_t>(dirent.sdir.DIR_FstClusHI) << 16) | dirent.sdir.DIR_FstClusLO;
+
+        if(firstCluster<2)
+          retval=errorProvider.set(ErrorProvider::ERROR_PROVIDER_FAT_JOURNAL,E_INVALID_JOURNAL);
+        else
+          _sectorIndex=_fs.clusterToSector(firstCluster);
+      }
+
+      delete file;
+      return retval;
+    }
+
+
+    /**
+     * Read the journal record and repeat the operation that it describes, if any. A record
+     * that fails the checksum was never completely written, so its operation was never
+     * started and it's ignored.
+     * @return false if it fails.
+     */
+
+    bool FatJournal::replay() {
+
+      Record record;
+
+      if(!isOpen())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FAT_JOURNAL,E_NOT_OPEN);
+
+      if(!_fs.readSector(_sectorIndex,_sector))
+        return false;
+
+      memcpy(&record,_sector,sizeof(record));
+
+      if(record.magic!=MAGIC || record.checksum!=calculateChecksum(record))
+        return true;
+
+      _sequence=record.sequence;
+
+      if(record.operation==OP_NONE)
+        return true;
+
+      return apply(record) && clearRecord();
+    }
+
+
+    /**
+     * Link a run of consecutive free clusters on to the end of a file's cluster chain
+     * @param[in] tailCluster The current last cluster in the chain, or zero if the file has no clusters.
+     * @param[in] firstCluster The first cluster in the run.
+     * @param[in] clusterCount The number of clusters in the run.
+     * @param[in] dirent The file's directory entry. The first cluster is updated on the device if tailCluster is zero.
+     * @return false if it fails.
+     */
+
+    bool FatJournal::extendChain(uint32_t tailCluster,uint32_t firstCluster,uint32_t clusterCount,const DirectoryEntryWithLocation& dirent) {
+
+      Record record;
+
+      if(!writeRecord(OP_EXTEND,tailCluster,firstCluster,clusterCount,dirent))
+        return false;
+
+      memcpy(&record,_sector,sizeof(record));
+      return applyExtend(record) && clearRecord();
+    }
+
+
+    /**
+     * Free all the clusters in a file's chain after the given cluster
+     * @param[in] tailCluster The last cluster to keep, or zero to free them all.
+     * @param[in] dirent The file's directory entry. The first cluster is zeroed on the device if tailCluster is zero.
+     * @return false if it fails.
+     */
+
+    bool FatJournal::trimChain(uint32_t tailCluster,const DirectoryEntryWithLocation& dirent) {
+
+      Record record;
+      uint32_t head;
+
+      // find the head of the part to be freed
+
+      if(tailCluster==0) {
+        if(!getFirstCluster(dirent.SectorNumber,dirent.IndexWithinSector,head))
+          return false;
+      }
+      else if(!_fs.readFatEntry(tailCluster,head))
+        return false;
+
+      // nothing to do?
+
+      if(head<2 || _fs.isEndOfClusterChainMarker(head))
+        return true;
+
+      if(!writeRecord(OP_TRIM,tailCluster,head,0,dirent))
+        return false;
+
+      memcpy(&record,_sector,sizeof(record));
+      return applyTrim(record) && clearRecord();
+    }
+
+
+    /*
+     * Write a new journal record
+     */
+
+    bool FatJournal::writeRecord(Operation op,uint32_t tailCluster,uint32_t firstCluster,uint32_t clusterCount,const DirectoryEntryWithLocation& dirent) {
+
+      Record *record;
+
+      if(!isOpen())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FAT_JOURNAL,E_NOT_OPEN);
+
+      memset(_sector,0,_fs.getSectorSizeInBytes());
+      record=reinterpret_cast<Record *>(_sector.getData());
+
+      record->magic=MAGIC;
+      record->sequence=++_sequence;
+      record->operation=op;
+      record->tailCluster=tailCluster;
+      record->firstCluster=firstCluster;
+      record->clusterCount=clusterCount;
+      record->direntSector=dirent.SectorNumber;
+      record->direntIndex=dirent.IndexWithinSector;
+      record->checksum=calculateChecksum(*record);
+
+      return _fs.writeSector(_sectorIndex,_sector);
+    }
+
+
+    /*
+     * Mark the journal clean
+     */
+
+    bool FatJournal::clearRecord() {
+
+      Record *record;
+
+      memset(_sector,0,_fs.getSectorSizeInBytes());
+      record=reinterpret_cast<Record *>(_sector.getData());
+
+      record->magic=MAGIC;
+      record->sequence=++_sequence;
+      record->operation=OP_NONE;
+      record->checksum=calculateChecksum(*record);
+
+      return _fs.writeSector(_sectorIndex,_sector);
+    }
+
+
+    /*
+     * Carry out a journalled operation
+     */
+
+    bool FatJournal::apply(const Record& record) {
+
+      switch(record.operation) {
+
+        case OP_EXTEND:
+          return applyExtend(record);
+
+        case OP_TRIM:
+          return applyTrim(record);
+
+        default:
+          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_FAT_JOURNAL,E_INVALID_JOURNAL);
+      }
+    }
+
+
+    /*
+     * Extend: the run is fully linked and terminated before the old tail (or the directory
+     * entry) is pointed at it, so the chain never references a free cluster.
+     */
+
+    bool FatJournal::applyExtend(const Record& record) {
+
+      if(!_fs.writeClusterRun(record.firstCluster,record.clusterCount))
+        return false;
+
+      if(record.tailCluster)
+        return _fs.writeFatEntry(record.tailCluster,record.firstCluster);
+
+      return setFirstCluster(record.direntSector,record.direntIndex,record.firstCluster);
+    }
+
+
+    /*
+     * Trim: detach the unwanted part of the chain then free it in one pass from the head.
+     * The successor is read before each cluster is freed. If this is interrupted then a
+     * repeat finds the head already free and stops, leaving the rest of the detached chain
+     * as lost clusters. That wastes space but never corrupts the file, which no longer
+     * references any of it.
+     */
+
+    bool FatJournal::applyTrim(const Record& record) {
+
+      uint32_t cluster,next;
+
+      // detach
+
+      if(record.tailCluster) {
+        if(!_fs.writeFatEntry(record.tailCluster,_fs.getEndOfClusterChainMarker()))
+          return false;
+      }
+      else if(!setFirstCluster(record.direntSector,record.direntIndex,0))
+        return false;
+
+      for(cluster=record.firstCluster;;cluster=next) {
+
+        if(!_fs.readFatEntry(cluster,next))
+          return false;
+
+        // already freed by an earlier attempt?
+
+        if(next==0)
+          return true;
+
+        if(!_fs.writeFatEntry(cluster,0))
+          return false;
+
+        if(next<2 || next>=_fs.getCountOfClusters()+2 || _fs.isEndOfClusterChainMarker(next))
+          return true;
+      }
+    }
+
+
+    /*
+     * Update the first cluster in a directory entry on the device
+     */
+
+    bool FatJournal::setFirstCluster(uint32_t direntSector,uint32_t direntIndex,uint32_t cluster) {
+
+      DirectoryEntry *dirent;
+      ByteMemblock sector(_fs.getSectorSizeInBytes());
+
+      if(!_fs.readSector(direntSector,sector))
+        return false;
+
+      dirent=reinterpret_cast<DirectoryEntry *>(sector.getData())+direntIndex;
+      dirent->sdir.DIR_FstClusLO=cluster & 0xFFFF;
+      dirent->sdir.DIR_FstClusHI=cluster >> 16;
+
+      return _fs.writeSector(direntSector,sector);
+    }
+
+
+    /*
+     * Read the first cluster from a directory entry on the device
+     */
+
+    bool FatJournal::getFirstCluster(uint32_t direntSector,uint32_t direntIndex,uint32_t& cluster) {
+
+      const DirectoryEntry *dirent;
+      ByteMemblock sector(_fs.getSectorSizeInBytes());
+
+      if(!_fs.readSector(direntSector,sector))
+        return false;
+
+      dirent=reinterpret_cast<const DirectoryEntry *>(sector.getData())+direntIndex;
+      cluster=(static_cast<uint32_t>(dirent->sdir.DIR_FstClusHI) << 16) | dirent->sdir.DIR_FstClusLO;
+
+      return true;
+    }
+
+
+    /*
+     * FNV-1a hash of the record, excluding the checksum itself
+     */
+
+    uint32_t FatJournal::calculateChecksum(const Record& record) {
+
+      const uint8_t *ptr;
+      uint32_t i,hash;
+
+      ptr=reinterpret_cast<const uint8_t *>(&record);
+      hash=2166136261U;
+
+      for(i=0;i<offsetof(Record,checksum);i++) {
+        hash^=ptr[i];
+        hash*=16777619U;
+      }
+
+      return hash;
+    }
+  }
+}
@@ -69,6 +69,17 @@ namespace stm32plus {
     }
 
 
+  /**
+   * Get the number of sectors from the current sector to the end of the current cluster,
+   * including the current sector. These sectors are consecutive on the device.
+   * @return The number of sectors.
+   */
+
+    uint32_t FileSectorIterator::getSectorsRemainingInCluster() const {
+      return _sectorsPerCluster-_sectorIndexInCluster;
+    }
+
+
   /**
    * Read sector from the cluster.
    * @param buffer_ A caller-supplied buffer that will receive the sector data.
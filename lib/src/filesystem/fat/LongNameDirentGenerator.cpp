@@ -22,7 +22,7 @@ namespace stm32plus {
      */
 
     LongNameDirentGenerator::LongNameDirentGenerator(const char *longName_,DirectoryEntryIterator& targetDir_,uint16_t createDate_,uint16_t createTime_)
-      : _targetDir(targetDir_),
+      : _targetDir(&targetDir_),
         _longName(longName_),
         _dirents(nullptr),
         _createDate(createDate_),
@@ -33,6 +33,27 @@ namespace stm32plus {
         errorProvider.clear();
     }
 
+    /**
+     * Constructor for batch use. The dirents are not generated until the caller has passed every
+     * entry in the target directory to scanEntry() and then called generate().
+     *
+     * @param[in] longName_ The desired long name for the new file.
+     * @param[in] createDate_ The creation date of the new file.
+     * @param[in] createTime_ The creation time of the new file. The tenths field will be set to zero.
+     */
+
+    LongNameDirentGenerator::LongNameDirentGenerator(const char *longName_,uint16_t createDate_,uint16_t createTime_)
+      : _targetDir(nullptr),
+        _longName(longName_),
+        _dirents(nullptr),
+        _createDate(createDate_),
+        _createTime(createTime_),
+        _currentIteratorIndex(-1) {
+
+      calculateDirentCount();
+      beginScan(0);
+    }
+
     /**
      * Virtual destructor, frees memory used by the directory entries.
      */
@@ -61,17 +82,75 @@ namespace stm32plus {
       return _dirents;
     }
 
+    /**
+     * Get the long name.
+     * @return The name that the dirents are for.
+     */
+
+    const char *LongNameDirentGenerator::getLongName() const {
+      return _longName;
+    }
+
+    /**
+     * Check an entry in the target directory during a batch scan.
+     * @param[in] filename_ The long name of the entry, or its short name if it has no long name.
+     * @param[in] direntName_ The 11 character short name of the entry.
+     * @return false if the entry has the same name as the new file. The error provider is set.
+     */
+
+    bool LongNameDirentGenerator::scanEntry(const char *filename_,const uint8_t *direntName_) {
+
+      if(_salt==0 && !strcasecmp(filename_,_longName))
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_LONG_FILENAME_GENERATOR,E_FILE_EXISTS);
+
+      if(_direntCount>1) {
+        markTailIfUsed(direntName_,_shortName,_plainTails,PLAIN_TAIL_LIMIT);
+        markTailIfUsed(direntName_,_hashedName,_hashedTails,HASHED_TAIL_LIMIT);
+      }
+
+      return true;
+    }
+
+    /**
+     * Generate the dirents after a batch scan.
+     * @return false if all the tails on both basis names are taken. The error provider is set and the
+     * caller should use the constructor that scans the directory, which can try other hashes.
+     */
+
+    bool LongNameDirentGenerator::generate() {
+
+      if(!selectShortName())
+        return errorProvider.set(ErrorProvider::ERROR_PROVIDER_LONG_FILENAME_GENERATOR,E_NO_UNIQUE_SHORT_NAME);
+
+      buildDirents();
+      return true;
+    }
+
     /*
      * Generate the DirectoryEntry structures from the long name
      */
 
     bool LongNameDirentGenerator::generateDirentsFromLongName() {
 
-      char shortName[12];
-      int namelen=0;
-      DirectoryEntry *de;
-      const char *src;
-      uint8_t checksum,ordinal;
+      calculateDirentCount();
+
+      // check for unique name. Only long names can have the short name
+      // modified up
+
+      if(!findUniqueShortName())
+        return false; // FAIL.
+
+      buildDirents();
+      return true;
+    }
+
+    /*
+     * Work out how many dirents the name needs
+     */
+
+    void LongNameDirentGenerator::calculateDirentCount() {
+
+      int namelen;
 
       // if the long name is a valid short name then there will be only
       // 1 dirent for the short name
@@ -85,12 +164,18 @@ namespace stm32plus {
         namelen=strlen(_longName);
         _direntCount=(namelen / 13) + (namelen % 13 == 0 ? 1 : 2);
       }
+    }
 
-      // check for unique name. Only long names can have the short name
-      // modified up
+    /*
+     * Create the dirents using the short name that's been selected
+     */
 
-      if(!findUniqueShortName(shortName))
-        return false; // FAIL.
+    void LongNameDirentGenerator::buildDirents() {
+
+      int namelen=0;
+      DirectoryEntry *de;
+      const char *src;
+      uint8_t checksum,ordinal;
 
       // need memory for these structures
 
@@ -100,7 +185,7 @@ namespace stm32plus {
 
       de=&_dirents[_direntCount - 1];
 
-      memcpy(de->sdir.DIR_Name,shortName,11);
+      memcpy(de->sdir.DIR_Name,_shortName,11);
       de->sdir.DIR_Attr=DirectoryEntry::ATTR_ARCHIVE;
       de->sdir.DIR_CrtDate=de->sdir.DIR_LstAccDate=de->sdir.DIR_WrtDate=_createDate;
       de->sdir.DIR_CrtTime=de->sdir.DIR_WrtTime=_createTime;
@@ -114,6 +199,7 @@ namespace stm32plus {
         // create the long entries
 
         src=_longName;
+        namelen=strlen(_longName);
         checksum=shortNameChecksum(_dirents[_direntCount - 1].sdir.DIR_Name);
         ordinal=1;
 
@@ -142,67 +228,176 @@ namespace stm32plus {
           copyChars(src,namelen,de->ldir.LDIR_Name3,2);
         }
       }
-
-      return true;
     }
 
     /*
-     * find unique short name for the long name
+     * find unique short name for the long name. The directory is scanned once per hash
+     * attempt and almost always only once in total.
      */
 
-    bool LongNameDirentGenerator::findUniqueShortName(char *shortName_) {
+    bool LongNameDirentGenerator::findUniqueShortName() {
 
-      char lossyName[11];
-      int tailNumber;
-      bool found;
+      uint16_t salt;
+
+      for(salt=0;salt<MAX_HASH_ATTEMPTS;salt++) {
+
+        beginScan(salt);
 
-      _targetDir.reset();
+        _targetDir->reset();
 
-      // first pass through to ensure that the filename is unique
+        // single pass: ensure that the filename is unique and collect the tails in use
 
-      while(_targetDir.next()) {
-        if(!strcasecmp(_targetDir.getFilename(),_longName))
-          return errorProvider.set(ErrorProvider::ERROR_PROVIDER_LONG_FILENAME_GENERATOR,E_FILE_EXISTS);
+        while(_targetDir->next())
+          if(!scanEntry(_targetDir->getFilename(),_targetDir->current().Dirent.sdir.DIR_Name))
+            return false;
+
+        if(selectShortName())
+          return true;
       }
 
-      // generate the short name
+      return errorProvider.set(ErrorProvider::ERROR_PROVIDER_LONG_FILENAME_GENERATOR,E_NO_UNIQUE_SHORT_NAME);
+    }
+
+    /*
+     * Get ready to scan the directory with the hashed basis for this salt. The first
+     * scan also generates the plain basis.
+     */
+
+    void LongNameDirentGenerator::beginScan(uint16_t salt_) {
+
+      _salt=salt_;
+
+      if(_salt==0)
+        generateShortName(_shortName);
+
+      generateHashedShortName(_shortName,_hashedName,_salt);
+
+      memset(_plainTails,0,sizeof(_plainTails));
+      memset(_hashedTails,0,sizeof(_hashedTails));
+    }
+
+    /*
+     * Choose the short name from the tails that were found in use. Prefer a low tail on the
+     * plain basis, then any tail on the hashed basis.
+     * @return false if they're all taken
+     */
 
-      generateShortName(shortName_);
+    bool LongNameDirentGenerator::selectShortName() {
+
+      char lossyName[11];
+      int tailNumber;
 
       // if there will only one dirent then that's it
 
       if(_direntCount == 1)
         return true;
 
-      // now need to ensure that the short name does not clash with another
-      // start the process by checking the unadulterated short name
+      if((tailNumber=findFreeTail(_plainTails,PLAIN_TAIL_LIMIT))!=0)
+        computeLossyShortName(_shortName,lossyName,tailNumber);
+      else if((tailNumber=findFreeTail(_hashedTails,HASHED_TAIL_LIMIT))!=0)
+        computeLossyShortName(_hashedName,lossyName,tailNumber);
+      else
+        return false;
 
-      for(tailNumber=1,found=true;found;tailNumber++) {
+      // keep the current find
 
-        // compute the lossy name
+      memcpy(_shortName,lossyName,11);
+      return true;
+    }
 
-        computeLossyShortName(shortName_,lossyName,tailNumber);
+    /*
+     * Generate the hashed basis name: the first two characters of the basis followed by
+     * four hex digits of a hash of the long name. The extension is unchanged.
+     */
 
-        _targetDir.reset();
-        found=false;
+    void LongNameDirentGenerator::generateHashedShortName(const char *shortName_,char *hashedName_,uint16_t salt_) const {
 
-        // search directory entries
+      static const char *hexDigits="0123456789ABCDEF";
 
-        while(_targetDir.next()) {
+      uint32_t hash;
+      const char *ptr;
+      int i;
 
-          // check the dirent shortname against the current lossy name (or short name if first around)
+      // FNV-1a over the upper-cased long name, folded to 16 bits
 
-          if(!memcmp(_targetDir.current().Dirent.sdir.DIR_Name,lossyName,11)) {
-            found=true;
-            break;
-          }
-        }
+      hash=2166136261UL ^ salt_;
+
+      for(ptr=_longName;*ptr;ptr++) {
+        hash^=static_cast<uint8_t>(toupper(*ptr));
+        hash*=16777619UL;
       }
 
-      // keep the current find
+      hash=(hash >> 16) ^ (hash & 0xffff);
 
-      memcpy(shortName_,lossyName,11);
-      return true;
+      // two characters of the basis, padded with spaces if it's shorter than that
+
+      memset(hashedName_,' ',8);
+      memcpy(hashedName_+8,shortName_+8,3);
+
+      for(i=0;i<2 && shortName_[i]!=' ';i++)
+        hashedName_[i]=shortName_[i];
+
+      // followed by the hash
+
+      hashedName_[i++]=hexDigits[(hash >> 12) & 0xf];
+      hashedName_[i++]=hexDigits[(hash >> 8) & 0xf];
+      hashedName_[i++]=hexDigits[(hash >> 4) & 0xf];
+      hashedName_[i]=hexDigits[hash & 0xf];
+    }
+
+    /*
+     * If the dirent name is the basis with a ~N tail where N <= tailLimit_ then set bit N in tails_
+     */
+
+    void LongNameDirentGenerator::markTailIfUsed(const uint8_t *direntName_,const char *basis_,uint32_t *tails_,int tailLimit_) const {
+
+      char lossyName[11];
+      int i,end,tailNumber;
+
+      // the tail is at the end of the name part, before the space padding
+
+      for(end=8;end>0 && direntName_[end-1]==' ';end--);
+
+      // scan back over the digits to the tilde. '~' is legal in the basis too so it's the
+      // last one, with only digits after it, that starts the tail.
+
+      for(i=end;i>0 && isdigit(direntName_[i-1]);i--);
+
+      if(i==end || i<2 || direntName_[i-1]!='~')
+        return;
+
+      // parse the digits
+
+      for(tailNumber=0;i<end;i++) {
+        if((tailNumber=tailNumber*10+direntName_[i]-'0')>tailLimit_)
+          return;
+      }
+
+      if(tailNumber==0)
+        return;
+
+      // it's a match if it's exactly what we would generate for this tail
+
+      computeLossyShortName(basis_,lossyName,tailNumber);
+
+      if(!memcmp(lossyName,direntName_,11))
+        tails_[tailNumber/32]|=1UL << (tailNumber%32);
+    }
+
+    /*
+     * Find the lowest tail number that is not in use
+     * @return the tail number or zero if all are taken
+     */
+
+    int LongNameDirentGenerator::findFreeTail(const uint32_t *tails_,int tailLimit_) {
+
+      int tailNumber;
+
+      for(tailNumber=1;tailNumber<=tailLimit_;tailNumber++)
+        if((tails_[tailNumber/32] & (1UL << (tailNumber%32)))==0)
+          return tailNumber;
+
+      return 0;
     }
 
     /*
@@ -19,13 +19,15 @@ namespace stm32plus {
      */
 
     NormalDirectoryEntryIterator::NormalDirectoryEntryIterator(FatFileSystem& fs_,uint32_t firstClusterIndex_,Options options_) :
-      DirectoryEntryIterator(fs_,options_), _iterator(fs_,firstClusterIndex_,ClusterChainIterator::extensionDontExtend) {
+      DirectoryEntryIterator(fs_,options_), _iterator(fs_,firstClusterIndex_,ClusterChainIterator::extensionDontExtend),
+      _cache(fs_,std::min(static_cast<uint32_t>(DirectorySectorCache::DEFAULT_CAPACITY),static_cast<uint32_t>(fs_.getBootSector().BPB_SecPerClus))) {
 
       // force a move to the first sector in next()
 
       _firstClusterIndex=firstClusterIndex_;
       _indexWithinSector=0x10000;
       _currentDirentIndex=-1;
+      _entriesPerSector=fs_.getSectorSizeInBytes()/sizeof(DirectoryEntry);
     }
 
     /*
@@ -36,6 +38,7 @@ namespace stm32plus {
       _iterator.reset(_firstClusterIndex);
       _indexWithinSector=0x10000;
       _currentDirentIndex=-1;
+      _cache.invalidate();
     }
 
     /*
@@ -44,24 +47,26 @@ namespace stm32plus {
 
     bool NormalDirectoryEntryIterator::internalNext() {
 
-      ByteMemblock sector(_fs.getSectorSizeInBytes());
+      uint8_t *sector;
 
       // check if need to move
 
-      if(++_indexWithinSector >= _fs.getBootSector().BPB_BytsPerSec / sizeof(DirectoryEntry)) {
+      if(++_indexWithinSector >= _entriesPerSector) {
         if(!_iterator.next())
           return false;
 
         _indexWithinSector=0;
       }
 
+      // get the sector from the cache. on a miss the rest of the cluster is read ahead
+
+      if((sector=_cache.getSector(_iterator.current(),_iterator.getSectorsRemainingInCluster()))==nullptr)
+        return false;
+
       // copy the current entry out of the sector
 
       DirectoryEntry& dirent=_currentEntry.Dirent;
 
-      if(!_iterator.readSector(sector))
-        return false;
-
       memcpy(&dirent,sector + (_indexWithinSector * sizeof(DirectoryEntry)),sizeof(DirectoryEntry));
       _currentEntry.SectorNumber=_iterator.current();
       _currentEntry.IndexWithinSector=_indexWithinSector;
@@ -78,7 +83,8 @@ namespace stm32plus {
     }
 
     /*
-     * Extend the directory to hold new entries
+     * Extend the directory to hold new entries. The iterator is positioned on the end of the
+     * directory so _currentDirentIndex is the last entry before the end marker.
      */
 
     bool NormalDirectoryEntryIterator::extendDirectory(DirectoryEntry *dirents_,uint32_t direntCount_) {
@@ -87,14 +93,6 @@ namespace stm32plus {
       ByteMemblock sector(_fs.getSectorSizeInBytes());
       void *dest;
 
-      // get the number of entries in this directory
-
-      reset();
-      while(next())
-        ;
-      if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_ITERATOR,Iterator<DirectoryEntryWithLocation>::E_END_OF_ENTRIES))
-        return false;
-
       // get a file sector iterator that extends and move to the sector
 
       FileSectorIterator it(_fs,_firstClusterIndex,ClusterChainIterator::extensionExtend);
@@ -123,7 +121,9 @@ namespace stm32plus {
         else
           memcpy(dest,&dirents_[i],sizeof(DirectoryEntry));
 
-        if(++indexInSector == entriesPerSector) {
+        // don't move on (and maybe extend) after the end marker fills a sector
+
+        if(++indexInSector == entriesPerSector && i < direntCount_) {
 
           // write the completed sector
 
@@ -144,6 +144,10 @@ namespace stm32plus {
       if(indexInSector > 0 && !it.writeSector(sector.getData()))
         return false;
 
+      // the cache may hold the sectors that we just wrote
+
+      _cache.invalidate();
+
       // done
 
       return true;
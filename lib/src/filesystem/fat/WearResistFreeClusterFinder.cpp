@@ -12,13 +12,14 @@ namespace stm32plus {
   namespace fat {
 
     /**
-     * Constructor: generate a random starting index between zero and the number of FAT entries.
+     * Constructor: generate a random starting index between zero and the number of FAT entries
+     * in use. The FAT may be larger than the number of clusters so its size is not the limit.
      *
      * @param[in] fs_ A reference to the fat file system class. Must stay in scope.
      */
 
     WearResistFreeClusterFinder::WearResistFreeClusterFinder(FatFileSystem& fs_) :
-      IteratingFreeClusterFinder(fs_,rand()%(fs_.getSectorsPerFat()*fs_.getSectorSizeInBytes())/fs_.getFatEntrySizeInBytes()) {
+      IteratingFreeClusterFinder(fs_,rand()%(fs_.getCountOfClusters()+2)) {
     }
   }
 }
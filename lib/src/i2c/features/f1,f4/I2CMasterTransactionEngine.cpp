@@ -0,0 +1,562 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+
+#include "config/stm32plus.h"
+
+#if defined(STM32PLUS_F1) || defined(STM32PLUS_F4)
+
+#include "config/i2c.h"
+
+
+namespace stm32plus {
+
+
+  /**
+   * Set the DMA channels to use for the data phase of long transfers
+   * @param dma The DMA channel pair, or nullptr to use interrupts for everything
+   * @param threshold The minimum data phase size, in bytes, that will be moved by DMA. Reads
+   *   of fewer than 2 bytes always use interrupts.
+   */
+
+  void I2CMasterTransactionEngine::setDma(I2CMasterDma *dma,uint16_t threshold) {
+
+    // the DMA features switch on the DMA request when they're constructed. we only want
+    // it on when a transfer is actually using DMA.
+
+    I2C_DMACmd(_peripheral,DISABLE);
+
+    _dma=dma;
+    _dmaThreshold=threshold < 2 ? 2 : threshold;
+  }
+
+
+  /**
+   * Submit a transaction. If the bus is idle then it starts immediately, otherwise it's
+   * appended to the queue. This method does not block.
+   * @param transaction The transaction. It must remain valid until it has completed.
+   * @return false if the transaction is already queued or in progress
+   */
+
+  bool I2CMasterTransactionEngine::submit(I2CTransaction& transaction) {
+
+    IrqSuspend suspender;
+
+    if(transaction.isBusy())
+      return false;
+
+    transaction.next=nullptr;
+    transaction.errorCode=0;
+    transaction.status=I2CTransaction::Status::QUEUED;
+
+    // append to the queue and start it if the bus is ours
+
+    if(_head==nullptr) {
+      _head=_tail=&transaction;
+      startNext();
+    }
+    else {
+      _tail->next=&transaction;
+      _tail=&transaction;
+    }
+
+    return true;
+  }
+
+
+  /**
+   * Start the transaction at the head of the queue. Interrupts must be suspended or we
+   * must be in IRQ context when this is called.
+   */
+
+  void I2CMasterTransactionEngine::startNext() {
+
+    I2CTransaction *t;
+
+    if((t=_head)==nullptr) {
+
+      // nothing left to do, quieten the event interrupts
+
+      _state=State::IDLE;
+      I2C_ITConfig(_peripheral,I2C_IT_EVT | I2C_IT_BUF,DISABLE);
+      return;
+    }
+
+    // the timeout runs from the first attempt to start
+
+    if(_state!=State::STOP_PENDING) {
+      t->status=I2CTransaction::Status::IN_PROGRESS;
+      _startTime=MillisecondTimer::millis();
+    }
+
+    // a STOP from the previous transaction may still be on the bus and CR1 must not be
+    // written until it has gone. There's no interrupt for that so checkTimeout() will
+    // start this transaction when it sees STOP clear.
+
+    if(_peripheral->CR1 & I2C_CR1_STOP) {
+      _state=State::STOP_PENDING;
+      I2C_ITConfig(_peripheral,I2C_IT_EVT | I2C_IT_BUF,DISABLE);
+      return;
+    }
+
+    _writePtr=t->writeData;
+    _readPtr=t->readData;
+
+    // a transaction with no read phase always has a write phase, even if it's empty (a probe)
+
+    if(t->writeCount || !t->readCount) {
+      _remaining=t->writeCount;
+      _state=State::WRITE_START;
+    }
+    else {
+      _remaining=t->readCount;
+      _state=State::READ_START;
+    }
+
+    // the buffer interrupts stay off until the address has been acknowledged. POS may
+    // have been left set by a 2 byte read.
+
+    I2C_NACKPositionConfig(_peripheral,I2C_NACKPosition_Current);
+    I2C_AcknowledgeConfig(_peripheral,ENABLE);
+    I2C_ITConfig(_peripheral,I2C_IT_BUF,DISABLE);
+    I2C_ITConfig(_peripheral,I2C_IT_EVT | I2C_IT_ERR,ENABLE);
+    I2C_GenerateSTART(_peripheral,ENABLE);
+  }
+
+
+  /**
+   * Finish the current transaction, notify the subscribers and move on to the next one
+   * @param status The final status
+   * @param errorCode The error code if status is FAILED
+   */
+
+  void I2CMasterTransactionEngine::complete(I2CTransaction::Status status,uint32_t errorCode) {
+
+    I2CTransaction *t;
+
+    if((t=_head)==nullptr)
+      return;
+
+    // unlink before notifying so the handler can resubmit the transaction
+
+    _head=t->next;
+    if(_head==nullptr)
+      _tail=nullptr;
+
+    _state=State::IDLE;
+
+    t->next=nullptr;
+    t->errorCode=errorCode;
+    t->status=status;
+
+    I2CTransactionCompleteEventSender.raiseEvent(*t);
+
+    // the handler may have submitted something to an empty queue, in which case it's already running
+
+    if(_state==State::IDLE)
+      startNext();
+  }
+
+
+  /**
+   * Abandon the current transaction following an error
+   * @param errorCode The I2C::E_I2C_* error code
+   */
+
+  void I2CMasterTransactionEngine::abort(uint32_t errorCode) {
+
+    // release the bus and make sure DMA is out of the way
+
+    I2C_DMACmd(_peripheral,DISABLE);
+    I2C_DMALastTransferCmd(_peripheral,DISABLE);
+
+    // a STOP would never clear if we've already lost master mode
+
+    if(_peripheral->SR2 & I2C_SR2_MSL)
+      I2C_GenerateSTOP(_peripheral,ENABLE);
+
+    errorProvider.set(ErrorProvider::ERROR_PROVIDER_I2C,errorCode);
+    complete(I2CTransaction::Status::FAILED,errorCode);
+  }
+
+
+  /**
+   * Interrupt notification from the I2C event and error handlers
+   * @param iet The event type
+   */
+
+  void I2CMasterTransactionEngine::onInterrupt(I2CEventType iet) {
+
+    if(_state==State::IDLE || _state==State::STOP_PENDING)
+      return;
+
+    switch(iet) {
+
+      case I2CEventType::EVENT_START_BIT_SENT:
+        onStartBitSent();
+        break;
+
+      case I2CEventType::EVENT_ADDRESS_SENT:
+        onAddressSent();
+        break;
+
+      case I2CEventType::EVENT_READY_TO_TRANSMIT:
+        onReadyToTransmit();
+        break;
+
+      case I2CEventType::EVENT_BYTE_TRANSFER_SENT:
+        onByteTransferFinished();
+        break;
+
+      case I2CEventType::EVENT_RECEIVE:
+        onReceive();
+        break;
+
+      case I2CEventType::EVENT_ACK_FAILURE:
+        abort(I2C::E_I2C_ACK_FAILURE);
+        break;
+
+      case I2CEventType::EVENT_ARBITRATION_LOSS:
+        abort(I2C::E_I2C_ARBITRATION_LOST);
+        break;
+
+      case I2CEventType::EVENT_BUS_ERROR:
+        abort(I2C::E_I2C_BUS_ERROR);
+        break;
+
+      case I2CEventType::EVENT_OVERRUN:
+        abort(I2C::E_I2C_OVERRUN);
+        break;
+
+      case I2CEventType::EVENT_PEC_ERROR:
+        abort(I2C::E_I2C_PEC_ERROR);
+        break;
+
+      case I2CEventType::EVENT_TIMEOUT:
+        abort(I2C::E_I2C_SMBUS_TIMEOUT);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+
+  /**
+   * SB: the (repeated) start has been sent, send the slave address. Writing DR clears SB.
+   */
+
+  void I2CMasterTransactionEngine::onStartBitSent() {
+
+    if(_state==State::WRITE_START) {
+      I2C_Send7bitAddress(_peripheral,_head->slaveAddress,I2C_Direction_Transmitter);
+      _state=State::WRITE_ADDRESS;
+    }
+    else if(_state==State::READ_START) {
+      I2C_Send7bitAddress(_peripheral,_head->slaveAddress,I2C_Direction_Receiver);
+      _state=State::READ_ADDRESS;
+    }
+  }
+
+
+  /**
+   * ADDR: the slave acknowledged its address. SR1 has already been read by the IRQ handler,
+   * reading SR2 clears ADDR. The ACK/STOP/DMA setup for the read phase must happen before
+   * ADDR is cleared. The TXE/RXNE interrupts are switched on here for the phases that are
+   * driven by interrupts. Before now TXE may still be set from the previous write phase.
+   *
+   * Interrupt driven reads follow the reference manual procedures. The ACK bit can only be
+   * changed safely while the clock is stretched with BTF set so the last 2 bytes of a read
+   * (or the last 3 if there are more than 2) are collected on BTF rather than RXNE.
+   */
+
+  void I2CMasterTransactionEngine::onAddressSent() {
+
+    if(_state==State::WRITE_ADDRESS) {
+
+      if(_dma && _remaining>=_dmaThreshold) {
+
+        // DMA feeds DR. we wait for BTF after the last byte so TXE is not wanted.
+
+        I2C_DMACmd(_peripheral,ENABLE);
+        _dma->beginWrite(_writePtr,_remaining);
+
+        _state=State::WRITE_DMA;
+      }
+      else {
+        I2C_ITConfig(_peripheral,I2C_IT_BUF,ENABLE);
+        _state=State::WRITE_DATA;
+      }
+
+      (void)_peripheral->SR2;
+    }
+    else if(_state==State::READ_ADDRESS) {
+
+      if(_dma && _remaining>=_dmaThreshold) {
+
+        // DMA drains DR and the LAST bit makes the peripheral NACK the final byte
+
+        I2C_DMALastTransferCmd(_peripheral,ENABLE);
+        I2C_DMACmd(_peripheral,ENABLE);
+        _dma->beginRead(_readPtr,_remaining);
+
+        _state=State::READ_DMA;
+        (void)_peripheral->SR2;
+      }
+      else if(_remaining==1) {
+
+        // single byte: NACK it and schedule the STOP as soon as ADDR is cleared
+
+        I2C_AcknowledgeConfig(_peripheral,DISABLE);
+        I2C_ITConfig(_peripheral,I2C_IT_BUF,ENABLE);
+        _state=State::READ_DATA;
+
+        (void)_peripheral->SR2;
+        I2C_GenerateSTOP(_peripheral,ENABLE);
+      }
+      else if(_remaining==2) {
+
+        // two bytes: POS moves the NACK onto the second byte. Both bytes are collected
+        // when BTF says the first is in DR and the second is in the shift register.
+
+        I2C_NACKPositionConfig(_peripheral,I2C_NACKPosition_Next);
+        I2C_AcknowledgeConfig(_peripheral,DISABLE);
+        _state=State::READ_LAST2;
+
+        (void)_peripheral->SR2;
+      }
+      else if(_remaining==3) {
+
+        // three bytes: wait for BTF with the first two received
+
+        _state=State::READ_LAST3;
+        (void)_peripheral->SR2;
+      }
+      else {
+        I2C_ITConfig(_peripheral,I2C_IT_BUF,ENABLE);
+        _state=State::READ_DATA;
+        (void)_peripheral->SR2;
+      }
+    }
+  }
+
+
+  /**
+   * TXE: the data register is empty in the write phase
+   */
+
+  void I2CMasterTransactionEngine::onReadyToTransmit() {
+
+    if(_state!=State::WRITE_DATA)
+      return;
+
+    if(_remaining==0) {
+
+      // zero length write, there's nothing for BTF to wait for
+
+      endWritePhase();
+      return;
+    }
+
+    I2C_SendData(_peripheral,*_writePtr++);
+
+    if(--_remaining==0) {
+
+      // last byte is in DR. TXE would fire continuously now so wait for BTF instead
+
+      I2C_ITConfig(_peripheral,I2C_IT_BUF,DISABLE);
+      _state=State::WRITE_LAST;
+    }
+  }
+
+
+  /**
+   * BTF: the last byte of the write phase has left the shift register, or in the read phase
+   * DR and the shift register are both full and the clock is being stretched.
+   */
+
+  void I2CMasterTransactionEngine::onByteTransferFinished() {
+
+    switch(_state) {
+
+      case State::WRITE_LAST:
+        endWritePhase();
+        break;
+
+      case State::WRITE_DMA:
+        I2C_DMACmd(_peripheral,DISABLE);
+        endWritePhase();
+        break;
+
+      case State::READ_LAST3:
+
+        // N-2 is in DR and N-1 in the shift register. NACK the last byte before reading
+        // N-2 releases the clock.
+
+        I2C_AcknowledgeConfig(_peripheral,DISABLE);
+        *_readPtr++=I2C_ReceiveData(_peripheral);
+
+        _remaining=2;
+        _state=State::READ_LAST2;
+        break;
+
+      case State::READ_LAST2:
+
+        // N-1 is in DR and N (already NACKed) is in the shift register
+
+        I2C_GenerateSTOP(_peripheral,ENABLE);
+        *_readPtr++=I2C_ReceiveData(_peripheral);
+        *_readPtr++=I2C_ReceiveData(_peripheral);
+
+        _remaining=0;
+        complete(I2CTransaction::Status::COMPLETE,0);
+        break;
+
+      default:
+        break;
+    }
+  }
+
+
+  /**
+   * The write phase is done. Either do a repeated start into the read phase or stop. TXE
+   * stays set until the repeated start goes out so the buffer interrupts must stay off
+   * until the read address has been acknowledged.
+   */
+
+  void I2CMasterTransactionEngine::endWritePhase() {
+
+    I2C_ITConfig(_peripheral,I2C_IT_BUF,DISABLE);
+
+    if(_head->readCount) {
+      _remaining=_head->readCount;
+      _state=State::READ_START;
+
+      I2C_AcknowledgeConfig(_peripheral,ENABLE);
+      I2C_GenerateSTART(_peripheral,ENABLE);
+    }
+    else {
+      I2C_GenerateSTOP(_peripheral,ENABLE);
+      complete(I2CTransaction::Status::COMPLETE,0);
+    }
+  }
+
+
+  /**
+   * RXNE: a byte has arrived in the read phase. This is used for a single byte read and for
+   * all but the last 3 bytes of a longer one.
+   */
+
+  void I2CMasterTransactionEngine::onReceive() {
+
+    if(_state!=State::READ_DATA)
+      return;
+
+    *_readPtr++=I2C_ReceiveData(_peripheral);
+    _remaining--;
+
+    if(_remaining==3) {
+
+      // the last 3 bytes are collected on BTF
+
+      I2C_ITConfig(_peripheral,I2C_IT_BUF,DISABLE);
+      _state=State::READ_LAST3;
+    }
+    else if(_remaining==0)
+      complete(I2CTransaction::Status::COMPLETE,0);
+  }
+
+
+  /**
+   * Notification from the DMA adapter that a transfer has finished
+   * @param success false if the DMA controller reported an error
+   */
+
+  void I2CMasterTransactionEngine::onDmaComplete(bool success) {
+
+    if(!success) {
+      if(_state==State::WRITE_DMA || _state==State::READ_DMA)
+        abort(I2C::E_I2C_BUS_ERROR);
+      return;
+    }
+
+    // write completion is handled by BTF. read completion is handled here.
+
+    if(_state==State::READ_DMA) {
+
+      I2C_GenerateSTOP(_peripheral,ENABLE);
+      I2C_DMACmd(_peripheral,DISABLE);
+      I2C_DMALastTransferCmd(_peripheral,DISABLE);
+
+      complete(I2CTransaction::Status::COMPLETE,0);
+    }
+  }
+
+
+  /**
+   * Call this periodically from normal code. It starts a queued transaction that was held
+   * back because the previous STOP was still on the bus and it detects a transaction that
+   * has stalled on the bus, e.g. a slave holding SCL low. A stalled transaction is failed
+   * with E_I2C_TIMEOUT, the bus is recovered and the queue moves on.
+   * @return true if a timeout was detected
+   */
+
+  bool I2CMasterTransactionEngine::checkTimeout() {
+
+    IrqSuspend suspender;
+
+    if(_state==State::STOP_PENDING && !(_peripheral->CR1 & I2C_CR1_STOP)) {
+      startNext();
+      return false;
+    }
+
+    if(_head==nullptr || _head->status!=I2CTransaction::Status::IN_PROGRESS)
+      return false;
+
+    if(!MillisecondTimer::hasTimedOut(_startTime,_timeout))
+      return false;
+
+    recoverBus();
+    abort(I2C::E_I2C_TIMEOUT);
+    return true;
+  }
+
+
+  /**
+   * Recover from a bus error or a stuck BUSY flag. A slave that is holding SDA low is clocked
+   * out of its byte with I2C::clearBus() and then the peripheral is reset. The software
+   * reset loses the configuration so the timing and addressing registers are saved and
+   * restored around it. Any transaction in progress will fail.
+   */
+
+  void I2CMasterTransactionEngine::recoverBus() {
+
+    uint16_t cr1,cr2,oar1,oar2,ccr,trise;
+
+    cr1=_peripheral->CR1 & ~(I2C_CR1_START | I2C_CR1_STOP | I2C_CR1_SWRST);
+    cr2=_peripheral->CR2;
+    oar1=_peripheral->OAR1;
+    oar2=_peripheral->OAR2;
+    ccr=_peripheral->CCR;
+    trise=_peripheral->TRISE;
+
+    _i2c.clearBus();
+
+    _peripheral->CR1|=I2C_CR1_SWRST;
+    _peripheral->CR1&=~I2C_CR1_SWRST;
+
+    // CCR and TRISE can only be written while PE is clear
+
+    _peripheral->CR2=cr2;
+    _peripheral->OAR1=oar1;
+    _peripheral->OAR2=oar2;
+    _peripheral->CCR=ccr;
+    _peripheral->TRISE=trise;
+    _peripheral->CR1=cr1;
+  }
+}
+
+#endif
@@ -52,7 +52,9 @@ namespace stm32plus {
 
       // subscribe to send and notify events
 
-      this->NetworkSendEventSender.insertSubscriber(NetworkSendEventSourceSlot::bind(this,&MacBase::onSend));
+      if(!this->NetworkSendEventSender.insertSubscriber(NetworkSendEventSourceSlot::bind(this,&MacBase::onSend)) ||
+         !this->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&MacBase::onNotification)))
+        return false;
 
       // set our MAC address
 
@@ -103,10 +105,143 @@ namespace stm32plus {
       // this is the next one to consider sending
 
       _transmitBufferIndex=0;
+      _transmitsQueued=0;
+
+      // reset the counters and create the latency histograms if they're wanted
+
+      memset(&_statistics,0,sizeof(_statistics));
+
+      if(params.mac_latencyHistograms) {
+        _receiveLatency.reset(new NetLatencyHistogram);
+        _transmitLatency.reset(new NetLatencyHistogram);
+        _transmitTimes.reset(new uint32_t[params.mac_transmitBufferCount]);
+      }
+
+      // hash table bits set up front in the parameters get a permanent reference so that groups
+      // joined and left at runtime can't clear them
+
+      for(i=0;i<64;i++)
+        _multicastHashReferences[i]=((i<32 ? ETH->MACHTLR : ETH->MACHTHR) & (1 << (i & 31)))!=0 ? 1 : 0;
+
       return true;
     }
 
 
+    /**
+     * Notification event from the stack
+     * @param ned The event descriptor
+     */
+
+    void MacBase::onNotification(NetEventDescriptor& ned) {
+
+      if(ned.eventType==NetEventDescriptor::NetEventType::DATALINK_MULTICAST_FILTER) {
+
+        DatalinkMulticastFilterEvent& event=static_cast<DatalinkMulticastFilterEvent&>(ned);
+        updateMulticastFilter(event.macAddress,event.add);
+      }
+    }
+
+
+    /**
+     * Add or remove a multicast address from the hash filter. The hash filter cannot reject
+     * every other address because 64 bits are shared by all the multicast addresses but it's
+     * a lot better than receiving everything. The first address that's added switches the MAC
+     * into hash filtering mode if it was only doing perfect filtering. Perfect filtering
+     * remains active so addresses in the MAC address filters still get through.
+     * @param address The multicast MAC address
+     * @param add true to add, false to remove
+     */
+
+    void MacBase::updateMulticastFilter(const MacAddress& address,bool add) {
+
+      uint8_t index;
+      uint32_t bit;
+      volatile uint32_t *reg;
+
+      index=getMulticastHashIndex(address);
+      bit=1 << (index & 31);
+      reg=index<32 ? &ETH->MACHTLR : &ETH->MACHTHR;
+
+      IrqSuspend suspender;
+
+      if(add) {
+
+        if(_multicastHashReferences[index]++==0)
+          *reg|=bit;
+
+        // pass all multicast (PM) already lets it through, otherwise hash filtering is needed
+
+        if((ETH->MACFFR & (ETH_MulticastFramesFilter_None | ETH_MulticastFramesFilter_HashTable))==0)
+          ETH->MACFFR|=ETH_MulticastFramesFilter_PerfectHashTable;
+      }
+      else if(_multicastHashReferences[index]!=0) {
+
+        if(--_multicastHashReferences[index]==0)
+          *reg&=~bit;
+      }
+    }
+
+
+    /**
+     * Get the hash table bit index for the 6 bytes of a MAC address. This is constexpr so that
+     * known values can be checked at compile time.
+     * @param address The 6 address bytes
+     * @return The bit index, 0..63
+     */
+
+    constexpr uint8_t MacBase::getMulticastHashIndex(const uint8_t *address) {
+
+      // constexpr functions need their variables initialised where they're declared
+
+      uint32_t crc=0xFFFFFFFF;
+      uint8_t i=0,j=0,index=0;
+
+      // the reflected CRC-32 of the address, complemented as the MAC does
+
+      for(i=0;i<6;i++) {
+
+        crc^=address[i];
+
+        for(j=0;j<8;j++)
+          crc=(crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+      }
+
+      crc=~crc;
+
+      // the upper 6 bits of the bit-reversed CRC are the reverse of the lower 6 bits
+
+      for(i=0;i<6;i++)
+        if((crc & (1 << i))!=0)
+          index|=0x20 >> i;
+
+      return index;
+    }
+
+
+    /**
+     * Get the index of the bit in the 64-bit hash table that the MAC will check for this
+     * address. The MAC takes the CRC-32 of the destination address, complements it and
+     * uses the upper 6 bits of the bit-reversed result.
+     * @param address The multicast MAC address
+     * @return The bit index, 0..63. Bits 0..31 are in MACHTLR and 32..63 are in MACHTHR.
+     */
+
+    uint8_t MacBase::getMulticastHashIndex(const MacAddress& address) {
+
+      // known values, the same as Linux computes for this MAC with bitrev32(~crc32_le(~0,addr,6)) >> 26
+
+      static constexpr uint8_t allHostsGroup[6]={ 0x01,0x00,0x5e,0x00,0x00,0x01 };     // 224.0.0.1
+      static constexpr uint8_t mdnsGroup[6]={ 0x01,0x00,0x5e,0x00,0x00,0xfb };         // 224.0.0.251
+      static constexpr uint8_t ssdpGroup[6]={ 0x01,0x00,0x5e,0x7f,0xff,0xfa };         // 239.255.255.250
+
+      static_assert(getMulticastHashIndex(allHostsGroup)==32,"multicast hash index is wrong");
+      static_assert(getMulticastHashIndex(mdnsGroup)==48,"multicast hash index is wrong");
+      static_assert(getMulticastHashIndex(ssdpGroup)==20,"multicast hash index is wrong");
+
+      return getMulticastHashIndex(address.macAddress);
+    }
+
+
     /**
      * Handle the receive DMA interrupt. Set up an EthernetFrame structure and notify observers. If an
      * error occurred, notify of the error
@@ -177,6 +312,7 @@ namespace stm32plus {
 
         // notify the observers of the error
 
+        _statistics.receiveErrors++;
         this->setError(ErrorProvider::ERROR_PROVIDER_NET_MAC,context);
       }
       else {
@@ -198,6 +334,7 @@ namespace stm32plus {
 
             // notify observers of the error (PE = payload, HE= header)
 
+            _statistics.receiveErrors++;
             this->setError(ErrorProvider::ERROR_PROVIDER_NET_MAC,context);
           }
           else {
@@ -218,22 +355,19 @@ namespace stm32plus {
 
             // extended frame with possible flags received
 
-            if(setupEthernetFrame(frame,ef))
-              NetworkReceiveEventSender.raiseEvent(DatalinkFrameEvent(ef));
+            deliverFrame(frame,ef);
           }
         }
         else {
 
           // basic frame with no extended info received OK
 
-          if(setupEthernetFrame(frame,ef))
-            NetworkReceiveEventSender.raiseEvent(DatalinkFrameEvent(ef));
+          deliverFrame(frame,ef);
         }
 #else
         // basic frame with no extended info received OK
 
-        if(setupEthernetFrame(frame,ef))
-          NetworkReceiveEventSender.raiseEvent(DatalinkFrameEvent(ef));
+        deliverFrame(frame,ef);
 #endif
       }
 
@@ -262,6 +396,7 @@ namespace stm32plus {
 
         // clear RBUS ETHERNET DMA flag
 
+        _statistics.receiveBuffersExhausted++;
         ETH->DMASR=ETH_DMASR_RBUS;
 
         // Resume DMA reception
@@ -271,6 +406,32 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Pass a good frame up the stack, timing how long the upper layers take with it if the
+     * latency histograms are enabled
+     * @param fd The incoming frame definition
+     * @param ef The EthernetFrame structure to fill in and send
+     */
+
+    void MacBase::deliverFrame(const FrameTypeDef& fd,EthernetFrame& ef) {
+
+      uint32_t start;
+
+      start=_receiveLatency.get() ? MonotonicTimer::micros() : 0;
+
+      if(!setupEthernetFrame(fd,ef)) {
+        _statistics.framesUnsupported++;
+        return;
+      }
+
+      _statistics.framesReceived++;
+      NetworkReceiveEventSender.raiseEvent(DatalinkFrameEvent(ef));
+
+      if(_receiveLatency.get())
+        _receiveLatency->record(MonotonicTimer::elapsed(start,MonotonicTimer::micros()));
+    }
+
+
     /**
      * Set up the EthernetFrame structure
      * @param fd The incoming frame definition
@@ -380,53 +541,49 @@ namespace stm32plus {
 
     void MacBase::onSend(NetEventDescriptor& ned) {
 
+      // batches of frames have their own handler
+
+      if(ned.eventType==NetEventDescriptor::NetEventType::ETHERNET_BATCH_TRANSMIT_REQUEST) {
+        sendBatch(static_cast<EthernetBatchTransmitRequestEvent&>(ned));
+        return;
+      }
+
       // must be an ethernet send request
 
       if(ned.eventType!=NetEventDescriptor::NetEventType::ETHERNET_TRANSMIT_REQUEST)
         return;
 
       EthernetTransmitRequestEvent& event=static_cast<EthernetTransmitRequestEvent&>(ned);
-      EthernetFrameData *efd;
-
-      // we cannot transmit data out of flash memory because the flash banks are
-      // not connected to the Ethernet DMA bus on the STM32. More's the pity.
-
-      uint32_t ub=reinterpret_cast<uint32_t>(event.networkBuffer->getUserBuffer());
 
-      if(ub && IS_FLASH_ADDRESS(ub)) {
+      if(!prepareFrame(event.networkBuffer,event.macAddress,event.etherType)) {
+        sync_fetch_and_increment(&_statistics.framesDropped);
         delete event.networkBuffer;
-        this->setError(ErrorProvider::ERROR_PROVIDER_NET_MAC,E_NO_FLASH_DATA);
         return;
       }
 
-      // the NetBuffer needs to get an ethernet header
-
-      efd=reinterpret_cast<EthernetFrameData *>(event.networkBuffer->moveWritePointerBack(getDatalinkTransmitHeaderSize()));
-
-      efd->eth_destinationAddress=event.macAddress;
-      efd->eth_sourceAddress=_params.mac_address;
-      efd->eth_etherType=NetUtil::htons(static_cast<uint16_t>(event.etherType));
-
       uint32_t now=MillisecondTimer::millis();
+      bool waited=false;
 
       while(!sendBuffer(event.networkBuffer)) {
 
         if(errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_NET_MAC,E_BUSY)) {
 
+          if(!waited) {
+            sync_fetch_and_increment(&_statistics.transmitBusy);
+            waited=true;
+          }
+
           // DMA still has our TX descriptor. If we're not running in an IRQ context then we
           // can wait to see if it frees up
 
-          if(Nvic::isAnyIrqActive()) {
-            delete event.networkBuffer;
-            return;
-          }
-
-          if(MillisecondTimer::hasTimedOut(now,_params.mac_txWaitMillis)) {
+          if(Nvic::isAnyIrqActive() || MillisecondTimer::hasTimedOut(now,_params.mac_txWaitMillis)) {
+            sync_fetch_and_increment(&_statistics.framesDropped);
             delete event.networkBuffer;
             return;
           }
         }
         else {
+          sync_fetch_and_increment(&_statistics.framesDropped);
           delete event.networkBuffer;
           return;         // other error
         }
@@ -438,6 +595,88 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Send a batch of frames. As many frames as there are free descriptors are queued in one go
+     * and the DMA is kicked once for all of them. If the MAC is busy and we are not in an IRQ
+     * context then we wait for descriptors to free up, giving up if no progress is made for the
+     * configured number of milliseconds. Frames that are not sent are deleted.
+     * @param event The batch event
+     */
+
+    void MacBase::sendBatch(EthernetBatchTransmitRequestEvent& event) {
+
+      uint16_t i,sent;
+      uint32_t now;
+      bool waited;
+
+      for(i=0;i<event.networkBufferCount;i++) {
+
+        if(!prepareFrame(event.networkBuffers[i],event.macAddress,event.etherType))
+          break;
+      }
+
+      now=MillisecondTimer::millis();
+      waited=false;
+
+      while(event.sentCount<i) {
+
+        if((sent=sendBuffers(event.networkBuffers+event.sentCount,i-event.sentCount))!=0) {
+          event.sentCount+=sent;
+          now=MillisecondTimer::millis();
+          waited=false;
+        }
+        else if(!errorProvider.isLastError(ErrorProvider::ERROR_PROVIDER_NET_MAC,E_BUSY) ||
+                Nvic::isAnyIrqActive() ||
+                MillisecondTimer::hasTimedOut(now,_params.mac_txWaitMillis))
+          break;
+        else if(!waited) {
+          sync_fetch_and_increment(&_statistics.transmitBusy);
+          waited=true;
+        }
+      }
+
+      // the frames that were sent will be deleted when the TX interrupt is processed
+
+      event.succeeded=event.sentCount==event.networkBufferCount;
+      sync_fetch_and_add(&_statistics.framesDropped,event.networkBufferCount-event.sentCount);
+
+      for(i=event.sentCount;i<event.networkBufferCount;i++)
+        delete event.networkBuffers[i];
+    }
+
+
+    /**
+     * Check that a frame can be sent and add the ethernet header to it
+     * @param nb The frame
+     * @param macAddress The destination
+     * @param etherType The ethertype
+     * @return true if it can be sent
+     */
+
+    bool MacBase::prepareFrame(NetBuffer *nb,const MacAddress& macAddress,EtherType etherType) {
+
+      EthernetFrameData *efd;
+
+      // we cannot transmit data out of flash memory because the flash banks are
+      // not connected to the Ethernet DMA bus on the STM32. More's the pity.
+
+      uint32_t ub=reinterpret_cast<uint32_t>(nb->getUserBuffer());
+
+      if(ub && IS_FLASH_ADDRESS(ub))
+        return this->setError(ErrorProvider::ERROR_PROVIDER_NET_MAC,E_NO_FLASH_DATA);
+
+      // the NetBuffer needs to get an ethernet header
+
+      efd=reinterpret_cast<EthernetFrameData *>(nb->moveWritePointerBack(getDatalinkTransmitHeaderSize()));
+
+      efd->eth_destinationAddress=macAddress;
+      efd->eth_sourceAddress=_params.mac_address;
+      efd->eth_etherType=NetUtil::htons(static_cast<uint16_t>(etherType));
+
+      return true;
+    }
+
+
     /**
      * Send the content of a NetBuffer via DMA. One NetBuffer contains exactly one frame which may be
      * in one or two buffers. When two buffers are used typically the first buffer contain all the
@@ -454,6 +693,46 @@ namespace stm32plus {
 
       IrqSuspend suspender;
 
+      if(!queueBuffer(nb))
+        return false;
+
+      startTransmit();
+      return true;
+    }
+
+
+    /**
+     * Send several NetBuffers via DMA. They're put into consecutive descriptors until the
+     * descriptors run out and then the DMA is told to poll once.
+     * @param nbs The buffers to send
+     * @param count The number of buffers
+     * @return The number of buffers sent. If this is less than count then the error provider says why.
+     */
+
+    uint16_t MacBase::sendBuffers(NetBuffer **nbs,uint16_t count) {
+
+      uint16_t sent;
+
+      IrqSuspend suspender;
+
+      for(sent=0;sent<count && queueBuffer(nbs[sent]);sent++);
+
+      if(sent)
+        startTransmit();
+
+      return sent;
+    }
+
+
+    /**
+     * Hand a NetBuffer to the next transmit descriptor. The caller must have suspended IRQs
+     * and must call startTransmit() when it has queued its buffers.
+     * @param nb The buffer to send.
+     * @return true if it worked
+     */
+
+    bool MacBase::queueBuffer(NetBuffer *nb) {
+
       // find the next buffer owned by the CPU with NetBuffer == nullptr (TDES0 OWN bit = 0)
       // it's important to consider NetBuffer == nullptr to avoid a race condition with the
       // IRQ handler that cleans up the NetBuffer
@@ -507,6 +786,14 @@ namespace stm32plus {
 
       _transmitNetBuffers[_transmitBufferIndex]=nb;
 
+      if(_transmitTimes.get())
+        _transmitTimes[_transmitBufferIndex]=MonotonicTimer::micros();
+
+      _statistics.framesSent++;
+
+      if(++_transmitsQueued>_statistics.transmitQueueHighWater)
+        _statistics.transmitQueueHighWater=_transmitsQueued;
+
       // move to the next, or back to the first
 
       if(_transmitBufferIndex==_params.mac_transmitBufferCount-1)
@@ -514,16 +801,21 @@ namespace stm32plus {
       else
         _transmitBufferIndex++;
 
-      // trigger DMA to poll for transmit buffers
+      return true;
+    }
+
+
+    /**
+     * Tell the DMA that there are transmit descriptors to process if it has suspended
+     * because it ran out of them
+     */
+
+    void MacBase::startTransmit() {
 
       if((ETH->DMASR & ETH_DMASR_TBUS)!=0) {
         ETH->DMASR=ETH_DMASR_TBUS;
         ETH->DMATPDR=0;               // poll demand register
       }
-
-      // done
-
-      return true;
     }
 
 
@@ -553,6 +845,10 @@ namespace stm32plus {
           // transmitted
 
           nb=_transmitNetBuffers[i];
+
+          if(_transmitLatency.get())
+            _transmitLatency->record(MonotonicTimer::elapsed(_transmitTimes[i],MonotonicTimer::micros()));
+
           this->NetworkNotificationEventSender.raiseEvent(DatalinkFrameSentEvent(*nb));
 
           // if this is the last in a sequence of fragmented packets then there will be a referenced
@@ -567,7 +863,10 @@ namespace stm32plus {
 
           delete _transmitNetBuffers[i];
           _transmitNetBuffers[i]=nullptr;
+          _transmitsQueued--;
         }
+
+        txbuf++;
       }
     }
 
@@ -600,6 +899,7 @@ namespace stm32plus {
       else
         context=E_UNSPECIFIED;
 
+      _statistics.dmaErrors++;
       this->setError(ErrorProvider::ERROR_PROVIDER_NET_MAC,context);
     }
   }
@@ -19,67 +19,77 @@ namespace stm32plus {
      * Calculate the checksum for a UDP packet
      * @param sourceAddress Our IP address
      * @param destinationAddress The destination IP address
-     * @param protocol The internet protocol - which must be UDP for this overload
      * @param nb The netbuffer containing the UDP packet including the header
      */
 
     void InternetChecksum::calculate(const IpAddress& sourceAddress,const IpAddress& destinationAddress,NetBuffer& nb) {
+      calculate(sourceAddress,destinationAddress,IpProtocol::UDP,nb);
+    }
 
-      PseudoHeader ph;
-      uint32_t sum,bufferSize;
-      uint16_t temp;
-      UdpDatagram *datagram;
-      const uint8_t *ptr;
 
-      // the internal buffer is always there and always has the UDP header
+    /**
+     * Calculate the checksum for a UDP, TCP, ICMP or IGMP packet and insert it into the protocol
+     * header. The checksum field is zeroed before the sum is taken so it's safe to call this
+     * more than once for the same packet.
+     * @param sourceAddress Our IP address
+     * @param destinationAddress The destination IP address
+     * @param protocol The internet protocol
+     * @param nb The netbuffer with the write pointer at the start of the protocol header. The
+     *   internal buffer must contain the whole protocol header.
+     * @return false if the protocol does not have a checksum that we know about
+     */
+
+    bool InternetChecksum::calculate(const IpAddress& sourceAddress,const IpAddress& destinationAddress,IpProtocol protocol,NetBuffer& nb) {
 
-      datagram=reinterpret_cast<UdpDatagram *>(nb.getWritePointer());
+      uint32_t sum,bufferSize,userBufferSize;
+      uint16_t temp,*checksum;
+      const uint8_t *ptr;
 
-      // set up the pseudo-header
+      ptr=static_cast<uint8_t *>(nb.getWritePointer());
+      bufferSize=nb.getSizeFromWritePointerToEnd();
+      userBufferSize=nb.getUserBufferSize();
 
-      ph.sourceAddress=sourceAddress;
-      ph.destinationAddress=destinationAddress;
-      ph.zero=0;
-      ph.protocol=IpProtocol::UDP;
-      ph.length=datagram->udp_length;
+      if((checksum=getChecksumField(protocol,nb.getWritePointer(),bufferSize))==nullptr)
+        return false;
 
-      // sum the pseudo-header
+      *checksum=0;
+
+      // sum the pseudo-header. ICMP and IGMP don't have one.
 
       sum=0;
-      sumit(&ph,sizeof(PseudoHeader),sum);
 
-      // sum the internal buffer - the UDP API guarantees that there will be an internal buffer
+      if(hasPseudoHeader(protocol))
+        sumPseudoHeader(sourceAddress,destinationAddress,protocol,bufferSize+userBufferSize,sum);
 
-      ptr=static_cast<uint8_t *>(nb.getWritePointer());
-      bufferSize=nb.getSizeFromWritePointerToEnd();
+      // sum the internal buffer
 
       sumit(ptr,bufferSize & ~1,sum);
 
-      // if there's one left, get it
+      // if there's one left then it pairs up with the first byte of the user buffer
 
       if((bufferSize & 1)!=0) {
 
-        if(nb.getUserBufferSize()) {
+        if(userBufferSize) {
 
           temp=ptr[bufferSize-1];
 
           ptr=static_cast<const uint8_t *>(nb.getUserBuffer());
-          temp=(temp << 8) | *ptr++;
+          temp|=static_cast<uint16_t>(*ptr++) << 8;
 
-          bufferSize=nb.getUserBufferSize()-1;
+          bufferSize=userBufferSize-1;
           sumit(&temp,2,sum);
         }
       }
       else {
-        if(nb.getUserBufferSize()) {
+        if(userBufferSize) {
           ptr=static_cast<const uint8_t *>(nb.getUserBuffer());
-          bufferSize=nb.getUserBufferSize();
+          bufferSize=userBufferSize;
         }
       }
 
       // if there's a user buffer, sum it
 
-      if(nb.getUserBufferSize())
+      if(userBufferSize)
         sumit(ptr,bufferSize & ~1,sum);
 
       // take care of any left over byte
@@ -87,12 +97,202 @@ namespace stm32plus {
       if((bufferSize & 1)!=0)
         sum+=ptr[bufferSize-1];
 
+      // insert the complement into the checksum field. a UDP checksum of zero means
+      // "not calculated" so it's transmitted as all ones.
+
+      temp=~fold(sum);
+
+      if(temp==0 && protocol==IpProtocol::UDP)
+        temp=0xFFFF;
+
+      *checksum=temp;
+      return true;
+    }
+
+
+    /**
+     * Calculate the checksum of an IP header and insert it. The header must not have options.
+     * @param header The IP header
+     */
+
+    void InternetChecksum::calculateHeader(IpPacketHeader& header) {
+
+      uint32_t sum;
+
+      header.ip_hdr_checksum=0;
+
+      sum=0;
+      sumit(&header,IpPacketHeader::getNoOptionsHeaderSize(),sum);
+
+      header.ip_hdr_checksum=~fold(sum);
+    }
+
+
+    /**
+     * Update a checksum after one 16-bit word of the data that it covers has changed, without
+     * summing the data again (RFC 1624, eqn. 3). The values can be in either byte order as long
+     * as they're all in the same one.
+     * @param checksum The checksum as it was before the change
+     * @param oldValue The old value of the word
+     * @param newValue The new value of the word
+     * @return The new checksum
+     */
+
+    uint16_t InternetChecksum::adjust(uint16_t checksum,uint16_t oldValue,uint16_t newValue) {
+
+      uint32_t sum;
+
+      sum=static_cast<uint16_t>(~checksum);
+      sum+=static_cast<uint16_t>(~oldValue);
+      sum+=newValue;
+
+      return ~fold(sum);
+    }
+
+
+    /**
+     * Verify the checksum of a received IP header
+     * @param header The header
+     * @param headerLength The header size including options
+     * @return true if the checksum is correct
+     */
+
+    bool InternetChecksum::verifyHeader(const IpPacketHeader& header,uint16_t headerLength) {
+
+      uint32_t sum;
+
+      sum=0;
+      sumit(&header,headerLength,sum);
+
+      return fold(sum)==0xFFFF;
+    }
+
+
+    /**
+     * Verify the checksum of a received UDP, TCP, ICMP or IGMP packet. Other protocols are
+     * passed as correct because we don't know where their checksum is.
+     * @param sourceAddress The source address from the IP header
+     * @param destinationAddress The destination address from the IP header
+     * @param protocol The protocol from the IP header
+     * @param payload The IP payload
+     * @param length The size of the payload
+     * @return true if the checksum is correct
+     */
+
+    bool InternetChecksum::verify(const IpAddress& sourceAddress,const IpAddress& destinationAddress,IpProtocol protocol,const void *payload,uint16_t length) {
+
+      const uint16_t *checksum;
+      uint32_t sum;
+
+      if((checksum=getChecksumField(protocol,const_cast<void *>(payload),length))==nullptr)
+        return protocol!=IpProtocol::UDP && protocol!=IpProtocol::TCP && protocol!=IpProtocol::ICMP && protocol!=IpProtocol::IGMP;
+
+      // the sender may choose not to calculate a UDP checksum
+
+      if(protocol==IpProtocol::UDP && *checksum==0)
+        return true;
+
+      sum=0;
+
+      if(hasPseudoHeader(protocol))
+        sumPseudoHeader(sourceAddress,destinationAddress,protocol,length,sum);
+
+      sumit(payload,length,sum);
+
+      if((length & 1)!=0)
+        sum+=static_cast<const uint8_t *>(payload)[length-1];
+
+      return fold(sum)==0xFFFF;
+    }
+
+
+    /**
+     * Get the address of the checksum field in a protocol header
+     * @param protocol The protocol
+     * @param protocolHeader The start of the header
+     * @param length The number of bytes available at protocolHeader
+     * @return The checksum field address, or nullptr if the protocol is not known or the header
+     *   is too short to contain the field
+     */
+
+    uint16_t *InternetChecksum::getChecksumField(IpProtocol protocol,void *protocolHeader,uint16_t length) {
+
+      switch(protocol) {
+
+        case IpProtocol::UDP:
+          if(length>=UdpDatagram::getHeaderSize())
+            return &static_cast<UdpDatagram *>(protocolHeader)->udp_checksum;
+          break;
+
+        case IpProtocol::TCP:
+          if(length>=sizeof(TcpHeader))
+            return &static_cast<TcpHeader *>(protocolHeader)->tcp_checksum;
+          break;
+
+        case IpProtocol::ICMP:
+          if(length>=sizeof(IcmpPacket))
+            return &static_cast<IcmpPacket *>(protocolHeader)->icmp_checksum;
+          break;
+
+        case IpProtocol::IGMP:
+          if(length>=sizeof(IgmpPacket))
+            return &static_cast<IgmpPacket *>(protocolHeader)->igmp_checksum;
+          break;
+
+        default:
+          break;
+      }
+
+      return nullptr;
+    }
+
+
+    /**
+     * Check if a protocol includes the pseudo-header in its checksum
+     * @param protocol The protocol
+     * @return true for TCP and UDP
+     */
+
+    bool InternetChecksum::hasPseudoHeader(IpProtocol protocol) {
+      return protocol==IpProtocol::TCP || protocol==IpProtocol::UDP;
+    }
+
+
+    /**
+     * Add the TCP/UDP pseudo-header to a running sum
+     * @param sourceAddress The source IP address
+     * @param destinationAddress The destination IP address
+     * @param protocol The protocol
+     * @param length The length of the protocol header and data
+     * @param[in,out] sum The running total
+     */
+
+    void InternetChecksum::sumPseudoHeader(const IpAddress& sourceAddress,const IpAddress& destinationAddress,IpProtocol protocol,uint16_t length,uint32_t& sum) {
+
+      PseudoHeader ph;
+
+      ph.sourceAddress=sourceAddress;
+      ph.destinationAddress=destinationAddress;
+      ph.zero=0;
+      ph.protocol=protocol;
+      ph.length=NetUtil::htons(length);
+
+      sumit(&ph,sizeof(PseudoHeader),sum);
+    }
+
+
+    /**
+     * Fold a 32-bit running total into a 16-bit one's complement sum
+     * @param sum The running total
+     * @return The folded sum
+     */
+
+    uint16_t InternetChecksum::fold(uint32_t sum) {
+
       while(sum >> 16)
         sum=(sum & 0xFFFF)+(sum >> 16);
 
-      // insert the complement into the datagram checksum
-
-      datagram->udp_checksum=~sum;
+      return sum;
     }
 
 
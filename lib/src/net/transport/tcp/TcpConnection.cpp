@@ -16,22 +16,27 @@ namespace stm32plus {
 
 
     /**
-     * Constructor when creating a connection from an incoming connection to a TcpServer. This is IRQ code.
-     * @param networkUtilityObjects utility objects
-     * @param tcpEvents TCP events
-     * @param segmentEvent The event that triggered the server
-     * @param segmentSizeLimit The MSS limit for this server
-     * @param additionalHeaderSize Number of bytes required for lower layer headers
+     * Initialise a server connection whose handshake has already been completed by the server's
+     * SYN queue. The SYN-ACK has been sent and ACKed so we go straight to ESTABLISHED.
+     * This is IRQ code.
+     * @param networkUtilityObjects The network utility objects
+     * @param tcpEvents The TCP event source
+     * @param halfOpen The handshake state held by the server
+     * @param localPort The server's listening port
+     * @param sendWindow The window advertised in the segment that completed the handshake
+     * @param segmentSizeLimit Our maximum segment size
+     * @param additionalHeaderSize Bytes required for the lower layer headers
+     * @return true if it worked
      */
 
     bool TcpConnection::initialise(NetworkUtilityObjects& networkUtilityObjects,
                                    TcpEvents& tcpEvents,
-                                   TcpSegmentEvent& segmentEvent,
+                                   const TcpHalfOpenConnection& halfOpen,
+                                   uint16_t localPort,
+                                   uint16_t sendWindow,
                                    uint16_t segmentSizeLimit,
                                    uint16_t additionalHeaderSize) {
 
-      const TcpOptionMaximumSegmentSize *mss;
-
       // remember parameters
 
       _networkUtilityObjects=&networkUtilityObjects;
@@ -46,28 +51,21 @@ namespace stm32plus {
 
       // set up the class
 
-      initialise(segmentEvent.ipPacket.header->ip_sourceAddress,
-                 segmentEvent.sourcePort,
-                 segmentEvent.destinationPort);
+      if(!initialise(halfOpen.remoteAddress,halfOpen.remotePort,localPort))
+        return false;
 
-      // pull out the state variables from the remote side
-
-      _state.rxWindow.receiveNext=NetUtil::ntohl(segmentEvent.tcpHeader.tcp_sequenceNumber);
-      _state.txWindow.sendWindow=NetUtil::ntohs(segmentEvent.tcpHeader.tcp_windowSize);
+      // the sequence numbers were chosen by the handshake. both SYNs cost a sequence number.
 
-      // find the MSS option
-
-      if((mss=segmentEvent.tcpHeader.findOption<TcpOptionMaximumSegmentSize>())==nullptr)
-        _remoteMss=536;                 // default from the RFC
-      else
-        _remoteMss=NetUtil::ntohs(mss->tcp_optionMss);
-
-      // this is an incoming client connection to our server. we need to send a SYN-ACK
+      _state.txWindow.sendNext=halfOpen.initialSendSequence+1;
+      _state.txWindow.sendUnacknowledged=_state.txWindow.sendNext;
+      _state.txWindow.sendWindow=sendWindow;
+      _state.rxWindow.receiveNext=halfOpen.initialReceiveSequence+1;
+      _remoteMss=halfOpen.remoteMss;
 
       _state.localPortIsEphemeral=false;
-      _state.changeState(*_networkUtilityObjects,TcpState::SYN_RCVD);
+      _state.changeState(*_networkUtilityObjects,TcpState::ESTABLISHED);
 
-      return sendSynAck();
+      return true;
     }
 
 
@@ -101,7 +99,8 @@ namespace stm32plus {
 
       // set up the class
 
-      initialise(remoteAddress,remotePort,localPort);
+      if(!initialise(remoteAddress,remotePort,localPort))
+        return false;
 
       // no state variables from the remote side yet
 
@@ -147,9 +146,10 @@ namespace stm32plus {
      * @param remoteAddress IP address of the remote end
      * @param remotePort The remote port
      * @param localPort The local port
+     * @return false if the event subscriptions could not be made
      */
 
-    void TcpConnection::initialise(const IpAddress& remoteAddress,uint16_t remotePort,uint16_t localPort) {
+    bool TcpConnection::initialise(const IpAddress& remoteAddress,uint16_t remotePort,uint16_t localPort) {
 
       _state.changeState(*_networkUtilityObjects,TcpState::CLOSED);
       _state.additionalHeaderSize=_additionalHeaderSize;
@@ -175,13 +175,25 @@ namespace stm32plus {
       _state.txWindow.sendUnacknowledged=_state.txWindow.sendNext;
       _state.rxWindow.receiveWindow=_receiveBuffer->availableToWrite();
 
-      // subscribe to notification events
+      // nothing received, nothing to ACK
+
+      _state.pendingDataAck=false;
+      _unackedSegments=0;
+      _advertisedWindow=_state.rxWindow.receiveWindow;
+      memset(&_ackStatistics,0,sizeof(_ackStatistics));
+      memset(&_segmentStatistics,0,sizeof(_segmentStatistics));
+
+      // keep-alive timing starts now
 
-      _networkUtilityObjects->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&TcpConnection::onNotification));
+      _keepAliveIdleTime=_params.tcp_keepAliveIdleTime;
+      _lastReceiveTime=_lastActiveTime;
+      _keepAliveProbesSent=0;
 
-      // subscribe to segment receive events
+      // subscribe to notification and segment receive events. the destructor removes them
+      // so there's nothing to undo if one of them doesn't fit.
 
-      _tcpEvents->TcpReceiveEventSender.insertSubscriber(TcpReceiveEventSourceSlot::bind(this,&TcpConnection::onReceive));
+      return _networkUtilityObjects->NetworkNotificationEventSender.insertSubscriber(NetworkNotificationEventSourceSlot::bind(this,&TcpConnection::onNotification)) &&
+             _tcpEvents->TcpReceiveEventSender.insertSubscriber(TcpReceiveEventSourceSlot::bind(this,&TcpConnection::onReceive));
     }
 
 
@@ -194,6 +206,10 @@ namespace stm32plus {
 
       if(ned.eventType==NetEventDescriptor::NetEventType::TCP_FIND_CONNECTION)
         handleFindConnectionEvent(static_cast<TcpFindConnectionNotificationEvent&>(ned));
+      else if(ned.eventType==NetEventDescriptor::NetEventType::TCP_DELAYED_ACK_TIMER) {
+        checkDelayedAck();
+        checkKeepAlive();
+      }
     }
 
 
@@ -215,6 +231,11 @@ namespace stm32plus {
 
       event.handled=true;
 
+      // the other end is alive, including when this is the answer to a keep-alive probe
+
+      _lastReceiveTime=MillisecondTimer::millis();
+      _keepAliveProbesSent=0;
+
       // see what we've been sent
 
       if(event.tcpHeader.hasRst())
@@ -269,7 +290,7 @@ namespace stm32plus {
       // ACK the FIN so the connection is now half-closed
 
       _state.rxWindow.receiveNext++;
-      _state.sendAck(*_networkUtilityObjects,sillyWindowAvoidance());
+      sendAck();
 
       // notify
 
@@ -285,6 +306,7 @@ namespace stm32plus {
     void TcpConnection::handleIncomingData(const TcpSegmentEvent& event) {
 
       uint32_t rxnext;
+      bool ackNow;
 
       // we've become active
 
@@ -295,6 +317,7 @@ namespace stm32plus {
       // lost or been overtaken on the network. the sender will have to resend.
 
       rxnext=NetUtil::ntohl(event.tcpHeader.tcp_sequenceNumber);
+      ackNow=true;
 
       if(rxnext==_state.rxWindow.receiveNext) {
 
@@ -311,12 +334,21 @@ namespace stm32plus {
 
           _state.rxWindow.receiveNext+=event.payloadLength;
           _state.rxWindow.receiveWindow=_receiveBuffer->availableToWrite();
+
+          _ackStatistics.segmentsReceived++;
+          ackNow=!delayAck();
         }
+        else
+          _segmentStatistics.bufferFullDropped++;
       }
+      else
+        _segmentStatistics.outOfOrderDropped++;
 
-      // ack the current state
+      // ack the current state. out of order segments and window probes are always ACK'd immediately
+      // so that the sender finds out as soon as possible.
 
-      _state.sendAck(*_networkUtilityObjects,sillyWindowAvoidance());
+      if(ackNow)
+        sendAck();
 
       // notify if there is some data to read
 
@@ -355,8 +387,10 @@ namespace stm32plus {
         // if the ACK has no data and did not move the window then re-ack our current state
         // possibly opening our window
 
-        if(!hasData)
-          _state.sendAck(*_networkUtilityObjects,sillyWindowAvoidance());
+        if(!hasData) {
+          _segmentStatistics.duplicateAcks++;
+          sendAck();
+        }
       }
     }
 
@@ -398,66 +432,131 @@ namespace stm32plus {
 
       // ACK their SYN-ACK
 
-      _state.sendAck(*_networkUtilityObjects,sillyWindowAvoidance());
+      sendAck();
     }
 
 
     /**
-     * Send a SYN segment to the server. This segment has no data. It contains the SYN flag plus our receive buffer
-     * size and the MSS option.
-     * @return true if it was sent
+     * Decide whether the ACK for an in-order data segment can be delayed. Following RFC 1122 we ACK
+     * at least every tcp_delayedAckSegments segments and never hold an ACK for longer than
+     * tcp_delayedAckTimeout. We also ACK immediately if the window is closing because the sender
+     * needs to know that before it can do anything useful.
+     *
+     * This is IRQ code.
+     *
+     * @return true if the ACK has been delayed, false if it must be sent now.
      */
 
-    bool TcpConnection::sendSyn() {
+    bool TcpConnection::delayAck() {
 
-      // create a NetBuffer to hold the SYN segment
+      if(_params.tcp_delayedAckTimeout==0 ||
+         ++_unackedSegments>=_params.tcp_delayedAckSegments ||
+         !receiveWindowCanBeOpened())
+        return false;
 
-      NetBuffer *nb=new NetBuffer(_additionalHeaderSize+TcpHeader::getNoOptionsHeaderSize(),4);
+      // start the timer on the first segment that we're holding
 
-      // set up MSS (maximum segment size) option
+      if(!_state.pendingDataAck) {
+        _state.pendingDataAck=true;
+        _delayedAckTime=MillisecondTimer::millis();
+      }
 
-      TcpOptionMaximumSegmentSize *mssOption=reinterpret_cast<TcpOptionMaximumSegmentSize *>(nb->moveWritePointerBack(4));
-      mssOption->initialise(_segmentSizeLimit);
+      _ackStatistics.acksDelayed++;
+      return true;
+    }
 
-      // construct the header
 
-      TcpHeader *header=reinterpret_cast<TcpHeader *>(nb->moveWritePointerBack(TcpHeader::getNoOptionsHeaderSize()));
+    /**
+     * Send an ACK for everything received so far, advertising the current window. Any delayed
+     * ACK is cancelled because this one covers it.
+     *
+     * Must be called from IRQ code or with IRQs suspended.
+     */
 
-      // we're acking the SYN, which costs the sender 1 sequence number
+    void TcpConnection::sendAck() {
 
-      header->initialise(_state.localPort,                          // ports
-                         _state.remotePort,
-                         _state.txWindow.sendNext,                  // initial sequence number
-                         0,                                         // nothing to ACK
-                         getReceiveBufferSpaceAvailable(),          // data space available
-                         TcpHeaderFlags::SYN);
+      _advertisedWindow=sillyWindowAvoidance();
+      _state.pendingDataAck=false;
+      _unackedSegments=0;
+      _ackStatistics.acksSent++;
 
-      // this header is larger than the minimum
+      _state.sendAck(*_networkUtilityObjects,_advertisedWindow);
+    }
 
-      header->setSize(TcpHeader::getNoOptionsHeaderSize()+TcpOptionMaximumSegmentSize::getSize());
 
-      // ask the IP layer to send the packet
+    /**
+     * Send the delayed ACK if it's been held for longer than tcp_delayedAckTimeout. This is called
+     * while send() and receive() are waiting, from Tcp::tcpCheckTimers() and by the TCP module once a
+     * second. Call Tcp::tcpCheckTimers() from your main loop to keep the ACKs close to the timeout.
+     */
 
-      IpTransmitRequestEvent iptre(
-          nb,
-          _state.remoteAddress,
-          IpProtocol::TCP);
+    void TcpConnection::checkDelayedAck() {
 
-      _networkUtilityObjects->NetworkSendEventSender.raiseEvent(iptre);
-      return iptre.succeeded;
+      IrqSuspend suspender;
+
+      if(_state.pendingDataAck && MillisecondTimer::hasTimedOut(_delayedAckTime,_params.tcp_delayedAckTimeout))
+        sendAck();
     }
 
 
     /**
-     * Send a SYN-ACK segment back to our client. This segment has no data. It contains the SYN
-     * and ACK flags plus our receive buffer size and the MSS option.
-     * @return true if it worked
+     * Send a keep-alive probe if we have not heard from the other end for the keep-alive idle time,
+     * and then every tcp_keepAliveInterval until it answers. If tcp_keepAliveProbes go unanswered then
+     * the other end has gone away without telling us and the connection is reset. Probes are only
+     * sent when there is no unacknowledged data because the resend logic is already waiting for an
+     * answer in that case. This is called from Tcp::tcpCheckTimers() and by the TCP module once a second,
+     * which is IRQ code.
      */
 
-    bool TcpConnection::sendSynAck() {
+    void TcpConnection::checkKeepAlive() {
 
-      // create a NetBuffer to hold the SYN-ACK segment. we're dealing with an incoming
-      // SYN segment from an IRQ
+      if(_keepAliveIdleTime==0 || _state.state!=TcpState::ESTABLISHED)
+        return;
+
+      if(_state.txWindow.sendUnacknowledged!=_state.txWindow.sendNext)
+        return;
+
+      if(_keepAliveProbesSent==0) {
+
+        // has the connection been idle long enough to need a probe?
+
+        if(!MillisecondTimer::hasTimedOut(_lastReceiveTime,_keepAliveIdleTime))
+          return;
+      }
+      else {
+
+        // wait for the answer to the last probe
+
+        if(!MillisecondTimer::hasTimedOut(_lastKeepAliveTime,_params.tcp_keepAliveInterval))
+          return;
+
+        // if we've run out of probes then the other end is dead. the connection is closed
+        // so that we stop probing and the pool will not hand it out again.
+
+        if(_keepAliveProbesSent>=_params.tcp_keepAliveProbes) {
+          _state.sendRstAck(*_networkUtilityObjects,0);
+          _state.changeState(*_networkUtilityObjects,TcpState::CLOSED);
+          TcpConnectionClosedEventSender.raiseEvent(TcpConnectionClosedEvent(*this));
+          return;
+        }
+      }
+
+      _keepAliveProbesSent++;
+      _lastKeepAliveTime=MillisecondTimer::millis();
+
+      _state.sendKeepAlive(*_networkUtilityObjects,_advertisedWindow);
+    }
+
+
+    /**
+     * Send a SYN segment to the server. This segment has no data. It contains the SYN flag plus our receive buffer
+     * size and the MSS option.
+     * @return true if it was sent
+     */
+
+    bool TcpConnection::sendSyn() {
+
+      // create a NetBuffer to hold the SYN segment
 
       NetBuffer *nb=new NetBuffer(_additionalHeaderSize+TcpHeader::getNoOptionsHeaderSize(),4);
 
@@ -472,29 +571,23 @@ namespace stm32plus {
 
       // we're acking the SYN, which costs the sender 1 sequence number
 
-      _state.rxWindow.receiveNext++;
-
       header->initialise(_state.localPort,                          // ports
                          _state.remotePort,
                          _state.txWindow.sendNext,                  // initial sequence number
-                         _state.rxWindow.receiveNext,               // ack the SYN (the SYN consumes a sequence number)
+                         0,                                         // nothing to ACK
                          getReceiveBufferSpaceAvailable(),          // data space available
-                         TcpHeaderFlags::SYN | TcpHeaderFlags::ACK);
+                         TcpHeaderFlags::SYN);
 
       // this header is larger than the minimum
 
       header->setSize(TcpHeader::getNoOptionsHeaderSize()+TcpOptionMaximumSegmentSize::getSize());
 
-      // increment our sequence number
-
-      _state.txWindow.sendNext++;
-
       // ask the IP layer to send the packet
 
       IpTransmitRequestEvent iptre(
-            nb,
-            _state.remoteAddress,
-            IpProtocol::TCP);
+          nb,
+          _state.remoteAddress,
+          IpProtocol::TCP);
 
       _networkUtilityObjects->NetworkSendEventSender.raiseEvent(iptre);
       return iptre.succeeded;
@@ -627,6 +720,19 @@ namespace stm32plus {
 
           if(batchpos+tosend>=_state.txWindow.sendUnacknowledged) {
 
+            // if there's more than one segment left in this batch then send them all in one request
+
+            if(_params.tcp_largeSend && batchremaining>tosend) {
+
+              if(!sendSegments(reinterpret_cast<const uint8_t *>(data)+batchbufpos,batchremaining,batchpos,tosend,headerFlags))
+                return false;
+
+              batchpos+=batchremaining;
+              batchbufpos+=batchremaining;
+              batchremaining=0;
+              break;
+            }
+
             // create a netbuffer for the user data - only the header space is alloc'd. the user data
             // is transmitted in-place.
 
@@ -638,13 +744,7 @@ namespace stm32plus {
             // create the header
 
             TcpHeader *header=reinterpret_cast<TcpHeader *>(nb->moveWritePointerBack(TcpHeader::getNoOptionsHeaderSize()));
-
-            header->initialise(_state.localPort,
-                               _state.remotePort,
-                                batchpos,                       // where we are sending from
-                                _state.rxWindow.receiveNext,    //  ack up to receiveNext
-                                _state.rxWindow.receiveWindow,  // current window size
-                                headerFlags);                   // always ACK
+            initialiseDataHeader(*header,batchpos,headerFlags);
 
             // ask the IP layer to send the packet
 
@@ -656,6 +756,8 @@ namespace stm32plus {
             _networkUtilityObjects->NetworkSendEventSender.raiseEvent(iptre);
             if(!iptre.succeeded)
               return false;
+
+            sync_fetch_and_increment(&_segmentStatistics.segmentsSent);
           }
 
           // update the sequence number (batchpos) and the user buffer position (batchbufpos)
@@ -682,10 +784,14 @@ namespace stm32plus {
           // check for resend timeout for this batch
 
           if(MillisecondTimer::hasTimedOut(startwait,resendtimeout)) {
+            _segmentStatistics.retransmitTimeouts++;
             resend=true;
             resendtimeout=std::min(_params.tcp_maxResendDelay,resendtimeout*2);
             break;
           }
+
+          checkDelayedAck();
+          TaskScheduler::yield();
         }
 
         // if we're not about to go into a resend of this batch then update the batch position
@@ -710,6 +816,73 @@ namespace stm32plus {
     }
 
 
+    /**
+     * Fill in the header for a data segment. The segment carries any ACK that we've been delaying
+     * so the receive side must not change underneath us while we fill it in.
+     * @param header The header to fill in
+     * @param sequenceNumber The sequence number of the first byte in the segment
+     * @param flags The header flags
+     */
+
+    void TcpConnection::initialiseDataHeader(TcpHeader& header,uint32_t sequenceNumber,TcpHeaderFlags flags) {
+
+      uint16_t window;
+
+      IrqSuspend suspender;
+
+      window=_state.rxWindow.receiveWindow;
+
+      header.initialise(_state.localPort,
+                        _state.remotePort,
+                        sequenceNumber,                 // where we are sending from
+                        _state.rxWindow.receiveNext,    //  ack up to receiveNext
+                        window,                         // current window size
+                        flags);                         // always ACK
+
+      if(_state.pendingDataAck)
+        sync_fetch_and_increment(&_ackStatistics.acksPiggybacked);
+
+      _state.pendingDataAck=false;
+      _unackedSegments=0;
+      _advertisedWindow=window;
+    }
+
+
+    /**
+     * Send several segments of data in one request to the IP layer. The IP layer builds each
+     * segment's headers from one template header instead of each segment being passed down the
+     * stack on its own.
+     * @param data The data to send
+     * @param dataSize The amount of data
+     * @param sequenceNumber The sequence number of the first byte
+     * @param segmentSize The maximum amount of data in each segment
+     * @param flags The header flags
+     * @return true if all the segments were sent
+     */
+
+    bool TcpConnection::sendSegments(const uint8_t *data,uint32_t dataSize,uint32_t sequenceNumber,uint16_t segmentSize,TcpHeaderFlags flags) {
+
+      TcpHeader header;
+
+      initialiseDataHeader(header,sequenceNumber,flags);
+
+      IpLargeSendRequestEvent iplsre(
+            _state.remoteAddress,
+            IpProtocol::TCP,
+            &header,
+            TcpHeader::getNoOptionsHeaderSize(),
+            offsetof(TcpHeader,tcp_sequenceNumber),
+            data,
+            dataSize,
+            segmentSize);
+
+      _networkUtilityObjects->NetworkSendEventSender.raiseEvent(iplsre);
+
+      sync_fetch_and_add(&_segmentStatistics.segmentsSent,iplsre.segmentsSent);
+      return iplsre.succeeded;
+    }
+
+
     /**
      * Receive some data from the remote client. If the timeout is zero then this is a blocking call that will
      * not return until success, the other end closes, or a network error occurs. actuallyReceived will be filled
@@ -789,11 +962,15 @@ namespace stm32plus {
 
               return _networkUtilityObjects->setError(ErrorProvider::ERROR_PROVIDER_NET_TCP_CONNECTION,E_TIMED_OUT);
             }
+
+            checkDelayedAck();
+            TaskScheduler::yield();
           }
         }
       }
 
-      // if we've got some data then we can check if a currently-closed receive window can be opened
+      // if we've got some data then we can check if the window we last advertised can be opened. the
+      // update is only sent if it's grown by enough to be worth it or there's an ACK waiting to go.
 
       if(actuallyReceived) {
 
@@ -801,12 +978,16 @@ namespace stm32plus {
 
         IrqSuspend suspender;
 
-        // if the receive window is closed and we can now open it then do so
+        if((_receiveWindowIsClosed && receiveWindowCanBeOpened()) ||
+           _state.rxWindow.receiveWindow-_advertisedWindow>=getWindowUpdateThreshold()) {
+
+          if(!_state.pendingDataAck)
+            _ackStatistics.windowUpdates++;
 
-        if(_receiveWindowIsClosed && receiveWindowCanBeOpened()) {
-          _receiveWindowIsClosed=false;
-          _state.sendAck(*_networkUtilityObjects,sillyWindowAvoidance());
+          sendAck();
         }
+        else
+          checkDelayedAck();
       }
 
       // finished
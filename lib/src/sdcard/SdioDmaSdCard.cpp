@@ -17,7 +17,8 @@ namespace stm32plus {
    * Constructor
    */
 
-  SdioDmaSdCard::SdioDmaSdCard(bool autoInitialise) {
+  SdioDmaSdCard::SdioDmaSdCard(bool autoInitialise)
+    : _transferBusy(false) {
 
     // subscribe to the SDIO and DMA events
 
@@ -95,6 +96,8 @@ namespace stm32plus {
 
   bool SdioDmaSdCard::readBlock(void *dest,uint32_t blockIndex) {
 
+    TransferOwner owner(*this);
+
     _dmaFinished=_sdioFinished=false;
 
     // enable the relevant interrupts
@@ -134,6 +137,8 @@ namespace stm32plus {
 
   bool SdioDmaSdCard::readBlocks(void *dest,uint32_t blockIndex,uint32_t numBlocks) {
 
+    TransferOwner owner(*this);
+
     _dmaFinished=_sdioFinished=false;
 
     // enable the relevant interrupts
@@ -171,6 +176,8 @@ namespace stm32plus {
 
   bool SdioDmaSdCard::writeBlock(const void *src,uint32_t blockIndex) {
 
+    TransferOwner owner(*this);
+
     _dmaFinished=_sdioFinished=false;
 
     // enable the relevant interrupts
@@ -210,6 +217,8 @@ namespace stm32plus {
 
   bool SdioDmaSdCard::writeBlocks(const void *src,uint32_t blockIndex,uint32_t numBlocks) {
 
+    TransferOwner owner(*this);
+
     _dmaFinished=_sdioFinished=false;
 
     // enable the relevant interrupts
@@ -245,10 +254,14 @@ namespace stm32plus {
 
   bool SdioDmaSdCard::waitForTransfer() const {
 
-    // first wait for the SDIO interrupt
+    // first wait for the SDIO interrupt. Other tasks may run while we wait but they can't
+    // start a transfer of their own until this one has released the card.
+
+    while(!_sdioFinished)
+      TaskScheduler::yield();
 
-    while(!_sdioFinished);
-    while(!_dmaFinished);
+    while(!_dmaFinished)
+      TaskScheduler::yield();
 
     // clear static flags
 
@@ -13,15 +13,39 @@ namespace stm32plus {
   /**
    * Constructor.
    * @param[in] initialSize The size to allocate.
-   * @param[in] resizeAmount The amount to increase allocation by when new space needed
+   * @param[in] resizeAmount The minimum amount to increase allocation by when new space needed
+   * @param[in] maxResizeAmount The maximum amount to increase allocation by when new space needed
    */
 
-  ByteArrayOutputStream::ByteArrayOutputStream(uint32_t initialSize,uint32_t resizeAmount)
+  ByteArrayOutputStream::ByteArrayOutputStream(uint32_t initialSize,uint32_t resizeAmount,uint32_t maxResizeAmount)
     : _memblock(initialSize) {
 
     _currentUsage=0;
     _initialSize=initialSize;
     _resizeAmount=resizeAmount;
+    _maxResizeAmount=std::max(resizeAmount,maxResizeAmount);
+  }
+
+
+  /**
+   * Ensure that the buffer can hold at least the given number of bytes without
+   * further reallocation.
+   * @param[in] capacity The number of bytes
+   */
+
+  void ByteArrayOutputStream::reserve(uint32_t capacity) {
+    if(capacity>_memblock.getSize())
+      _memblock.reallocate(capacity,_currentUsage);
+  }
+
+
+  /**
+   * get the number of bytes that can be written before the buffer must grow
+   * @return The allocated size of the buffer
+   */
+
+  uint32_t ByteArrayOutputStream::getCapacity() const {
+    return _memblock.getSize();
   }
 
 
@@ -71,14 +95,16 @@ namespace stm32plus {
 
   bool ByteArrayOutputStream::write(const void *buffer,uint32_t size) {
 
-    uint32_t newSize;
+    uint32_t newSize,increment;
 
     if(_currentUsage+size>_memblock.getSize()) {
 
-      // more space needed: reallocate to the required amount plus margin
+      // more space needed: grow by the current size, bounded by the min/max increments
+
+      increment=std::min(std::max(_memblock.getSize(),_resizeAmount),_maxResizeAmount);
+      newSize=std::max(_memblock.getSize()+increment,_currentUsage+size);
 
-      newSize=_currentUsage+size+_resizeAmount;
-      _memblock.reallocate(newSize);
+      _memblock.reallocate(newSize,_currentUsage);
     }
 
     memcpy(_memblock.getData()+_currentUsage,buffer,size);
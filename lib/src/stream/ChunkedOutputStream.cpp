@@ -0,0 +1,181 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/stream.h"
+
+
+namespace stm32plus {
+
+  /**
+   * Constructor. Nothing is allocated until the first write.
+   * @param[in] chunkSize The size of the first chunk
+   * @param[in] maxChunkSize The largest size that chunks will grow to
+   */
+
+  ChunkedOutputStream::ChunkedOutputStream(uint32_t chunkSize,uint32_t maxChunkSize)
+    : _first(nullptr),
+      _last(nullptr),
+      _size(0),
+      _chunkCount(0),
+      _nextChunkSize(chunkSize),
+      _chunkSize(chunkSize),
+      _maxChunkSize(std::max(chunkSize,maxChunkSize)) {
+  }
+
+
+  /**
+   * Destructor, free the chunks
+   */
+
+  ChunkedOutputStream::~ChunkedOutputStream() {
+    clear();
+  }
+
+
+  /**
+   * Free all the chunks and go back to the initial state
+   */
+
+  void ChunkedOutputStream::clear() {
+
+    Chunk *chunk,*next;
+
+    for(chunk=_first;chunk;chunk=next) {
+      next=chunk->next;
+      delete [] reinterpret_cast<uint8_t *>(chunk);
+    }
+
+    _first=_last=nullptr;
+    _size=0;
+    _chunkCount=0;
+    _nextChunkSize=_chunkSize;
+  }
+
+
+  /**
+   * Link a new chunk on to the end of the list
+   * @param[in] minimumSize The chunk must be at least this big
+   */
+
+  void ChunkedOutputStream::addChunk(uint32_t minimumSize) {
+
+    uint32_t capacity;
+    uint8_t *memory;
+    Chunk *chunk;
+
+    capacity=std::max(_nextChunkSize,minimumSize);
+
+    memory=new uint8_t[sizeof(Chunk)+capacity];
+    chunk=reinterpret_cast<Chunk *>(memory);
+    chunk->next=nullptr;
+    chunk->size=0;
+    chunk->capacity=capacity;
+
+    if(_last)
+      _last->next=chunk;
+    else
+      _first=chunk;
+
+    _last=chunk;
+    _chunkCount++;
+
+    // grow geometrically up to the limit
+
+    if(_nextChunkSize<_maxChunkSize)
+      _nextChunkSize=std::min(_nextChunkSize*2,_maxChunkSize);
+  }
+
+
+  /**
+   * Write a byte
+   * @param[in] c The byte to write
+   * @return true
+   */
+
+  bool ChunkedOutputStream::write(uint8_t c) {
+    return write(&c,1);
+  }
+
+
+  /**
+   * Write a buffer. The last chunk is filled and then one new chunk is added if there's more.
+   * @param[in] buffer The data to write
+   * @param[in] size The number of bytes to write
+   * @return true
+   */
+
+  bool ChunkedOutputStream::write(const void *buffer,uint32_t size) {
+
+    const uint8_t *ptr;
+    uint32_t count;
+
+    ptr=static_cast<const uint8_t *>(buffer);
+
+    // top up the current chunk
+
+    if(_last && _last->size<_last->capacity) {
+
+      count=std::min(size,_last->capacity-_last->size);
+      memcpy(_last->data()+_last->size,ptr,count);
+
+      _last->size+=count;
+      _size+=count;
+      ptr+=count;
+      size-=count;
+    }
+
+    if(size==0)
+      return true;
+
+    // the remainder goes in a single new chunk
+
+    addChunk(size);
+    memcpy(_last->data(),ptr,size);
+    _last->size=size;
+    _size+=size;
+
+    return true;
+  }
+
+
+  /**
+   * Copy all the chunks to another stream, in order
+   * @param[in] os The stream to write to
+   * @return false if the write fails
+   */
+
+  bool ChunkedOutputStream::writeTo(OutputStream& os) const {
+
+    const Chunk *chunk;
+
+    for(chunk=_first;chunk;chunk=chunk->next)
+      if(chunk->size && !os.write(chunk->data(),chunk->size))
+        return false;
+
+    return true;
+  }
+
+
+  /**
+   * Close does nothing, the data remains available
+   * @return true
+   */
+
+  bool ChunkedOutputStream::close() {
+    return true;
+  }
+
+
+  /**
+   * Flush does nothing
+   * @return true
+   */
+
+  bool ChunkedOutputStream::flush() {
+    return true;
+  }
+}
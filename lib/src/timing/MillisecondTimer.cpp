@@ -13,6 +13,7 @@ namespace stm32plus {
 
 
   volatile uint32_t MillisecondTimer::_counter;
+  volatile uint32_t MillisecondTimer::_counterHigh;
 
 
   /**
@@ -21,6 +22,7 @@ namespace stm32plus {
 
   void MillisecondTimer::initialise() {
     _counter=0;
+    _counterHigh=0;
     SysTick_Config(SystemCoreClock / 1000);
   }
 
@@ -41,11 +43,13 @@ namespace stm32plus {
 
 
 /**
- * SysTick interrupt handler
+ * SysTick interrupt handler. If you replace this then you must maintain _counterHigh as
+ * well as _counter for MonotonicTimer to keep counting past 49 days.
  */
 
 extern "C" {
   void __attribute__ ((weak,interrupt("IRQ"))) SysTick_Handler(void) {
-    stm32plus::MillisecondTimer::_counter++;
+    if(++stm32plus::MillisecondTimer::_counter==0)
+      stm32plus::MillisecondTimer::_counterHigh++;
   }
 }
@@ -0,0 +1,66 @@
+/*
+ * This file is a part of the open source stm32plus library.
+ * Copyright (c) 2011,2012,2013,2014 Andy Brown <www.andybrown.me.uk>
+ * Please see website for licensing terms.
+ */
+
+#include "config/stm32plus.h"
+#include "config/timing.h"
+
+
+namespace stm32plus {
+
+
+  /**
+   * Initialise the clock. The microsecond clock needs nothing more than MillisecondTimer. On the
+   * M3/M4 this enables the DWT cycle counter.
+   */
+
+  void MonotonicTimer::initialise() {
+
+#if !defined(STM32PLUS_F0)
+    *reinterpret_cast<volatile uint32_t *>(DEBUG_DEMCR)|=DEBUG_DEMCR_TRCENA;
+    *reinterpret_cast<volatile uint32_t *>(DWT_CYCCNT)=0;
+    *reinterpret_cast<volatile uint32_t *>(DWT_CTRL)|=DWT_CTRL_CYCCNTENA;
+#endif
+  }
+
+
+  /**
+   * Get the microseconds since MillisecondTimer was initialised. Safe to call from IRQ
+   * context, including IRQs that pre-empt SysTick.
+   * @return The monotonic time in microseconds
+   */
+
+  uint64_t MonotonicTimer::micros() {
+
+    uint32_t low,high,before,value,reload;
+    uint64_t millis;
+    bool pending;
+
+    reload=SysTick->LOAD;
+
+    // sample the counters until the millisecond count is stable around the down-counter reads.
+    // the down-counter is read before and after the pending flag.
+
+    do {
+      high=MillisecondTimer::_counterHigh;
+      low=MillisecondTimer::_counter;
+      before=SysTick->VAL;
+      pending=(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)!=0;
+      value=SysTick->VAL;
+    } while(low!=MillisecondTimer::_counter || high!=MillisecondTimer::_counterHigh);
+
+    millis=(static_cast<uint64_t>(high) << 32) | low;
+
+    // if SysTick can't run (we're in a higher priority IRQ or interrupts are off) then the
+    // millisecond count is one behind after a reload. A pending SysTick means the reload came
+    // before the second down-counter read however long it's been pending. A second read that's
+    // higher than the first means the reload came just after the flag was read.
+
+    if(pending || value>before)
+      millis++;
+
+    return millis*1000+((reload-value)*1000)/(reload+1);
+  }
+}